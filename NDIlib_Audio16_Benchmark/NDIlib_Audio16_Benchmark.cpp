@@ -0,0 +1,222 @@
+#include <csignal>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <Processing.NDI.Lib.h>
+
+#include "../NDIlib_Common/NDIlib_Audio.h"
+#include "../NDIlib_Common/NDIlib_Benchmark.h"
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#define strcasecmp _stricmp
+#else
+#include <strings.h>
+#endif
+
+// A micro-benchmark of converting NDI's planar float audio to interleaved 16-bit samples, comparing
+// NDIlib_util_audio_to_interleaved_16s_v2 with ndi_audio::to_int16 using each instruction set, and with TPDF dither.
+// Each conversion is timed on its own, and is displayed as a share of the time that the frame lasts for.
+//		-channels 2,4,8,16,32,64	The numbers of channels to run (default those).
+//		-samples <n>				The number of samples in a frame (default 1602, a 29.97Hz frame at 48kHz).
+//		-reference_level <dB>		How many dB above +4dBU the full 16-bit range is (default 20).
+// along with the -warmup, -duration, -json, -csv and -quiet options of the other benchmarks. Each run is 1 second
+// unless -duration is given.
+
+static std::atomic<bool> exit_loop(false);
+static void sigint_handler(int)
+{
+	exit_loop = true;
+}
+
+// The ways of converting that are compared
+struct method_t {
+	std::string name;
+	bool use_sdk;
+	ndi_audio::simd_e simd;
+	bool use_dither;
+};
+
+int main(int argc, char* argv[])
+{
+	// Not required, but "correct" (see the SDK documentation).
+	if (!NDIlib_initialize()) {
+		printf("Cannot run NDI.");
+		return 0;
+	}
+
+	// Catch interrupt so that we can shut down gracefully
+	signal(SIGINT, sigint_handler);
+
+	// The settings
+	ndi_benchmark::options bench_options;
+	bench_options.m_warmup_seconds = 0.25;
+	bench_options.parse(argc, argv);
+
+	std::vector<int> channel_counts;
+	int no_samples = 1602, reference_level = 20;
+	for (int i = 1; i < argc - 1; i++) {
+		if (strcasecmp(argv[i], "-channels") == 0) {
+			for (const char* p_list = argv[i + 1]; *p_list;) {
+				const int no_channels = atoi(p_list);
+				if (no_channels > 0)
+					channel_counts.push_back(no_channels);
+				const char* p_comma = strchr(p_list, ',');
+				p_list = p_comma ? p_comma + 1 : p_list + strlen(p_list);
+			}
+		} else if (strcasecmp(argv[i], "-samples") == 0) {
+			no_samples = std::max(1, atoi(argv[i + 1]));
+		} else if (strcasecmp(argv[i], "-reference_level") == 0) {
+			reference_level = atoi(argv[i + 1]);
+		}
+	}
+	if (channel_counts.empty())
+		channel_counts = { 2, 4, 8, 16, 32, 64 };
+
+	// Each conversion is a short run, and the results of each are appended to the CSV file as they are made. The JSON
+	// file is written with all of them at the end.
+	ndi_benchmark::options run_options = bench_options;
+	if (run_options.m_duration_seconds <= 0.0)
+		run_options.m_duration_seconds = 1.0;
+	run_options.m_json_filename.clear();
+	run_options.m_quiet = true;
+
+	// The methods that this CPU can run
+	const ndi_audio::simd_e best_simd = ndi_audio::detect_simd();
+	std::vector<method_t> methods;
+	methods.push_back(method_t{ "NDI SDK", true, ndi_audio::simd_scalar, false });
+	for (int simd = ndi_audio::simd_scalar; simd <= best_simd; simd++)
+		methods.push_back(method_t{ ndi_audio::simd_name((ndi_audio::simd_e)simd), false, (ndi_audio::simd_e)simd, false });
+	methods.push_back(method_t{ std::string(ndi_audio::simd_name(best_simd)) + " + dither", false, best_simd, true });
+
+	// The time that a frame lasts for at 48kHz
+	const int sample_rate = 48000;
+	const double frame_us = 1e6 * no_samples / sample_rate;
+
+	// The results for the JSON file
+	struct result_t {
+		int no_channels;
+		std::string method;
+		double mean_us, p99_us;
+		int max_diff;
+	};
+	std::vector<result_t> all_results;
+
+	for (const int no_channels : channel_counts) {
+		if (exit_loop)
+			break;
+
+		// A tone on each channel at a different frequency and level, the loudest of which are clipped at the default
+		// reference level
+		std::vector<float> src((size_t)no_samples * no_channels);
+		for (int ch = 0; ch < no_channels; ch++) {
+			const float amplitude = 12.0f * (float)(ch + 1) / (float)no_channels;
+			const double step = 2.0 * 3.14159265358979 * 220.0 * (ch + 1) / sample_rate;
+			for (int i = 0; i < no_samples; i++)
+				src[(size_t)ch * no_samples + i] = amplitude * (float)sin(step * i);
+		}
+
+		NDIlib_audio_frame_v2_t audio_frame(sample_rate, no_channels, no_samples);
+		audio_frame.p_data = src.data();
+		audio_frame.channel_stride_in_bytes = no_samples * (int)sizeof(float);
+
+		std::vector<int16_t> dst_sdk((size_t)no_samples * no_channels), dst((size_t)no_samples * no_channels);
+		ndi_audio::tpdf_dither dither;
+
+		printf("\n%d channels of %d samples   mean us   p99 us   ns/sample   frame budget   speed-up   output\n", no_channels, no_samples);
+
+		double sdk_mean_us = 0.0;
+		for (const method_t& method : methods) {
+			if (exit_loop)
+				break;
+
+			ndi_benchmark::session bench("NDIlib_Audio16_Benchmark", run_options);
+			bench.set("no_channels", no_channels);
+			bench.set("no_samples", no_samples);
+			bench.set("reference_level", reference_level);
+			bench.set("method", method.name);
+
+			NDIlib_audio_frame_interleaved_16s_t frame_16s;
+			frame_16s.reference_level = reference_level;
+			frame_16s.p_data = method.use_sdk ? dst_sdk.data() : dst.data();
+
+			while (!exit_loop && bench.running()) {
+				bench.begin_call();
+				if (method.use_sdk) {
+					NDIlib_util_audio_to_interleaved_16s_v2(&audio_frame, &frame_16s);
+				} else {
+					const float* p_dither = method.use_dither ? dither.generate(no_channels, no_samples, method.simd) : NULL;
+					ndi_audio::to_int16(src.data(), audio_frame.channel_stride_in_bytes, no_channels, no_samples, dst.data(),
+						reference_level, p_dither, method.simd);
+				}
+				bench.end_call();
+			}
+
+			// Compare with the SDK, which without dither should be the same or within rounding of it
+			int max_diff = 0;
+			if (!method.use_sdk) {
+				for (size_t i = 0; i < dst.size(); i++)
+					max_diff = std::max(max_diff, abs((int)dst[i] - (int)dst_sdk[i]));
+			}
+
+			const ndi_benchmark::results& results = bench.get_results();
+			const double mean_us = results.m_call_ns.mean() * 1e-3;
+			const double p99_us = (double)results.m_call_ns.percentile(99.0) * 1e-3;
+			if (method.use_sdk)
+				sdk_mean_us = mean_us;
+
+			char output[64];
+			if (method.use_sdk)
+				snprintf(output, sizeof(output), "reference");
+			else if (!max_diff)
+				snprintf(output, sizeof(output), "matches");
+			else
+				snprintf(output, sizeof(output), "within %d", max_diff);
+
+			printf("  %-30s %8.2f %8.2f %11.3f %13.2f%% %9.1fx   %s\n", method.name.c_str(), mean_us, p99_us,
+				1e3 * mean_us / ((double)no_samples * no_channels), 100.0 * mean_us / frame_us,
+				(mean_us > 0.0) ? sdk_mean_us / mean_us : 0.0, output);
+
+			bench.set("max_diff_from_sdk", max_diff);
+			if (!run_options.m_csv_filename.empty())
+				bench.write_csv(run_options.m_csv_filename);
+
+			all_results.push_back(result_t{ no_channels, method.name, mean_us, p99_us, max_diff });
+		}
+	}
+
+	// Write the results as JSON
+	if (!bench_options.m_json_filename.empty()) {
+		const bool to_stdout = (bench_options.m_json_filename == "-");
+		FILE* p_file = to_stdout ? stdout : fopen(bench_options.m_json_filename.c_str(), "w");
+		if (p_file) {
+			fprintf(p_file, "{\n  \"benchmark\": \"NDIlib_Audio16_Benchmark\",\n  \"ndi_version\": \"%s\",\n  \"no_samples\": %d,\n  \"reference_level\": %d,\n  \"results\": [",
+				NDIlib_version(), no_samples, reference_level);
+			for (size_t i = 0; i < all_results.size(); i++) {
+				const result_t& result = all_results[i];
+				fprintf(p_file, "%s\n    { \"no_channels\": %d, \"method\": \"%s\", \"mean_us\": %.3f, \"p99_us\": %.3f, \"max_diff_from_sdk\": %d }",
+					i ? "," : "", result.no_channels, result.method.c_str(), result.mean_us, result.p99_us, result.max_diff);
+			}
+			fprintf(p_file, "\n  ]\n}\n");
+
+			if (!to_stdout)
+				fclose(p_file);
+		}
+	}
+
+	// Not required, but nice
+	NDIlib_destroy();
+
+	// Success
+	return 0;
+}
@@ -0,0 +1,332 @@
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Processing.NDI.Lib.h>
+
+#include "../NDIlib_Common/NDIlib_Audio.h"
+#include "../NDIlib_Send_VirtualPTZ/rapidxml/rapidxml.hpp"
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#define strcasecmp _stricmp
+#else
+#include <strings.h>
+#endif // _WIN32
+
+// This mixes the audio of any number of NDI sources into a single NDI source, which is what a small audio desk does.
+//
+// Every input is received through a frame-sync. For each frame of the mix, the same number of samples is taken from
+// every input at the same moment, so all of the inputs end up on the mix's clock whatever clocks their sources are on,
+// and a source that goes away is just silence. Each input has a gain, a mute and a pan, which are applied as its channels
+// are added into the mix with AVX2 or SSE4.1 (see NDIlib_Audio.h). The mix is sent with NDI clocking the audio, which is
+// what paces the whole loop.
+//
+// On a stereo mix, a mono input is panned with a constant power pan law, and an input with more channels has its even
+// channels mixed to the left and its odd channels to the right, with the pan as a balance between them. On a mix that
+// is not stereo, channel n of each input is mixed to channel n of the mix (wrapping around), and the pan is not used.
+//
+// The gain, mute and pan of an input can be changed while the mix is running by sending metadata to the mix, such as
+//		<ndi_mixer input="2" gain="-6" mute="false" pan="-0.5"/>
+// where the inputs are numbered from 1, in the order that they were given.
+//		NDIlib_AudioMixer -input <source> [input options] [-input <source> [input options] ...] [options]
+//		-input <source>						An NDI source to mix, which can be followed by these options for it :
+//			-gain <dB>						The gain of the input, up to +24 (default 0).
+//			-pan <-1 to 1>					Where the input sits between the left (-1) and right (1) (default 0).
+//			-mute							Start with the input muted.
+//		-name <name>						The name of the mix (default "Audio Mix").
+//		-channels <n>						The number of channels in the mix (default 2).
+//		-rate <Hz>							The sample rate of the mix (default 48000).
+//		-frame <ms>							The length of each frame of the mix (default 10).
+
+static std::atomic<bool> exit_loop(false);
+static void sigint_handler(int)
+{
+	exit_loop = true;
+}
+
+// Helper to convert from dB to a ratio
+static float dB_to_ratio(float dB)
+{
+	return powf(10.0f, dB / 20.0f);
+}
+
+// Helper to read a gain in dB, from silence (-inf) up to +24dB, so that a large gain cannot overflow the mix
+static float parse_gain_dB(const char* p_value)
+{
+	const float dB = (float)atof(p_value);
+	return (dB != dB) ? 0.0f : std::min(24.0f, dB);
+}
+
+// Helper to display a level in dB
+static float ratio_to_dB(float ratio)
+{
+	return (ratio > 0.0f) ? 20.0f * log10f(ratio) : -INFINITY;
+}
+
+// An input to the mix.
+struct input_t {
+	explicit input_t(const std::string& source)
+		: m_source(source), m_gain_dB(0.0f), m_pan(0.0f), m_mute(false), m_pNDI_recv(NULL), m_pNDI_framesync(NULL), m_peak(0.0f)
+	{
+	}
+
+	~input_t(void)
+	{
+		// Stop the frame-sync and the receiver.
+		if (m_pNDI_framesync)
+			NDIlib_framesync_destroy(m_pNDI_framesync);
+		if (m_pNDI_recv)
+			NDIlib_recv_destroy(m_pNDI_recv);
+	}
+
+	// Start receiving the source.
+	bool create(void)
+	{
+		NDIlib_recv_create_v3_t recv_desc;
+		recv_desc.source_to_connect_to.p_ndi_name = m_source.c_str();
+		recv_desc.bandwidth = NDIlib_recv_bandwidth_audio_only;
+		recv_desc.p_ndi_recv_name = "Example Audio Mixer";
+		m_pNDI_recv = NDIlib_recv_create_v3(&recv_desc);
+		m_pNDI_framesync = m_pNDI_recv ? NDIlib_framesync_create(m_pNDI_recv) : NULL;
+		return m_pNDI_framesync != NULL;
+	}
+
+	// The gains to the left and right of a stereo mix for a channel of this input.
+	void stereo_gains(const int no_channels, const int channel, float& left, float& right) const
+	{
+		const float gain = m_mute ? 0.0f : dB_to_ratio(m_gain_dB);
+		const float pan = std::max(-1.0f, std::min(1.0f, m_pan));
+		if (no_channels == 1) {
+			// Constant power, so a mono input is 3dB down on each side in the middle
+			const float angle = (pan + 1.0f) * 0.25f * 3.14159265f;
+			left = gain * cosf(angle);
+			right = gain * sinf(angle);
+		} else {
+			// A balance, which only turns the other side down
+			left = (channel & 1) ? 0.0f : gain * std::min(1.0f, 1.0f - pan);
+			right = (channel & 1) ? gain * std::min(1.0f, 1.0f + pan) : 0.0f;
+		}
+	}
+
+	// Add this input's audio into the mix.
+	void mix(const NDIlib_audio_frame_v2_t& audio_frame, float* p_mix, const int no_mix_channels, const int no_samples, const ndi_audio::simd_e simd)
+	{
+		const int mix_stride = no_samples;
+		for (int ch = 0; ch < audio_frame.no_channels; ch++) {
+			const float* p_src = (const float*)((const uint8_t*)audio_frame.p_data + (size_t)ch * audio_frame.channel_stride_in_bytes);
+
+			// The level meter is before the gain and the mute
+			m_peak = std::max(m_peak, ndi_audio::peak(p_src, no_samples, simd));
+			if (m_mute)
+				continue;
+
+			if (no_mix_channels == 2) {
+				float left, right;
+				stereo_gains(audio_frame.no_channels, ch, left, right);
+				if (left != 0.0f)
+					ndi_audio::mix(p_src, no_samples, p_mix, left, simd);
+				if (right != 0.0f)
+					ndi_audio::mix(p_src, no_samples, p_mix + mix_stride, right, simd);
+			} else {
+				ndi_audio::mix(p_src, no_samples, p_mix + (ch % no_mix_channels) * mix_stride, dB_to_ratio(m_gain_dB), simd);
+			}
+		}
+	}
+
+	// The settings
+	const std::string m_source;
+	float m_gain_dB;
+	float m_pan;
+	bool m_mute;
+
+	// The receiver
+	NDIlib_recv_instance_t m_pNDI_recv;
+	NDIlib_framesync_instance_t m_pNDI_framesync;
+
+	// The highest level since it was last displayed
+	float m_peak;
+
+private:
+	input_t(const input_t&);
+	input_t& operator=(const input_t&);
+};
+
+// Change the settings of an input from metadata sent to the mix, returning whether it was for us.
+static bool apply_metadata(const char* p_data, std::vector<std::unique_ptr<input_t>>& inputs)
+{
+	try {
+		// Parse the XML
+		std::string xml(p_data);
+		rapidxml::xml_document<char> parser;
+		parser.parse<0>((char*)xml.data());
+
+		// Is it for us ?
+		rapidxml::xml_node<char>* p_node = parser.first_node();
+		if (!p_node || (p_node->type() != rapidxml::node_element) || strcasecmp(p_node->name(), "ndi_mixer"))
+			return false;
+
+		// Which input is it for ?
+		const rapidxml::xml_attribute<char>* p_input = p_node->first_attribute("input");
+		const int input_no = p_input ? atoi(p_input->value()) : 0;
+		if ((input_no < 1) || (input_no > (int)inputs.size()))
+			return false;
+		input_t& input = *inputs[input_no - 1];
+
+		// Get the values that are there
+		const rapidxml::xml_attribute<char>* p_gain = p_node->first_attribute("gain");
+		const rapidxml::xml_attribute<char>* p_mute = p_node->first_attribute("mute");
+		const rapidxml::xml_attribute<char>* p_pan = p_node->first_attribute("pan");
+		if (p_gain)
+			input.m_gain_dB = parse_gain_dB(p_gain->value());
+		if (p_mute)
+			input.m_mute = (strcasecmp(p_mute->value(), "true") == 0);
+		if (p_pan)
+			input.m_pan = std::max(-1.0f, std::min(1.0f, (float)atof(p_pan->value())));
+
+		// Display what just happened
+		printf("Input %d (%s) : gain %1.1fdB, pan %1.2f%s\n", input_no, input.m_source.c_str(), input.m_gain_dB, input.m_pan, input.m_mute ? ", muted" : "");
+		return true;
+	} catch (...) {
+		return false;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	// The settings
+	std::vector<std::unique_ptr<input_t>> inputs;
+	const char* p_ndi_name = "Audio Mix";
+	int no_channels = 2, sample_rate = 48000, frame_ms = 10;
+	for (int i = 1; i < argc; i++) {
+		const bool has_value = (i < argc - 1);
+		if ((strcasecmp(argv[i], "-input") == 0) && has_value)
+			inputs.push_back(std::unique_ptr<input_t>(new input_t(argv[++i])));
+		else if ((strcasecmp(argv[i], "-gain") == 0) && has_value && !inputs.empty())
+			inputs.back()->m_gain_dB = parse_gain_dB(argv[++i]);
+		else if ((strcasecmp(argv[i], "-pan") == 0) && has_value && !inputs.empty())
+			inputs.back()->m_pan = std::max(-1.0f, std::min(1.0f, (float)atof(argv[++i])));
+		else if ((strcasecmp(argv[i], "-mute") == 0) && !inputs.empty())
+			inputs.back()->m_mute = true;
+		else if ((strcasecmp(argv[i], "-name") == 0) && has_value)
+			p_ndi_name = argv[++i];
+		else if ((strcasecmp(argv[i], "-channels") == 0) && has_value)
+			no_channels = std::max(1, atoi(argv[++i]));
+		else if ((strcasecmp(argv[i], "-rate") == 0) && has_value)
+			sample_rate = std::max(8000, atoi(argv[++i]));
+		else if ((strcasecmp(argv[i], "-frame") == 0) && has_value)
+			frame_ms = std::max(1, atoi(argv[++i]));
+		else
+			printf("Unknown option %s.\n", argv[i]);
+	}
+
+	// Bail if there is nothing to mix.
+	if (inputs.empty()) {
+		printf("Usage : NDIlib_AudioMixer -input <source> [-gain <dB>] [-pan <-1 to 1>] [-mute] [-input ...] [-name <name>]\n");
+		printf("        [-channels <n>] [-rate <Hz>] [-frame <ms>]\n");
+		return 0;
+	}
+
+	// Not required, but "correct" (see the SDK documentation).
+	if (!NDIlib_initialize()) {
+		printf("Cannot run NDI.");
+		return 0;
+	}
+
+	// Catch interrupt so that we can shut down gracefully
+	signal(SIGINT, sigint_handler);
+
+	// Start receiving the inputs
+	for (size_t i = 0; i < inputs.size(); i++) {
+		if (!inputs[i]->create()) {
+			printf("Cannot receive %s.\n", inputs[i]->m_source.c_str());
+			return 0;
+		}
+		printf("Input %d : %s, gain %1.1fdB, pan %1.2f%s\n", (int)i + 1, inputs[i]->m_source.c_str(), inputs[i]->m_gain_dB, inputs[i]->m_pan, inputs[i]->m_mute ? ", muted" : "");
+	}
+
+	// We create the NDI sender, with NDI clocking the audio so that the mix goes out in real time.
+	NDIlib_send_create_t NDI_send_create_desc;
+	NDI_send_create_desc.p_ndi_name = p_ndi_name;
+	NDI_send_create_desc.clock_video = false;
+	NDI_send_create_desc.clock_audio = true;
+	NDIlib_send_instance_t pNDI_send = NDIlib_send_create(&NDI_send_create_desc);
+	if (!pNDI_send)
+		return 0;
+
+	// The mix
+	const int no_samples = std::max(1, sample_rate * frame_ms / 1000);
+	std::vector<float> mix((size_t)no_channels * no_samples);
+	NDIlib_audio_frame_v2_t mix_frame;
+	mix_frame.sample_rate = sample_rate;
+	mix_frame.no_channels = no_channels;
+	mix_frame.no_samples = no_samples;
+	mix_frame.p_data = mix.data();
+	mix_frame.channel_stride_in_bytes = no_samples * (int)sizeof(float);
+
+	const ndi_audio::simd_e simd = ndi_audio::detect_simd();
+	printf("Mixing %d inputs to %s, %d channels at %dHz in frames of %d samples (%s).\n", (int)inputs.size(), p_ndi_name, no_channels,
+		sample_rate, no_samples, ndi_audio::simd_name(simd));
+
+	using namespace std::chrono;
+	auto last_display = steady_clock::now();
+	float mix_peak = 0.0f;
+	while (!exit_loop) {
+		std::fill(mix.begin(), mix.end(), 0.0f);
+
+		// Take a frame's worth of audio from every input, at the mix's rate, and add it in
+		for (auto& p_input : inputs) {
+			NDIlib_audio_frame_v2_t audio_frame;
+			NDIlib_framesync_capture_audio(p_input->m_pNDI_framesync, &audio_frame, sample_rate, 0, no_samples);
+			if (audio_frame.p_data && (audio_frame.no_samples == no_samples))
+				p_input->mix(audio_frame, mix.data(), no_channels, no_samples, simd);
+			NDIlib_framesync_free_audio(p_input->m_pNDI_framesync, &audio_frame);
+		}
+
+		for (int ch = 0; ch < no_channels; ch++)
+			mix_peak = std::max(mix_peak, ndi_audio::peak(mix.data() + (size_t)ch * no_samples, no_samples, simd));
+
+		// Send the mix, which waits until it is time for it
+		NDIlib_send_send_audio_v2(pNDI_send, &mix_frame);
+
+		// Pick up any changes to the inputs
+		NDIlib_metadata_frame_t metadata;
+		while (NDIlib_send_capture(pNDI_send, &metadata, 0) == NDIlib_frame_type_metadata) {
+			apply_metadata(metadata.p_data, inputs);
+			NDIlib_send_free_metadata(pNDI_send, &metadata);
+		}
+
+		// Display the levels once a second
+		if (steady_clock::now() - last_display >= seconds(1)) {
+			printf("Mix %1.1fdB", ratio_to_dB(mix_peak));
+			for (size_t i = 0; i < inputs.size(); i++) {
+				printf(" | %d %1.1fdB%s", (int)i + 1, ratio_to_dB(inputs[i]->m_peak), inputs[i]->m_mute ? " (muted)" : "");
+				inputs[i]->m_peak = 0.0f;
+			}
+			printf("\n");
+			mix_peak = 0.0f;
+			last_display = steady_clock::now();
+		}
+	}
+
+	// Destroy the NDI sender and the inputs
+	NDIlib_send_destroy(pNDI_send);
+	inputs.clear();
+
+	// Not required, but nice
+	NDIlib_destroy();
+
+	// Success
+	return 0;
+}
@@ -0,0 +1,724 @@
+#pragma once
+
+// Audio sample kernels for the examples that move audio between a sound card and NDI. These run on the sound card's
+// own thread, so none of them allocate memory or take locks, and the work that a real-time callback does is done in a
+// single pass over the samples :
+//		deinterleave	Interleaved 32-bit float samples to NDI's planar layout, with a gain applied on the way.
+//		interleave		The other way around, NDI's planar layout to interleaved samples, with a gain.
+//		mix				Add a channel to a bus with a gain, which is what a mixer does for every input channel.
+//		peak			The largest absolute sample value, for level meters.
+//		to_int16		NDI's planar layout to interleaved 16-bit samples at a reference level, with optional dither.
+//
+// There is also a ring buffer of interleaved samples for passing audio between a sound card's thread and a thread that
+// talks to NDI, which neither side ever waits on, and a source of TPDF dither noise for to_int16.
+//
+// The kernels use AVX2 or SSE4.1 when the CPU supports them (selected at run-time, with a scalar fallback). Each
+// output sample is exactly one multiply of one input sample (and one add for mix and for dither), so every path gives
+// bit identical results.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "NDIlib_Content.h"
+
+namespace ndi_audio {
+
+// The instruction sets are the same as the content generator's
+using ndi_content::simd_e;
+using ndi_content::simd_scalar;
+using ndi_content::simd_sse41;
+using ndi_content::simd_avx2;
+using ndi_content::simd_name;
+using ndi_content::detect_simd;
+
+namespace detail {
+
+// Samples [from, to) of channels [ch_from, ch_to)
+inline void deinterleave_scalar(const float* p_src, const int no_channels, const int ch_from, const int ch_to,
+	const int from, const int to, float* p_dst, const size_t channel_stride, const float gain)
+{
+	for (int ch = ch_from; ch < ch_to; ch++) {
+		const float* p_src_ch = p_src + ch;
+		float* p_dst_ch = p_dst + ch * channel_stride;
+		for (int i = from; i < to; i++)
+			p_dst_ch[i] = p_src_ch[(size_t)i * no_channels] * gain;
+	}
+}
+
+inline void interleave_scalar(const float* p_src, const size_t channel_stride, const int ch_from, const int ch_to,
+	const int from, const int to, float* p_dst, const int no_channels, const float gain)
+{
+	for (int ch = ch_from; ch < ch_to; ch++) {
+		const float* p_src_ch = p_src + ch * channel_stride;
+		float* p_dst_ch = p_dst + ch;
+		for (int i = from; i < to; i++)
+			p_dst_ch[(size_t)i * no_channels] = p_src_ch[i] * gain;
+	}
+}
+
+// The 16-bit value of samples [from, to) of channels [ch_from, ch_to). The dither is added after the clamp, which keeps
+// the compiler from fusing the multiply and the add (the SIMD code does not), and the result is saturated afterwards.
+inline void to_int16_scalar(const float* p_src, const size_t channel_stride, const int ch_from, const int ch_to,
+	const int from, const int to, int16_t* p_dst, const int no_channels, const float scale, const float* p_dither, const size_t dither_stride)
+{
+	for (int ch = ch_from; ch < ch_to; ch++) {
+		const float* p_src_ch = p_src + ch * channel_stride;
+		const float* p_dither_ch = p_dither ? p_dither + ch * dither_stride : NULL;
+		int16_t* p_dst_ch = p_dst + ch;
+		for (int i = from; i < to; i++) {
+			float value = std::max(-32768.0f, std::min(32767.0f, p_src_ch[i] * scale));
+			if (p_dither_ch)
+				value += p_dither_ch[i];
+			p_dst_ch[(size_t)i * no_channels] = (int16_t)std::max(-32768L, std::min(32767L, lrintf(value)));
+		}
+	}
+}
+
+// Eight lanes of xorshift32 turned into TPDF noise, by adding the two 16-bit halves of each value.
+inline void dither_scalar(uint32_t* p_state, float* p_dst)
+{
+	for (int lane = 0; lane < 8; lane++) {
+		uint32_t x = p_state[lane];
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		p_state[lane] = x;
+		p_dst[lane] = (float)(int)((x >> 16) + (x & 0xFFFF)) * (1.0f / 65536.0f) - 1.0f;
+	}
+}
+
+#ifdef NDI_CONTENT_X86
+
+// Returns the number of samples that were done, the caller does the rest.
+NDI_CONTENT_TARGET_SSE41 inline int deinterleave_mono_sse41(const float* p_src, const int no_samples, float* p_dst, const float gain)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	int i = 0;
+	for (; i + 4 <= no_samples; i += 4)
+		_mm_storeu_ps(p_dst + i, _mm_mul_ps(_mm_loadu_ps(p_src + i), g));
+	return i;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int deinterleave_stereo_sse41(const float* p_src, const int no_samples, float* p_dst, const size_t channel_stride, const float gain)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	float* p_dst_l = p_dst;
+	float* p_dst_r = p_dst + channel_stride;
+	int i = 0;
+	for (; i + 4 <= no_samples; i += 4) {
+		// L0 R0 L1 R1 and L2 R2 L3 R3
+		const __m128 a = _mm_loadu_ps(p_src + 2 * i);
+		const __m128 b = _mm_loadu_ps(p_src + 2 * i + 4);
+		_mm_storeu_ps(p_dst_l + i, _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), g));
+		_mm_storeu_ps(p_dst_r + i, _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)), g));
+	}
+	return i;
+}
+
+// Groups of four channels are transposed four samples at a time, so this handles any multiple of four channels.
+NDI_CONTENT_TARGET_SSE41 inline int deinterleave_quad_sse41(const float* p_src, const int no_channels, const int no_samples, float* p_dst, const size_t channel_stride, const float gain)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	int i = 0;
+	for (; i + 4 <= no_samples; i += 4) {
+		const float* p_row = p_src + (size_t)i * no_channels;
+		for (int ch = 0; ch < no_channels; ch += 4) {
+			__m128 s0 = _mm_loadu_ps(p_row + ch);
+			__m128 s1 = _mm_loadu_ps(p_row + ch + no_channels);
+			__m128 s2 = _mm_loadu_ps(p_row + ch + 2 * no_channels);
+			__m128 s3 = _mm_loadu_ps(p_row + ch + 3 * no_channels);
+			_MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+			float* p_dst_ch = p_dst + ch * channel_stride + i;
+			_mm_storeu_ps(p_dst_ch, _mm_mul_ps(s0, g));
+			_mm_storeu_ps(p_dst_ch + channel_stride, _mm_mul_ps(s1, g));
+			_mm_storeu_ps(p_dst_ch + 2 * channel_stride, _mm_mul_ps(s2, g));
+			_mm_storeu_ps(p_dst_ch + 3 * channel_stride, _mm_mul_ps(s3, g));
+		}
+	}
+	return i;
+}
+
+NDI_CONTENT_TARGET_AVX2 inline int deinterleave_mono_avx2(const float* p_src, const int no_samples, float* p_dst, const float gain)
+{
+	const __m256 g = _mm256_set1_ps(gain);
+	int i = 0;
+	for (; i + 8 <= no_samples; i += 8)
+		_mm256_storeu_ps(p_dst + i, _mm256_mul_ps(_mm256_loadu_ps(p_src + i), g));
+	return i;
+}
+
+NDI_CONTENT_TARGET_AVX2 inline int deinterleave_stereo_avx2(const float* p_src, const int no_samples, float* p_dst, const size_t channel_stride, const float gain)
+{
+	const __m256 g = _mm256_set1_ps(gain);
+	float* p_dst_l = p_dst;
+	float* p_dst_r = p_dst + channel_stride;
+	int i = 0;
+	for (; i + 8 <= no_samples; i += 8) {
+		// The shuffles work within each 128-bit lane, giving L0 L1 L4 L5 L2 L3 L6 L7, so the middle quarters are swapped
+		const __m256 a = _mm256_loadu_ps(p_src + 2 * i);
+		const __m256 b = _mm256_loadu_ps(p_src + 2 * i + 8);
+		const __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		_mm256_storeu_ps(p_dst_l + i, _mm256_mul_ps(_mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0))), g));
+		_mm256_storeu_ps(p_dst_r + i, _mm256_mul_ps(_mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0))), g));
+	}
+	return i;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int interleave_stereo_sse41(const float* p_src, const size_t channel_stride, const int no_samples, float* p_dst, const float gain)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	const float* p_src_l = p_src;
+	const float* p_src_r = p_src + channel_stride;
+	int i = 0;
+	for (; i + 4 <= no_samples; i += 4) {
+		const __m128 l = _mm_mul_ps(_mm_loadu_ps(p_src_l + i), g);
+		const __m128 r = _mm_mul_ps(_mm_loadu_ps(p_src_r + i), g);
+		_mm_storeu_ps(p_dst + 2 * i, _mm_unpacklo_ps(l, r));
+		_mm_storeu_ps(p_dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+	}
+	return i;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int interleave_quad_sse41(const float* p_src, const size_t channel_stride, const int no_samples, float* p_dst, const int no_channels, const float gain)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	int i = 0;
+	for (; i + 4 <= no_samples; i += 4) {
+		float* p_row = p_dst + (size_t)i * no_channels;
+		for (int ch = 0; ch < no_channels; ch += 4) {
+			const float* p_src_ch = p_src + ch * channel_stride + i;
+			__m128 s0 = _mm_mul_ps(_mm_loadu_ps(p_src_ch), g);
+			__m128 s1 = _mm_mul_ps(_mm_loadu_ps(p_src_ch + channel_stride), g);
+			__m128 s2 = _mm_mul_ps(_mm_loadu_ps(p_src_ch + 2 * channel_stride), g);
+			__m128 s3 = _mm_mul_ps(_mm_loadu_ps(p_src_ch + 3 * channel_stride), g);
+			_MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+			_mm_storeu_ps(p_row + ch, s0);
+			_mm_storeu_ps(p_row + ch + no_channels, s1);
+			_mm_storeu_ps(p_row + ch + 2 * no_channels, s2);
+			_mm_storeu_ps(p_row + ch + 3 * no_channels, s3);
+		}
+	}
+	return i;
+}
+
+NDI_CONTENT_TARGET_AVX2 inline int interleave_stereo_avx2(const float* p_src, const size_t channel_stride, const int no_samples, float* p_dst, const float gain)
+{
+	const __m256 g = _mm256_set1_ps(gain);
+	const float* p_src_l = p_src;
+	const float* p_src_r = p_src + channel_stride;
+	int i = 0;
+	for (; i + 8 <= no_samples; i += 8) {
+		// The unpacks work within each 128-bit lane, so the halves are put back together afterwards
+		const __m256 l = _mm256_mul_ps(_mm256_loadu_ps(p_src_l + i), g);
+		const __m256 r = _mm256_mul_ps(_mm256_loadu_ps(p_src_r + i), g);
+		const __m256 lo = _mm256_unpacklo_ps(l, r);
+		const __m256 hi = _mm256_unpackhi_ps(l, r);
+		_mm256_storeu_ps(p_dst + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+		_mm256_storeu_ps(p_dst + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+	}
+	return i;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int mix_sse41(const float* p_src, const int no_samples, float* p_dst, const float gain)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	int i = 0;
+	for (; i + 4 <= no_samples; i += 4)
+		_mm_storeu_ps(p_dst + i, _mm_add_ps(_mm_loadu_ps(p_dst + i), _mm_mul_ps(_mm_loadu_ps(p_src + i), g)));
+	return i;
+}
+
+NDI_CONTENT_TARGET_AVX2 inline int mix_avx2(const float* p_src, const int no_samples, float* p_dst, const float gain)
+{
+	// This is a multiply and then an add rather than an FMA, so that it rounds the same as the scalar code
+	const __m256 g = _mm256_set1_ps(gain);
+	int i = 0;
+	for (; i + 8 <= no_samples; i += 8)
+		_mm256_storeu_ps(p_dst + i, _mm256_add_ps(_mm256_loadu_ps(p_dst + i), _mm256_mul_ps(_mm256_loadu_ps(p_src + i), g)));
+	return i;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int peak_sse41(const float* p_src, const int no_samples, float& peak)
+{
+	const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 max = _mm_setzero_ps();
+	int i = 0;
+	for (; i + 4 <= no_samples; i += 4)
+		max = _mm_max_ps(max, _mm_and_ps(_mm_loadu_ps(p_src + i), abs_mask));
+	max = _mm_max_ps(max, _mm_movehl_ps(max, max));
+	max = _mm_max_ss(max, _mm_shuffle_ps(max, max, 1));
+	peak = _mm_cvtss_f32(max);
+	return i;
+}
+
+NDI_CONTENT_TARGET_AVX2 inline int peak_avx2(const float* p_src, const int no_samples, float& peak)
+{
+	const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	__m256 max = _mm256_setzero_ps();
+	int i = 0;
+	for (; i + 8 <= no_samples; i += 8)
+		max = _mm256_max_ps(max, _mm256_and_ps(_mm256_loadu_ps(p_src + i), abs_mask));
+	__m128 max4 = _mm_max_ps(_mm256_castps256_ps128(max), _mm256_extractf128_ps(max, 1));
+	max4 = _mm_max_ps(max4, _mm_movehl_ps(max4, max4));
+	max4 = _mm_max_ss(max4, _mm_shuffle_ps(max4, max4, 1));
+	peak = _mm_cvtss_f32(max4);
+	return i;
+}
+
+// Eight samples of one channel as 16-bit values. cvtps rounds to nearest like lrintf, and packs saturates.
+NDI_CONTENT_TARGET_SSE41 inline __m128i to_int16x8_sse41(const float* p_src, const float* p_dither, const __m128 scale)
+{
+	const __m128 lo = _mm_set1_ps(-32768.0f), hi = _mm_set1_ps(32767.0f);
+	__m128 a = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(p_src), scale), hi), lo);
+	__m128 b = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(p_src + 4), scale), hi), lo);
+	if (p_dither) {
+		a = _mm_add_ps(a, _mm_loadu_ps(p_dither));
+		b = _mm_add_ps(b, _mm_loadu_ps(p_dither + 4));
+	}
+	return _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int to_int16_mono_sse41(const float* p_src, const int no_samples, int16_t* p_dst, const float scale, const float* p_dither)
+{
+	const __m128 s = _mm_set1_ps(scale);
+	int i = 0;
+	for (; i + 8 <= no_samples; i += 8)
+		_mm_storeu_si128((__m128i*)(p_dst + i), to_int16x8_sse41(p_src + i, p_dither ? p_dither + i : NULL, s));
+	return i;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int to_int16_stereo_sse41(const float* p_src, const size_t channel_stride, const int no_samples, int16_t* p_dst,
+	const float scale, const float* p_dither, const size_t dither_stride)
+{
+	const __m128 s = _mm_set1_ps(scale);
+	const float* p_src_l = p_src;
+	const float* p_src_r = p_src + channel_stride;
+	int i = 0;
+	for (; i + 8 <= no_samples; i += 8) {
+		const __m128i l = to_int16x8_sse41(p_src_l + i, p_dither ? p_dither + i : NULL, s);
+		const __m128i r = to_int16x8_sse41(p_src_r + i, p_dither ? p_dither + dither_stride + i : NULL, s);
+		_mm_storeu_si128((__m128i*)(p_dst + 2 * i), _mm_unpacklo_epi16(l, r));
+		_mm_storeu_si128((__m128i*)(p_dst + 2 * i + 8), _mm_unpackhi_epi16(l, r));
+	}
+	return i;
+}
+
+// Groups of four channels are transposed four samples at a time, so this handles any multiple of four channels.
+NDI_CONTENT_TARGET_SSE41 inline int to_int16_quad_sse41(const float* p_src, const size_t channel_stride, const int no_samples, int16_t* p_dst,
+	const int no_channels, const float scale, const float* p_dither, const size_t dither_stride)
+{
+	const __m128 s = _mm_set1_ps(scale);
+	const __m128 lo = _mm_set1_ps(-32768.0f), hi = _mm_set1_ps(32767.0f);
+	int i = 0;
+	for (; i + 4 <= no_samples; i += 4) {
+		int16_t* p_row = p_dst + (size_t)i * no_channels;
+		for (int ch = 0; ch < no_channels; ch += 4) {
+			const float* p_src_ch = p_src + ch * channel_stride + i;
+			__m128 s0 = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(p_src_ch), s), hi), lo);
+			__m128 s1 = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(p_src_ch + channel_stride), s), hi), lo);
+			__m128 s2 = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(p_src_ch + 2 * channel_stride), s), hi), lo);
+			__m128 s3 = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(p_src_ch + 3 * channel_stride), s), hi), lo);
+			if (p_dither) {
+				const float* p_dither_ch = p_dither + ch * dither_stride + i;
+				s0 = _mm_add_ps(s0, _mm_loadu_ps(p_dither_ch));
+				s1 = _mm_add_ps(s1, _mm_loadu_ps(p_dither_ch + dither_stride));
+				s2 = _mm_add_ps(s2, _mm_loadu_ps(p_dither_ch + 2 * dither_stride));
+				s3 = _mm_add_ps(s3, _mm_loadu_ps(p_dither_ch + 3 * dither_stride));
+			}
+			_MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+
+			// Each register now holds the four channels of one sample, and each half of a pack is one row
+			const __m128i s01 = _mm_packs_epi32(_mm_cvtps_epi32(s0), _mm_cvtps_epi32(s1));
+			const __m128i s23 = _mm_packs_epi32(_mm_cvtps_epi32(s2), _mm_cvtps_epi32(s3));
+			_mm_storel_epi64((__m128i*)(p_row + ch), s01);
+			_mm_storeh_pd((double*)(p_row + ch + no_channels), _mm_castsi128_pd(s01));
+			_mm_storel_epi64((__m128i*)(p_row + ch + 2 * no_channels), s23);
+			_mm_storeh_pd((double*)(p_row + ch + 3 * no_channels), _mm_castsi128_pd(s23));
+		}
+	}
+	return i;
+}
+
+// Any other number of channels, which converts eight samples of a channel at a time and leaves the interleaving to the
+// stores.
+NDI_CONTENT_TARGET_SSE41 inline int to_int16_any_sse41(const float* p_src, const size_t channel_stride, const int no_samples, int16_t* p_dst,
+	const int no_channels, const float scale, const float* p_dither, const size_t dither_stride)
+{
+	const __m128 s = _mm_set1_ps(scale);
+	alignas(16) int16_t values[8];
+	int i = 0;
+	for (; i + 8 <= no_samples; i += 8) {
+		for (int ch = 0; ch < no_channels; ch++) {
+			_mm_store_si128((__m128i*)values, to_int16x8_sse41(p_src + ch * channel_stride + i, p_dither ? p_dither + ch * dither_stride + i : NULL, s));
+			int16_t* p_dst_ch = p_dst + (size_t)i * no_channels + ch;
+			for (int j = 0; j < 8; j++)
+				p_dst_ch[j * no_channels] = values[j];
+		}
+	}
+	return i;
+}
+
+// Sixteen samples of one channel as 16-bit values
+NDI_CONTENT_TARGET_AVX2 inline __m256i to_int16x16_avx2(const float* p_src, const float* p_dither, const __m256 scale)
+{
+	const __m256 lo = _mm256_set1_ps(-32768.0f), hi = _mm256_set1_ps(32767.0f);
+	__m256 a = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(_mm256_loadu_ps(p_src), scale), hi), lo);
+	__m256 b = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(_mm256_loadu_ps(p_src + 8), scale), hi), lo);
+	if (p_dither) {
+		a = _mm256_add_ps(a, _mm256_loadu_ps(p_dither));
+		b = _mm256_add_ps(b, _mm256_loadu_ps(p_dither + 8));
+	}
+
+	// The pack works within each 128-bit lane, so the middle quarters are swapped back
+	return _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b)), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+NDI_CONTENT_TARGET_AVX2 inline int to_int16_mono_avx2(const float* p_src, const int no_samples, int16_t* p_dst, const float scale, const float* p_dither)
+{
+	const __m256 s = _mm256_set1_ps(scale);
+	int i = 0;
+	for (; i + 16 <= no_samples; i += 16)
+		_mm256_storeu_si256((__m256i*)(p_dst + i), to_int16x16_avx2(p_src + i, p_dither ? p_dither + i : NULL, s));
+	return i;
+}
+
+NDI_CONTENT_TARGET_AVX2 inline int to_int16_stereo_avx2(const float* p_src, const size_t channel_stride, const int no_samples, int16_t* p_dst,
+	const float scale, const float* p_dither, const size_t dither_stride)
+{
+	const __m256 s = _mm256_set1_ps(scale);
+	const float* p_src_l = p_src;
+	const float* p_src_r = p_src + channel_stride;
+	int i = 0;
+	for (; i + 16 <= no_samples; i += 16) {
+		// The unpacks work within each 128-bit lane, so the halves are put back together afterwards
+		const __m256i l = to_int16x16_avx2(p_src_l + i, p_dither ? p_dither + i : NULL, s);
+		const __m256i r = to_int16x16_avx2(p_src_r + i, p_dither ? p_dither + dither_stride + i : NULL, s);
+		const __m256i lo = _mm256_unpacklo_epi16(l, r);
+		const __m256i hi = _mm256_unpackhi_epi16(l, r);
+		_mm256_storeu_si256((__m256i*)(p_dst + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i*)(p_dst + 2 * i + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	return i;
+}
+
+// no_blocks blocks of eight values of dither
+NDI_CONTENT_TARGET_SSE41 inline void dither_sse41(uint32_t* p_state, float* p_dst, const size_t no_blocks)
+{
+	const __m128i mask = _mm_set1_epi32(0xFFFF);
+	const __m128 step = _mm_set1_ps(1.0f / 65536.0f), one = _mm_set1_ps(1.0f);
+	__m128i x[2] = { _mm_loadu_si128((const __m128i*)p_state), _mm_loadu_si128((const __m128i*)(p_state + 4)) };
+	for (size_t i = 0; i < no_blocks; i++) {
+		for (int half = 0; half < 2; half++) {
+			x[half] = _mm_xor_si128(x[half], _mm_slli_epi32(x[half], 13));
+			x[half] = _mm_xor_si128(x[half], _mm_srli_epi32(x[half], 17));
+			x[half] = _mm_xor_si128(x[half], _mm_slli_epi32(x[half], 5));
+			const __m128i sum = _mm_add_epi32(_mm_srli_epi32(x[half], 16), _mm_and_si128(x[half], mask));
+			_mm_storeu_ps(p_dst + 8 * i + 4 * half, _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(sum), step), one));
+		}
+	}
+	_mm_storeu_si128((__m128i*)p_state, x[0]);
+	_mm_storeu_si128((__m128i*)(p_state + 4), x[1]);
+}
+
+NDI_CONTENT_TARGET_AVX2 inline void dither_avx2(uint32_t* p_state, float* p_dst, const size_t no_blocks)
+{
+	const __m256i mask = _mm256_set1_epi32(0xFFFF);
+	const __m256 step = _mm256_set1_ps(1.0f / 65536.0f), one = _mm256_set1_ps(1.0f);
+	__m256i x = _mm256_loadu_si256((const __m256i*)p_state);
+	for (size_t i = 0; i < no_blocks; i++) {
+		x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+		x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+		x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+		const __m256i sum = _mm256_add_epi32(_mm256_srli_epi32(x, 16), _mm256_and_si256(x, mask));
+		_mm256_storeu_ps(p_dst + 8 * i, _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(sum), step), one));
+	}
+	_mm256_storeu_si256((__m256i*)p_state, x);
+}
+
+#endif // NDI_CONTENT_X86
+
+} // namespace detail
+
+// Convert no_samples interleaved samples of no_channels channels into planar channels channel_stride_in_bytes apart
+// (which must be a multiple of four), multiplying every sample by gain. The source and destination must not overlap.
+inline void deinterleave(const float* p_src, const int no_channels, const int no_samples, float* p_dst, const int channel_stride_in_bytes,
+	const float gain, const simd_e simd = detect_simd())
+{
+	const size_t channel_stride = (size_t)channel_stride_in_bytes / sizeof(float);
+	int done = 0;
+
+#ifdef NDI_CONTENT_X86
+	if (simd == simd_avx2) {
+		if (no_channels == 1)
+			done = detail::deinterleave_mono_avx2(p_src, no_samples, p_dst, gain);
+		else if (no_channels == 2)
+			done = detail::deinterleave_stereo_avx2(p_src, no_samples, p_dst, channel_stride, gain);
+	}
+	if (simd != simd_scalar) {
+		if (no_channels == 1)
+			done += detail::deinterleave_mono_sse41(p_src + done, no_samples - done, p_dst + done, gain);
+		else if (no_channels == 2)
+			done += detail::deinterleave_stereo_sse41(p_src + 2 * done, no_samples - done, p_dst + done, channel_stride, gain);
+		else if ((no_channels % 4) == 0)
+			done = detail::deinterleave_quad_sse41(p_src, no_channels, no_samples, p_dst, channel_stride, gain);
+	}
+#else
+	(void)simd;
+#endif
+
+	// The samples that are left over, and channel counts that the SIMD code does not handle
+	detail::deinterleave_scalar(p_src, no_channels, 0, no_channels, done, no_samples, p_dst, channel_stride, gain);
+}
+
+// Convert planar channels channel_stride_in_bytes apart (which must be a multiple of four) into no_samples interleaved
+// samples of no_channels channels, multiplying every sample by gain. The source and destination must not overlap.
+inline void interleave(const float* p_src, const int channel_stride_in_bytes, const int no_channels, const int no_samples, float* p_dst,
+	const float gain, const simd_e simd = detect_simd())
+{
+	const size_t channel_stride = (size_t)channel_stride_in_bytes / sizeof(float);
+	int done = 0;
+
+#ifdef NDI_CONTENT_X86
+	if (simd == simd_avx2) {
+		if (no_channels == 1)
+			done = detail::deinterleave_mono_avx2(p_src, no_samples, p_dst, gain);
+		else if (no_channels == 2)
+			done = detail::interleave_stereo_avx2(p_src, channel_stride, no_samples, p_dst, gain);
+	}
+	if (simd != simd_scalar) {
+		if (no_channels == 1)
+			done += detail::deinterleave_mono_sse41(p_src + done, no_samples - done, p_dst + done, gain);
+		else if (no_channels == 2)
+			done += detail::interleave_stereo_sse41(p_src + done, channel_stride, no_samples - done, p_dst + 2 * done, gain);
+		else if ((no_channels % 4) == 0)
+			done = detail::interleave_quad_sse41(p_src, channel_stride, no_samples, p_dst, no_channels, gain);
+	}
+#else
+	(void)simd;
+#endif
+
+	// The samples that are left over, and channel counts that the SIMD code does not handle
+	detail::interleave_scalar(p_src, channel_stride, 0, no_channels, done, no_samples, p_dst, no_channels, gain);
+}
+
+// Add no_samples samples multiplied by gain to p_dst. The source and destination must not overlap.
+inline void mix(const float* p_src, const int no_samples, float* p_dst, const float gain, const simd_e simd = detect_simd())
+{
+	int done = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd == simd_avx2)
+		done = detail::mix_avx2(p_src, no_samples, p_dst, gain);
+	else if (simd == simd_sse41)
+		done = detail::mix_sse41(p_src, no_samples, p_dst, gain);
+#else
+	(void)simd;
+#endif
+
+	for (int i = done; i < no_samples; i++)
+		p_dst[i] += p_src[i] * gain;
+}
+
+// The largest absolute value of no_samples samples, which is 0 when there are none.
+inline float peak(const float* p_src, const int no_samples, const simd_e simd = detect_simd())
+{
+	float max = 0.0f;
+	int done = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd == simd_avx2)
+		done = detail::peak_avx2(p_src, no_samples, max);
+	else if (simd == simd_sse41)
+		done = detail::peak_sse41(p_src, no_samples, max);
+#else
+	(void)simd;
+#endif
+
+	for (int i = done; i < no_samples; i++)
+		max = std::max(max, std::fabs(p_src[i]));
+	return max;
+}
+
+// The multiplier from a float sample to a 16-bit one at a reference level, which is how many dB above +4dBU (a float
+// sample of 1.0) the full 16-bit range is. This is the scaling of NDIlib_util_audio_to_interleaved_16s_v2.
+inline float int16_scale(const int reference_level)
+{
+	return 32767.0f * (float)pow(10.0, -reference_level / 20.0);
+}
+
+// Convert planar channels channel_stride_in_bytes apart (which must be a multiple of four) into no_samples interleaved
+// 16-bit samples of no_channels channels at a reference level, clipping samples that are too loud. p_dither is noise to
+// add to the 16-bit values, laid out as no_channels channels of no_samples samples (see tpdf_dither), or NULL for none.
+inline void to_int16(const float* p_src, const int channel_stride_in_bytes, const int no_channels, const int no_samples, int16_t* p_dst,
+	const int reference_level, const float* p_dither = NULL, const simd_e simd = detect_simd())
+{
+	const size_t channel_stride = (size_t)channel_stride_in_bytes / sizeof(float);
+	const size_t dither_stride = (size_t)std::max(no_samples, 0);
+	const float scale = int16_scale(reference_level);
+	int done = 0;
+
+#ifdef NDI_CONTENT_X86
+	if (simd == simd_avx2) {
+		if (no_channels == 1)
+			done = detail::to_int16_mono_avx2(p_src, no_samples, p_dst, scale, p_dither);
+		else if (no_channels == 2)
+			done = detail::to_int16_stereo_avx2(p_src, channel_stride, no_samples, p_dst, scale, p_dither, dither_stride);
+	}
+	if (simd != simd_scalar) {
+		if (no_channels == 1)
+			done += detail::to_int16_mono_sse41(p_src + done, no_samples - done, p_dst + done, scale, p_dither ? p_dither + done : NULL);
+		else if (no_channels == 2)
+			done += detail::to_int16_stereo_sse41(p_src + done, channel_stride, no_samples - done, p_dst + 2 * done, scale, p_dither ? p_dither + done : NULL, dither_stride);
+		else if ((no_channels % 4) == 0)
+			done = detail::to_int16_quad_sse41(p_src, channel_stride, no_samples, p_dst, no_channels, scale, p_dither, dither_stride);
+		else
+			done = detail::to_int16_any_sse41(p_src, channel_stride, no_samples, p_dst, no_channels, scale, p_dither, dither_stride);
+	}
+#else
+	(void)simd;
+#endif
+
+	// The samples that are left over
+	detail::to_int16_scalar(p_src, channel_stride, 0, no_channels, done, no_samples, p_dst, no_channels, scale, p_dither, dither_stride);
+}
+
+// TPDF (triangular) dither of up to one 16-bit step either way for to_int16, which turns the distortion of quiet audio
+// being rounded to 16 bits into a steady noise floor. The noise comes from eight xorshift generators that are stepped
+// together, which is the same on every path, so dithered output is bit identical whichever instruction set is used.
+class tpdf_dither {
+public:
+	explicit tpdf_dither(const uint32_t seed = 1)
+	{
+		// Spread the seed over the generators, none of which may start at zero
+		for (int lane = 0; lane < 8; lane++) {
+			uint32_t x = seed + 0x9E3779B9u * (uint32_t)(lane + 1);
+			x = (x ^ (x >> 16)) * 0x85EBCA6Bu;
+			x = (x ^ (x >> 13)) * 0xC2B2AE35u;
+			x ^= x >> 16;
+			m_state[lane] = x ? x : (uint32_t)(lane + 1);
+		}
+	}
+
+	// New noise for no_channels channels of no_samples samples, which stays valid until the next call. The buffer only
+	// grows when more is asked for than before, so once the format of the audio has settled this does not allocate.
+	const float* generate(const int no_channels, const int no_samples, const simd_e simd = detect_simd())
+	{
+		const size_t no_blocks = ((size_t)std::max(no_channels, 0) * std::max(no_samples, 0) + 7) / 8;
+		if (m_noise.size() < no_blocks * 8)
+			m_noise.resize(no_blocks * 8);
+
+#ifdef NDI_CONTENT_X86
+		if (simd == simd_avx2) {
+			detail::dither_avx2(m_state, m_noise.data(), no_blocks);
+			return m_noise.data();
+		}
+		if (simd == simd_sse41) {
+			detail::dither_sse41(m_state, m_noise.data(), no_blocks);
+			return m_noise.data();
+		}
+#else
+		(void)simd;
+#endif
+
+		for (size_t i = 0; i < no_blocks; i++)
+			detail::dither_scalar(m_state, m_noise.data() + 8 * i);
+		return m_noise.data();
+	}
+
+private:
+	tpdf_dither(const tpdf_dither&);
+	tpdf_dither& operator=(const tpdf_dither&);
+
+	uint32_t m_state[8];
+	std::vector<float> m_noise;
+};
+
+// A ring buffer of interleaved audio with one thread writing to it and one thread reading from it. Neither side takes a
+// lock or waits for the other, a read or a write is just one or two memcpy's, so it is safe to use from a sound card's
+// callback. When there is not room for all of a write, or not enough audio for all of a read, as much as there is
+// room or audio for is done and the caller is told how much that was, so that it can decide what to do about it.
+class ring {
+public:
+	ring(void)
+		: m_no_channels(0), m_capacity(0), m_write(0), m_read(0)
+	{
+	}
+
+	// Allocate room for no_samples samples of no_channels channels and empty it. This must not be called while either
+	// side is using the ring.
+	void create(const int no_channels, const size_t no_samples)
+	{
+		m_no_channels = std::max(no_channels, 1);
+		m_capacity = std::max(no_samples, (size_t)1);
+		m_data.assign(m_capacity * m_no_channels, 0.0f);
+		m_write.store(0, std::memory_order_relaxed);
+		m_read.store(0, std::memory_order_relaxed);
+	}
+
+	int no_channels(void) const { return m_no_channels; }
+	size_t capacity(void) const { return m_capacity; }
+
+	// The number of samples waiting to be read. This is exact for the reader, and the writer can only see it go down.
+	size_t available(void) const
+	{
+		return (size_t)(m_write.load(std::memory_order_acquire) - m_read.load(std::memory_order_acquire));
+	}
+
+	// The number of samples that there is room for. This is exact for the writer, and the reader can only see it go down.
+	size_t space(void) const
+	{
+		return m_capacity - available();
+	}
+
+	// Write up to no_samples samples, returning how many were written. Only one thread may write.
+	size_t write(const float* p_src, size_t no_samples)
+	{
+		const uint64_t write_pos = m_write.load(std::memory_order_relaxed);
+		const uint64_t read_pos = m_read.load(std::memory_order_acquire);
+		no_samples = std::min(no_samples, m_capacity - (size_t)(write_pos - read_pos));
+
+		// In one or two pieces, depending on whether it goes past the end
+		const size_t start = (size_t)(write_pos % m_capacity);
+		const size_t first = std::min(no_samples, m_capacity - start);
+		memcpy(m_data.data() + start * m_no_channels, p_src, first * m_no_channels * sizeof(float));
+		memcpy(m_data.data(), p_src + first * m_no_channels, (no_samples - first) * m_no_channels * sizeof(float));
+
+		m_write.store(write_pos + no_samples, std::memory_order_release);
+		return no_samples;
+	}
+
+	// Read up to no_samples samples, returning how many were read. Only one thread may read.
+	size_t read(float* p_dst, size_t no_samples)
+	{
+		const uint64_t read_pos = m_read.load(std::memory_order_relaxed);
+		const uint64_t write_pos = m_write.load(std::memory_order_acquire);
+		no_samples = std::min(no_samples, (size_t)(write_pos - read_pos));
+
+		const size_t start = (size_t)(read_pos % m_capacity);
+		const size_t first = std::min(no_samples, m_capacity - start);
+		memcpy(p_dst, m_data.data() + start * m_no_channels, first * m_no_channels * sizeof(float));
+		memcpy(p_dst + first * m_no_channels, m_data.data(), (no_samples - first) * m_no_channels * sizeof(float));
+
+		m_read.store(read_pos + no_samples, std::memory_order_release);
+		return no_samples;
+	}
+
+private:
+	ring(const ring&);
+	ring& operator=(const ring&);
+
+	std::vector<float> m_data;
+	int m_no_channels;
+	size_t m_capacity;
+
+	// The number of samples that have ever been written and read, each on its own cache line so that the two threads
+	// do not fight over it.
+	alignas(64) std::atomic<uint64_t> m_write;
+	alignas(64) std::atomic<uint64_t> m_read;
+};
+
+} // namespace ndi_audio
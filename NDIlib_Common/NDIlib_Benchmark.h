@@ -0,0 +1,456 @@
+#pragma once
+
+// A small benchmark harness that is shared between the examples that measure how fast we can send. It handles a
+// warm-up period followed by a fixed duration run, records the time taken by each call that is being measured in a
+// histogram so that percentiles can be reported, measures the CPU time of the sending thread and of the process, and
+// writes the results as JSON and/or CSV so that they can be compared across hosts and NDI versions.
+//
+// Command line options that are understood by all benchmarks :
+//		-warmup <seconds>		Time to run before measuring starts (default 2).
+//		-duration <seconds>		Time to measure for, 0 means until interrupted.
+//		-json <file>			Write the results as JSON, "-" is stdout.
+//		-csv <file>				Append the results to a CSV file, a header is written if the file is empty.
+//		-quiet					Do not display progress once a second.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+// We use std::min and std::max, which the macros of the same name in windows.h break
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#define strcasecmp _stricmp
+#else
+#include <strings.h>
+#include <time.h>
+#endif
+
+namespace ndi_benchmark {
+
+typedef std::chrono::steady_clock clock_type;
+
+// Get the CPU time used by the calling thread, in seconds.
+inline double thread_cpu_seconds(void)
+{
+#ifdef _WIN32
+	FILETIME creation_time, exit_time, kernel_time, user_time;
+	if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time))
+		return 0.0;
+	const uint64_t kernel = ((uint64_t)kernel_time.dwHighDateTime << 32) | kernel_time.dwLowDateTime;
+	const uint64_t user = ((uint64_t)user_time.dwHighDateTime << 32) | user_time.dwLowDateTime;
+	return (double)(kernel + user) * 1e-7;
+#else
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+// Get the CPU time used by the whole process (including all of the NDI threads), in seconds.
+inline double process_cpu_seconds(void)
+{
+#ifdef _WIN32
+	FILETIME creation_time, exit_time, kernel_time, user_time;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time))
+		return 0.0;
+	const uint64_t kernel = ((uint64_t)kernel_time.dwHighDateTime << 32) | kernel_time.dwLowDateTime;
+	const uint64_t user = ((uint64_t)user_time.dwHighDateTime << 32) | user_time.dwLowDateTime;
+	return (double)(kernel + user) * 1e-7;
+#else
+	timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+// A log-linear histogram of values (typically nano-seconds). Values below 256 are exact, and above that each power of
+// two is split into 128 buckets so that any percentile is within 1% of the true value. It is a fixed size, so adding
+// a value never allocates and millions of samples cost nothing extra.
+class histogram {
+public:
+	histogram(void) : m_counts(no_buckets, 0) { reset(); }
+
+	void reset(void)
+	{
+		std::fill(m_counts.begin(), m_counts.end(), 0);
+		m_count = 0;
+		m_sum = 0;
+		m_min = UINT64_MAX;
+		m_max = 0;
+	}
+
+	void add(const uint64_t value)
+	{
+		m_counts[bucket_index(value)]++;
+		m_count++;
+		m_sum += value;
+		m_min = std::min(m_min, value);
+		m_max = std::max(m_max, value);
+	}
+
+	// Add all of the values from another histogram
+	void merge(const histogram& other)
+	{
+		for (int i = 0; i < no_buckets; i++)
+			m_counts[i] += other.m_counts[i];
+		m_count += other.m_count;
+		m_sum += other.m_sum;
+		m_min = std::min(m_min, other.m_min);
+		m_max = std::max(m_max, other.m_max);
+	}
+
+	uint64_t count(void) const { return m_count; }
+	uint64_t min(void) const { return m_count ? m_min : 0; }
+	uint64_t max(void) const { return m_max; }
+	double mean(void) const { return m_count ? (double)m_sum / (double)m_count : 0.0; }
+
+	// Get a percentile, for instance 99.9
+	uint64_t percentile(const double percent) const
+	{
+		if (!m_count)
+			return 0;
+
+		const uint64_t target = std::max((uint64_t)1, (uint64_t)((percent / 100.0) * (double)m_count + 0.5));
+		uint64_t total = 0;
+		for (int i = 0; i < no_buckets; i++) {
+			total += m_counts[i];
+			if (total >= target)
+				return std::min(m_max, std::max(m_min, bucket_value(i)));
+		}
+
+		return m_max;
+	}
+
+	// Call a function for each bucket that has values in it, with the value range and the count
+	template<typename function_type>
+	void for_each_bucket(function_type function) const
+	{
+		for (int i = 0; i < no_buckets; i++) {
+			if (m_counts[i])
+				function(bucket_lower(i), bucket_lower(i + 1), m_counts[i]);
+		}
+	}
+
+private:
+	static const int sub_bucket_bits = 8;
+	static const int sub_bucket_count = 1 << sub_bucket_bits;
+	static const int sub_bucket_half = sub_bucket_count / 2;
+	static const int no_buckets = sub_bucket_count + (64 - sub_bucket_bits) * sub_bucket_half;
+
+	static int highest_bit(const uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return (int)index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	static int bucket_index(const uint64_t value)
+	{
+		if (value < (uint64_t)sub_bucket_count)
+			return (int)value;
+
+		const int shift = highest_bit(value) - (sub_bucket_bits - 1);
+		return sub_bucket_count + (shift - 1) * sub_bucket_half + (int)((value >> shift) - sub_bucket_half);
+	}
+
+	static uint64_t bucket_lower(const int index)
+	{
+		if (index < sub_bucket_count)
+			return (uint64_t)index;
+
+		const int shift = (index - sub_bucket_count) / sub_bucket_half + 1;
+		if (shift + sub_bucket_bits > 64)
+			return UINT64_MAX;
+		return (uint64_t)((index - sub_bucket_count) % sub_bucket_half + sub_bucket_half) << shift;
+	}
+
+	// The value that we report for a bucket is its middle
+	static uint64_t bucket_value(const int index)
+	{
+		const uint64_t lower = bucket_lower(index);
+		return lower + (bucket_lower(index + 1) - lower) / 2;
+	}
+
+	std::vector<uint64_t> m_counts;
+	uint64_t m_count, m_sum, m_min, m_max;
+};
+
+// The options that are common to all benchmarks
+struct options {
+	options(void) : m_warmup_seconds(2.0), m_duration_seconds(0.0), m_quiet(false) {}
+
+	// Parse the command line. Arguments that are not known are ignored so that each benchmark can have its own.
+	void parse(int argc, char* argv[])
+	{
+		for (int i = 1; i < argc; i++) {
+			if ((strcasecmp(argv[i], "-warmup") == 0) && (i + 1 < argc))
+				m_warmup_seconds = atof(argv[++i]);
+			else if ((strcasecmp(argv[i], "-duration") == 0) && (i + 1 < argc))
+				m_duration_seconds = atof(argv[++i]);
+			else if ((strcasecmp(argv[i], "-json") == 0) && (i + 1 < argc))
+				m_json_filename = argv[++i];
+			else if ((strcasecmp(argv[i], "-csv") == 0) && (i + 1 < argc))
+				m_csv_filename = argv[++i];
+			else if (strcasecmp(argv[i], "-quiet") == 0)
+				m_quiet = true;
+		}
+	}
+
+	double m_warmup_seconds;
+	double m_duration_seconds;
+	std::string m_json_filename;
+	std::string m_csv_filename;
+	bool m_quiet;
+};
+
+// The results of a measurement
+struct results {
+	results(void) : m_frames(0), m_seconds(0.0), m_thread_cpu_seconds(0.0), m_process_cpu_seconds(0.0) {}
+
+	double fps(void) const { return m_seconds > 0.0 ? (double)m_frames / m_seconds : 0.0; }
+
+	uint64_t m_frames;
+	double m_seconds;
+	double m_thread_cpu_seconds;
+	double m_process_cpu_seconds;
+	histogram m_call_ns;
+};
+
+// A benchmark session. This is used from the thread that is doing the work :
+//
+//		ndi_benchmark::session bench("My Benchmark", opts);
+//		while (!exit_loop && bench.running()) {
+//			bench.begin_call();
+//			NDIlib_send_send_video_async_v2(pNDI_send, &NDI_video_frame);
+//			bench.end_call();
+//		}
+//		bench.report();
+class session {
+public:
+	session(const char* p_name, const options& opts)
+		: m_name(p_name), m_options(opts), m_started(false), m_measuring(false), m_call_start_ns(0),
+		  m_thread_cpu_start(0.0), m_process_cpu_start(0.0), m_progress_frames(0)
+	{
+	}
+
+	// Add a parameter that describes this run to the report
+	void set(const char* p_key, const std::string& value) { m_params.push_back(std::make_pair(std::string(p_key), value)); }
+	void set(const char* p_key, const char* p_value) { set(p_key, std::string(p_value ? p_value : "")); }
+	void set(const char* p_key, const int value) { set(p_key, std::to_string(value)); }
+	void set(const char* p_key, const double value) { char text[64]; snprintf(text, sizeof(text), "%g", value); set(p_key, std::string(text)); }
+
+	// Call this once per iteration, it returns false when the benchmark is finished
+	bool running(void)
+	{
+		const auto now = clock_type::now();
+
+		// The first call starts the warm-up
+		if (!m_started) {
+			m_started = true;
+			m_phase_start = now;
+			if (m_options.m_warmup_seconds <= 0.0)
+				start_measuring(now);
+			else if (!m_options.m_quiet)
+				printf("%s : warming up for %1.1fs ...\n", m_name.c_str(), m_options.m_warmup_seconds);
+			return true;
+		}
+
+		// Has the warm-up finished
+		if (!m_measuring) {
+			if (seconds(now - m_phase_start) >= m_options.m_warmup_seconds)
+				start_measuring(now);
+			return true;
+		}
+
+		// Display progress once a second
+		m_results.m_frames++;
+		if (!m_options.m_quiet && (seconds(now - m_progress_time) >= 1.0)) {
+			printf("%s : %1.1ffps, call p50=%1.2fus p99=%1.2fus\n", m_name.c_str(),
+				(double)(m_results.m_frames - m_progress_frames) / seconds(now - m_progress_time),
+				(double)m_results.m_call_ns.percentile(50.0) * 1e-3, (double)m_results.m_call_ns.percentile(99.0) * 1e-3);
+			m_progress_time = now;
+			m_progress_frames = m_results.m_frames;
+		}
+
+		// Are we done
+		if ((m_options.m_duration_seconds > 0.0) && (seconds(now - m_phase_start) >= m_options.m_duration_seconds)) {
+			finish(now);
+			return false;
+		}
+
+		return true;
+	}
+
+	// Wrap the call that is being measured in these
+	void begin_call(void)
+	{
+		m_call_start_ns = now_ns();
+	}
+
+	void end_call(void)
+	{
+		if (m_measuring)
+			m_results.m_call_ns.add(now_ns() - m_call_start_ns);
+	}
+
+	// Stop measuring, if that has not already happened because the duration was reached
+	void finish(void) { finish(clock_type::now()); }
+
+	// Get the results, this finishes the measurement if needed
+	const results& get_results(void) { finish(); return m_results; }
+
+	// Display the results and write the files that were asked for
+	void report(void)
+	{
+		finish();
+
+		const results& r = m_results;
+		printf("\n%s results\n", m_name.c_str());
+		for (const auto& param : m_params)
+			printf("    %-20s %s\n", param.first.c_str(), param.second.c_str());
+		printf("    %-20s %llu in %1.2fs = %1.2ffps\n", "frames", (unsigned long long)r.m_frames, r.m_seconds, r.fps());
+		printf("    %-20s min=%1.2f mean=%1.2f p50=%1.2f p99=%1.2f p99.9=%1.2f max=%1.2f\n", "call time (us)",
+			(double)r.m_call_ns.min() * 1e-3, r.m_call_ns.mean() * 1e-3, (double)r.m_call_ns.percentile(50.0) * 1e-3,
+			(double)r.m_call_ns.percentile(99.0) * 1e-3, (double)r.m_call_ns.percentile(99.9) * 1e-3, (double)r.m_call_ns.max() * 1e-3);
+		printf("    %-20s thread=%1.2fs (%1.1f%%), process=%1.2fs (%1.1f%%)\n", "cpu time",
+			r.m_thread_cpu_seconds, percent_of(r.m_thread_cpu_seconds, r.m_seconds),
+			r.m_process_cpu_seconds, percent_of(r.m_process_cpu_seconds, r.m_seconds));
+
+		if (!m_options.m_json_filename.empty())
+			write_json(m_options.m_json_filename);
+
+		if (!m_options.m_csv_filename.empty())
+			write_csv(m_options.m_csv_filename);
+	}
+
+	// Write the results as a JSON object
+	void write_json(const std::string& filename)
+	{
+		const bool to_stdout = (filename == "-");
+		FILE* p_file = to_stdout ? stdout : fopen(filename.c_str(), "w");
+		if (!p_file) {
+			fprintf(stderr, "Unable to write %s\n", filename.c_str());
+			return;
+		}
+
+		const results& r = m_results;
+		fprintf(p_file, "{\n  \"benchmark\": \"%s\",\n  \"params\": {", json_escape(m_name).c_str());
+		for (size_t i = 0; i < m_params.size(); i++)
+			fprintf(p_file, "%s\n    \"%s\": \"%s\"", i ? "," : "", json_escape(m_params[i].first).c_str(), json_escape(m_params[i].second).c_str());
+		fprintf(p_file, "\n  },\n");
+		fprintf(p_file, "  \"frames\": %llu,\n  \"seconds\": %.6f,\n  \"fps\": %.3f,\n", (unsigned long long)r.m_frames, r.m_seconds, r.fps());
+		fprintf(p_file, "  \"call_ns\": { \"min\": %llu, \"mean\": %.1f, \"p50\": %llu, \"p99\": %llu, \"p99_9\": %llu, \"max\": %llu },\n",
+			(unsigned long long)r.m_call_ns.min(), r.m_call_ns.mean(), (unsigned long long)r.m_call_ns.percentile(50.0),
+			(unsigned long long)r.m_call_ns.percentile(99.0), (unsigned long long)r.m_call_ns.percentile(99.9), (unsigned long long)r.m_call_ns.max());
+		fprintf(p_file, "  \"thread_cpu_seconds\": %.6f,\n  \"process_cpu_seconds\": %.6f\n}\n", r.m_thread_cpu_seconds, r.m_process_cpu_seconds);
+
+		if (!to_stdout)
+			fclose(p_file);
+	}
+
+	// Append the results as a line of CSV
+	void write_csv(const std::string& filename)
+	{
+		FILE* p_file = fopen(filename.c_str(), "a");
+		if (!p_file) {
+			fprintf(stderr, "Unable to write %s\n", filename.c_str());
+			return;
+		}
+
+		// Write the header if this is a new file
+		fseek(p_file, 0, SEEK_END);
+		if (ftell(p_file) == 0) {
+			fprintf(p_file, "benchmark");
+			for (const auto& param : m_params)
+				fprintf(p_file, ",%s", param.first.c_str());
+			fprintf(p_file, ",frames,seconds,fps,call_min_ns,call_mean_ns,call_p50_ns,call_p99_ns,call_p99_9_ns,call_max_ns,thread_cpu_seconds,process_cpu_seconds\n");
+		}
+
+		const results& r = m_results;
+		fprintf(p_file, "%s", m_name.c_str());
+		for (const auto& param : m_params)
+			fprintf(p_file, ",%s", param.second.c_str());
+		fprintf(p_file, ",%llu,%.6f,%.3f,%llu,%.1f,%llu,%llu,%llu,%llu,%.6f,%.6f\n",
+			(unsigned long long)r.m_frames, r.m_seconds, r.fps(),
+			(unsigned long long)r.m_call_ns.min(), r.m_call_ns.mean(), (unsigned long long)r.m_call_ns.percentile(50.0),
+			(unsigned long long)r.m_call_ns.percentile(99.0), (unsigned long long)r.m_call_ns.percentile(99.9), (unsigned long long)r.m_call_ns.max(),
+			r.m_thread_cpu_seconds, r.m_process_cpu_seconds);
+
+		fclose(p_file);
+	}
+
+private:
+	static double seconds(const clock_type::duration duration)
+	{
+		return std::chrono::duration_cast<std::chrono::duration<double>>(duration).count();
+	}
+
+	static uint64_t now_ns(void)
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now().time_since_epoch()).count();
+	}
+
+	static double percent_of(const double value, const double total)
+	{
+		return total > 0.0 ? 100.0 * value / total : 0.0;
+	}
+
+	static std::string json_escape(const std::string& text)
+	{
+		std::string ret;
+		for (const char ch : text) {
+			if ((ch == '"') || (ch == '\\'))
+				ret += '\\';
+			ret += ch;
+		}
+		return ret;
+	}
+
+	void start_measuring(const clock_type::time_point now)
+	{
+		m_measuring = true;
+		m_phase_start = m_progress_time = now;
+		m_progress_frames = 0;
+		m_results = results();
+		m_thread_cpu_start = thread_cpu_seconds();
+		m_process_cpu_start = process_cpu_seconds();
+	}
+
+	void finish(const clock_type::time_point now)
+	{
+		if (!m_measuring)
+			return;
+
+		m_measuring = false;
+		m_results.m_seconds = seconds(now - m_phase_start);
+		m_results.m_thread_cpu_seconds = thread_cpu_seconds() - m_thread_cpu_start;
+		m_results.m_process_cpu_seconds = process_cpu_seconds() - m_process_cpu_start;
+	}
+
+	std::string m_name;
+	options m_options;
+	std::vector<std::pair<std::string, std::string>> m_params;
+
+	bool m_started, m_measuring;
+	clock_type::time_point m_phase_start, m_progress_time;
+	uint64_t m_call_start_ns;
+	double m_thread_cpu_start, m_process_cpu_start;
+	uint64_t m_progress_frames;
+
+	results m_results;
+};
+
+} // namespace ndi_benchmark
@@ -0,0 +1,1003 @@
+#pragma once
+
+// Colour space conversion between the video formats that NDI sends and receives : UYVY and UYVA, BGRA, BGRX, RGBA and
+// RGBX, NV12, I420 and YV12, and P216 and PA16, in either direction, with the BT.601, BT.709 or BT.2020 matrix and
+// limited (video) or full range YUV.
+//
+// Every conversion goes through 16 bit 4:2:2 lines, which are the Y and UV lines of P216, with 8 bit values shifted up
+// by 8 bits. Going to 4:2:2 from RGB, chroma is the average of each pair of pixels, going to 4:2:0 it is the average of
+// each pair of lines, and going back up it is repeated. Alpha is carried between the formats that have it, and is
+// opaque otherwise. YUV formats need an even xres.
+//
+// The RGB conversions use fixed point arithmetic, with AVX2 or SSE4.1 when the CPU supports them, selected at run-time
+// with a scalar fallback that gives exactly the same results. The rows of a frame can be split across a pool of threads,
+// so that a sender can use whichever format is cheapest for NDI and do the conversion on spare cores.
+
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include <Processing.NDI.Lib.h>
+
+#include "NDIlib_Content.h"
+#include "NDIlib_Thread.h"
+
+namespace ndi_color {
+
+// The instruction sets are the same as the content generator's
+using ndi_content::simd_e;
+using ndi_content::simd_scalar;
+using ndi_content::simd_sse41;
+using ndi_content::simd_avx2;
+using ndi_content::simd_name;
+using ndi_content::detect_simd;
+
+// The YUV matrices
+enum matrix_e {
+	matrix_bt601,
+	matrix_bt709,
+	matrix_bt2020
+};
+
+// Limited range has Y in [16, 235] and UV in [16, 240] at 8 bits, full range uses all of [0, 255]
+enum range_e {
+	range_limited,
+	range_full
+};
+
+inline const char* matrix_name(const matrix_e matrix)
+{
+	static const char* p_names[] = { "BT.601", "BT.709", "BT.2020" };
+	return p_names[matrix];
+}
+
+inline const char* range_name(const range_e range)
+{
+	return (range == range_full) ? "full" : "limited";
+}
+
+// Parse "601", "709" or "2020", with or without "BT" or "BT."
+inline bool parse_matrix(const char* p_name, matrix_e& matrix)
+{
+	if ((tolower(p_name[0]) == 'b') && (tolower(p_name[1]) == 't'))
+		p_name += (p_name[2] == '.') ? 3 : 2;
+
+	if (!strcmp(p_name, "601")) matrix = matrix_bt601;
+	else if (!strcmp(p_name, "709")) matrix = matrix_bt709;
+	else if (!strcmp(p_name, "2020")) matrix = matrix_bt2020;
+	else return false;
+	return true;
+}
+
+inline bool parse_range(const char* p_name, range_e& range)
+{
+	if (!strcasecmp(p_name, "limited")) range = range_limited;
+	else if (!strcasecmp(p_name, "full")) range = range_full;
+	else return false;
+	return true;
+}
+
+// SD video is BT.601 and HD and UHD video is BT.709. BT.2020 is only for video that is known to be wide gamut.
+inline matrix_e default_matrix(const int xres, const int yres)
+{
+	return ((xres < 1280) && (yres < 720)) ? matrix_bt601 : matrix_bt709;
+}
+
+// The fixed point coefficients for one matrix and range
+struct coefficients_t {
+	// RGB to YUV scaled by 2^14, in the order of the bytes of a pixel, so B G R for BGRA and R G B for RGBA. Y is
+	// (sum + y_offset) >> 6 for each pixel, and U and V are (sum + uv_offset) >> 7 with the sum over a pair of pixels.
+	int16_t to_y[4], to_u[4], to_v[4];
+	int32_t y_offset, uv_offset;
+
+	// YUV to RGB scaled by 2^13, from 16 bit values with the chroma offset removed
+	int32_t from_y, from_y_offset, r_v, g_u, g_v, b_u;
+
+	// Are pixels R G B A rather than B G R A
+	bool rgba;
+};
+
+inline coefficients_t make_coefficients(const matrix_e matrix, const range_e range, const bool rgba = false)
+{
+	double kr = 0.2126, kb = 0.0722;
+	if (matrix == matrix_bt601) {
+		kr = 0.299;
+		kb = 0.114;
+	} else if (matrix == matrix_bt2020) {
+		kr = 0.2627;
+		kb = 0.0593;
+	}
+	const double kg = 1.0 - kr - kb;
+
+	const bool limited = (range == range_limited);
+	const double y_scale = limited ? 219.0 / 255.0 : 1.0;
+	const double c_scale = limited ? 224.0 / 255.0 : 1.0;
+
+	// RGB to YUV. The rows add up to exactly what they should, so that white is exactly white and greys have no chroma.
+	const int y_r = (int)std::lround(kr * y_scale * 16384.0);
+	const int y_b = (int)std::lround(kb * y_scale * 16384.0);
+	const int y_g = (int)std::lround(y_scale * 16384.0) - y_r - y_b;
+	const int u_b = (int)std::lround(0.5 * c_scale * 16384.0);
+	const int u_r = -(int)std::lround(kr / (2.0 * (1.0 - kb)) * c_scale * 16384.0);
+	const int u_g = -u_b - u_r;
+	const int v_r = u_b;
+	const int v_b = -(int)std::lround(kb / (2.0 * (1.0 - kr)) * c_scale * 16384.0);
+	const int v_g = -v_r - v_b;
+
+	coefficients_t c;
+	const int r = rgba ? 0 : 2, b = rgba ? 2 : 0;
+	c.to_y[b] = (int16_t)y_b; c.to_y[1] = (int16_t)y_g; c.to_y[r] = (int16_t)y_r; c.to_y[3] = 0;
+	c.to_u[b] = (int16_t)u_b; c.to_u[1] = (int16_t)u_g; c.to_u[r] = (int16_t)u_r; c.to_u[3] = 0;
+	c.to_v[b] = (int16_t)v_b; c.to_v[1] = (int16_t)v_g; c.to_v[r] = (int16_t)v_r; c.to_v[3] = 0;
+	c.y_offset = (limited ? (16 << 14) : 0) + 32;
+	c.uv_offset = (128 << 15) + 64;
+
+	// YUV to RGB
+	c.from_y = (int)std::lround(8192.0 / y_scale);
+	c.from_y_offset = limited ? (16 << 8) : 0;
+	c.r_v = (int)std::lround(2.0 * (1.0 - kr) / c_scale * 8192.0);
+	c.g_u = (int)std::lround(2.0 * (1.0 - kb) * kb / kg / c_scale * 8192.0);
+	c.g_v = (int)std::lround(2.0 * (1.0 - kr) * kr / kg / c_scale * 8192.0);
+	c.b_u = (int)std::lround(2.0 * (1.0 - kb) / c_scale * 8192.0);
+	c.rgba = rgba;
+
+	return c;
+}
+
+namespace detail {
+
+inline int clamp_8(const int value)
+{
+	return std::max(0, std::min(255, value));
+}
+
+inline int clamp_16(const int value)
+{
+	return std::max(0, std::min(65535, value));
+}
+
+// 16 bit to 8 bit with rounding
+inline uint8_t narrow(const int value)
+{
+	return (uint8_t)(std::min(65535, value + 128) >> 8);
+}
+
+// RGB to 16 bit YUV from pixel x0 (which is even) to the end of a line
+inline void rgb_to_yuv_scalar(uint16_t* p_y, uint16_t* p_uv, const uint8_t* p_src, const coefficients_t& c, const int x0, const int xres)
+{
+	for (int x = x0; x < xres; x += 2) {
+		const uint8_t* p_0 = p_src + x * 4;
+		const uint8_t* p_1 = p_0 + 4;
+		p_y[x + 0] = (uint16_t)clamp_16((c.to_y[0] * p_0[0] + c.to_y[1] * p_0[1] + c.to_y[2] * p_0[2] + c.y_offset) >> 6);
+		p_y[x + 1] = (uint16_t)clamp_16((c.to_y[0] * p_1[0] + c.to_y[1] * p_1[1] + c.to_y[2] * p_1[2] + c.y_offset) >> 6);
+
+		const int s_0 = p_0[0] + p_1[0], s_1 = p_0[1] + p_1[1], s_2 = p_0[2] + p_1[2];
+		p_uv[x + 0] = (uint16_t)clamp_16((c.to_u[0] * s_0 + c.to_u[1] * s_1 + c.to_u[2] * s_2 + c.uv_offset) >> 7);
+		p_uv[x + 1] = (uint16_t)clamp_16((c.to_v[0] * s_0 + c.to_v[1] * s_1 + c.to_v[2] * s_2 + c.uv_offset) >> 7);
+	}
+}
+
+// 16 bit YUV to RGB with opaque alpha
+inline void yuv_to_rgb_scalar(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_uv, const coefficients_t& c, const int x0, const int xres)
+{
+	const int r = c.rgba ? 0 : 2, b = c.rgba ? 2 : 0;
+	for (int x = x0; x < xres; x += 2) {
+		const int u = p_uv[x + 0] - 32768, v = p_uv[x + 1] - 32768;
+		const int r_uv = c.r_v * v, g_uv = c.g_u * u + c.g_v * v, b_uv = c.b_u * u;
+
+		for (int i = 0; i < 2; i++) {
+			const int y = c.from_y * (p_y[x + i] - c.from_y_offset) + (1 << 20);
+			uint8_t* p_out = p_dst + (x + i) * 4;
+			p_out[b] = (uint8_t)clamp_8((y + b_uv) >> 21);
+			p_out[1] = (uint8_t)clamp_8((y - g_uv) >> 21);
+			p_out[r] = (uint8_t)clamp_8((y + r_uv) >> 21);
+			p_out[3] = 255;
+		}
+	}
+}
+
+inline void uyvy_to_yuv_scalar(uint16_t* p_y, uint16_t* p_uv, const uint8_t* p_src, const int x0, const int xres)
+{
+	for (int x = x0; x < xres; x++) {
+		p_uv[x] = (uint16_t)(p_src[x * 2 + 0] << 8);
+		p_y[x] = (uint16_t)(p_src[x * 2 + 1] << 8);
+	}
+}
+
+inline void yuv_to_uyvy_scalar(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_uv, const int x0, const int xres)
+{
+	for (int x = x0; x < xres; x++) {
+		p_dst[x * 2 + 0] = narrow(p_uv[x]);
+		p_dst[x * 2 + 1] = narrow(p_y[x]);
+	}
+}
+
+inline void widen_scalar(uint16_t* p_dst, const uint8_t* p_src, const int x0, const int n)
+{
+	for (int x = x0; x < n; x++)
+		p_dst[x] = (uint16_t)(p_src[x] << 8);
+}
+
+inline void narrow_scalar(uint8_t* p_dst, const uint16_t* p_src, const int x0, const int n)
+{
+	for (int x = x0; x < n; x++)
+		p_dst[x] = narrow(p_src[x]);
+}
+
+// 4:2:0 chroma is the average of the chroma of two lines
+inline void narrow_chroma_scalar(uint8_t* p_dst, const uint16_t* p_uv_0, const uint16_t* p_uv_1, const int x0, const int n)
+{
+	for (int x = x0; x < n; x++)
+		p_dst[x] = narrow((p_uv_0[x] + p_uv_1[x] + 1) >> 1);
+}
+
+inline void narrow_chroma_planar_scalar(uint8_t* p_u, uint8_t* p_v, const uint16_t* p_uv_0, const uint16_t* p_uv_1, const int x0, const int n)
+{
+	for (int x = x0; x < n; x += 2) {
+		p_u[x / 2] = narrow((p_uv_0[x + 0] + p_uv_1[x + 0] + 1) >> 1);
+		p_v[x / 2] = narrow((p_uv_0[x + 1] + p_uv_1[x + 1] + 1) >> 1);
+	}
+}
+
+inline void widen_chroma_planar_scalar(uint16_t* p_uv, const uint8_t* p_u, const uint8_t* p_v, const int x0, const int n)
+{
+	for (int x = x0; x < n; x += 2) {
+		p_uv[x + 0] = (uint16_t)(p_u[x / 2] << 8);
+		p_uv[x + 1] = (uint16_t)(p_v[x / 2] << 8);
+	}
+}
+
+// Copy RGB pixels, swapping R and B when the byte orders differ, and making them opaque when the source has no alpha
+inline void rgb_to_rgb_scalar(uint8_t* p_dst, const uint8_t* p_src, const bool swap, const bool opaque, const int x0, const int xres)
+{
+	const int r = swap ? 2 : 0, b = swap ? 0 : 2;
+	for (int x = x0; x < xres; x++) {
+		p_dst[x * 4 + 0] = p_src[x * 4 + r];
+		p_dst[x * 4 + 1] = p_src[x * 4 + 1];
+		p_dst[x * 4 + 2] = p_src[x * 4 + b];
+		p_dst[x * 4 + 3] = opaque ? 255 : p_src[x * 4 + 3];
+	}
+}
+
+#ifdef NDI_CONTENT_X86
+
+// Eight pixels at a time. _mm_madd_epi16 gives us the sum of the first two and of the last two channels of each pixel,
+// and _mm_hadd_epi32 adds those together. Chroma is worked out from the sum of each pair of pixels, which fits in 16 bits.
+// These return the first pixel that they did not do.
+NDI_CONTENT_TARGET_SSE41 inline int rgb_to_yuv_sse41(uint16_t* p_y, uint16_t* p_uv, const uint8_t* p_src, const coefficients_t& c, const int xres)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i coeff_y = _mm_setr_epi16(c.to_y[0], c.to_y[1], c.to_y[2], 0, c.to_y[0], c.to_y[1], c.to_y[2], 0);
+	const __m128i coeff_u = _mm_setr_epi16(c.to_u[0], c.to_u[1], c.to_u[2], 0, c.to_u[0], c.to_u[1], c.to_u[2], 0);
+	const __m128i coeff_v = _mm_setr_epi16(c.to_v[0], c.to_v[1], c.to_v[2], 0, c.to_v[0], c.to_v[1], c.to_v[2], 0);
+	const __m128i offset_y = _mm_set1_epi32(c.y_offset), offset_uv = _mm_set1_epi32(c.uv_offset);
+
+	int x = 0;
+	for (; x + 8 <= xres; x += 8) {
+		const __m128i src_0 = _mm_loadu_si128((const __m128i*)(p_src + x * 4));
+		const __m128i src_1 = _mm_loadu_si128((const __m128i*)(p_src + x * 4 + 16));
+		const __m128i px[4] = {
+			_mm_unpacklo_epi8(src_0, zero), _mm_unpackhi_epi8(src_0, zero),
+			_mm_unpacklo_epi8(src_1, zero), _mm_unpackhi_epi8(src_1, zero)
+		};
+
+		// Luma for the eight pixels
+		const __m128i y_0 = _mm_hadd_epi32(_mm_madd_epi16(px[0], coeff_y), _mm_madd_epi16(px[1], coeff_y));
+		const __m128i y_1 = _mm_hadd_epi32(_mm_madd_epi16(px[2], coeff_y), _mm_madd_epi16(px[3], coeff_y));
+		_mm_storeu_si128((__m128i*)(p_y + x), _mm_packus_epi32(
+			_mm_srai_epi32(_mm_add_epi32(y_0, offset_y), 6), _mm_srai_epi32(_mm_add_epi32(y_1, offset_y), 6)));
+
+		// The four pairs of pixels added together
+		const __m128i pairs_0 = _mm_unpacklo_epi64(_mm_add_epi16(px[0], _mm_srli_si128(px[0], 8)), _mm_add_epi16(px[1], _mm_srli_si128(px[1], 8)));
+		const __m128i pairs_1 = _mm_unpacklo_epi64(_mm_add_epi16(px[2], _mm_srli_si128(px[2], 8)), _mm_add_epi16(px[3], _mm_srli_si128(px[3], 8)));
+
+		// Chroma for the four pairs, interleaved
+		const __m128i u = _mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(_mm_madd_epi16(pairs_0, coeff_u), _mm_madd_epi16(pairs_1, coeff_u)), offset_uv), 7);
+		const __m128i v = _mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(_mm_madd_epi16(pairs_0, coeff_v), _mm_madd_epi16(pairs_1, coeff_v)), offset_uv), 7);
+		_mm_storeu_si128((__m128i*)(p_uv + x), _mm_packus_epi32(_mm_unpacklo_epi32(u, v), _mm_unpackhi_epi32(u, v)));
+	}
+
+	return x;
+}
+
+// Write eight pixels from 16 bit values of each channel, saturating them to 8 bits
+NDI_CONTENT_TARGET_SSE41 inline void store_rgb_sse41(uint8_t* p_dst, const __m128i first, const __m128i g, const __m128i third)
+{
+	const __m128i fg = _mm_packus_epi16(first, g);
+	const __m128i ta = _mm_packus_epi16(third, _mm_set1_epi16(255));
+	const __m128i fg_i = _mm_unpacklo_epi8(fg, _mm_srli_si128(fg, 8));
+	const __m128i ta_i = _mm_unpacklo_epi8(ta, _mm_srli_si128(ta, 8));
+	_mm_storeu_si128((__m128i*)p_dst, _mm_unpacklo_epi16(fg_i, ta_i));
+	_mm_storeu_si128((__m128i*)(p_dst + 16), _mm_unpackhi_epi16(fg_i, ta_i));
+}
+
+// Eight pixels at a time. The chroma terms are worked out once for each pair of pixels and then repeated.
+NDI_CONTENT_TARGET_SSE41 inline int yuv_to_rgb_sse41(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_uv, const coefficients_t& c, const int xres)
+{
+	const __m128i from_y = _mm_set1_epi32(c.from_y), from_y_offset = _mm_set1_epi32(c.from_y_offset), round = _mm_set1_epi32(1 << 20);
+	const __m128i r_v = _mm_set1_epi32(c.r_v), g_u = _mm_set1_epi32(c.g_u), g_v = _mm_set1_epi32(c.g_v), b_u = _mm_set1_epi32(c.b_u);
+	const __m128i uv_offset = _mm_set1_epi32(32768), low_16 = _mm_set1_epi32(0xFFFF);
+
+	int x = 0;
+	for (; x + 8 <= xres; x += 8) {
+		const __m128i y_src = _mm_loadu_si128((const __m128i*)(p_y + x));
+		const __m128i y_0 = _mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(_mm_cvtepu16_epi32(y_src), from_y_offset), from_y), round);
+		const __m128i y_1 = _mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(_mm_cvtepu16_epi32(_mm_srli_si128(y_src, 8)), from_y_offset), from_y), round);
+
+		const __m128i uv = _mm_loadu_si128((const __m128i*)(p_uv + x));
+		const __m128i u = _mm_sub_epi32(_mm_and_si128(uv, low_16), uv_offset);
+		const __m128i v = _mm_sub_epi32(_mm_srli_epi32(uv, 16), uv_offset);
+		const __m128i r_uv = _mm_mullo_epi32(v, r_v);
+		const __m128i g_uv = _mm_add_epi32(_mm_mullo_epi32(u, g_u), _mm_mullo_epi32(v, g_v));
+		const __m128i b_uv = _mm_mullo_epi32(u, b_u);
+
+		const __m128i r = _mm_packs_epi32(
+			_mm_srai_epi32(_mm_add_epi32(y_0, _mm_unpacklo_epi32(r_uv, r_uv)), 21),
+			_mm_srai_epi32(_mm_add_epi32(y_1, _mm_unpackhi_epi32(r_uv, r_uv)), 21));
+		const __m128i g = _mm_packs_epi32(
+			_mm_srai_epi32(_mm_sub_epi32(y_0, _mm_unpacklo_epi32(g_uv, g_uv)), 21),
+			_mm_srai_epi32(_mm_sub_epi32(y_1, _mm_unpackhi_epi32(g_uv, g_uv)), 21));
+		const __m128i b = _mm_packs_epi32(
+			_mm_srai_epi32(_mm_add_epi32(y_0, _mm_unpacklo_epi32(b_uv, b_uv)), 21),
+			_mm_srai_epi32(_mm_add_epi32(y_1, _mm_unpackhi_epi32(b_uv, b_uv)), 21));
+
+		if (c.rgba)
+			store_rgb_sse41(p_dst + x * 4, r, g, b);
+		else
+			store_rgb_sse41(p_dst + x * 4, b, g, r);
+	}
+
+	return x;
+}
+
+// Each 16 bit lane of UYVY is a chroma sample in the low byte and a luma sample in the high byte
+NDI_CONTENT_TARGET_SSE41 inline int uyvy_to_yuv_sse41(uint16_t* p_y, uint16_t* p_uv, const uint8_t* p_src, const int xres)
+{
+	const __m128i high_8 = _mm_set1_epi16((short)0xFF00);
+
+	int x = 0;
+	for (; x + 8 <= xres; x += 8) {
+		const __m128i src = _mm_loadu_si128((const __m128i*)(p_src + x * 2));
+		_mm_storeu_si128((__m128i*)(p_y + x), _mm_and_si128(src, high_8));
+		_mm_storeu_si128((__m128i*)(p_uv + x), _mm_slli_epi16(src, 8));
+	}
+
+	return x;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int yuv_to_uyvy_sse41(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_uv, const int xres)
+{
+	const __m128i half = _mm_set1_epi16(128), high_8 = _mm_set1_epi16((short)0xFF00);
+
+	int x = 0;
+	for (; x + 8 <= xres; x += 8) {
+		const __m128i y = _mm_and_si128(_mm_adds_epu16(_mm_loadu_si128((const __m128i*)(p_y + x)), half), high_8);
+		const __m128i uv = _mm_srli_epi16(_mm_adds_epu16(_mm_loadu_si128((const __m128i*)(p_uv + x)), half), 8);
+		_mm_storeu_si128((__m128i*)(p_dst + x * 2), _mm_or_si128(y, uv));
+	}
+
+	return x;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline __m128i narrow_sse41(const __m128i lo, const __m128i hi)
+{
+	const __m128i half = _mm_set1_epi16(128);
+	return _mm_packus_epi16(_mm_srli_epi16(_mm_adds_epu16(lo, half), 8), _mm_srli_epi16(_mm_adds_epu16(hi, half), 8));
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int widen_sse41(uint16_t* p_dst, const uint8_t* p_src, const int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	int x = 0;
+	for (; x + 16 <= n; x += 16) {
+		const __m128i src = _mm_loadu_si128((const __m128i*)(p_src + x));
+		_mm_storeu_si128((__m128i*)(p_dst + x), _mm_unpacklo_epi8(zero, src));
+		_mm_storeu_si128((__m128i*)(p_dst + x + 8), _mm_unpackhi_epi8(zero, src));
+	}
+
+	return x;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int narrow_sse41(uint8_t* p_dst, const uint16_t* p_src, const int n)
+{
+	int x = 0;
+	for (; x + 16 <= n; x += 16) {
+		_mm_storeu_si128((__m128i*)(p_dst + x), narrow_sse41(
+			_mm_loadu_si128((const __m128i*)(p_src + x)), _mm_loadu_si128((const __m128i*)(p_src + x + 8))));
+	}
+
+	return x;
+}
+
+// _mm_avg_epu16 rounds up, in the same way as the scalar code
+NDI_CONTENT_TARGET_SSE41 inline __m128i narrow_chroma_sse41(const uint16_t* p_uv_0, const uint16_t* p_uv_1)
+{
+	return narrow_sse41(
+		_mm_avg_epu16(_mm_loadu_si128((const __m128i*)p_uv_0), _mm_loadu_si128((const __m128i*)p_uv_1)),
+		_mm_avg_epu16(_mm_loadu_si128((const __m128i*)(p_uv_0 + 8)), _mm_loadu_si128((const __m128i*)(p_uv_1 + 8))));
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int narrow_chroma_sse41(uint8_t* p_dst, const uint16_t* p_uv_0, const uint16_t* p_uv_1, const int n)
+{
+	int x = 0;
+	for (; x + 16 <= n; x += 16)
+		_mm_storeu_si128((__m128i*)(p_dst + x), narrow_chroma_sse41(p_uv_0 + x, p_uv_1 + x));
+
+	return x;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int narrow_chroma_planar_sse41(uint8_t* p_u, uint8_t* p_v, const uint16_t* p_uv_0, const uint16_t* p_uv_1, const int n)
+{
+	const __m128i split = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+	int x = 0;
+	for (; x + 16 <= n; x += 16) {
+		const __m128i uv = _mm_shuffle_epi8(narrow_chroma_sse41(p_uv_0 + x, p_uv_1 + x), split);
+		_mm_storel_epi64((__m128i*)(p_u + x / 2), uv);
+		_mm_storel_epi64((__m128i*)(p_v + x / 2), _mm_srli_si128(uv, 8));
+	}
+
+	return x;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int widen_chroma_planar_sse41(uint16_t* p_uv, const uint8_t* p_u, const uint8_t* p_v, const int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	int x = 0;
+	for (; x + 16 <= n; x += 16) {
+		const __m128i uv = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p_u + x / 2)), _mm_loadl_epi64((const __m128i*)(p_v + x / 2)));
+		_mm_storeu_si128((__m128i*)(p_uv + x), _mm_unpacklo_epi8(zero, uv));
+		_mm_storeu_si128((__m128i*)(p_uv + x + 8), _mm_unpackhi_epi8(zero, uv));
+	}
+
+	return x;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int rgb_to_rgb_sse41(uint8_t* p_dst, const uint8_t* p_src, const bool swap, const bool opaque, const int xres)
+{
+	const __m128i order = swap ? _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15) : _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i alpha = opaque ? _mm_set1_epi32((int)0xFF000000) : _mm_setzero_si128();
+
+	int x = 0;
+	for (; x + 4 <= xres; x += 4)
+		_mm_storeu_si128((__m128i*)(p_dst + x * 4), _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p_src + x * 4)), order), alpha));
+
+	return x;
+}
+
+// The AVX2 versions do sixteen pixels at a time. Most of the instructions work within each 128 bit lane, so the results
+// come out with their pairs of 16 bit values out of order, and a single _mm256_permutevar8x32_epi32 puts them back.
+NDI_CONTENT_TARGET_AVX2 inline int rgb_to_yuv_avx2(uint16_t* p_y, uint16_t* p_uv, const uint8_t* p_src, const coefficients_t& c, const int xres)
+{
+	const __m256i coeff_y = _mm256_setr_epi16(c.to_y[0], c.to_y[1], c.to_y[2], 0, c.to_y[0], c.to_y[1], c.to_y[2], 0, c.to_y[0], c.to_y[1], c.to_y[2], 0, c.to_y[0], c.to_y[1], c.to_y[2], 0);
+	const __m256i coeff_u = _mm256_setr_epi16(c.to_u[0], c.to_u[1], c.to_u[2], 0, c.to_u[0], c.to_u[1], c.to_u[2], 0, c.to_u[0], c.to_u[1], c.to_u[2], 0, c.to_u[0], c.to_u[1], c.to_u[2], 0);
+	const __m256i coeff_v = _mm256_setr_epi16(c.to_v[0], c.to_v[1], c.to_v[2], 0, c.to_v[0], c.to_v[1], c.to_v[2], 0, c.to_v[0], c.to_v[1], c.to_v[2], 0, c.to_v[0], c.to_v[1], c.to_v[2], 0);
+	const __m256i offset_y = _mm256_set1_epi32(c.y_offset), offset_uv = _mm256_set1_epi32(c.uv_offset);
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	int x = 0;
+	for (; x + 16 <= xres; x += 16) {
+		// Four pixels in each, two in each lane
+		const __m256i src_0 = _mm256_loadu_si256((const __m256i*)(p_src + x * 4));
+		const __m256i src_1 = _mm256_loadu_si256((const __m256i*)(p_src + x * 4 + 32));
+		const __m256i px[4] = {
+			_mm256_cvtepu8_epi16(_mm256_castsi256_si128(src_0)), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(src_0, 1)),
+			_mm256_cvtepu8_epi16(_mm256_castsi256_si128(src_1)), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(src_1, 1))
+		};
+
+		// Luma comes out as 0 1 4 5 8 9 12 13 in the low lane and 2 3 6 7 10 11 14 15 in the high lane
+		const __m256i y_0 = _mm256_hadd_epi32(_mm256_madd_epi16(px[0], coeff_y), _mm256_madd_epi16(px[1], coeff_y));
+		const __m256i y_1 = _mm256_hadd_epi32(_mm256_madd_epi16(px[2], coeff_y), _mm256_madd_epi16(px[3], coeff_y));
+		const __m256i y = _mm256_packus_epi32(_mm256_srai_epi32(_mm256_add_epi32(y_0, offset_y), 6), _mm256_srai_epi32(_mm256_add_epi32(y_1, offset_y), 6));
+		_mm256_storeu_si256((__m256i*)(p_y + x), _mm256_permutevar8x32_epi32(y, order));
+
+		// The pairs of pixels added together, and chroma from them in the same order as luma
+		const __m256i pairs_0 = _mm256_unpacklo_epi64(_mm256_add_epi16(px[0], _mm256_bsrli_epi128(px[0], 8)), _mm256_add_epi16(px[1], _mm256_bsrli_epi128(px[1], 8)));
+		const __m256i pairs_1 = _mm256_unpacklo_epi64(_mm256_add_epi16(px[2], _mm256_bsrli_epi128(px[2], 8)), _mm256_add_epi16(px[3], _mm256_bsrli_epi128(px[3], 8)));
+		const __m256i u = _mm256_srai_epi32(_mm256_add_epi32(_mm256_hadd_epi32(_mm256_madd_epi16(pairs_0, coeff_u), _mm256_madd_epi16(pairs_1, coeff_u)), offset_uv), 7);
+		const __m256i v = _mm256_srai_epi32(_mm256_add_epi32(_mm256_hadd_epi32(_mm256_madd_epi16(pairs_0, coeff_v), _mm256_madd_epi16(pairs_1, coeff_v)), offset_uv), 7);
+		const __m256i uv = _mm256_packus_epi32(_mm256_unpacklo_epi32(u, v), _mm256_unpackhi_epi32(u, v));
+		_mm256_storeu_si256((__m256i*)(p_uv + x), _mm256_permutevar8x32_epi32(uv, order));
+	}
+
+	return x + rgb_to_yuv_sse41(p_y + x, p_uv + x, p_src + x * 4, c, xres - x);
+}
+
+// Write sixteen pixels. The channels are in the order that _mm256_packs_epi32 leaves them, pixels 0-3 and 8-11 in the
+// low lane and 4-7 and 12-15 in the high lane, which the interleaving puts back in order.
+NDI_CONTENT_TARGET_AVX2 inline void store_rgb_avx2(uint8_t* p_dst, const __m256i first, const __m256i g, const __m256i third)
+{
+	const __m256i fg = _mm256_packus_epi16(first, g);
+	const __m256i ta = _mm256_packus_epi16(third, _mm256_set1_epi16(255));
+	const __m256i fg_i = _mm256_unpacklo_epi8(fg, _mm256_bsrli_epi128(fg, 8));
+	const __m256i ta_i = _mm256_unpacklo_epi8(ta, _mm256_bsrli_epi128(ta, 8));
+	_mm256_storeu_si256((__m256i*)p_dst, _mm256_unpacklo_epi16(fg_i, ta_i));
+	_mm256_storeu_si256((__m256i*)(p_dst + 32), _mm256_unpackhi_epi16(fg_i, ta_i));
+}
+
+NDI_CONTENT_TARGET_AVX2 inline int yuv_to_rgb_avx2(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_uv, const coefficients_t& c, const int xres)
+{
+	const __m256i from_y = _mm256_set1_epi32(c.from_y), from_y_offset = _mm256_set1_epi32(c.from_y_offset), round = _mm256_set1_epi32(1 << 20);
+	const __m256i r_v = _mm256_set1_epi32(c.r_v), g_u = _mm256_set1_epi32(c.g_u), g_v = _mm256_set1_epi32(c.g_v), b_u = _mm256_set1_epi32(c.b_u);
+	const __m256i uv_offset = _mm256_set1_epi32(32768), low_16 = _mm256_set1_epi32(0xFFFF);
+	const __m256i repeat_0 = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3), repeat_1 = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+
+	int x = 0;
+	for (; x + 16 <= xres; x += 16) {
+		const __m256i y_0 = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(p_y + x))), from_y_offset), from_y), round);
+		const __m256i y_1 = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(p_y + x + 8))), from_y_offset), from_y), round);
+
+		const __m256i uv = _mm256_loadu_si256((const __m256i*)(p_uv + x));
+		const __m256i u = _mm256_sub_epi32(_mm256_and_si256(uv, low_16), uv_offset);
+		const __m256i v = _mm256_sub_epi32(_mm256_srli_epi32(uv, 16), uv_offset);
+		const __m256i r_uv = _mm256_mullo_epi32(v, r_v);
+		const __m256i g_uv = _mm256_add_epi32(_mm256_mullo_epi32(u, g_u), _mm256_mullo_epi32(v, g_v));
+		const __m256i b_uv = _mm256_mullo_epi32(u, b_u);
+
+		const __m256i r = _mm256_packs_epi32(
+			_mm256_srai_epi32(_mm256_add_epi32(y_0, _mm256_permutevar8x32_epi32(r_uv, repeat_0)), 21),
+			_mm256_srai_epi32(_mm256_add_epi32(y_1, _mm256_permutevar8x32_epi32(r_uv, repeat_1)), 21));
+		const __m256i g = _mm256_packs_epi32(
+			_mm256_srai_epi32(_mm256_sub_epi32(y_0, _mm256_permutevar8x32_epi32(g_uv, repeat_0)), 21),
+			_mm256_srai_epi32(_mm256_sub_epi32(y_1, _mm256_permutevar8x32_epi32(g_uv, repeat_1)), 21));
+		const __m256i b = _mm256_packs_epi32(
+			_mm256_srai_epi32(_mm256_add_epi32(y_0, _mm256_permutevar8x32_epi32(b_uv, repeat_0)), 21),
+			_mm256_srai_epi32(_mm256_add_epi32(y_1, _mm256_permutevar8x32_epi32(b_uv, repeat_1)), 21));
+
+		if (c.rgba)
+			store_rgb_avx2(p_dst + x * 4, r, g, b);
+		else
+			store_rgb_avx2(p_dst + x * 4, b, g, r);
+	}
+
+	return x + yuv_to_rgb_sse41(p_dst + x * 4, p_y + x, p_uv + x, c, xres - x);
+}
+
+#endif // NDI_CONTENT_X86
+
+} // namespace detail
+
+// Convert single lines with the best instruction set that we are allowed to use. The 16 bit lines are the Y and UV lines
+// of one row of P216, and n is the number of samples. Only the RGB conversions have AVX2 versions, the others are
+// limited by memory rather than arithmetic.
+inline void rgb_to_yuv_line(uint16_t* p_y, uint16_t* p_uv, const uint8_t* p_src, const coefficients_t& c, const int xres, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd == simd_avx2) x = detail::rgb_to_yuv_avx2(p_y, p_uv, p_src, c, xres);
+	else if (simd == simd_sse41) x = detail::rgb_to_yuv_sse41(p_y, p_uv, p_src, c, xres);
+#endif
+	detail::rgb_to_yuv_scalar(p_y, p_uv, p_src, c, x, xres);
+}
+
+inline void yuv_to_rgb_line(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_uv, const coefficients_t& c, const int xres, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd == simd_avx2) x = detail::yuv_to_rgb_avx2(p_dst, p_y, p_uv, c, xres);
+	else if (simd == simd_sse41) x = detail::yuv_to_rgb_sse41(p_dst, p_y, p_uv, c, xres);
+#endif
+	detail::yuv_to_rgb_scalar(p_dst, p_y, p_uv, c, x, xres);
+}
+
+inline void uyvy_to_yuv_line(uint16_t* p_y, uint16_t* p_uv, const uint8_t* p_src, const int xres, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd != simd_scalar) x = detail::uyvy_to_yuv_sse41(p_y, p_uv, p_src, xres);
+#endif
+	detail::uyvy_to_yuv_scalar(p_y, p_uv, p_src, x, xres);
+}
+
+inline void yuv_to_uyvy_line(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_uv, const int xres, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd != simd_scalar) x = detail::yuv_to_uyvy_sse41(p_dst, p_y, p_uv, xres);
+#endif
+	detail::yuv_to_uyvy_scalar(p_dst, p_y, p_uv, x, xres);
+}
+
+// 8 bit samples to 16 bit and back, for instance the Y plane of NV12
+inline void widen_line(uint16_t* p_dst, const uint8_t* p_src, const int n, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd != simd_scalar) x = detail::widen_sse41(p_dst, p_src, n);
+#endif
+	detail::widen_scalar(p_dst, p_src, x, n);
+}
+
+inline void narrow_line(uint8_t* p_dst, const uint16_t* p_src, const int n, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd != simd_scalar) x = detail::narrow_sse41(p_dst, p_src, n);
+#endif
+	detail::narrow_scalar(p_dst, p_src, x, n);
+}
+
+// The 4:2:0 chroma for two lines of 4:2:2 chroma, interleaved as NV12 or as separate U and V lines as I420
+inline void narrow_chroma_line(uint8_t* p_dst, const uint16_t* p_uv_0, const uint16_t* p_uv_1, const int n, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd != simd_scalar) x = detail::narrow_chroma_sse41(p_dst, p_uv_0, p_uv_1, n);
+#endif
+	detail::narrow_chroma_scalar(p_dst, p_uv_0, p_uv_1, x, n);
+}
+
+inline void narrow_chroma_planar_line(uint8_t* p_u, uint8_t* p_v, const uint16_t* p_uv_0, const uint16_t* p_uv_1, const int n, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd != simd_scalar) x = detail::narrow_chroma_planar_sse41(p_u, p_v, p_uv_0, p_uv_1, n);
+#endif
+	detail::narrow_chroma_planar_scalar(p_u, p_v, p_uv_0, p_uv_1, x, n);
+}
+
+inline void widen_chroma_planar_line(uint16_t* p_uv, const uint8_t* p_u, const uint8_t* p_v, const int n, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd != simd_scalar) x = detail::widen_chroma_planar_sse41(p_uv, p_u, p_v, n);
+#endif
+	detail::widen_chroma_planar_scalar(p_uv, p_u, p_v, x, n);
+}
+
+inline void rgb_to_rgb_line(uint8_t* p_dst, const uint8_t* p_src, const bool swap, const bool opaque, const int xres, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd != simd_scalar) x = detail::rgb_to_rgb_sse41(p_dst, p_src, swap, opaque, xres);
+#endif
+	detail::rgb_to_rgb_scalar(p_dst, p_src, swap, opaque, x, xres);
+}
+
+// The kinds of memory layout that the formats have
+enum layout_e {
+	layout_rgb,		// BGRA, BGRX, RGBA and RGBX
+	layout_uyvy,	// UYVY, and UYVA with an 8 bit alpha plane after it with half the line stride
+	layout_nv12,	// A Y plane and then a plane of interleaved UV at half the height, with the same line stride
+	layout_i420,	// A Y plane and then U and V planes (V and U for YV12) at half the height with half the line stride
+	layout_p216		// P216, and PA16 with a 16 bit alpha plane after it with the same line stride
+};
+
+struct format_t {
+	layout_e layout;
+	bool alpha;		// Does it have alpha
+	bool swap;		// RGBA rather than BGRA, or YV12 rather than I420
+};
+
+// Is a format supported, and what is it
+inline bool get_format(const NDIlib_FourCC_video_type_e FourCC, format_t& format)
+{
+	format.alpha = false;
+	format.swap = false;
+
+	switch (FourCC) {
+		case NDIlib_FourCC_type_BGRA: format.alpha = true; // Fall through
+		case NDIlib_FourCC_type_BGRX: format.layout = layout_rgb; return true;
+		case NDIlib_FourCC_type_RGBA: format.alpha = true; // Fall through
+		case NDIlib_FourCC_type_RGBX: format.layout = layout_rgb; format.swap = true; return true;
+		case NDIlib_FourCC_type_UYVA: format.alpha = true; // Fall through
+		case NDIlib_FourCC_type_UYVY: format.layout = layout_uyvy; return true;
+		case NDIlib_FourCC_type_NV12: format.layout = layout_nv12; return true;
+		case NDIlib_FourCC_type_YV12: format.swap = true; // Fall through
+		case NDIlib_FourCC_type_I420: format.layout = layout_i420; return true;
+		case NDIlib_FourCC_type_PA16: format.alpha = true; // Fall through
+		case NDIlib_FourCC_type_P216: format.layout = layout_p216; return true;
+		default: return false;
+	}
+}
+
+// The line stride that a format has by default, which is the one for its first plane
+inline int line_stride(const NDIlib_FourCC_video_type_e FourCC, const int xres)
+{
+	format_t format;
+	if (!get_format(FourCC, format))
+		return 0;
+
+	switch (format.layout) {
+		case layout_rgb: return xres * 4;
+		case layout_uyvy: return xres * 2;
+		case layout_p216: return xres * (int)sizeof(uint16_t);
+		default: return xres;
+	}
+}
+
+// The size of a frame, including any chroma and alpha planes
+inline size_t frame_size(const NDIlib_FourCC_video_type_e FourCC, const int xres, const int yres, int line_stride_in_bytes = 0)
+{
+	format_t format;
+	if (!get_format(FourCC, format))
+		return 0;
+	if (!line_stride_in_bytes)
+		line_stride_in_bytes = line_stride(FourCC, xres);
+
+	const size_t plane_size = (size_t)line_stride_in_bytes * yres;
+	const size_t chroma_lines = (size_t)(yres + 1) / 2;
+	switch (format.layout) {
+		case layout_rgb: return plane_size;
+		case layout_uyvy: return plane_size + (format.alpha ? (size_t)(line_stride_in_bytes / 2) * yres : 0);
+		case layout_nv12: return plane_size + (size_t)line_stride_in_bytes * chroma_lines;
+		case layout_i420: return plane_size + (size_t)(line_stride_in_bytes / 2) * chroma_lines * 2;
+		case layout_p216: return plane_size * (format.alpha ? 3 : 2);
+		default: return 0;
+	}
+}
+
+// Converts whole frames between any two of the formats, splitting the rows across a pool of threads. A converter keeps
+// its threads, so it is worth keeping one around rather than creating it for each frame. It should only be used by one
+// thread at a time.
+class converter {
+public:
+	// no_threads = 0 means one per CPU
+	explicit converter(const matrix_e matrix = matrix_bt709, const range_e range = range_limited, const int no_threads = 0, const simd_e simd = detect_simd())
+		: m_matrix(matrix), m_range(range), m_simd(simd), m_threads(no_threads),
+		  m_bgra(make_coefficients(matrix, range, false)), m_rgba(make_coefficients(matrix, range, true)), m_scratch_xres(0)
+	{
+	}
+
+	matrix_e matrix(void) const { return m_matrix; }
+	range_e range(void) const { return m_range; }
+	simd_e simd(void) const { return m_simd; }
+	int no_threads(void) const { return m_threads.no_threads(); }
+
+	// Convert a frame into the FourCC of the destination, which must have p_data allocated with at least frame_size bytes.
+	// The rest of its description is filled in from the source, and a line stride of zero in either frame means the
+	// default. This fails when either format is not supported, or when xres is odd and either format is YUV.
+	bool convert(const NDIlib_video_frame_v2_t* p_src, NDIlib_video_frame_v2_t* p_dst)
+	{
+		frame_t src, dst;
+		if (!get_format(p_src->FourCC, src.format) || !get_format(p_dst->FourCC, dst.format))
+			return false;
+
+		const int xres = p_src->xres, yres = p_src->yres;
+		const bool all_rgb = (src.format.layout == layout_rgb) && (dst.format.layout == layout_rgb);
+		if ((xres <= 0) || (yres <= 0) || (!all_rgb && (xres & 1)) || !p_src->p_data || !p_dst->p_data)
+			return false;
+
+		describe(p_src, p_dst, p_dst->FourCC, line_stride(p_dst->FourCC, xres));
+		src.p_data = p_src->p_data;
+		src.stride = p_src->line_stride_in_bytes ? p_src->line_stride_in_bytes : line_stride(p_src->FourCC, xres);
+		src.yres = yres;
+		dst.p_data = p_dst->p_data;
+		dst.stride = p_dst->line_stride_in_bytes;
+		dst.yres = yres;
+
+		// Each band has its own 16 bit lines, which are only allocated again when the resolution gets wider
+		if (m_scratch_xres < xres) {
+			m_scratch.assign(m_threads.no_threads(), std::vector<uint16_t>((size_t)xres * 5));
+			m_scratch_xres = xres;
+		}
+
+		// Bands start on even lines, so that each pair of lines for 4:2:0 is in one band
+		m_threads.run_bands(yres, [&](const int band, const int y_start, const int y_end) {
+			convert_lines(src, dst, xres, y_start, y_end, m_scratch[band].data());
+		}, 16, 2);
+
+		return true;
+	}
+
+private:
+	converter(const converter&);
+	converter& operator=(const converter&);
+
+	// Where the lines of each plane of a frame are
+	struct frame_t {
+		format_t format;
+		uint8_t* p_data;
+		int stride, yres;
+
+		uint8_t* line(const int y) const { return p_data + (size_t)y * stride; }
+		uint8_t* chroma_line(const int y) const { return p_data + (size_t)(yres + y / 2) * stride; }
+		uint8_t* uv_line(const int y) const { return p_data + (size_t)(yres + y) * stride; }
+
+		// I420 has U and then V, YV12 has them the other way around
+		uint8_t* u_line(const int y) const { return planar_line(y, format.swap ? 1 : 0); }
+		uint8_t* v_line(const int y) const { return planar_line(y, format.swap ? 0 : 1); }
+		uint8_t* planar_line(const int y, const int plane) const
+		{
+			return p_data + (size_t)stride * yres + (size_t)(stride / 2) * ((size_t)plane * ((yres + 1) / 2) + y / 2);
+		}
+
+		// The alpha planes of UYVA and PA16
+		uint8_t* alpha_line(const int y) const
+		{
+			if (format.layout == layout_uyvy)
+				return p_data + (size_t)stride * yres + (size_t)(stride / 2) * y;
+			return p_data + (size_t)stride * (yres * 2 + y);
+		}
+	};
+
+	void convert_lines(const frame_t& src, const frame_t& dst, const int xres, const int y_start, const int y_end, uint16_t* p_scratch)
+	{
+		// RGB to RGB is just a matter of moving the bytes
+		if ((src.format.layout == layout_rgb) && (dst.format.layout == layout_rgb)) {
+			for (int y = y_start; y < y_end; y++)
+				rgb_to_rgb_line(dst.line(y), src.line(y), src.format.swap != dst.format.swap, !src.format.alpha, xres, m_simd);
+			return;
+		}
+
+		// The 16 bit lines for two rows, and a line of alpha, in the band's xres * 5 values of scratch. When the source or
+		// destination is P216, its own lines are used instead.
+		uint16_t* p_alpha = p_scratch + (size_t)xres * 4;
+
+		const coefficients_t& src_coefficients = src.format.swap ? m_rgba : m_bgra;
+		const coefficients_t& dst_coefficients = dst.format.swap ? m_rgba : m_bgra;
+
+		for (int y = y_start; y < y_end; y += 2) {
+			const int no_lines = std::min(2, y_end - y);
+
+			uint16_t* p_y[2];
+			uint16_t* p_uv[2];
+			for (int i = 0; i < no_lines; i++) {
+				const frame_t* p_frame = (src.format.layout == layout_p216) ? &src : (dst.format.layout == layout_p216) ? &dst : NULL;
+				p_y[i] = p_frame ? (uint16_t*)p_frame->line(y + i) : p_scratch + (size_t)xres * i;
+				p_uv[i] = p_frame ? (uint16_t*)p_frame->uv_line(y + i) : p_scratch + (size_t)xres * (2 + i);
+			}
+
+			// Convert the source into 16 bit lines
+			switch (src.format.layout) {
+				case layout_rgb:
+					for (int i = 0; i < no_lines; i++)
+						rgb_to_yuv_line(p_y[i], p_uv[i], src.line(y + i), src_coefficients, xres, m_simd);
+					break;
+
+				case layout_uyvy:
+					for (int i = 0; i < no_lines; i++)
+						uyvy_to_yuv_line(p_y[i], p_uv[i], src.line(y + i), xres, m_simd);
+					break;
+
+				case layout_nv12:
+				case layout_i420:
+					for (int i = 0; i < no_lines; i++)
+						widen_line(p_y[i], src.line(y + i), xres, m_simd);
+
+					// Both lines have the same chroma. Unless we are writing straight into P216, the second line can just
+					// use the first one's.
+					if (src.format.layout == layout_nv12)
+						widen_line(p_uv[0], src.chroma_line(y), xres, m_simd);
+					else
+						widen_chroma_planar_line(p_uv[0], src.u_line(y), src.v_line(y), xres, m_simd);
+
+					if (no_lines > 1) {
+						if (dst.format.layout == layout_p216)
+							memcpy(p_uv[1], p_uv[0], (size_t)xres * sizeof(uint16_t));
+						else
+							p_uv[1] = p_uv[0];
+					}
+					break;
+
+				case layout_p216:
+					break;
+			}
+
+			// And then into the destination
+			switch (dst.format.layout) {
+				case layout_rgb:
+					for (int i = 0; i < no_lines; i++)
+						yuv_to_rgb_line(dst.line(y + i), p_y[i], p_uv[i], dst_coefficients, xres, m_simd);
+					break;
+
+				case layout_uyvy:
+					for (int i = 0; i < no_lines; i++)
+						yuv_to_uyvy_line(dst.line(y + i), p_y[i], p_uv[i], xres, m_simd);
+					break;
+
+				case layout_nv12:
+				case layout_i420:
+					for (int i = 0; i < no_lines; i++)
+						narrow_line(dst.line(y + i), p_y[i], xres, m_simd);
+
+					if (dst.format.layout == layout_nv12)
+						narrow_chroma_line(dst.chroma_line(y), p_uv[0], p_uv[no_lines - 1], xres, m_simd);
+					else
+						narrow_chroma_planar_line(dst.u_line(y), dst.v_line(y), p_uv[0], p_uv[no_lines - 1], xres, m_simd);
+					break;
+
+				case layout_p216:
+					// Only P216 to P216 is not already in place
+					for (int i = 0; (i < no_lines) && (src.format.layout == layout_p216) && (src.p_data != dst.p_data); i++) {
+						memcpy(dst.line(y + i), p_y[i], (size_t)xres * sizeof(uint16_t));
+						memcpy(dst.uv_line(y + i), p_uv[i], (size_t)xres * sizeof(uint16_t));
+					}
+					break;
+			}
+
+			// RGB without alpha in the source is already opaque
+			if (dst.format.alpha && (src.format.alpha || (dst.format.layout != layout_rgb))) {
+				for (int i = 0; i < no_lines; i++) {
+					read_alpha(p_alpha, src, y + i, xres);
+					write_alpha(dst, y + i, p_alpha, xres);
+				}
+			}
+		}
+	}
+
+	// Alpha is carried as 16 bit, where 8 bit alpha is multiplied by 257 so that opaque is 65535
+	static void read_alpha(uint16_t* p_alpha, const frame_t& src, const int y, const int xres)
+	{
+		if (!src.format.alpha) {
+			std::fill_n(p_alpha, xres, (uint16_t)65535);
+			return;
+		}
+
+		switch (src.format.layout) {
+			case layout_rgb: {
+				const uint8_t* p_src = src.line(y);
+				for (int x = 0; x < xres; x++)
+					p_alpha[x] = (uint16_t)(p_src[x * 4 + 3] * 257);
+				break;
+			}
+
+			case layout_uyvy: {
+				const uint8_t* p_src = src.alpha_line(y);
+				for (int x = 0; x < xres; x++)
+					p_alpha[x] = (uint16_t)(p_src[x] * 257);
+				break;
+			}
+
+			default:
+				memcpy(p_alpha, src.alpha_line(y), (size_t)xres * sizeof(uint16_t));
+				break;
+		}
+	}
+
+	static void write_alpha(const frame_t& dst, const int y, const uint16_t* p_alpha, const int xres)
+	{
+		switch (dst.format.layout) {
+			case layout_rgb: {
+				uint8_t* p_dst = dst.line(y);
+				for (int x = 0; x < xres; x++)
+					p_dst[x * 4 + 3] = detail::narrow(p_alpha[x]);
+				break;
+			}
+
+			case layout_uyvy: {
+				uint8_t* p_dst = dst.alpha_line(y);
+				for (int x = 0; x < xres; x++)
+					p_dst[x] = detail::narrow(p_alpha[x]);
+				break;
+			}
+
+			default:
+				memcpy(dst.alpha_line(y), p_alpha, (size_t)xres * sizeof(uint16_t));
+				break;
+		}
+	}
+
+	// Describe the output frame from the input frame
+	static void describe(const NDIlib_video_frame_v2_t* p_src, NDIlib_video_frame_v2_t* p_dst, const NDIlib_FourCC_video_type_e FourCC, const int default_stride)
+	{
+		p_dst->xres = p_src->xres;
+		p_dst->yres = p_src->yres;
+		p_dst->FourCC = FourCC;
+		p_dst->frame_rate_N = p_src->frame_rate_N;
+		p_dst->frame_rate_D = p_src->frame_rate_D;
+		p_dst->picture_aspect_ratio = p_src->picture_aspect_ratio;
+		p_dst->frame_format_type = p_src->frame_format_type;
+		p_dst->timecode = p_src->timecode;
+		if (!p_dst->line_stride_in_bytes)
+			p_dst->line_stride_in_bytes = default_stride;
+	}
+
+	matrix_e m_matrix;
+	range_e m_range;
+	simd_e m_simd;
+	ndi_thread::band_pool m_threads;
+	coefficients_t m_bgra, m_rgba;
+
+	// The 16 bit lines for each band, for frames up to m_scratch_xres wide
+	std::vector<std::vector<uint16_t>> m_scratch;
+	int m_scratch_xres;
+};
+
+} // namespace ndi_color
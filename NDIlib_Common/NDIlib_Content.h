@@ -0,0 +1,626 @@
+#pragma once
+
+// Test content for the send benchmarks. How fast NDI can compress a frame depends a great deal on what is in it, so
+// this can generate several classes of content with very different entropy :
+//		gradient	Smooth, slowly changing colour gradients. This is the pattern the benchmarks have always used.
+//		noise		Per pixel random values, the worst case for any compressor.
+//		text		Lines of large text scrolling horizontally at different speeds over flat backgrounds.
+//		camera		Low frequency gradients with sensor-like grain, which is roughly what a real camera looks like.
+//
+// Frames are generated with SSE4.1 or AVX2 when the CPU supports them (selected at run-time, with a scalar fallback)
+// and the rows of each frame are split across threads, so that even 8K frames only take a few milliseconds.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "NDIlib_Thread.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define NDI_CONTENT_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef _WIN32
+#define strcasecmp _stricmp
+#else
+#include <strings.h>
+#endif
+
+// Functions that use a particular instruction set are compiled for it individually, so that the rest of the
+// application does not need to be built for a CPU that might not support it.
+#if defined(NDI_CONTENT_X86) && (defined(__GNUC__) || defined(__clang__))
+#define NDI_CONTENT_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define NDI_CONTENT_TARGET_AVX2  __attribute__((target("avx2")))
+#else
+#define NDI_CONTENT_TARGET_SSE41
+#define NDI_CONTENT_TARGET_AVX2
+#endif
+
+namespace ndi_content {
+
+// The classes of content that can be generated
+enum content_e {
+	content_gradient,
+	content_noise,
+	content_text,
+	content_camera,
+	content_max
+};
+
+inline const char* content_name(const content_e content)
+{
+	static const char* const p_names[content_max] = { "gradient", "noise", "text", "camera" };
+	return ((content >= 0) && (content < content_max)) ? p_names[content] : "unknown";
+}
+
+// Get a content class from its name, returns false if it is not known.
+inline bool parse_content(const char* p_name, content_e& content)
+{
+	for (int i = 0; i < content_max; i++) {
+		if (strcasecmp(p_name, content_name((content_e)i)) == 0) {
+			content = (content_e)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// The instruction sets that can be used
+enum simd_e {
+	simd_scalar,
+	simd_sse41,
+	simd_avx2
+};
+
+inline const char* simd_name(const simd_e simd)
+{
+	return (simd == simd_avx2) ? "AVX2" : (simd == simd_sse41) ? "SSE4.1" : "scalar";
+}
+
+// Get the best instruction set that this CPU supports.
+inline simd_e detect_simd(void)
+{
+#if defined(NDI_CONTENT_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	const int max_leaf = info[0];
+
+	__cpuid(info, 1);
+	const bool sse41 = (info[2] & (1 << 19)) != 0;
+	const bool os_avx = ((info[2] & (1 << 27)) != 0) && ((_xgetbv(0) & 6) == 6);
+
+	bool avx2 = false;
+	if (os_avx && (max_leaf >= 7)) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+
+	return avx2 ? simd_avx2 : sse41 ? simd_sse41 : simd_scalar;
+#elif defined(NDI_CONTENT_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return simd_avx2;
+	if (__builtin_cpu_supports("sse4.1"))
+		return simd_sse41;
+	return simd_scalar;
+#else
+	return simd_scalar;
+#endif
+}
+
+namespace detail {
+
+// The hash that is used for noise and grain. It is a well mixed function of the position and frame number so that
+// every pixel of every frame is different, but it is repeatable.
+inline uint32_t hash(const uint32_t x, const uint32_t y_seed)
+{
+	uint32_t h = (x * 0x9E3779B1u) ^ y_seed;
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	h ^= h >> 12;
+	h *= 0x297A2D39u;
+	h ^= h >> 15;
+	return h;
+}
+
+inline uint32_t row_seed(const int y, const int frame_no)
+{
+	return ((uint32_t)y * 0x85EBCA77u) + ((uint32_t)frame_no * 0x27D4EB2Fu);
+}
+
+// Each channel of a gradient is 0.5 + 0.5*cos(a*x + b*y). Since cos(A + B) = cos(A)cos(B) - sin(A)sin(B), we keep a
+// table of cos(A) and sin(A) for each column, which leaves only a multiply and subtract per pixel.
+struct gradient_row_t {
+	const float* p_cos[3];	// Per column, for R, G and B
+	const float* p_sin[3];
+	float cos_y[3];			// For this row
+	float sin_y[3];
+};
+
+// Scalar versions of each row function. These are also used for the pixels at the end of each row.
+inline void gradient_row_scalar(uint32_t* p_dst, const gradient_row_t& row, const int x0, const int xres)
+{
+	for (int x = x0; x < xres; x++) {
+		uint32_t bgra = 0xFF000000u;
+		for (int c = 0; c < 3; c++) {
+			const float v = (row.p_cos[c][x] * row.cos_y[c] - row.p_sin[c][x] * row.sin_y[c]) * 0.5f + 0.5f;
+			const int i = (int)(std::min(std::max(v, 0.0f), 1.0f) * 255.0f);
+			bgra |= (uint32_t)i << (16 - c * 8);
+		}
+		p_dst[x] = bgra;
+	}
+}
+
+inline void noise_row_scalar(uint32_t* p_dst, const uint32_t seed, const int x0, const int xres)
+{
+	for (int x = x0; x < xres; x++)
+		p_dst[x] = hash((uint32_t)x, seed) | 0xFF000000u;
+}
+
+// Grain is added to each colour channel as a value in [-8, 7], with saturation.
+inline void grain_row_scalar(uint32_t* p_dst, const uint32_t seed, const int x0, const int xres)
+{
+	for (int x = x0; x < xres; x++) {
+		const uint32_t grain = hash((uint32_t)x, seed);
+		uint32_t bgra = p_dst[x] & 0xFF000000u;
+		for (int c = 0; c < 24; c += 8) {
+			const int v = (int)((p_dst[x] >> c) & 0xFF) + (int)((grain >> c) & 0x0F);
+			bgra |= (uint32_t)std::max(0, std::min(255, v) - 8) << c;
+		}
+		p_dst[x] = bgra;
+	}
+}
+
+// Convert BGRA to UYVY with the same integer colour conversion the benchmarks have always used. Chroma is the average
+// of each pair of pixels.
+inline void bgra_to_uyvy_scalar(uint8_t* p_dst, const uint32_t* p_src, const int x0, const int xres)
+{
+	for (int x = x0; x < xres; x += 2) {
+		const int b0 = p_src[x] & 0xFF, g0 = (p_src[x] >> 8) & 0xFF, r0 = (p_src[x] >> 16) & 0xFF;
+		const int b1 = p_src[x + 1] & 0xFF, g1 = (p_src[x + 1] >> 8) & 0xFF, r1 = (p_src[x + 1] >> 16) & 0xFF;
+
+		const int u = (112 * b0 - 87 * g0 - 26 * r0) + (112 * b1 - 87 * g1 - 26 * r1);
+		const int v = (112 * r0 - 10 * b0 - 102 * g0) + (112 * r1 - 10 * b1 - 102 * g1);
+
+		uint8_t* p_out = p_dst + x * 2;
+		p_out[0] = (uint8_t)std::max(0, std::min(255, (u >> 9) + 128));
+		p_out[1] = (uint8_t)std::max(0, std::min(255, ((16 * b0 + 157 * g0 + 47 * r0) >> 8) + 16));
+		p_out[2] = (uint8_t)std::max(0, std::min(255, (v >> 9) + 128));
+		p_out[3] = (uint8_t)std::max(0, std::min(255, ((16 * b1 + 157 * g1 + 47 * r1) >> 8) + 16));
+	}
+}
+
+#ifdef NDI_CONTENT_X86
+
+// SSE4.1 versions, four pixels at a time
+NDI_CONTENT_TARGET_SSE41 inline __m128i hash_sse41(const __m128i x, const __m128i seed)
+{
+	__m128i h = _mm_xor_si128(_mm_mullo_epi32(x, _mm_set1_epi32((int)0x9E3779B1u)), seed);
+	h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+	h = _mm_mullo_epi32(h, _mm_set1_epi32(0x2C1B3C6D));
+	h = _mm_xor_si128(h, _mm_srli_epi32(h, 12));
+	h = _mm_mullo_epi32(h, _mm_set1_epi32(0x297A2D39));
+	return _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+}
+
+NDI_CONTENT_TARGET_SSE41 inline void gradient_row_sse41(uint32_t* p_dst, const gradient_row_t& row, const int xres)
+{
+	const __m128 half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(255.0f);
+	__m128 cos_y[3], sin_y[3];
+	for (int c = 0; c < 3; c++) {
+		cos_y[c] = _mm_set1_ps(row.cos_y[c]);
+		sin_y[c] = _mm_set1_ps(row.sin_y[c]);
+	}
+
+	int x = 0;
+	for (; x + 4 <= xres; x += 4) {
+		__m128i bgra = _mm_set1_epi32((int)0xFF000000u);
+		for (int c = 0; c < 3; c++) {
+			__m128 v = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(row.p_cos[c] + x), cos_y[c]), _mm_mul_ps(_mm_loadu_ps(row.p_sin[c] + x), sin_y[c]));
+			v = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(v, half), half), zero), one);
+			bgra = _mm_or_si128(bgra, _mm_slli_epi32(_mm_cvttps_epi32(_mm_mul_ps(v, scale)), 16 - c * 8));
+		}
+		_mm_storeu_si128((__m128i*)(p_dst + x), bgra);
+	}
+
+	gradient_row_scalar(p_dst, row, x, xres);
+}
+
+NDI_CONTENT_TARGET_SSE41 inline void noise_row_sse41(uint32_t* p_dst, const uint32_t seed, const int xres)
+{
+	const __m128i seed_4 = _mm_set1_epi32((int)seed), alpha = _mm_set1_epi32((int)0xFF000000u), step = _mm_set1_epi32(4);
+	__m128i x_4 = _mm_setr_epi32(0, 1, 2, 3);
+
+	int x = 0;
+	for (; x + 4 <= xres; x += 4, x_4 = _mm_add_epi32(x_4, step))
+		_mm_storeu_si128((__m128i*)(p_dst + x), _mm_or_si128(hash_sse41(x_4, seed_4), alpha));
+
+	noise_row_scalar(p_dst, seed, x, xres);
+}
+
+NDI_CONTENT_TARGET_SSE41 inline void grain_row_sse41(uint32_t* p_dst, const uint32_t seed, const int xres)
+{
+	const __m128i seed_4 = _mm_set1_epi32((int)seed), mask = _mm_set1_epi32(0x000F0F0F), bias = _mm_set1_epi32(0x00080808), step = _mm_set1_epi32(4);
+	__m128i x_4 = _mm_setr_epi32(0, 1, 2, 3);
+
+	int x = 0;
+	for (; x + 4 <= xres; x += 4, x_4 = _mm_add_epi32(x_4, step)) {
+		const __m128i grain = _mm_and_si128(hash_sse41(x_4, seed_4), mask);
+		const __m128i src = _mm_loadu_si128((const __m128i*)(p_dst + x));
+		_mm_storeu_si128((__m128i*)(p_dst + x), _mm_subs_epu8(_mm_adds_epu8(src, grain), bias));
+	}
+
+	grain_row_scalar(p_dst, seed, x, xres);
+}
+
+// Eight pixels at a time. _mm_madd_epi16 gives us b*cb + g*cg and r*cr for each pixel, and _mm_hadd_epi32 adds those
+// together. Chroma is added across each pair of pixels with a second _mm_hadd_epi32.
+NDI_CONTENT_TARGET_SSE41 inline void bgra_to_uyvy_sse41(uint8_t* p_dst, const uint32_t* p_src, const int xres)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i coeff_y = _mm_setr_epi16(16, 157, 47, 0, 16, 157, 47, 0);
+	const __m128i coeff_u = _mm_setr_epi16(112, -87, -26, 0, 112, -87, -26, 0);
+	const __m128i coeff_v = _mm_setr_epi16(-10, -102, 112, 0, -10, -102, 112, 0);
+	const __m128i offset_y = _mm_set1_epi32(16), offset_uv = _mm_set1_epi32(128);
+
+	int x = 0;
+	for (; x + 8 <= xres; x += 8) {
+		const __m128i src_0 = _mm_loadu_si128((const __m128i*)(p_src + x));
+		const __m128i src_1 = _mm_loadu_si128((const __m128i*)(p_src + x + 4));
+		const __m128i px[4] = {
+			_mm_unpacklo_epi8(src_0, zero), _mm_unpackhi_epi8(src_0, zero),
+			_mm_unpacklo_epi8(src_1, zero), _mm_unpackhi_epi8(src_1, zero)
+		};
+
+		// Luma for the eight pixels
+		const __m128i y_0 = _mm_hadd_epi32(_mm_madd_epi16(px[0], coeff_y), _mm_madd_epi16(px[1], coeff_y));
+		const __m128i y_1 = _mm_hadd_epi32(_mm_madd_epi16(px[2], coeff_y), _mm_madd_epi16(px[3], coeff_y));
+		const __m128i y = _mm_packs_epi32(_mm_add_epi32(_mm_srai_epi32(y_0, 8), offset_y), _mm_add_epi32(_mm_srai_epi32(y_1, 8), offset_y));
+
+		// Chroma for the four pairs
+		const __m128i u = _mm_hadd_epi32(
+			_mm_hadd_epi32(_mm_madd_epi16(px[0], coeff_u), _mm_madd_epi16(px[1], coeff_u)),
+			_mm_hadd_epi32(_mm_madd_epi16(px[2], coeff_u), _mm_madd_epi16(px[3], coeff_u)));
+		const __m128i v = _mm_hadd_epi32(
+			_mm_hadd_epi32(_mm_madd_epi16(px[0], coeff_v), _mm_madd_epi16(px[1], coeff_v)),
+			_mm_hadd_epi32(_mm_madd_epi16(px[2], coeff_v), _mm_madd_epi16(px[3], coeff_v)));
+		const __m128i uv = _mm_unpacklo_epi16(
+			_mm_packs_epi32(_mm_add_epi32(_mm_srai_epi32(u, 9), offset_uv), zero),
+			_mm_packs_epi32(_mm_add_epi32(_mm_srai_epi32(v, 9), offset_uv), zero));
+
+		// U0 Y0 V0 Y1 U1 Y2 V1 Y3 ..., and saturate to 8 bits
+		_mm_storeu_si128((__m128i*)(p_dst + x * 2), _mm_packus_epi16(_mm_unpacklo_epi16(uv, y), _mm_unpackhi_epi16(uv, y)));
+	}
+
+	bgra_to_uyvy_scalar(p_dst, p_src, x, xres);
+}
+
+// AVX2 versions, eight pixels at a time
+NDI_CONTENT_TARGET_AVX2 inline __m256i hash_avx2(const __m256i x, const __m256i seed)
+{
+	__m256i h = _mm256_xor_si256(_mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x9E3779B1u)), seed);
+	h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+	h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x2C1B3C6D));
+	h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 12));
+	h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x297A2D39));
+	return _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+}
+
+NDI_CONTENT_TARGET_AVX2 inline void gradient_row_avx2(uint32_t* p_dst, const gradient_row_t& row, const int xres)
+{
+	const __m256 half = _mm256_set1_ps(0.5f), zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), scale = _mm256_set1_ps(255.0f);
+	__m256 cos_y[3], sin_y[3];
+	for (int c = 0; c < 3; c++) {
+		cos_y[c] = _mm256_set1_ps(row.cos_y[c]);
+		sin_y[c] = _mm256_set1_ps(row.sin_y[c]);
+	}
+
+	int x = 0;
+	for (; x + 8 <= xres; x += 8) {
+		__m256i bgra = _mm256_set1_epi32((int)0xFF000000u);
+		for (int c = 0; c < 3; c++) {
+			__m256 v = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(row.p_cos[c] + x), cos_y[c]), _mm256_mul_ps(_mm256_loadu_ps(row.p_sin[c] + x), sin_y[c]));
+			v = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_mul_ps(v, half), half), zero), one);
+			bgra = _mm256_or_si256(bgra, _mm256_slli_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(v, scale)), 16 - c * 8));
+		}
+		_mm256_storeu_si256((__m256i*)(p_dst + x), bgra);
+	}
+
+	gradient_row_scalar(p_dst, row, x, xres);
+}
+
+NDI_CONTENT_TARGET_AVX2 inline void noise_row_avx2(uint32_t* p_dst, const uint32_t seed, const int xres)
+{
+	const __m256i seed_8 = _mm256_set1_epi32((int)seed), alpha = _mm256_set1_epi32((int)0xFF000000u), step = _mm256_set1_epi32(8);
+	__m256i x_8 = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	int x = 0;
+	for (; x + 8 <= xres; x += 8, x_8 = _mm256_add_epi32(x_8, step))
+		_mm256_storeu_si256((__m256i*)(p_dst + x), _mm256_or_si256(hash_avx2(x_8, seed_8), alpha));
+
+	noise_row_scalar(p_dst, seed, x, xres);
+}
+
+NDI_CONTENT_TARGET_AVX2 inline void grain_row_avx2(uint32_t* p_dst, const uint32_t seed, const int xres)
+{
+	const __m256i seed_8 = _mm256_set1_epi32((int)seed), mask = _mm256_set1_epi32(0x000F0F0F), bias = _mm256_set1_epi32(0x00080808), step = _mm256_set1_epi32(8);
+	__m256i x_8 = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	int x = 0;
+	for (; x + 8 <= xres; x += 8, x_8 = _mm256_add_epi32(x_8, step)) {
+		const __m256i grain = _mm256_and_si256(hash_avx2(x_8, seed_8), mask);
+		const __m256i src = _mm256_loadu_si256((const __m256i*)(p_dst + x));
+		_mm256_storeu_si256((__m256i*)(p_dst + x), _mm256_subs_epu8(_mm256_adds_epu8(src, grain), bias));
+	}
+
+	grain_row_scalar(p_dst, seed, x, xres);
+}
+
+#endif // NDI_CONTENT_X86
+
+// A 5x7 font for the text content, each row is 5 bits with the left-most pixel in bit 4.
+inline const uint8_t* glyph(const char ch)
+{
+	static const uint8_t glyphs[][7] = {
+		{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E }, { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },	// 0 1
+		{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F }, { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },	// 2 3
+		{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 }, { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },	// 4 5
+		{ 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E }, { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },	// 6 7
+		{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E }, { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },	// 8 9
+		{ 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 }, { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E },	// A B
+		{ 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E }, { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C },	// C D
+		{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 },	// E F
+		{ 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F }, { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },	// G H
+		{ 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C },	// I J
+		{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F },	// K L
+		{ 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 }, { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },	// M N
+		{ 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 },	// O P
+		{ 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D }, { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 },	// Q R
+		{ 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E }, { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },	// S T
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 },	// U V
+		{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A }, { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 },	// W X
+		{ 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 }, { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F },	// Y Z
+		{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 }, { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 },	// : -
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C }, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// . space
+	};
+
+	if ((ch >= '0') && (ch <= '9')) return glyphs[ch - '0'];
+	if ((ch >= 'A') && (ch <= 'Z')) return glyphs[10 + ch - 'A'];
+	if (ch == ':') return glyphs[36];
+	if (ch == '-') return glyphs[37];
+	if (ch == '.') return glyphs[38];
+	return glyphs[39];
+}
+
+} // namespace detail
+
+// Generates frames of one class of content. A generator keeps some tables for the current resolution, so it is
+// worth keeping one around rather than creating it for each frame. A single generator should only be used by one
+// thread at a time, it uses its own threads internally.
+class generator {
+public:
+	// no_threads = 0 means one per CPU
+	generator(const content_e content = content_gradient, const int no_threads = 0, const simd_e simd = detect_simd())
+		: m_content(content), m_simd(simd), m_no_threads(no_threads ? no_threads : ndi_thread::no_cpus()), m_table_xres(0)
+	{
+	}
+
+	content_e content(void) const { return m_content; }
+	simd_e simd(void) const { return m_simd; }
+
+	// Generate a BGRA frame. The frame number moves the content, so that consecutive frames are different.
+	void generate_bgra(uint8_t* p_dst, const int xres, const int yres, const int line_stride_in_bytes, const int frame_no)
+	{
+		prepare(xres);
+		parallel_rows(yres, [&](const int y_start, const int y_end) {
+			for (int y = y_start; y < y_end; y++)
+				render_row((uint32_t*)(p_dst + (size_t)y * line_stride_in_bytes), xres, y, frame_no);
+		});
+	}
+
+	// Generate a UYVY frame, xres must be even.
+	void generate_uyvy(uint8_t* p_dst, const int xres, const int yres, const int line_stride_in_bytes, const int frame_no)
+	{
+		prepare(xres);
+		parallel_rows(yres, [&](const int y_start, const int y_end) {
+			std::vector<uint32_t> bgra(xres);
+			for (int y = y_start; y < y_end; y++) {
+				render_row(bgra.data(), xres, y, frame_no);
+				bgra_to_uyvy(p_dst + (size_t)y * line_stride_in_bytes, bgra.data(), xres);
+			}
+		});
+	}
+
+private:
+	// Run a function over bands of rows, one band per thread. The calling thread takes the last band.
+	template<typename fn_type>
+	void parallel_rows(const int yres, const fn_type& fn)
+	{
+		const int no_bands = std::max(1, std::min(m_no_threads, yres / 16));
+		const int band_size = (yres + no_bands - 1) / no_bands;
+
+		std::vector<std::thread> threads;
+		for (int band = 0; band < no_bands - 1; band++)
+			threads.push_back(std::thread(fn, band * band_size, std::min(yres, (band + 1) * band_size)));
+		fn((no_bands - 1) * band_size, yres);
+
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	// Build the per column tables
+	void prepare(const int xres)
+	{
+		if (xres == m_table_xres)
+			return;
+
+		const float* p_freq_x = gradient_freq_x();
+		for (int c = 0; c < 3; c++) {
+			m_cos[c].resize(xres);
+			m_sin[c].resize(xres);
+			for (int x = 0; x < xres; x++) {
+				const double a = p_freq_x[c] * (double)x / (double)xres;
+				m_cos[c][x] = (float)cos(a);
+				m_sin[c][x] = (float)sin(a);
+			}
+		}
+
+		m_table_xres = xres;
+	}
+
+	// The frequencies of the gradients. The camera content uses a much lower frequency.
+	const float* gradient_freq_x(void) const
+	{
+		static const float freq[] = { 9.0f, 12.0f, 23.0f }, camera_freq[] = { 2.0f, 3.0f, 1.5f };
+		return (m_content == content_camera) ? camera_freq : freq;
+	}
+
+	const float* gradient_freq_y(void) const
+	{
+		static const float freq[] = { 9.5f, 40.5f, 15.5f }, camera_freq[] = { 1.5f, 2.5f, 3.5f };
+		return (m_content == content_camera) ? camera_freq : freq;
+	}
+
+	// Render one row of BGRA
+	void render_row(uint32_t* p_dst, const int xres, const int y, const int frame_no) const
+	{
+		switch (m_content) {
+			case content_gradient:
+				// The content scrolls up one line per frame, which is what the benchmark has always done
+				gradient_row(p_dst, xres, (float)(y + frame_no) / (float)xres * (16.0f / 9.0f));
+				break;
+
+			case content_noise:
+				noise_row(p_dst, detail::row_seed(y, frame_no), xres);
+				break;
+
+			case content_text:
+				text_row(p_dst, xres, y, frame_no);
+				break;
+
+			case content_camera:
+				// A slow pan with grain that changes every frame
+				gradient_row(p_dst, xres, (float)(y + frame_no * 2) / (float)xres * (16.0f / 9.0f));
+				grain_row(p_dst, detail::row_seed(y, frame_no), xres);
+				break;
+
+			default:
+				std::fill_n(p_dst, xres, 0xFF000000u);
+				break;
+		}
+	}
+
+	void gradient_row(uint32_t* p_dst, const int xres, const float fy) const
+	{
+		detail::gradient_row_t row;
+		const float* p_freq_y = gradient_freq_y();
+		for (int c = 0; c < 3; c++) {
+			row.p_cos[c] = m_cos[c].data();
+			row.p_sin[c] = m_sin[c].data();
+			row.cos_y[c] = (float)cos(p_freq_y[c] * fy);
+			row.sin_y[c] = (float)sin(p_freq_y[c] * fy);
+		}
+
+#ifdef NDI_CONTENT_X86
+		if (m_simd == simd_avx2) { detail::gradient_row_avx2(p_dst, row, xres); return; }
+		if (m_simd == simd_sse41) { detail::gradient_row_sse41(p_dst, row, xres); return; }
+#endif
+		detail::gradient_row_scalar(p_dst, row, 0, xres);
+	}
+
+	void noise_row(uint32_t* p_dst, const uint32_t seed, const int xres) const
+	{
+#ifdef NDI_CONTENT_X86
+		if (m_simd == simd_avx2) { detail::noise_row_avx2(p_dst, seed, xres); return; }
+		if (m_simd == simd_sse41) { detail::noise_row_sse41(p_dst, seed, xres); return; }
+#endif
+		detail::noise_row_scalar(p_dst, seed, 0, xres);
+	}
+
+	void grain_row(uint32_t* p_dst, const uint32_t seed, const int xres) const
+	{
+#ifdef NDI_CONTENT_X86
+		if (m_simd == simd_avx2) { detail::grain_row_avx2(p_dst, seed, xres); return; }
+		if (m_simd == simd_sse41) { detail::grain_row_sse41(p_dst, seed, xres); return; }
+#endif
+		detail::grain_row_scalar(p_dst, seed, 0, xres);
+	}
+
+	void bgra_to_uyvy(uint8_t* p_dst, const uint32_t* p_src, const int xres) const
+	{
+#ifdef NDI_CONTENT_X86
+		if (m_simd != simd_scalar) { detail::bgra_to_uyvy_sse41(p_dst, p_src, xres); return; }
+#endif
+		detail::bgra_to_uyvy_scalar(p_dst, p_src, 0, xres);
+	}
+
+	// Lines of text, each one scrolling at its own speed and direction over a flat background
+	void text_row(uint32_t* p_dst, const int xres, const int y, const int frame_no) const
+	{
+		static const char* const p_lines[] = {
+			"NDI SEND BENCHMARK - THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG. ",
+			"0123456789 ABCDEFGHIJKLMNOPQRSTUVWXYZ ",
+			"FRAME RATE 59.94 - RESOLUTION 3840X2160 - FORMAT UYVY. ",
+			"PACK MY BOX WITH FIVE DOZEN LIQUOR JUGS: 1234567890 ",
+		};
+		static const uint32_t backgrounds[] = { 0xFF101828u, 0xFF202020u, 0xFF281010u, 0xFF102810u };
+		static const uint32_t foregrounds[] = { 0xFFF0F0F0u, 0xFFFFE040u, 0xFF40E0FFu, 0xFFFFFFFFu };
+		const int no_lines = sizeof(p_lines) / sizeof(p_lines[0]);
+
+		// The size of each character, including one pixel of space on each side
+		const int scale = std::max(1, xres / 240);
+		const int cell_w = 6 * scale, cell_h = 9 * scale;
+
+		const int line_no = y / cell_h;
+		const int line = line_no % no_lines;
+		const uint32_t background = backgrounds[line_no % 4], foreground = foregrounds[line_no % 4];
+		std::fill_n(p_dst, xres, background);
+
+		const int glyph_y = (y % cell_h) / scale - 1;
+		if ((glyph_y < 0) || (glyph_y >= 7))
+			return;
+
+		// Where on the line of text the left of the frame is
+		const char* p_text = p_lines[line];
+		const int text_len = (int)strlen(p_text);
+		const int text_w = text_len * cell_w;
+		const int speed = scale * (1 + line_no % 3) * ((line_no & 1) ? -1 : 1);
+		int text_x = (int)(((int64_t)frame_no * speed) % text_w);
+		if (text_x < 0)
+			text_x += text_w;
+
+		int ch = text_x / cell_w, cell_x = text_x % cell_w;
+		uint8_t bits = detail::glyph(p_text[ch])[glyph_y];
+		for (int x = 0; x < xres; x++) {
+			const int glyph_x = cell_x / scale;
+			if ((glyph_x < 5) && ((bits >> (4 - glyph_x)) & 1))
+				p_dst[x] = foreground;
+
+			if (++cell_x == cell_w) {
+				cell_x = 0;
+				if (++ch == text_len)
+					ch = 0;
+				bits = detail::glyph(p_text[ch])[glyph_y];
+			}
+		}
+	}
+
+	content_e m_content;
+	simd_e m_simd;
+	int m_no_threads;
+
+	// The per column gradient tables for R, G and B
+	int m_table_xres;
+	std::vector<float> m_cos[3], m_sin[3];
+};
+
+} // namespace ndi_content
@@ -0,0 +1,304 @@
+#pragma once
+
+// A pool of frame buffers for sending video asynchronously.
+//
+// When a frame is sent with NDIlib_send_send_video_async_v2, NDI owns its memory until the next synchronizing event,
+// which is the next call to NDIlib_send_send_video_async_v2 (or NDIlib_send_send_video_v2, or NDIlib_send_destroy).
+// Rather than having every application remember which buffer is in flight, the pool sends the frames itself and knows
+// that the buffer from the previous call is free again once the current call has returned.
+//
+// The buffers are page aligned, may be backed by huge pages (MAP_HUGETLB, falling back to transparent huge pages on
+// Linux and large pages on Windows), may be locked into memory, and are touched when they are allocated so that no
+// page faults are taken while sending. An 8K UYVY frame is 66MB, which is more than 16000 4KB pages.
+//
+//		ndi_frame_pool::frame_pool pool(pNDI_send, xres * yres * 2);
+//		while (...) {
+//			uint8_t* p_frame = pool.acquire();	// Waits until there is a free buffer
+//			... fill in p_frame ...
+//			NDI_video_frame.p_data = p_frame;
+//			pool.send_video(NDI_video_frame);	// The previous buffer is now free again
+//		}
+//
+// acquire and release may be called from any thread, so the buffers can be filled in by other threads. send_video
+// should always be called from the same thread.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <Processing.NDI.Lib.h>
+
+namespace ndi_frame_pool {
+
+// How the buffers are allocated
+struct options {
+	options(void) : m_no_buffers(3), m_huge_pages(false), m_lock(false) {}
+
+	int m_no_buffers;		// At least two, since one is always in flight
+	bool m_huge_pages;		// Try to back the buffers with huge pages
+	bool m_lock;			// Lock the buffers into memory so that they are never paged out
+};
+
+// A single page aligned allocation
+class buffer {
+public:
+	buffer(void) : m_p_data(NULL), m_size(0), m_huge_pages(false), m_locked(false) {}
+	~buffer(void) { free(); }
+
+	bool allocate(const size_t size, const bool huge_pages, const bool lock)
+	{
+		free();
+
+#ifdef _WIN32
+		// Large pages need the "Lock pages in memory" privilege, if we do not have it then we use normal pages
+		if (huge_pages) {
+			const size_t large_page = GetLargePageMinimum();
+			if (large_page) {
+				m_size = (size + large_page - 1) / large_page * large_page;
+				m_p_data = (uint8_t*)VirtualAlloc(NULL, m_size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+				m_huge_pages = (m_p_data != NULL);
+			}
+		}
+
+		if (!m_p_data) {
+			m_size = size;
+			m_p_data = (uint8_t*)VirtualAlloc(NULL, m_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		}
+
+		if (!m_p_data)
+			return false;
+
+		if (lock)
+			m_locked = (VirtualLock(m_p_data, m_size) != 0);
+#else
+		// Try explicit huge pages first, these need to have been reserved (vm.nr_hugepages)
+		const size_t huge_page = 2 * 1024 * 1024;
+#ifdef MAP_HUGETLB
+		if (huge_pages) {
+			m_size = (size + huge_page - 1) / huge_page * huge_page;
+			void* p_data = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (p_data != MAP_FAILED) {
+				m_p_data = (uint8_t*)p_data;
+				m_huge_pages = true;
+			}
+		}
+#endif
+
+		// Otherwise normal pages, for which we can ask for transparent huge pages
+		if (!m_p_data) {
+			m_size = huge_pages ? (size + huge_page - 1) / huge_page * huge_page : size;
+			void* p_data = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (p_data == MAP_FAILED) {
+				m_size = 0;
+				return false;
+			}
+			m_p_data = (uint8_t*)p_data;
+
+#ifdef MADV_HUGEPAGE
+			if (huge_pages)
+				m_huge_pages = (madvise(m_p_data, m_size, MADV_HUGEPAGE) == 0);
+#endif
+		}
+
+		if (lock)
+			m_locked = (mlock(m_p_data, m_size) == 0);
+#endif
+
+		// Touch every page now, so that we do not take the page faults while we are sending
+		memset(m_p_data, 0, m_size);
+		return true;
+	}
+
+	void free(void)
+	{
+		if (!m_p_data)
+			return;
+
+#ifdef _WIN32
+		if (m_locked)
+			VirtualUnlock(m_p_data, m_size);
+		VirtualFree(m_p_data, 0, MEM_RELEASE);
+#else
+		if (m_locked)
+			munlock(m_p_data, m_size);
+		munmap(m_p_data, m_size);
+#endif
+
+		m_p_data = NULL;
+		m_size = 0;
+		m_huge_pages = m_locked = false;
+	}
+
+	uint8_t* data(void) const { return m_p_data; }
+	size_t size(void) const { return m_size; }
+	bool huge_pages(void) const { return m_huge_pages; }
+	bool locked(void) const { return m_locked; }
+
+private:
+	buffer(const buffer&);
+	buffer& operator=(const buffer&);
+
+	uint8_t* m_p_data;
+	size_t m_size;
+	bool m_huge_pages, m_locked;
+};
+
+// The pool of buffers for one sender
+class frame_pool {
+public:
+	frame_pool(NDIlib_send_instance_t pNDI_send, const size_t buffer_size, const options& opts = options())
+		: m_pNDI_send(pNDI_send), m_buffer_size(buffer_size), m_buffers(std::max(2, opts.m_no_buffers)),
+		  m_states(m_buffers.size(), state_free), m_next(0), m_in_flight(-1), m_pending(false), m_valid(true), m_huge_pages(true), m_locked(true)
+	{
+		for (auto& buffer : m_buffers) {
+			if (!buffer.allocate(buffer_size, opts.m_huge_pages, opts.m_lock)) {
+				fprintf(stderr, "Unable to allocate a frame buffer of %llu bytes.\n", (unsigned long long)buffer_size);
+				m_valid = false;
+				return;
+			}
+			m_huge_pages = m_huge_pages && buffer.huge_pages();
+			m_locked = m_locked && buffer.locked();
+		}
+	}
+
+	// The last frame is still in flight, so we must synchronize before the memory is released
+	~frame_pool(void)
+	{
+		flush();
+	}
+
+	// Were all of the buffers allocated
+	bool valid(void) const { return m_valid; }
+
+	// Get a free buffer, waiting until one is free. Acquired buffers stay owned by the caller until they are sent, and a
+	// sent buffer is free again after the next send or flush. A buffer whose content does not change can be sent again
+	// without acquiring it again. The buffers are handed out in turn.
+	uint8_t* acquire(void)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		uint8_t* p_data;
+		while (!(p_data = next_free()))
+			m_cond.wait(lock);
+		return p_data;
+	}
+
+	// Get a free buffer if there is one, otherwise NULL
+	uint8_t* try_acquire(void)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		return next_free();
+	}
+
+	// Give back a buffer that was acquired but is not going to be sent
+	void release(const uint8_t* p_data)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		const int idx = find(p_data);
+		if ((idx >= 0) && (m_states[idx] == state_acquired))
+			m_states[idx] = state_free;
+		m_cond.notify_all();
+	}
+
+	// Send a frame whose p_data is one of our buffers. When this returns, the buffer from the previous call is free.
+	void send_video(const NDIlib_video_frame_v2_t& video_frame)
+	{
+		const int idx = find(video_frame.p_data);
+		if (idx >= 0) {
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_states[idx] = state_in_flight;
+		}
+
+		NDIlib_send_send_video_async_v2(m_pNDI_send, &video_frame);
+		m_pending = true;
+
+		std::unique_lock<std::mutex> lock(m_lock);
+		if ((m_in_flight >= 0) && (m_in_flight != idx))
+			m_states[m_in_flight] = state_free;
+		m_in_flight = idx;
+		m_cond.notify_all();
+	}
+
+	// Wait until NDI is no longer using any of the buffers. This does nothing if nothing has been sent since the last
+	// flush, so it is safe for the pool to be destroyed after the sender once it has been flushed.
+	void flush(void)
+	{
+		if (!m_pending)
+			return;
+		NDIlib_send_send_video_async_v2(m_pNDI_send, NULL);
+		m_pending = false;
+
+		std::unique_lock<std::mutex> lock(m_lock);
+		if (m_in_flight >= 0)
+			m_states[m_in_flight] = state_free;
+		m_in_flight = -1;
+		m_cond.notify_all();
+	}
+
+	size_t buffer_size(void) const { return m_buffer_size; }
+	int no_buffers(void) const { return (int)m_buffers.size(); }
+
+	// Are all of the buffers backed by huge pages, and locked into memory
+	bool huge_pages(void) const { return m_huge_pages; }
+	bool locked(void) const { return m_locked; }
+
+private:
+	frame_pool(const frame_pool&);
+	frame_pool& operator=(const frame_pool&);
+
+	enum state_e { state_free, state_acquired, state_in_flight };
+
+	// Take the next free buffer in turn, the lock must be held
+	uint8_t* next_free(void)
+	{
+		for (size_t i = 0; i < m_buffers.size(); i++) {
+			const size_t idx = (m_next + i) % m_buffers.size();
+			if (m_states[idx] == state_free) {
+				m_states[idx] = state_acquired;
+				m_next = (idx + 1) % m_buffers.size();
+				return m_buffers[idx].data();
+			}
+		}
+		return NULL;
+	}
+
+	// Which of our buffers is this, -1 if it is not one of ours
+	int find(const uint8_t* p_data) const
+	{
+		for (size_t i = 0; i < m_buffers.size(); i++) {
+			if ((p_data >= m_buffers[i].data()) && (p_data < m_buffers[i].data() + m_buffers[i].size()))
+				return (int)i;
+		}
+		return -1;
+	}
+
+	NDIlib_send_instance_t m_pNDI_send;
+	size_t m_buffer_size;
+
+	std::vector<buffer> m_buffers;
+	std::vector<state_e> m_states;
+	size_t m_next;
+	int m_in_flight;
+	bool m_pending;
+	bool m_valid, m_huge_pages, m_locked;
+
+	std::mutex m_lock;
+	std::condition_variable m_cond;
+};
+
+} // namespace ndi_frame_pool
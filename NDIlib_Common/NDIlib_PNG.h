@@ -0,0 +1,412 @@
+#pragma once
+
+// Writing video frames as PNG files.
+//
+// LodePNG with its default settings compresses well but is slow, a 4K frame takes seconds. When zlib is available
+// (NDI_HAVE_ZLIB is defined and the example is linked with it), frames are written by the encoder here instead, which
+// splits a frame into bands of lines that are filtered and compressed in parallel. Every band but the last ends with a
+// full flush, so that the compressed bands follow on from each other in a single zlib stream, which is how pigz works,
+// and each band is written as its own IDAT chunk. Lines are read in place using the line stride, and alpha is dropped
+// from frames that do not have any, so the frame is never copied. Without zlib, LodePNG is used for everything.
+//
+// The compression profiles are :
+//		none	No filter and stored blocks, for when disk bandwidth is cheaper than CPU time.
+//		fast	The Up filter on every line and zlib level 1 with run length matching only, which suits video well.
+//		best	The filter that gives the smallest sum of differences on each line and the default zlib level. Without
+//				zlib this is LodePNG's default.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include <Processing.NDI.Lib.h>
+
+#include "NDIlib_Thread.h"
+#include "../NDIlib_Recv_PNG/LodePNG/lodepng.h"
+
+#ifdef NDI_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef _WIN32
+#define strcasecmp _stricmp
+#else
+#include <strings.h>
+#endif
+
+namespace ndi_png {
+
+enum compression_e {
+	compression_none,
+	compression_fast,
+	compression_best
+};
+
+inline const char* compression_name(const compression_e compression)
+{
+	static const char* p_names[] = { "none", "fast", "best" };
+	return p_names[compression];
+}
+
+inline bool parse_compression(const char* p_name, compression_e& compression)
+{
+	for (int i = compression_none; i <= compression_best; i++) {
+		if (!strcasecmp(p_name, compression_name((compression_e)i))) {
+			compression = (compression_e)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Can frames in this format be written
+inline bool is_supported(const NDIlib_FourCC_video_type_e FourCC)
+{
+	return (FourCC == NDIlib_FourCC_type_RGBA) || (FourCC == NDIlib_FourCC_type_RGBX) ||
+		(FourCC == NDIlib_FourCC_type_BGRA) || (FourCC == NDIlib_FourCC_type_BGRX);
+}
+
+namespace detail {
+
+#ifdef NDI_HAVE_ZLIB
+// Append a chunk, with its length, type and CRC
+inline void append_chunk(std::vector<uint8_t>& png, const char* p_type, const uint8_t* p_data, const size_t size)
+{
+	const uint8_t length[4] = { (uint8_t)(size >> 24), (uint8_t)(size >> 16), (uint8_t)(size >> 8), (uint8_t)size };
+	png.insert(png.end(), length, length + 4);
+	png.insert(png.end(), p_type, p_type + 4);
+	if (size)
+		png.insert(png.end(), p_data, p_data + size);
+
+	// The CRC covers the type and the data
+	const uLong crc = crc32(0L, &png[png.size() - size - 4], (uInt)(size + 4));
+	const uint8_t crc_bytes[4] = { (uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc };
+	png.insert(png.end(), crc_bytes, crc_bytes + 4);
+}
+#endif // NDI_HAVE_ZLIB
+
+inline int paeth(const int a, const int b, const int c)
+{
+	const int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+	return ((pa <= pb) && (pa <= pc)) ? a : (pb <= pc) ? b : c;
+}
+
+// Filter a line with one of the five PNG filters. p_prev is the line above, which is all zero for the first line.
+inline void filter_line(uint8_t* p_dst, const uint8_t* p_line, const uint8_t* p_prev, const int line_size, const int bpp, const int filter)
+{
+	p_dst[0] = (uint8_t)filter;
+	p_dst++;
+
+	switch (filter) {
+		case 0:
+			memcpy(p_dst, p_line, line_size);
+			break;
+
+		case 1:
+			memcpy(p_dst, p_line, bpp);
+			for (int i = bpp; i < line_size; i++)
+				p_dst[i] = (uint8_t)(p_line[i] - p_line[i - bpp]);
+			break;
+
+		case 2:
+			for (int i = 0; i < line_size; i++)
+				p_dst[i] = (uint8_t)(p_line[i] - p_prev[i]);
+			break;
+
+		case 3:
+			for (int i = 0; i < bpp; i++)
+				p_dst[i] = (uint8_t)(p_line[i] - (p_prev[i] >> 1));
+			for (int i = bpp; i < line_size; i++)
+				p_dst[i] = (uint8_t)(p_line[i] - ((p_line[i - bpp] + p_prev[i]) >> 1));
+			break;
+
+		case 4:
+			for (int i = 0; i < bpp; i++)
+				p_dst[i] = (uint8_t)(p_line[i] - p_prev[i]);
+			for (int i = bpp; i < line_size; i++)
+				p_dst[i] = (uint8_t)(p_line[i] - paeth(p_line[i - bpp], p_prev[i], p_prev[i - bpp]));
+			break;
+	}
+}
+
+// The sum of the differences, for choosing a filter
+inline uint64_t filter_cost(const uint8_t* p_filtered, const int line_size)
+{
+	uint64_t cost = 0;
+	for (int i = 1; i <= line_size; i++)
+		cost += (uint64_t)std::abs((int)(int8_t)p_filtered[i]);
+	return cost;
+}
+
+} // namespace detail
+
+// Writes frames, keeping a pool of threads for the bands. A writer should only be used by one thread at a time.
+class writer {
+public:
+	// no_threads = 0 means one per CPU
+	explicit writer(const compression_e compression = compression_best, const int no_threads = 0)
+		: m_compression(compression), m_threads(no_threads)
+	{
+	}
+
+	compression_e compression(void) const { return m_compression; }
+	int no_threads(void) const { return m_threads.no_threads(); }
+
+	// Encode a frame into memory. The frame must be one of the formats that is_supported allows.
+	bool encode(const NDIlib_video_frame_v2_t& frame, std::vector<uint8_t>& png)
+	{
+		png.clear();
+		if (!is_supported(frame.FourCC) || (frame.xres <= 0) || (frame.yres <= 0) || !frame.p_data)
+			return false;
+
+#ifdef NDI_HAVE_ZLIB
+		return encode_zlib(frame, png);
+#else
+		return encode_lodepng(frame, png);
+#endif
+	}
+
+	// Encode a frame and write it to a file
+	bool write(const char* p_filename, const NDIlib_video_frame_v2_t& frame)
+	{
+		if (!encode(frame, m_png))
+			return false;
+
+		FILE* p_file = fopen(p_filename, "wb");
+		if (!p_file)
+			return false;
+
+		const bool ok = (fwrite(m_png.data(), 1, m_png.size(), p_file) == m_png.size());
+		return (fclose(p_file) == 0) && ok;
+	}
+
+private:
+	writer(const writer&);
+	writer& operator=(const writer&);
+
+	// Alpha is only written when the frame has it, and the channels are always written as R G B
+	struct layout_t {
+		int xres, yres, stride, bpp;
+		bool swap;
+	};
+
+	static layout_t get_layout(const NDIlib_video_frame_v2_t& frame)
+	{
+		layout_t layout;
+		layout.xres = frame.xres;
+		layout.yres = frame.yres;
+		layout.stride = frame.line_stride_in_bytes ? frame.line_stride_in_bytes : frame.xres * 4;
+		layout.bpp = ((frame.FourCC == NDIlib_FourCC_type_RGBA) || (frame.FourCC == NDIlib_FourCC_type_BGRA)) ? 4 : 3;
+		layout.swap = (frame.FourCC == NDIlib_FourCC_type_BGRA) || (frame.FourCC == NDIlib_FourCC_type_BGRX);
+		return layout;
+	}
+
+	// Get a line in PNG order, which is the frame's own memory when it already is
+	static const uint8_t* get_line(const NDIlib_video_frame_v2_t& frame, const layout_t& layout, const int y, uint8_t* p_buffer)
+	{
+		const uint8_t* p_src = frame.p_data + (size_t)y * layout.stride;
+		if ((layout.bpp == 4) && !layout.swap)
+			return p_src;
+
+		const int r = layout.swap ? 2 : 0, b = layout.swap ? 0 : 2;
+		for (int x = 0; x < layout.xres; x++, p_src += 4, p_buffer += layout.bpp) {
+			p_buffer[0] = p_src[r];
+			p_buffer[1] = p_src[1];
+			p_buffer[2] = p_src[b];
+			if (layout.bpp == 4)
+				p_buffer[3] = p_src[3];
+		}
+		return p_buffer - (size_t)layout.xres * layout.bpp;
+	}
+
+#ifdef NDI_HAVE_ZLIB
+	// One compressed band
+	struct band_t {
+		int y_start;
+		std::vector<uint8_t> data;
+		uLong adler, no_bytes;
+	};
+
+	bool encode_zlib(const NDIlib_video_frame_v2_t& frame, std::vector<uint8_t>& png)
+	{
+		const layout_t layout = get_layout(frame);
+		const int line_size = layout.xres * layout.bpp;
+
+		int level = Z_DEFAULT_COMPRESSION, strategy = Z_DEFAULT_STRATEGY, filter = -1;
+		if (m_compression == compression_none) {
+			level = 0;
+			filter = 0;
+		} else if (m_compression == compression_fast) {
+			level = 1;
+			strategy = Z_RLE;
+			filter = 2;
+		}
+
+		// Compress the bands in parallel
+		std::vector<band_t> bands;
+		std::mutex bands_lock;
+		bool ok = true;
+
+		m_threads.run(layout.yres, [&](const int y_start, const int y_end) {
+			band_t band;
+			band.y_start = y_start;
+			band.adler = adler32(0L, Z_NULL, 0);
+			band.no_bytes = 0;
+
+			z_stream stream;
+			memset(&stream, 0, sizeof(stream));
+			bool band_ok = (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, strategy) == Z_OK);
+
+			// The whole band always fits, with room for the flush at the end and for the zlib header in the first band
+			const uLong band_size = (uLong)(y_end - y_start) * (line_size + 1);
+			band.data.resize(deflateBound(&stream, band_size) + 16);
+			size_t offset = 0;
+			if (y_start == 0) {
+				band.data[0] = 0x78;
+				band.data[1] = 0x01;
+				offset = 2;
+			}
+			stream.next_out = band.data.data() + offset;
+			stream.avail_out = (uInt)(band.data.size() - offset);
+
+			// The lines in PNG order, the previous one is needed for the filters
+			std::vector<uint8_t> lines[2] = { std::vector<uint8_t>(line_size), std::vector<uint8_t>(line_size) };
+			std::vector<uint8_t> filtered((filter < 0) ? (line_size + 1) * 5 : line_size + 1);
+			const std::vector<uint8_t> zero_line(line_size, 0);
+			const uint8_t* p_prev = (y_start > 0) ? get_line(frame, layout, y_start - 1, lines[1].data()) : zero_line.data();
+
+			for (int y = y_start; band_ok && (y < y_end); y++) {
+				const uint8_t* p_line = get_line(frame, layout, y, lines[(y - y_start) & 1].data());
+
+				// Try each filter when asked to choose
+				uint8_t* p_filtered = filtered.data();
+				if (filter >= 0) {
+					detail::filter_line(p_filtered, p_line, p_prev, line_size, layout.bpp, filter);
+				} else {
+					uint64_t best_cost = UINT64_MAX;
+					for (int f = 0; f < 5; f++) {
+						uint8_t* p_try = filtered.data() + (size_t)f * (line_size + 1);
+						detail::filter_line(p_try, p_line, p_prev, line_size, layout.bpp, f);
+						const uint64_t cost = detail::filter_cost(p_try, line_size);
+						if (cost < best_cost) {
+							best_cost = cost;
+							p_filtered = p_try;
+						}
+					}
+				}
+
+				band.adler = adler32(band.adler, p_filtered, (uInt)(line_size + 1));
+				band.no_bytes += line_size + 1;
+				stream.next_in = p_filtered;
+				stream.avail_in = (uInt)(line_size + 1);
+				band_ok = (deflate(&stream, Z_NO_FLUSH) == Z_OK) && !stream.avail_in;
+				p_prev = p_line;
+			}
+
+			// The last band finishes the stream, the others end on a byte boundary with the dictionary reset
+			if (band_ok)
+				band_ok = (deflate(&stream, (y_end == layout.yres) ? Z_FINISH : Z_FULL_FLUSH) == ((y_end == layout.yres) ? Z_STREAM_END : Z_OK));
+			band.data.resize(band.data.size() - stream.avail_out);
+			deflateEnd(&stream);
+
+			std::unique_lock<std::mutex> lock(bands_lock);
+			ok = ok && band_ok;
+			bands.push_back(std::move(band));
+		}, 32);
+
+		if (!ok)
+			return false;
+
+		// The bands in order, and the Adler-32 of the whole stream goes at the end of the last one
+		std::sort(bands.begin(), bands.end(), [](const band_t& a, const band_t& b) { return a.y_start < b.y_start; });
+		uLong adler = bands[0].adler;
+		for (size_t i = 1; i < bands.size(); i++)
+			adler = adler32_combine(adler, bands[i].adler, (z_off_t)bands[i].no_bytes);
+		const uint8_t adler_bytes[4] = { (uint8_t)(adler >> 24), (uint8_t)(adler >> 16), (uint8_t)(adler >> 8), (uint8_t)adler };
+		bands.back().data.insert(bands.back().data.end(), adler_bytes, adler_bytes + 4);
+
+		// The signature and the header
+		size_t png_size = 8 + 25 + 12;
+		for (const band_t& band : bands)
+			png_size += band.data.size() + 12;
+		png.reserve(png_size);
+
+		static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+		png.insert(png.end(), signature, signature + 8);
+
+		const uint8_t header[13] = {
+			(uint8_t)(layout.xres >> 24), (uint8_t)(layout.xres >> 16), (uint8_t)(layout.xres >> 8), (uint8_t)layout.xres,
+			(uint8_t)(layout.yres >> 24), (uint8_t)(layout.yres >> 16), (uint8_t)(layout.yres >> 8), (uint8_t)layout.yres,
+			8, (uint8_t)((layout.bpp == 4) ? 6 : 2), 0, 0, 0
+		};
+		detail::append_chunk(png, "IHDR", header, sizeof(header));
+
+		// A chunk for each band
+		for (const band_t& band : bands)
+			detail::append_chunk(png, "IDAT", band.data.data(), band.data.size());
+		detail::append_chunk(png, "IEND", NULL, 0);
+
+		return true;
+	}
+#else // NDI_HAVE_ZLIB
+	// LodePNG needs the lines to be packed together in R G B A order, so frames that are not are copied
+	bool encode_lodepng(const NDIlib_video_frame_v2_t& frame, std::vector<uint8_t>& png)
+	{
+		const layout_t layout = get_layout(frame);
+		const uint8_t* p_rgba = frame.p_data;
+		if (layout.swap || (layout.stride != layout.xres * 4)) {
+			m_packed.resize((size_t)layout.xres * layout.yres * 4);
+			for (int y = 0; y < layout.yres; y++) {
+				const uint8_t* p_src = frame.p_data + (size_t)y * layout.stride;
+				uint8_t* p_dst = &m_packed[(size_t)y * layout.xres * 4];
+				for (int x = 0; x < layout.xres; x++, p_src += 4, p_dst += 4) {
+					p_dst[0] = p_src[layout.swap ? 2 : 0];
+					p_dst[1] = p_src[1];
+					p_dst[2] = p_src[layout.swap ? 0 : 2];
+					p_dst[3] = p_src[3];
+				}
+			}
+			p_rgba = m_packed.data();
+		}
+
+		LodePNGState state;
+		lodepng_state_init(&state);
+		state.info_raw.colortype = LCT_RGBA;
+		state.info_raw.bitdepth = 8;
+		if (m_compression != compression_best) {
+			state.encoder.auto_convert = 0;
+			state.info_png.color.colortype = (layout.bpp == 4) ? LCT_RGBA : LCT_RGB;
+			state.info_png.color.bitdepth = 8;
+			if (m_compression == compression_none) {
+				state.encoder.filter_strategy = LFS_ZERO;
+				state.encoder.zlibsettings.btype = 0;
+			} else {
+				state.encoder.filter_strategy = LFS_TWO;
+				state.encoder.zlibsettings.use_lz77 = 0;
+			}
+		}
+
+		unsigned char* p_png = NULL;
+		size_t png_size = 0;
+		const unsigned error = lodepng_encode(&p_png, &png_size, p_rgba, layout.xres, layout.yres, &state);
+		if (!error)
+			png.assign(p_png, p_png + png_size);
+		free(p_png);
+		lodepng_state_cleanup(&state);
+
+		return !error;
+	}
+
+	std::vector<uint8_t> m_packed;
+#endif // NDI_HAVE_ZLIB
+
+	compression_e m_compression;
+	ndi_thread::band_pool m_threads;
+	std::vector<uint8_t> m_png;
+};
+
+} // namespace ndi_png
@@ -0,0 +1,441 @@
+#pragma once
+
+// Test patterns for senders that should cost next to nothing to run, so that dozens of them can share a machine :
+//		bars		75% colour bars, with reversed bars and a grey scale underneath.
+//		ramp		Grey, red, green and blue ramps from black to full.
+//		zoneplate	A circular zone plate, which goes up to the highest frequency that the frame can hold at its edges.
+// On top of the pattern there can be a box that bounces around the frame and a counter with the frame number.
+//
+// The pattern never changes, so it is rendered once for each resolution and format, with the rows split across threads.
+// After that only the parts of a frame that change are drawn. The generator remembers where it drew the box and the
+// counter in each buffer that it has been given, so for a buffer that it has seen before it puts the pattern back where
+// they were and draws them in their new places, which is a few kilobytes a frame rather than the whole frame. A buffer
+// that it has not seen gets the whole pattern copied in. This means that the buffers must not be written to by anything
+// else, or invalidate() must be called when they are. Flat areas are filled with AVX2 or SSE4.1 when the CPU has them.
+//
+// BGRA, BGRX and UYVY frames can be generated, UYVY frames must have an even width.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include <Processing.NDI.Lib.h>
+
+#include "NDIlib_Content.h"
+#include "NDIlib_Thread.h"
+
+namespace ndi_pattern {
+
+// The instruction sets are the same as the content generator's
+using ndi_content::simd_e;
+using ndi_content::simd_scalar;
+using ndi_content::simd_sse41;
+using ndi_content::simd_avx2;
+using ndi_content::simd_name;
+using ndi_content::detect_simd;
+
+enum pattern_e {
+	pattern_bars,
+	pattern_ramp,
+	pattern_zone_plate,
+	pattern_max
+};
+
+inline const char* pattern_name(const pattern_e pattern)
+{
+	static const char* const p_names[pattern_max] = { "bars", "ramp", "zoneplate" };
+	return ((pattern >= 0) && (pattern < pattern_max)) ? p_names[pattern] : "unknown";
+}
+
+// Get a pattern from its name, returns false if it is not known.
+inline bool parse_pattern(const char* p_name, pattern_e& pattern)
+{
+	for (int i = 0; i < pattern_max; i++) {
+		if (strcasecmp(p_name, pattern_name((pattern_e)i)) == 0) {
+			pattern = (pattern_e)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Can frames in this format be generated
+inline bool is_supported(const NDIlib_FourCC_video_type_e FourCC)
+{
+	return (FourCC == NDIlib_FourCC_type_BGRA) || (FourCC == NDIlib_FourCC_type_BGRX) || (FourCC == NDIlib_FourCC_type_UYVY);
+}
+
+// What is drawn on top of the pattern
+struct options {
+	options(void) : m_box(true), m_counter(true) {}
+
+	bool m_box;			// A box that bounces around the frame
+	bool m_counter;		// The frame number
+};
+
+namespace detail {
+
+// A rectangle of pixels
+struct rect_t {
+	int x, y, w, h;
+};
+
+// Fill n 32 bit words with the same value. A word is one BGRA pixel, or two UYVY pixels.
+inline void fill_words_scalar(uint32_t* p_dst, const uint32_t value, const int x0, const int n)
+{
+	for (int x = x0; x < n; x++)
+		p_dst[x] = value;
+}
+
+#ifdef NDI_CONTENT_X86
+
+NDI_CONTENT_TARGET_SSE41 inline void fill_words_sse41(uint32_t* p_dst, const uint32_t value, const int n)
+{
+	const __m128i value_4 = _mm_set1_epi32((int)value);
+	int x = 0;
+	for (; x + 4 <= n; x += 4)
+		_mm_storeu_si128((__m128i*)(p_dst + x), value_4);
+	fill_words_scalar(p_dst, value, x, n);
+}
+
+NDI_CONTENT_TARGET_AVX2 inline void fill_words_avx2(uint32_t* p_dst, const uint32_t value, const int n)
+{
+	const __m256i value_8 = _mm256_set1_epi32((int)value);
+	int x = 0;
+	for (; x + 8 <= n; x += 8)
+		_mm256_storeu_si256((__m256i*)(p_dst + x), value_8);
+	fill_words_scalar(p_dst, value, x, n);
+}
+
+#endif // NDI_CONTENT_X86
+
+// Where something that bounces between 0 and range is after moving a distance
+inline int bounce(const int64_t distance, const int range)
+{
+	if (range <= 0)
+		return 0;
+	const int64_t position = distance % (2 * (int64_t)range);
+	return (int)((position < range) ? position : 2 * range - position);
+}
+
+} // namespace detail
+
+// Generates frames of a pattern. A generator keeps the pattern for the current resolution and format, and what it has
+// drawn in each buffer, so it should be kept around rather than created for each frame. A single generator should only
+// be used by one thread at a time, it uses its own threads internally.
+class generator {
+public:
+	// no_threads = 0 means one per CPU
+	explicit generator(const pattern_e pattern = pattern_bars, const options& opts = options(), const int no_threads = 0, const simd_e simd = detect_simd())
+		: m_pattern(pattern), m_options(opts), m_simd(simd), m_threads(no_threads),
+		  m_xres(0), m_yres(0), m_FourCC(NDIlib_FourCC_type_BGRA), m_background_stride(0), m_use_count(0), m_no_full_frames(0)
+	{
+	}
+
+	pattern_e pattern(void) const { return m_pattern; }
+	simd_e simd(void) const { return m_simd; }
+	int no_threads(void) const { return m_threads.no_threads(); }
+
+	// The number of frames that have had the whole pattern copied in, rather than just the parts that changed
+	int64_t no_full_frames(void) const { return m_no_full_frames; }
+
+	// Forget what has been drawn in the buffers, so the next frame in each one is drawn in full
+	void invalidate(void) { m_buffers.clear(); }
+
+	// Generate a frame into p_data, with its format, resolution and line stride (zero for the default). The frame number
+	// moves the box and is shown on the counter. This returns false when the format is not supported.
+	bool generate(const NDIlib_video_frame_v2_t& frame, const int64_t frame_no)
+	{
+		const bool uyvy = (frame.FourCC == NDIlib_FourCC_type_UYVY);
+		if (!is_supported(frame.FourCC) || !frame.p_data || (frame.xres <= 0) || (frame.yres <= 0) || (uyvy && (frame.xres & 1)))
+			return false;
+
+		// The pattern is rendered again when the resolution or format changes
+		if ((frame.xres != m_xres) || (frame.yres != m_yres) || (frame.FourCC != m_FourCC))
+			prepare(frame.xres, frame.yres, frame.FourCC);
+
+		const int line_stride = frame.line_stride_in_bytes ? frame.line_stride_in_bytes : m_background_stride;
+		buffer_t& buffer = find_buffer(frame.p_data, line_stride);
+
+		// Put the pattern back where we drew last time in this buffer, or everywhere when we have not drawn in it before
+		if (buffer.m_no_rects < 0) {
+			m_threads.run(m_yres, [&](const int y_start, const int y_end) {
+				for (int y = y_start; y < y_end; y++)
+					memcpy(frame.p_data + (size_t)y * line_stride, &m_background[(size_t)y * m_background_stride], m_background_stride);
+			});
+			m_no_full_frames++;
+		} else {
+			for (int i = 0; i < buffer.m_no_rects; i++)
+				restore(frame.p_data, line_stride, buffer.m_rects[i]);
+		}
+
+		// Draw what changes
+		buffer.m_no_rects = 0;
+		if (m_options.m_box)
+			buffer.m_rects[buffer.m_no_rects++] = draw_box(frame.p_data, line_stride, frame_no);
+		if (m_options.m_counter)
+			buffer.m_rects[buffer.m_no_rects++] = draw_counter(frame.p_data, line_stride, frame_no);
+
+		return true;
+	}
+
+private:
+	generator(const generator&);
+	generator& operator=(const generator&);
+
+	// What has been drawn in a buffer, a count of -1 means that it does not have the pattern in it yet
+	struct buffer_t {
+		uint8_t* m_p_data;
+		int m_line_stride;
+		int m_no_rects;
+		detail::rect_t m_rects[2];
+		uint64_t m_last_used;
+	};
+
+	// The buffers that we remember, which is enough for a frame pool or a double buffered sender
+	static const size_t max_buffers = 16;
+
+	buffer_t& find_buffer(uint8_t* p_data, const int line_stride)
+	{
+		m_use_count++;
+		for (buffer_t& buffer : m_buffers) {
+			if ((buffer.m_p_data == p_data) && (buffer.m_line_stride == line_stride)) {
+				buffer.m_last_used = m_use_count;
+				return buffer;
+			}
+		}
+
+		// One that we have not seen replaces the one that was used longest ago
+		buffer_t new_buffer = { p_data, line_stride, -1, {}, m_use_count };
+		if (m_buffers.size() < max_buffers) {
+			m_buffers.push_back(new_buffer);
+			return m_buffers.back();
+		}
+
+		buffer_t& oldest = *std::min_element(m_buffers.begin(), m_buffers.end(), [](const buffer_t& a, const buffer_t& b) { return a.m_last_used < b.m_last_used; });
+		oldest = new_buffer;
+		return oldest;
+	}
+
+	// Render the pattern for a resolution and format
+	void prepare(const int xres, const int yres, const NDIlib_FourCC_video_type_e FourCC)
+	{
+		m_xres = xres;
+		m_yres = yres;
+		m_FourCC = FourCC;
+		m_background_stride = (FourCC == NDIlib_FourCC_type_UYVY) ? xres * 2 : xres * 4;
+		m_background.resize((size_t)m_background_stride * yres);
+		m_buffers.clear();
+
+		// The zone plate's phase is in 1024ths of a turn, so each pixel is a lookup in this
+		for (int i = 0; i < 1024; i++)
+			m_zone_plate[i] = (uint8_t)lrint(127.5 + 127.5 * cos(2.0 * 3.14159265358979323846 * i / 1024.0));
+
+		// The bars and ramps have bands of rows that are all the same, so we only render the first row of each band
+		m_threads.run(yres, [&](const int y_start, const int y_end) {
+			std::vector<uint32_t> bgra(xres);
+			for (int y = y_start; y < y_end; y++) {
+				uint8_t* p_dst = &m_background[(size_t)y * m_background_stride];
+				if ((y > y_start) && (band_of(y) >= 0) && (band_of(y) == band_of(y - 1))) {
+					memcpy(p_dst, p_dst - m_background_stride, m_background_stride);
+					continue;
+				}
+
+				render_row(bgra.data(), y);
+				if (FourCC == NDIlib_FourCC_type_UYVY)
+					bgra_to_uyvy(p_dst, bgra.data());
+				else
+					memcpy(p_dst, bgra.data(), m_background_stride);
+			}
+		}, 32);
+
+		// The colours that are drawn on top, as 32 bit words in the format of the frame. The box is orange, which is not in
+		// any of the patterns.
+		m_box_word = to_word(0xFFEB7010u);
+		m_counter_background_word = to_word(0xFF101010u);
+		m_counter_text_word = to_word(0xFFEBEBEBu);
+
+		// The size of the box and of the counter's characters, which cover whole words in UYVY
+		m_box_size = std::max(2, (yres / 8) & ~1);
+		m_text_scale = std::max(2, (yres / 135) & ~1);
+	}
+
+	// Which band of identical rows a row is in, or -1 when every row is different
+	int band_of(const int y) const
+	{
+		switch (m_pattern) {
+			case pattern_bars:
+				return (y < m_yres * 2 / 3) ? 0 : (y < m_yres * 3 / 4) ? 1 : 2;
+			case pattern_ramp:
+				return y * 4 / m_yres;
+			default:
+				return -1;
+		}
+	}
+
+	// Render a row of the pattern in BGRA
+	void render_row(uint32_t* p_dst, const int y) const
+	{
+		switch (m_pattern) {
+			case pattern_bars: {
+				// 75% bars, then the reversed bars, then an 11 step grey scale
+				static const uint32_t bars[7] = { 0xFFBFBFBFu, 0xFFBFBF00u, 0xFF00BFBFu, 0xFF00BF00u, 0xFFBF00BFu, 0xFFBF0000u, 0xFF0000BFu };
+				static const uint32_t reversed[7] = { 0xFF0000BFu, 0xFF101010u, 0xFFBF00BFu, 0xFF101010u, 0xFF00BFBFu, 0xFF101010u, 0xFFBFBFBFu };
+				const int band = band_of(y);
+				for (int x = 0; x < m_xres; x++) {
+					if (band == 2) {
+						const uint32_t grey = (uint32_t)(16 + (x * 11 / m_xres) * 219 / 10);
+						p_dst[x] = 0xFF000000u | (grey << 16) | (grey << 8) | grey;
+					} else
+						p_dst[x] = (band ? reversed : bars)[x * 7 / m_xres];
+				}
+				break;
+			}
+
+			case pattern_ramp: {
+				// Grey, red, green and blue
+				static const uint32_t masks[4] = { 0x00FFFFFFu, 0x00FF0000u, 0x0000FF00u, 0x000000FFu };
+				const uint32_t mask = masks[band_of(y)];
+				for (int x = 0; x < m_xres; x++) {
+					const uint32_t v = (uint32_t)(x * 255 / std::max(1, m_xres - 1));
+					p_dst[x] = 0xFF000000u | (((v << 16) | (v << 8) | v) & mask);
+				}
+				break;
+			}
+
+			case pattern_zone_plate: {
+				// cos(pi r^2 / xres), which reaches the highest frequency that the frame can hold where r = xres / 2. The
+				// distances from the center are doubled so that they are whole numbers.
+				const int64_t dy = 2 * (int64_t)y + 1 - m_yres;
+				for (int x = 0; x < m_xres; x++) {
+					const int64_t dx = 2 * (int64_t)x + 1 - m_xres;
+					const uint32_t v = m_zone_plate[((dx * dx + dy * dy) * 128 / m_xres) & 1023];
+					p_dst[x] = 0xFF000000u | (v << 16) | (v << 8) | v;
+				}
+				break;
+			}
+
+			default:
+				std::fill_n(p_dst, m_xres, 0xFF000000u);
+				break;
+		}
+	}
+
+	void bgra_to_uyvy(uint8_t* p_dst, const uint32_t* p_src) const
+	{
+#ifdef NDI_CONTENT_X86
+		if (m_simd != simd_scalar) { ndi_content::detail::bgra_to_uyvy_sse41(p_dst, p_src, m_xres); return; }
+#endif
+		ndi_content::detail::bgra_to_uyvy_scalar(p_dst, p_src, 0, m_xres);
+	}
+
+	// A colour as a 32 bit word of the frame, which for UYVY is two pixels
+	uint32_t to_word(const uint32_t bgra) const
+	{
+		if (m_FourCC != NDIlib_FourCC_type_UYVY)
+			return bgra;
+
+		const uint32_t pair[2] = { bgra, bgra };
+		uint32_t word;
+		ndi_content::detail::bgra_to_uyvy_scalar((uint8_t*)&word, pair, 0, 2);
+		return word;
+	}
+
+	// The number of pixels in a 32 bit word
+	int pixels_per_word(void) const { return (m_FourCC == NDIlib_FourCC_type_UYVY) ? 2 : 1; }
+
+	void fill(uint8_t* p_data, const int line_stride, const detail::rect_t& rect, const uint32_t word) const
+	{
+		const int no_words = rect.w / pixels_per_word();
+		for (int y = rect.y; y < rect.y + rect.h; y++) {
+			uint32_t* p_dst = (uint32_t*)(p_data + (size_t)y * line_stride) + rect.x / pixels_per_word();
+#ifdef NDI_CONTENT_X86
+			if (m_simd == simd_avx2) { detail::fill_words_avx2(p_dst, word, no_words); continue; }
+			if (m_simd == simd_sse41) { detail::fill_words_sse41(p_dst, word, no_words); continue; }
+#endif
+			detail::fill_words_scalar(p_dst, word, 0, no_words);
+		}
+	}
+
+	void restore(uint8_t* p_data, const int line_stride, const detail::rect_t& rect) const
+	{
+		const size_t offset = (size_t)rect.x * 4 / pixels_per_word(), size = (size_t)rect.w * 4 / pixels_per_word();
+		for (int y = rect.y; y < rect.y + rect.h; y++)
+			memcpy(p_data + (size_t)y * line_stride + offset, &m_background[(size_t)y * m_background_stride + offset], size);
+	}
+
+	// The box moves a little under a frame's width a second at 60Hz, and at a different speed up and down
+	detail::rect_t draw_box(uint8_t* p_data, const int line_stride, const int64_t frame_no) const
+	{
+		const int size_x = std::min(m_box_size, m_xres & ~1), size_y = std::min(m_box_size, m_yres);
+		const int speed = std::max(2, (m_xres / 64) & ~1);
+		detail::rect_t rect = { detail::bounce(frame_no * speed, m_xres - size_x) & ~1, detail::bounce(frame_no * speed * 3 / 4, m_yres - size_y), size_x, size_y };
+		fill(p_data, line_stride, rect, m_box_word);
+		return rect;
+	}
+
+	// The frame number, in the top left of the frame
+	detail::rect_t draw_counter(uint8_t* p_data, const int line_stride, const int64_t frame_no) const
+	{
+		char text[32];
+		snprintf(text, sizeof(text), "FRAME %08lld", (long long)(frame_no % 100000000));
+
+		// Each character is 5x7 with a pixel around it, and the characters are scaled up so that they are readable
+		const int scale = m_text_scale, cell_w = 6 * scale, cell_h = 9 * scale;
+		const int no_chars = (int)strlen(text);
+		detail::rect_t rect = { 2 * scale, 2 * scale, (no_chars * cell_w + scale) & ~1, cell_h };
+		rect.w = std::max(0, std::min(rect.w, (m_xres - rect.x) & ~1));
+		rect.h = std::max(0, std::min(rect.h, m_yres - rect.y));
+		fill(p_data, line_stride, rect, m_counter_background_word);
+
+		// Each row of a character is made of runs of set pixels, which are filled like a rectangle
+		for (int ch = 0; ch < no_chars; ch++) {
+			const uint8_t* p_glyph = ndi_content::detail::glyph(text[ch]);
+			for (int row = 0; row < 7; row++) {
+				for (int bit = 0; bit < 5;) {
+					if (!((p_glyph[row] >> (4 - bit)) & 1)) {
+						bit++;
+						continue;
+					}
+
+					const int start = bit;
+					while ((bit < 5) && ((p_glyph[row] >> (4 - bit)) & 1))
+						bit++;
+
+					detail::rect_t run = { rect.x + scale + ch * cell_w + start * scale, rect.y + (row + 1) * scale, (bit - start) * scale, scale };
+					run.w = std::max(0, std::min(run.w, rect.x + rect.w - run.x));
+					run.h = std::max(0, std::min(run.h, rect.y + rect.h - run.y));
+					fill(p_data, line_stride, run, m_counter_text_word);
+				}
+			}
+		}
+
+		return rect;
+	}
+
+	pattern_e m_pattern;
+	options m_options;
+	simd_e m_simd;
+	ndi_thread::band_pool m_threads;
+
+	// The pattern for the current resolution and format
+	int m_xres, m_yres;
+	NDIlib_FourCC_video_type_e m_FourCC;
+	int m_background_stride;
+	std::vector<uint8_t> m_background;
+	uint8_t m_zone_plate[1024];
+
+	// What is drawn on top of it
+	uint32_t m_box_word, m_counter_background_word, m_counter_text_word;
+	int m_box_size, m_text_scale;
+
+	// The buffers that we have drawn in
+	std::vector<buffer_t> m_buffers;
+	uint64_t m_use_count;
+	int64_t m_no_full_frames;
+};
+
+} // namespace ndi_pattern
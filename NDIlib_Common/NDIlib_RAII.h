@@ -0,0 +1,377 @@
+#pragma once
+
+// RAII wrappers for the NDI instances and for the frames that they return.
+//
+// The handles (NDIInitializer, NDIFinder, NDIReceiver, NDIFrameSync and NDISender) own their NDI instance and destroy
+// it when they go out of scope. They cannot be copied, since two copies would destroy the same instance, but they can
+// be moved.
+//
+// VideoFrame, AudioFrame and MetadataFrame own a frame that was returned by a receiver or a frame-sync and free it in
+// the right way when they are destroyed. They can also only be moved, so a frame can be captured on one thread and
+// handed to another without copying the data and without any chance of it being freed twice or not at all. A frame
+// must be released before the receiver or frame-sync that it came from is destroyed.
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#include <Processing.NDI.Lib.h>
+
+// RAII class for initializing and cleaning up NDI
+class NDIInitializer {
+public:
+    NDIInitializer() : m_initialized(NDIlib_initialize()) {
+        if (!m_initialized) {
+            throw std::runtime_error("Failed to initialize NDI");
+        }
+    }
+
+    ~NDIInitializer() {
+        if (m_initialized) {
+            NDIlib_destroy();
+        }
+    }
+
+    NDIInitializer(NDIInitializer&& other) : m_initialized(other.m_initialized) { other.m_initialized = false; }
+    NDIInitializer& operator=(NDIInitializer&& other) { std::swap(m_initialized, other.m_initialized); return *this; }
+
+    NDIInitializer(const NDIInitializer&) = delete;
+    NDIInitializer& operator=(const NDIInitializer&) = delete;
+
+private:
+    bool m_initialized;
+};
+
+// Owns a video frame from a receiver or a frame-sync
+class VideoFrame {
+public:
+    VideoFrame() : m_pNDI_recv(nullptr), m_pNDI_framesync(nullptr) {}
+    ~VideoFrame() { reset(); }
+
+    VideoFrame(VideoFrame&& other) : VideoFrame() { swap(other); }
+    VideoFrame& operator=(VideoFrame&& other) { reset(); swap(other); return *this; }
+
+    VideoFrame(const VideoFrame&) = delete;
+    VideoFrame& operator=(const VideoFrame&) = delete;
+
+    // Take ownership of a frame that was just captured
+    static VideoFrame from_recv(NDIlib_recv_instance_t pNDI_recv, const NDIlib_video_frame_v2_t& frame) { return VideoFrame(frame, pNDI_recv, nullptr); }
+    static VideoFrame from_framesync(NDIlib_framesync_instance_t pNDI_framesync, const NDIlib_video_frame_v2_t& frame) { return VideoFrame(frame, nullptr, pNDI_framesync); }
+
+    // Free the frame now
+    void reset() {
+        if (m_pNDI_recv) {
+            NDIlib_recv_free_video_v2(m_pNDI_recv, &m_frame);
+        } else if (m_pNDI_framesync) {
+            NDIlib_framesync_free_video(m_pNDI_framesync, &m_frame);
+        }
+        m_pNDI_recv = nullptr;
+        m_pNDI_framesync = nullptr;
+        m_frame = NDIlib_video_frame_v2_t();
+    }
+
+    void swap(VideoFrame& other) {
+        std::swap(m_frame, other.m_frame);
+        std::swap(m_pNDI_recv, other.m_pNDI_recv);
+        std::swap(m_pNDI_framesync, other.m_pNDI_framesync);
+    }
+
+    // Is there a frame with data. A frame-sync returns an empty frame until the source has sent video.
+    explicit operator bool() const { return m_frame.p_data != nullptr; }
+
+    const NDIlib_video_frame_v2_t& get() const { return m_frame; }
+    const NDIlib_video_frame_v2_t* operator->() const { return &m_frame; }
+
+private:
+    VideoFrame(const NDIlib_video_frame_v2_t& frame, NDIlib_recv_instance_t pNDI_recv, NDIlib_framesync_instance_t pNDI_framesync)
+        : m_frame(frame), m_pNDI_recv(pNDI_recv), m_pNDI_framesync(pNDI_framesync) {}
+
+    NDIlib_video_frame_v2_t m_frame;
+    NDIlib_recv_instance_t m_pNDI_recv;
+    NDIlib_framesync_instance_t m_pNDI_framesync;
+};
+
+// Owns an audio frame from a receiver or a frame-sync
+class AudioFrame {
+public:
+    AudioFrame() : m_pNDI_recv(nullptr), m_pNDI_framesync(nullptr) {}
+    ~AudioFrame() { reset(); }
+
+    AudioFrame(AudioFrame&& other) : AudioFrame() { swap(other); }
+    AudioFrame& operator=(AudioFrame&& other) { reset(); swap(other); return *this; }
+
+    AudioFrame(const AudioFrame&) = delete;
+    AudioFrame& operator=(const AudioFrame&) = delete;
+
+    // Take ownership of a frame that was just captured
+    static AudioFrame from_recv(NDIlib_recv_instance_t pNDI_recv, const NDIlib_audio_frame_v2_t& frame) { return AudioFrame(frame, pNDI_recv, nullptr); }
+    static AudioFrame from_framesync(NDIlib_framesync_instance_t pNDI_framesync, const NDIlib_audio_frame_v2_t& frame) { return AudioFrame(frame, nullptr, pNDI_framesync); }
+
+    // Free the frame now
+    void reset() {
+        if (m_pNDI_recv) {
+            NDIlib_recv_free_audio_v2(m_pNDI_recv, &m_frame);
+        } else if (m_pNDI_framesync) {
+            NDIlib_framesync_free_audio(m_pNDI_framesync, &m_frame);
+        }
+        m_pNDI_recv = nullptr;
+        m_pNDI_framesync = nullptr;
+        m_frame = NDIlib_audio_frame_v2_t();
+    }
+
+    void swap(AudioFrame& other) {
+        std::swap(m_frame, other.m_frame);
+        std::swap(m_pNDI_recv, other.m_pNDI_recv);
+        std::swap(m_pNDI_framesync, other.m_pNDI_framesync);
+    }
+
+    explicit operator bool() const { return m_frame.p_data != nullptr; }
+
+    const NDIlib_audio_frame_v2_t& get() const { return m_frame; }
+    const NDIlib_audio_frame_v2_t* operator->() const { return &m_frame; }
+
+private:
+    AudioFrame(const NDIlib_audio_frame_v2_t& frame, NDIlib_recv_instance_t pNDI_recv, NDIlib_framesync_instance_t pNDI_framesync)
+        : m_frame(frame), m_pNDI_recv(pNDI_recv), m_pNDI_framesync(pNDI_framesync) {}
+
+    NDIlib_audio_frame_v2_t m_frame;
+    NDIlib_recv_instance_t m_pNDI_recv;
+    NDIlib_framesync_instance_t m_pNDI_framesync;
+};
+
+// Owns a metadata frame from a receiver
+class MetadataFrame {
+public:
+    MetadataFrame() : m_pNDI_recv(nullptr) {}
+    ~MetadataFrame() { reset(); }
+
+    MetadataFrame(MetadataFrame&& other) : MetadataFrame() { swap(other); }
+    MetadataFrame& operator=(MetadataFrame&& other) { reset(); swap(other); return *this; }
+
+    MetadataFrame(const MetadataFrame&) = delete;
+    MetadataFrame& operator=(const MetadataFrame&) = delete;
+
+    // Take ownership of a frame that was just captured
+    static MetadataFrame from_recv(NDIlib_recv_instance_t pNDI_recv, const NDIlib_metadata_frame_t& frame) { return MetadataFrame(frame, pNDI_recv); }
+
+    // Free the frame now
+    void reset() {
+        if (m_pNDI_recv) {
+            NDIlib_recv_free_metadata(m_pNDI_recv, &m_frame);
+        }
+        m_pNDI_recv = nullptr;
+        m_frame = NDIlib_metadata_frame_t();
+    }
+
+    void swap(MetadataFrame& other) {
+        std::swap(m_frame, other.m_frame);
+        std::swap(m_pNDI_recv, other.m_pNDI_recv);
+    }
+
+    explicit operator bool() const { return m_frame.p_data != nullptr; }
+
+    const NDIlib_metadata_frame_t& get() const { return m_frame; }
+    const NDIlib_metadata_frame_t* operator->() const { return &m_frame; }
+
+private:
+    MetadataFrame(const NDIlib_metadata_frame_t& frame, NDIlib_recv_instance_t pNDI_recv) : m_frame(frame), m_pNDI_recv(pNDI_recv) {}
+
+    NDIlib_metadata_frame_t m_frame;
+    NDIlib_recv_instance_t m_pNDI_recv;
+};
+
+// RAII class for handling the NDI find instance
+class NDIFinder {
+public:
+    explicit NDIFinder(const NDIlib_find_create_t* p_create_settings = nullptr) {
+        pNDI_find = NDIlib_find_create_v2(p_create_settings);
+        if (!pNDI_find) {
+            throw std::runtime_error("Failed to create NDI finder");
+        }
+    }
+
+    ~NDIFinder() {
+        if (pNDI_find) {
+            NDIlib_find_destroy(pNDI_find);
+        }
+    }
+
+    NDIFinder(NDIFinder&& other) : pNDI_find(other.pNDI_find) { other.pNDI_find = nullptr; }
+    NDIFinder& operator=(NDIFinder&& other) { std::swap(pNDI_find, other.pNDI_find); return *this; }
+
+    NDIFinder(const NDIFinder&) = delete;
+    NDIFinder& operator=(const NDIFinder&) = delete;
+
+    // Wait until the sources on the network have changed
+    bool wait_for_sources(uint32_t timeout_in_ms) {
+        return NDIlib_find_wait_for_sources(pNDI_find, timeout_in_ms);
+    }
+
+    // The current sources, these remain valid until the next call or until the finder is destroyed
+    const NDIlib_source_t* get_current_sources(uint32_t& no_sources) {
+        return NDIlib_find_get_current_sources(pNDI_find, &no_sources);
+    }
+
+    NDIlib_find_instance_t get() const {
+        return pNDI_find;
+    }
+
+private:
+    NDIlib_find_instance_t pNDI_find;
+};
+
+// RAII class for handling the NDI receiver instance
+class NDIReceiver {
+public:
+    explicit NDIReceiver(const NDIlib_recv_create_v3_t* p_create_settings = nullptr) {
+        pNDI_recv = NDIlib_recv_create_v3(p_create_settings);
+        if (!pNDI_recv) {
+            throw std::runtime_error("Failed to create NDI receiver");
+        }
+    }
+
+    // Create a receiver that connects to a source straight away
+    NDIReceiver(const NDIlib_source_t& source, const char* p_ndi_recv_name) {
+        NDIlib_recv_create_v3_t NDI_recv_create_desc;
+        NDI_recv_create_desc.source_to_connect_to = source;
+        NDI_recv_create_desc.p_ndi_recv_name = p_ndi_recv_name;
+
+        pNDI_recv = NDIlib_recv_create_v3(&NDI_recv_create_desc);
+        if (!pNDI_recv) {
+            throw std::runtime_error("Failed to create NDI receiver");
+        }
+    }
+
+    ~NDIReceiver() {
+        if (pNDI_recv) {
+            NDIlib_recv_destroy(pNDI_recv);
+        }
+    }
+
+    NDIReceiver(NDIReceiver&& other) : pNDI_recv(other.pNDI_recv) { other.pNDI_recv = nullptr; }
+    NDIReceiver& operator=(NDIReceiver&& other) { std::swap(pNDI_recv, other.pNDI_recv); return *this; }
+
+    NDIReceiver(const NDIReceiver&) = delete;
+    NDIReceiver& operator=(const NDIReceiver&) = delete;
+
+    void connect(const NDIlib_source_t* p_source) {
+        NDIlib_recv_connect(pNDI_recv, p_source);
+    }
+
+    void connect(const NDIlib_source_t& source) {
+        NDIlib_recv_connect(pNDI_recv, &source);
+    }
+
+    // Capture a frame. Any of the frames may be null if that type is not wanted, and the frame of the type that is
+    // returned now owns the data.
+    NDIlib_frame_type_e capture(VideoFrame* p_video, AudioFrame* p_audio, MetadataFrame* p_metadata, uint32_t timeout_in_ms) {
+        NDIlib_video_frame_v2_t video_frame;
+        NDIlib_audio_frame_v2_t audio_frame;
+        NDIlib_metadata_frame_t metadata_frame;
+
+        const NDIlib_frame_type_e frame_type = NDIlib_recv_capture_v2(pNDI_recv, p_video ? &video_frame : nullptr,
+            p_audio ? &audio_frame : nullptr, p_metadata ? &metadata_frame : nullptr, timeout_in_ms);
+
+        switch (frame_type) {
+            case NDIlib_frame_type_video:
+                *p_video = VideoFrame::from_recv(pNDI_recv, video_frame);
+                break;
+
+            case NDIlib_frame_type_audio:
+                *p_audio = AudioFrame::from_recv(pNDI_recv, audio_frame);
+                break;
+
+            case NDIlib_frame_type_metadata:
+                *p_metadata = MetadataFrame::from_recv(pNDI_recv, metadata_frame);
+                break;
+
+            default:
+                break;
+        }
+
+        return frame_type;
+    }
+
+    NDIlib_recv_instance_t get() const { return pNDI_recv; }
+
+private:
+    NDIlib_recv_instance_t pNDI_recv;
+};
+
+// RAII class for handling the NDI frame sync. It must be destroyed before the receiver that it was created from.
+class NDIFrameSync {
+public:
+    explicit NDIFrameSync(NDIlib_recv_instance_t pNDI_recv) {
+        pNDI_framesync = NDIlib_framesync_create(pNDI_recv);
+        if (!pNDI_framesync) {
+            throw std::runtime_error("Failed to create NDI frame sync");
+        }
+    }
+
+    ~NDIFrameSync() {
+        if (pNDI_framesync) {
+            NDIlib_framesync_destroy(pNDI_framesync);
+        }
+    }
+
+    NDIFrameSync(NDIFrameSync&& other) : pNDI_framesync(other.pNDI_framesync) { other.pNDI_framesync = nullptr; }
+    NDIFrameSync& operator=(NDIFrameSync&& other) { std::swap(pNDI_framesync, other.pNDI_framesync); return *this; }
+
+    NDIFrameSync(const NDIFrameSync&) = delete;
+    NDIFrameSync& operator=(const NDIFrameSync&) = delete;
+
+    // Get the current video frame, this is empty until the source has sent video
+    VideoFrame capture_video(NDIlib_frame_format_type_e field_type = NDIlib_frame_format_type_progressive) {
+        NDIlib_video_frame_v2_t video_frame;
+        NDIlib_framesync_capture_video(pNDI_framesync, &video_frame, field_type);
+        return VideoFrame::from_framesync(pNDI_framesync, video_frame);
+    }
+
+    // Get audio, resampled to the rate and number of channels that are asked for. Zero for either means use what the
+    // source is sending.
+    AudioFrame capture_audio(int sample_rate, int no_channels, int no_samples) {
+        NDIlib_audio_frame_v2_t audio_frame;
+        NDIlib_framesync_capture_audio(pNDI_framesync, &audio_frame, sample_rate, no_channels, no_samples);
+        return AudioFrame::from_framesync(pNDI_framesync, audio_frame);
+    }
+
+    // The number of audio samples that are currently queued
+    int audio_queue_depth() {
+        return NDIlib_framesync_audio_queue_depth(pNDI_framesync);
+    }
+
+    NDIlib_framesync_instance_t get() const { return pNDI_framesync; }
+
+private:
+    NDIlib_framesync_instance_t pNDI_framesync;
+};
+
+// RAII class for handling the NDI sender instance
+class NDISender {
+public:
+    explicit NDISender(const NDIlib_send_create_t* p_create_settings = nullptr) {
+        pNDI_send = NDIlib_send_create(p_create_settings);
+        if (!pNDI_send) {
+            throw std::runtime_error("Failed to create NDI sender");
+        }
+    }
+
+    ~NDISender() {
+        if (pNDI_send) {
+            // Make sure that no asynchronous frame is still in use
+            NDIlib_send_send_video_async_v2(pNDI_send, nullptr);
+            NDIlib_send_destroy(pNDI_send);
+        }
+    }
+
+    NDISender(NDISender&& other) : pNDI_send(other.pNDI_send) { other.pNDI_send = nullptr; }
+    NDISender& operator=(NDISender&& other) { std::swap(pNDI_send, other.pNDI_send); return *this; }
+
+    NDISender(const NDISender&) = delete;
+    NDISender& operator=(const NDISender&) = delete;
+
+    NDIlib_send_instance_t get() const { return pNDI_send; }
+
+private:
+    NDIlib_send_instance_t pNDI_send;
+};
@@ -0,0 +1,267 @@
+#pragma once
+
+// Raw video frames on disk, in a form that can be memory mapped and handed to NDI as they are.
+//
+// A raw frame file is a header followed by the frame exactly as it is sent, line stride and all. The header is padded to
+// a whole page, so that the frame in a mapping of the file is page aligned. The header also records the size and the
+// modification time of the file that the frame was made from, if there was one, so that a frame that is used as a cache
+// can tell when it is out of date.
+//
+//		ndi_raw::mapped_file file;
+//		ndi_raw::frame_header_t header;
+//		if (ndi_raw::map_frame_file("frame.ndiraw", file, header)) {
+//			NDI_video_frame.p_data = (uint8_t*)ndi_raw::frame_data(file, header);
+//			...
+//		}
+//
+// The mapping is read-only, and the pages come from the operating system's file cache, so a file that was used recently
+// is sent without it being read or copied at all.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <Processing.NDI.Lib.h>
+
+namespace ndi_raw {
+
+// The size and modification time of a file
+struct file_info_t {
+	int64_t size;
+	int64_t mtime;
+
+	bool operator==(const file_info_t& other) const { return (size == other.size) && (mtime == other.mtime); }
+};
+
+inline bool get_file_info(const std::string& filename, file_info_t& info)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &attributes))
+		return false;
+	info.size = ((int64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+	info.mtime = ((int64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat file_stat;
+	if (stat(filename.c_str(), &file_stat))
+		return false;
+	info.size = (int64_t)file_stat.st_size;
+#ifdef __APPLE__
+	info.mtime = (int64_t)file_stat.st_mtimespec.tv_sec * 1000000000LL + file_stat.st_mtimespec.tv_nsec;
+#else
+	info.mtime = (int64_t)file_stat.st_mtim.tv_sec * 1000000000LL + file_stat.st_mtim.tv_nsec;
+#endif
+#endif
+	return true;
+}
+
+// A read-only mapping of a whole file
+class mapped_file {
+public:
+	mapped_file(void) : m_p_data(NULL), m_size(0)
+#ifdef _WIN32
+		, m_hFile(INVALID_HANDLE_VALUE), m_hMapping(NULL)
+#endif
+	{
+	}
+
+	~mapped_file(void) { close(); }
+
+	bool open(const std::string& filename)
+	{
+		close();
+
+#ifdef _WIN32
+		m_hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (m_hFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_hFile, &size) || !size.QuadPart) {
+			close();
+			return false;
+		}
+		m_size = (size_t)size.QuadPart;
+
+		m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		m_p_data = m_hMapping ? (const uint8_t*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+#else
+		const int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) || !file_stat.st_size) {
+			::close(fd);
+			return false;
+		}
+		m_size = (size_t)file_stat.st_size;
+
+		// The mapping keeps the file open
+		void* p_data = mmap(NULL, m_size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		m_p_data = (p_data == MAP_FAILED) ? NULL : (const uint8_t*)p_data;
+#endif
+
+		if (!m_p_data) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close(void)
+	{
+#ifdef _WIN32
+		if (m_p_data)
+			UnmapViewOfFile(m_p_data);
+		if (m_hMapping)
+			CloseHandle(m_hMapping);
+		if (m_hFile != INVALID_HANDLE_VALUE)
+			CloseHandle(m_hFile);
+		m_hMapping = NULL;
+		m_hFile = INVALID_HANDLE_VALUE;
+#else
+		if (m_p_data)
+			munmap((void*)m_p_data, m_size);
+#endif
+		m_p_data = NULL;
+		m_size = 0;
+	}
+
+	// Ask for a range of the file to be read in, because we are about to use it
+	void will_need(const size_t offset, const size_t size) const
+	{
+#ifndef _WIN32
+		if (m_p_data && (offset < m_size)) {
+			const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+			const size_t start = offset / page * page;
+			madvise((void*)(m_p_data + start), std::min(m_size, offset + size) - start, MADV_WILLNEED);
+		}
+#else
+		(void)offset;
+		(void)size;
+#endif
+	}
+
+	const uint8_t* data(void) const { return m_p_data; }
+	size_t size(void) const { return m_size; }
+	bool is_open(void) const { return m_p_data != NULL; }
+
+private:
+	mapped_file(const mapped_file&);
+	mapped_file& operator=(const mapped_file&);
+
+	const uint8_t* m_p_data;
+	size_t m_size;
+#ifdef _WIN32
+	HANDLE m_hFile, m_hMapping;
+#endif
+};
+
+// The header of a raw frame file. The values are in the byte order of the machine that wrote it.
+struct frame_header_t {
+	char magic[8];					// "NDIRAW1"
+	uint32_t header_size;			// Where the frame starts in the file, which is a whole number of pages
+	uint32_t FourCC;
+	int32_t xres, yres;
+	int32_t line_stride_in_bytes;
+	int32_t frame_rate_N, frame_rate_D;
+	uint32_t flags;					// What the frame was made with, which is up to the application
+	uint64_t data_size;				// The size of the frame
+	file_info_t source;				// The file that the frame was made from, or zero
+
+	frame_header_t(void)
+	{
+		memset(this, 0, sizeof(*this));
+		memcpy(magic, "NDIRAW1", 8);
+		header_size = 4096;
+	}
+};
+
+// The frame in a mapped file
+inline const uint8_t* frame_data(const mapped_file& file, const frame_header_t& header)
+{
+	return file.data() + header.header_size;
+}
+
+// Write a frame file. It is written to a temporary file that is then renamed, so that a file that is being mapped by
+// someone else never changes underneath them, and a file that was not finished is never seen. Each write has its own
+// temporary file, so several threads or processes can write the same frame file at once and one of them wins.
+inline bool write_frame_file(const std::string& filename, const frame_header_t& header, const uint8_t* p_data)
+{
+	static std::atomic<uint32_t> write_no(0);
+#ifdef _WIN32
+	const unsigned long process_id = (unsigned long)GetCurrentProcessId();
+#else
+	const unsigned long process_id = (unsigned long)getpid();
+#endif
+	char suffix[64];
+	snprintf(suffix, sizeof(suffix), ".%lu.%zx.%u.tmp", process_id, std::hash<std::thread::id>()(std::this_thread::get_id()), (unsigned)write_no++);
+	const std::string temp_filename = filename + suffix;
+	FILE* p_file = fopen(temp_filename.c_str(), "wb");
+	if (!p_file)
+		return false;
+
+	// The header is padded with zeros to where the frame starts
+	char padding[4096] = { 0 };
+	bool ok = (header.header_size >= sizeof(header)) && (fwrite(&header, sizeof(header), 1, p_file) == 1);
+	for (size_t remaining = header.header_size - sizeof(header); ok && remaining;) {
+		const size_t size = std::min(remaining, sizeof(padding));
+		ok = (fwrite(padding, 1, size, p_file) == size);
+		remaining -= size;
+	}
+	ok = ok && (fwrite(p_data, 1, (size_t)header.data_size, p_file) == (size_t)header.data_size);
+	ok = (fclose(p_file) == 0) && ok;
+
+#ifdef _WIN32
+	// rename does not replace a file on Windows
+	if (!ok || !MoveFileExA(temp_filename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+#else
+	if (!ok || rename(temp_filename.c_str(), filename.c_str())) {
+#endif
+		remove(temp_filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Map a frame file and check that it is complete. When the source is given, the frame must have been made from a file
+// of the same size and modification time.
+inline bool map_frame_file(const std::string& filename, mapped_file& file, frame_header_t& header, const file_info_t* p_source = NULL)
+{
+	if (!file.open(filename))
+		return false;
+
+	bool ok = (file.size() >= sizeof(header));
+	if (ok) {
+		memcpy(&header, file.data(), sizeof(header));
+		ok = !memcmp(header.magic, "NDIRAW1", 8) && (header.header_size >= sizeof(header)) && (header.header_size <= file.size()) &&
+			(header.data_size <= file.size() - header.header_size) &&
+			(header.xres > 0) && (header.yres > 0) && (!p_source || (header.source == *p_source));
+	}
+
+	if (!ok)
+		file.close();
+	return ok;
+}
+
+} // namespace ndi_raw
@@ -0,0 +1,399 @@
+#pragma once
+
+// Recordings of what an NDI receiver sees, with its video, audio and metadata frames exactly as they were received, in a
+// form that can be memory mapped and played back without copying them.
+//
+// A recording is a header padded to a page, then the frames in the order that they were received, then an index. Each
+// frame is an index entry followed by the frame's data, and any metadata that was attached to it. Video frames start on
+// a page and everything else on a cache line, so that they can be handed to NDI straight from a mapping of the file.
+// The index is a copy of all of the entries, which is written when the recording is closed. When a recording was not
+// closed properly the reader finds the frames by walking the entries instead.
+//
+//		ndi_record::reader recording;
+//		if (recording.open("recording.ndirec")) {
+//			for (const ndi_record::index_entry_t& entry : recording.entries()) {
+//				if (entry.type == ndi_record::frame_type_video) {
+//					NDIlib_video_frame_v2_t video_frame;
+//					recording.get_video(entry, video_frame);
+//					...
+//
+// The values are in the byte order of the machine that wrote it.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <Processing.NDI.Lib.h>
+
+#include "NDIlib_Color.h"
+#include "NDIlib_Raw.h"
+
+namespace ndi_record {
+
+enum frame_type_e { frame_type_video = 1, frame_type_audio = 2, frame_type_metadata = 3 };
+
+// Where the frame data starts
+static const size_t video_alignment = 4096;
+static const size_t data_alignment = 64;
+
+// A frame in a recording
+struct index_entry_t {
+	char magic[4];					// "NDIF"
+	uint32_t type;					// frame_type_e
+	int64_t time;					// When it was received, in nanoseconds since the first frame
+	int64_t timecode, timestamp;	// As they were received
+	uint64_t offset;				// Where the data is
+	uint64_t data_size;				// The size of the data
+	uint32_t metadata_size;			// The size of the metadata that follows the data, with its terminator, or zero
+
+	// Video
+	uint32_t FourCC;
+	int32_t xres, yres;
+	int32_t line_stride_in_bytes;
+	int32_t frame_rate_N, frame_rate_D;
+	float picture_aspect_ratio;
+	int32_t frame_format_type;
+
+	// Audio
+	int32_t sample_rate, no_channels, no_samples;
+	int32_t channel_stride_in_bytes;
+
+	index_entry_t(void)
+	{
+		memset(this, 0, sizeof(*this));
+		memcpy(magic, "NDIF", 4);
+	}
+};
+
+// The header at the start of a recording
+struct file_header_t {
+	char magic[8];					// "NDIREC1"
+	uint32_t header_size;			// Where the first frame starts
+	uint32_t entry_size;			// The size of an index entry
+	uint64_t index_offset;			// Where the index is, or zero when the recording was not closed
+	uint64_t no_entries;			// The number of entries in the index
+	int64_t duration;				// The time from the first frame to the last one, in nanoseconds
+	char source[256];				// The name of the source that was recorded
+
+	file_header_t(void)
+	{
+		memset(this, 0, sizeof(*this));
+		memcpy(magic, "NDIREC1", 8);
+		header_size = 4096;
+		entry_size = sizeof(index_entry_t);
+	}
+};
+
+namespace detail {
+
+inline uint64_t align(const uint64_t offset, const size_t alignment)
+{
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+} // namespace detail
+
+// Writes a recording. Frames are written in the order that they are given, and the time of each one is up to the
+// caller, which would normally be when it was received.
+class writer {
+public:
+	writer(void) : m_p_file(NULL), m_offset(0), m_first_time(0) {}
+	~writer(void) { close(); }
+
+	bool open(const std::string& filename, const char* p_source_name)
+	{
+		close();
+		m_p_file = fopen(filename.c_str(), "wb");
+		if (!m_p_file)
+			return false;
+
+		// Video frames are big enough to go straight to the file, it is the small frames that want buffering
+		setvbuf(m_p_file, NULL, _IOFBF, 1024 * 1024);
+
+		m_header = file_header_t();
+		if (p_source_name)
+			strncpy(m_header.source, p_source_name, sizeof(m_header.source) - 1);
+		m_entries.clear();
+		m_offset = 0;
+		if (!write_at(0, &m_header, sizeof(m_header)) || !pad_to(m_header.header_size)) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	// Finish the recording by writing the index
+	bool close(void)
+	{
+		if (!m_p_file)
+			return false;
+
+		m_header.index_offset = detail::align(m_offset, data_alignment);
+		m_header.no_entries = m_entries.size();
+		m_header.duration = m_entries.empty() ? 0 : m_entries.back().time;
+
+		bool ok = pad_to(m_header.index_offset) &&
+			(m_entries.empty() || write_at(m_offset, m_entries.data(), m_entries.size() * sizeof(index_entry_t)));
+		ok = ok && !fseek(m_p_file, 0, SEEK_SET) && (fwrite(&m_header, sizeof(m_header), 1, m_p_file) == 1);
+		ok = (fclose(m_p_file) == 0) && ok;
+		m_p_file = NULL;
+		return ok;
+	}
+
+	bool write_video(const NDIlib_video_frame_v2_t& frame, const int64_t time)
+	{
+		const int line_stride = frame.line_stride_in_bytes ? frame.line_stride_in_bytes : ndi_color::line_stride(frame.FourCC, frame.xres);
+		const size_t data_size = ndi_color::frame_size(frame.FourCC, frame.xres, frame.yres, line_stride);
+		if (!data_size || !frame.p_data)
+			return false;
+
+		index_entry_t entry;
+		entry.type = frame_type_video;
+		entry.timecode = frame.timecode;
+		entry.timestamp = frame.timestamp;
+		entry.FourCC = (uint32_t)frame.FourCC;
+		entry.xres = frame.xres;
+		entry.yres = frame.yres;
+		entry.line_stride_in_bytes = line_stride;
+		entry.frame_rate_N = frame.frame_rate_N;
+		entry.frame_rate_D = frame.frame_rate_D;
+		entry.picture_aspect_ratio = frame.picture_aspect_ratio;
+		entry.frame_format_type = (int32_t)frame.frame_format_type;
+		return write_entry(entry, time, video_alignment, frame.p_data, data_size, frame.p_metadata);
+	}
+
+	bool write_audio(const NDIlib_audio_frame_v2_t& frame, const int64_t time)
+	{
+		if (!frame.p_data || (frame.no_channels <= 0) || (frame.no_samples <= 0))
+			return false;
+
+		index_entry_t entry;
+		entry.type = frame_type_audio;
+		entry.timecode = frame.timecode;
+		entry.timestamp = frame.timestamp;
+		entry.sample_rate = frame.sample_rate;
+		entry.no_channels = frame.no_channels;
+		entry.no_samples = frame.no_samples;
+		entry.channel_stride_in_bytes = frame.channel_stride_in_bytes ? frame.channel_stride_in_bytes : frame.no_samples * (int)sizeof(float);
+		const size_t data_size = (size_t)entry.channel_stride_in_bytes * (frame.no_channels - 1) + (size_t)frame.no_samples * sizeof(float);
+		return write_entry(entry, time, data_alignment, (const uint8_t*)frame.p_data, data_size, frame.p_metadata);
+	}
+
+	bool write_metadata(const NDIlib_metadata_frame_t& frame, const int64_t time)
+	{
+		if (!frame.p_data)
+			return false;
+
+		index_entry_t entry;
+		entry.type = frame_type_metadata;
+		entry.timecode = frame.timecode;
+		return write_entry(entry, time, data_alignment, (const uint8_t*)frame.p_data, strlen(frame.p_data) + 1, NULL);
+	}
+
+	bool is_open(void) const { return m_p_file != NULL; }
+	uint64_t size(void) const { return m_offset; }
+	size_t no_frames(void) const { return m_entries.size(); }
+
+private:
+	writer(const writer&);
+	writer& operator=(const writer&);
+
+	bool write_entry(index_entry_t& entry, const int64_t time, const size_t alignment, const uint8_t* p_data, const size_t data_size, const char* p_metadata)
+	{
+		if (!m_p_file)
+			return false;
+
+		// Times are from the first frame
+		if (m_entries.empty())
+			m_first_time = time;
+		entry.time = time - m_first_time;
+
+		const uint64_t entry_offset = detail::align(m_offset, data_alignment);
+		entry.offset = detail::align(entry_offset + sizeof(entry), alignment);
+		entry.data_size = data_size;
+		entry.metadata_size = p_metadata ? (uint32_t)strlen(p_metadata) + 1 : 0;
+
+		const bool ok = pad_to(entry_offset) && write_at(entry_offset, &entry, sizeof(entry)) && pad_to(entry.offset) &&
+			write_at(entry.offset, p_data, data_size) && (!p_metadata || write_at(m_offset, p_metadata, entry.metadata_size));
+		if (ok)
+			m_entries.push_back(entry);
+		return ok;
+	}
+
+	// The file is written in order, so this only checks that we are where we think we are
+	bool write_at(const uint64_t offset, const void* p_data, const size_t size)
+	{
+		if ((offset != m_offset) || (fwrite(p_data, 1, size, m_p_file) != size))
+			return false;
+		m_offset += size;
+		return true;
+	}
+
+	bool pad_to(const uint64_t offset)
+	{
+		static const uint8_t padding[video_alignment] = { 0 };
+		while (m_offset < offset) {
+			if (!write_at(m_offset, padding, (size_t)std::min<uint64_t>(offset - m_offset, sizeof(padding))))
+				return false;
+		}
+		return true;
+	}
+
+	FILE* m_p_file;
+	file_header_t m_header;
+	std::vector<index_entry_t> m_entries;
+	uint64_t m_offset;
+	int64_t m_first_time;
+};
+
+// Reads a recording through a memory mapping. The frames point into the mapping, so they stay valid until the reader is
+// closed.
+class reader {
+public:
+	reader(void) : m_complete(false) {}
+
+	bool open(const std::string& filename)
+	{
+		close();
+		if (!m_file.open(filename) || (m_file.size() < sizeof(m_header)))
+			return fail();
+
+		memcpy(&m_header, m_file.data(), sizeof(m_header));
+		if (memcmp(m_header.magic, "NDIREC1", 8) || (m_header.entry_size != sizeof(index_entry_t)) || (m_header.header_size < sizeof(m_header)))
+			return fail();
+		m_header.source[sizeof(m_header.source) - 1] = 0;
+
+		// Use the index when there is one, otherwise find the frames
+		m_complete = m_header.index_offset && (m_header.index_offset + m_header.no_entries * sizeof(index_entry_t) <= m_file.size());
+		if (m_complete) {
+			m_entries.resize((size_t)m_header.no_entries);
+			if (!m_entries.empty())
+				memcpy(m_entries.data(), m_file.data() + m_header.index_offset, m_entries.size() * sizeof(index_entry_t));
+		} else {
+			for (uint64_t offset = m_header.header_size; offset + sizeof(index_entry_t) <= m_file.size();) {
+				index_entry_t entry;
+				memcpy(&entry, m_file.data() + offset, sizeof(entry));
+				if (memcmp(entry.magic, "NDIF", 4) || (entry.offset < offset + sizeof(entry)) ||
+					(entry.offset + entry.data_size + entry.metadata_size > m_file.size()))
+					break;
+				m_entries.push_back(entry);
+				offset = detail::align(entry.offset + entry.data_size + entry.metadata_size, data_alignment);
+			}
+			m_header.duration = m_entries.empty() ? 0 : m_entries.back().time;
+		}
+
+		// Check that every frame is in the file, and what it says it is
+		for (const index_entry_t& entry : m_entries) {
+			if (!is_valid(entry))
+				return fail();
+		}
+		return !m_entries.empty() || fail();
+	}
+
+	void close(void)
+	{
+		m_file.close();
+		m_entries.clear();
+		m_complete = false;
+	}
+
+	const std::vector<index_entry_t>& entries(void) const { return m_entries; }
+	const char* source_name(void) const { return m_header.source; }
+	int64_t duration(void) const { return m_header.duration; }
+	uint64_t size(void) const { return m_file.size(); }
+
+	// Whether the recording was closed properly, rather than its frames being found by walking through it
+	bool is_complete(void) const { return m_complete; }
+
+	// The frames, pointing into the mapping
+	void get_video(const index_entry_t& entry, NDIlib_video_frame_v2_t& frame) const
+	{
+		frame.xres = entry.xres;
+		frame.yres = entry.yres;
+		frame.FourCC = (NDIlib_FourCC_video_type_e)entry.FourCC;
+		frame.frame_rate_N = entry.frame_rate_N;
+		frame.frame_rate_D = entry.frame_rate_D;
+		frame.picture_aspect_ratio = entry.picture_aspect_ratio;
+		frame.frame_format_type = (NDIlib_frame_format_type_e)entry.frame_format_type;
+		frame.timecode = entry.timecode;
+		frame.timestamp = entry.timestamp;
+		frame.p_data = (uint8_t*)data(entry);
+		frame.line_stride_in_bytes = entry.line_stride_in_bytes;
+		frame.p_metadata = metadata(entry);
+	}
+
+	void get_audio(const index_entry_t& entry, NDIlib_audio_frame_v2_t& frame) const
+	{
+		frame.sample_rate = entry.sample_rate;
+		frame.no_channels = entry.no_channels;
+		frame.no_samples = entry.no_samples;
+		frame.timecode = entry.timecode;
+		frame.timestamp = entry.timestamp;
+		frame.p_data = (float*)data(entry);
+		frame.channel_stride_in_bytes = entry.channel_stride_in_bytes;
+		frame.p_metadata = metadata(entry);
+	}
+
+	void get_metadata(const index_entry_t& entry, NDIlib_metadata_frame_t& frame) const
+	{
+		frame.length = (int)entry.data_size;
+		frame.timecode = entry.timecode;
+		frame.p_data = (char*)data(entry);
+	}
+
+	// Ask for a frame to be read in, because we are about to send it
+	void will_need(const index_entry_t& entry) const
+	{
+		m_file.will_need((size_t)entry.offset, (size_t)(entry.data_size + entry.metadata_size));
+	}
+
+private:
+	reader(const reader&);
+	reader& operator=(const reader&);
+
+	bool fail(void)
+	{
+		close();
+		return false;
+	}
+
+	const uint8_t* data(const index_entry_t& entry) const
+	{
+		return m_file.data() + entry.offset;
+	}
+
+	const char* metadata(const index_entry_t& entry) const
+	{
+		return entry.metadata_size ? (const char*)(m_file.data() + entry.offset + entry.data_size) : NULL;
+	}
+
+	bool is_valid(const index_entry_t& entry) const
+	{
+		if ((entry.offset + entry.data_size + entry.metadata_size > m_file.size()) || (entry.metadata_size && data(entry)[entry.data_size + entry.metadata_size - 1]))
+			return false;
+
+		switch (entry.type) {
+			case frame_type_video:
+				return (entry.xres > 0) && (entry.yres > 0) &&
+					(ndi_color::frame_size((NDIlib_FourCC_video_type_e)entry.FourCC, entry.xres, entry.yres, entry.line_stride_in_bytes) == entry.data_size);
+			case frame_type_audio:
+				return (entry.no_channels > 0) && (entry.no_samples > 0) &&
+					((uint64_t)entry.channel_stride_in_bytes * (entry.no_channels - 1) + (uint64_t)entry.no_samples * sizeof(float) == entry.data_size);
+			case frame_type_metadata:
+				return entry.data_size && !data(entry)[entry.data_size - 1];
+			default:
+				return false;
+		}
+	}
+
+	ndi_raw::mapped_file m_file;
+	file_header_t m_header;
+	std::vector<index_entry_t> m_entries;
+	bool m_complete;
+};
+
+} // namespace ndi_record
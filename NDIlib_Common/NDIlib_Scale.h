@@ -0,0 +1,352 @@
+#pragma once
+
+// Scaling 8 bit frames with four bytes per pixel (BGRA, BGRX, RGBA and RGBX), for making thumbnails and previews.
+//
+// There are two filters :
+//		box			Each output pixel is the average of the rectangle of input pixels that it covers. This is what you
+//					want when shrinking a lot, since every input pixel counts and nothing aliases. The rows of a
+//					rectangle are summed into a 16 bit line first, and then the columns of each pixel of that line.
+//		bilinear	Each output pixel is blended from the four input pixels around its center. This is for enlarging or
+//					for shrinking by less than half, where a box would be only one or two pixels across.
+// The channels are treated the same, so the order of them does not matter. The sums use AVX2 or SSE4.1 when the CPU has
+// them, with a scalar fallback that gives exactly the same results.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include <Processing.NDI.Lib.h>
+
+#include "NDIlib_Content.h"
+
+namespace ndi_scale {
+
+// The instruction sets are the same as the content generator's
+using ndi_content::simd_e;
+using ndi_content::simd_scalar;
+using ndi_content::simd_sse41;
+using ndi_content::simd_avx2;
+using ndi_content::simd_name;
+using ndi_content::detect_simd;
+
+// The filters, automatic uses a box when shrinking by at least half in both directions and bilinear otherwise
+enum filter_e {
+	filter_auto,
+	filter_box,
+	filter_bilinear
+};
+
+inline const char* filter_name(const filter_e filter)
+{
+	static const char* p_names[] = { "auto", "box", "bilinear" };
+	return p_names[filter];
+}
+
+inline bool parse_filter(const char* p_name, filter_e& filter)
+{
+	for (int i = filter_auto; i <= filter_bilinear; i++) {
+		if (!strcasecmp(p_name, filter_name((filter_e)i))) {
+			filter = (filter_e)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Can frames in this format be scaled
+inline bool is_supported(const NDIlib_FourCC_video_type_e FourCC)
+{
+	return (FourCC == NDIlib_FourCC_type_BGRA) || (FourCC == NDIlib_FourCC_type_BGRX) ||
+		(FourCC == NDIlib_FourCC_type_RGBA) || (FourCC == NDIlib_FourCC_type_RGBX);
+}
+
+namespace detail {
+
+// The most rows that are summed for a box, 257 x 255 is the most that fits in 16 bits. Taller boxes skip rows.
+static const int max_box_rows = 256;
+
+// Add a line of n bytes into the 16 bit sums, or start the sums from it
+inline void accumulate_scalar(uint16_t* p_sum, const uint8_t* p_src, const bool first, const int x, const int n)
+{
+	for (int i = x; i < n; i++)
+		p_sum[i] = first ? (uint16_t)p_src[i] : (uint16_t)(p_sum[i] + p_src[i]);
+}
+
+// Divide the sums of the pixels in each box by the number in it, which is done by multiplying by 1 / count in single
+// precision, since with thousands of pixels in a box the sums are too big to do that in 32 bit fixed point
+inline void box_columns_scalar(uint8_t* p_dst, const uint16_t* p_sum, const int* p_x_start, const int* p_x_end, const float* p_recip, const int x, const int dst_xres)
+{
+	for (int dst_x = x; dst_x < dst_xres; dst_x++) {
+		uint32_t total[4] = { 0, 0, 0, 0 };
+		for (int src_x = p_x_start[dst_x]; src_x < p_x_end[dst_x]; src_x++) {
+			for (int c = 0; c < 4; c++)
+				total[c] += p_sum[src_x * 4 + c];
+		}
+
+		for (int c = 0; c < 4; c++)
+			p_dst[dst_x * 4 + c] = (uint8_t)lrintf((float)total[c] * p_recip[dst_x]);
+	}
+}
+
+// Blend two lines with weights that add up to 256
+inline void blend_rows_scalar(uint16_t* p_dst, const uint8_t* p_src_0, const uint8_t* p_src_1, const int weight_1, const int x, const int n)
+{
+	for (int i = x; i < n; i++)
+		p_dst[i] = (uint16_t)(p_src_0[i] * (256 - weight_1) + p_src_1[i] * weight_1);
+}
+
+// Blend the pixels of a blended line either side of each output pixel
+inline void blend_columns_scalar(uint8_t* p_dst, const uint16_t* p_src, const int* p_x_0, const int* p_x_1, const int* p_weight_1, const int x, const int dst_xres)
+{
+	for (int dst_x = x; dst_x < dst_xres; dst_x++) {
+		const uint16_t* p_0 = p_src + p_x_0[dst_x] * 4;
+		const uint16_t* p_1 = p_src + p_x_1[dst_x] * 4;
+		const uint32_t w_1 = (uint32_t)p_weight_1[dst_x], w_0 = 256 - w_1;
+		for (int c = 0; c < 4; c++)
+			p_dst[dst_x * 4 + c] = (uint8_t)((p_0[c] * w_0 + p_1[c] * w_1 + 32768) >> 16);
+	}
+}
+
+#ifdef NDI_CONTENT_X86
+NDI_CONTENT_TARGET_SSE41 inline int accumulate_sse41(uint16_t* p_sum, const uint8_t* p_src, const bool first, const int n)
+{
+	int i = 0;
+	for (; i + 16 <= n; i += 16) {
+		const __m128i src = _mm_loadu_si128((const __m128i*)(p_src + i));
+		__m128i lo = _mm_cvtepu8_epi16(src), hi = _mm_cvtepu8_epi16(_mm_srli_si128(src, 8));
+		if (!first) {
+			lo = _mm_add_epi16(lo, _mm_loadu_si128((const __m128i*)(p_sum + i)));
+			hi = _mm_add_epi16(hi, _mm_loadu_si128((const __m128i*)(p_sum + i + 8)));
+		}
+		_mm_storeu_si128((__m128i*)(p_sum + i), lo);
+		_mm_storeu_si128((__m128i*)(p_sum + i + 8), hi);
+	}
+	return i;
+}
+
+// One pixel of four channels at a time, in 32 bits
+NDI_CONTENT_TARGET_SSE41 inline int box_columns_sse41(uint8_t* p_dst, const uint16_t* p_sum, const int* p_x_start, const int* p_x_end, const float* p_recip, const int dst_xres)
+{
+	for (int dst_x = 0; dst_x < dst_xres; dst_x++) {
+		__m128i total = _mm_setzero_si128();
+		for (int src_x = p_x_start[dst_x]; src_x < p_x_end[dst_x]; src_x++)
+			total = _mm_add_epi32(total, _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(p_sum + src_x * 4))));
+
+		total = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(total), _mm_set1_ps(p_recip[dst_x])));
+		total = _mm_packus_epi32(total, total);
+		const int pixel = _mm_cvtsi128_si32(_mm_packus_epi16(total, total));
+		memcpy(p_dst + dst_x * 4, &pixel, 4);
+	}
+	return dst_xres;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int blend_rows_sse41(uint16_t* p_dst, const uint8_t* p_src_0, const uint8_t* p_src_1, const int weight_1, const int n)
+{
+	const __m128i w_0 = _mm_set1_epi16((short)(256 - weight_1)), w_1 = _mm_set1_epi16((short)weight_1);
+	int i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m128i src_0 = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(p_src_0 + i)));
+		const __m128i src_1 = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(p_src_1 + i)));
+		_mm_storeu_si128((__m128i*)(p_dst + i), _mm_add_epi16(_mm_mullo_epi16(src_0, w_0), _mm_mullo_epi16(src_1, w_1)));
+	}
+	return i;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int blend_columns_sse41(uint8_t* p_dst, const uint16_t* p_src, const int* p_x_0, const int* p_x_1, const int* p_weight_1, const int dst_xres)
+{
+	for (int dst_x = 0; dst_x < dst_xres; dst_x++) {
+		const __m128i src_0 = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(p_src + p_x_0[dst_x] * 4)));
+		const __m128i src_1 = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(p_src + p_x_1[dst_x] * 4)));
+		__m128i sum = _mm_add_epi32(_mm_mullo_epi32(src_0, _mm_set1_epi32(256 - p_weight_1[dst_x])), _mm_mullo_epi32(src_1, _mm_set1_epi32(p_weight_1[dst_x])));
+		sum = _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(32768)), 16);
+		sum = _mm_packus_epi32(sum, sum);
+		const int pixel = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+		memcpy(p_dst + dst_x * 4, &pixel, 4);
+	}
+	return dst_xres;
+}
+
+NDI_CONTENT_TARGET_AVX2 inline int accumulate_avx2(uint16_t* p_sum, const uint8_t* p_src, const bool first, const int n)
+{
+	int i = 0;
+	for (; i + 32 <= n; i += 32) {
+		const __m256i src = _mm256_loadu_si256((const __m256i*)(p_src + i));
+		__m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(src)), hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(src, 1));
+		if (!first) {
+			lo = _mm256_add_epi16(lo, _mm256_loadu_si256((const __m256i*)(p_sum + i)));
+			hi = _mm256_add_epi16(hi, _mm256_loadu_si256((const __m256i*)(p_sum + i + 16)));
+		}
+		_mm256_storeu_si256((__m256i*)(p_sum + i), lo);
+		_mm256_storeu_si256((__m256i*)(p_sum + i + 16), hi);
+	}
+	return i;
+}
+
+NDI_CONTENT_TARGET_AVX2 inline int blend_rows_avx2(uint16_t* p_dst, const uint8_t* p_src_0, const uint8_t* p_src_1, const int weight_1, const int n)
+{
+	const __m256i w_0 = _mm256_set1_epi16((short)(256 - weight_1)), w_1 = _mm256_set1_epi16((short)weight_1);
+	int i = 0;
+	for (; i + 16 <= n; i += 16) {
+		const __m256i src_0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p_src_0 + i)));
+		const __m256i src_1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p_src_1 + i)));
+		_mm256_storeu_si256((__m256i*)(p_dst + i), _mm256_add_epi16(_mm256_mullo_epi16(src_0, w_0), _mm256_mullo_epi16(src_1, w_1)));
+	}
+	return i;
+}
+#endif // NDI_CONTENT_X86
+
+} // namespace detail
+
+// Scales frames, keeping the tables and lines that it needs between calls so that it does not allocate once it has seen
+// a size. A scaler should only be used by one thread at a time.
+class scaler {
+public:
+	explicit scaler(const simd_e simd = detect_simd()) : m_simd(simd) {}
+
+	simd_e simd(void) const { return m_simd; }
+
+	// Scale a frame with four bytes per pixel
+	void scale(uint8_t* p_dst, const int dst_stride, const int dst_xres, const int dst_yres,
+			   const uint8_t* p_src, const int src_stride, const int src_xres, const int src_yres, filter_e filter = filter_auto)
+	{
+		if ((dst_xres <= 0) || (dst_yres <= 0) || (src_xres <= 0) || (src_yres <= 0))
+			return;
+
+		if (filter == filter_auto)
+			filter = ((dst_xres * 2 <= src_xres) && (dst_yres * 2 <= src_yres)) ? filter_box : filter_bilinear;
+
+		if (filter == filter_box)
+			scale_box(p_dst, dst_stride, dst_xres, dst_yres, p_src, src_stride, src_xres, src_yres);
+		else
+			scale_bilinear(p_dst, dst_stride, dst_xres, dst_yres, p_src, src_stride, src_xres, src_yres);
+	}
+
+	// Scale one frame into another. The destination has its resolution, data and line stride filled in by the caller,
+	// and is given the source's FourCC.
+	bool scale(const NDIlib_video_frame_v2_t& src, NDIlib_video_frame_v2_t& dst, const filter_e filter = filter_auto)
+	{
+		if (!is_supported(src.FourCC) || !src.p_data || !dst.p_data)
+			return false;
+
+		dst.FourCC = src.FourCC;
+		if (!dst.line_stride_in_bytes)
+			dst.line_stride_in_bytes = dst.xres * 4;
+		scale(dst.p_data, dst.line_stride_in_bytes, dst.xres, dst.yres,
+			  src.p_data, src.line_stride_in_bytes ? src.line_stride_in_bytes : src.xres * 4, src.xres, src.yres, filter);
+		return true;
+	}
+
+private:
+	void scale_box(uint8_t* p_dst, const int dst_stride, const int dst_xres, const int dst_yres,
+				   const uint8_t* p_src, const int src_stride, const int src_xres, const int src_yres)
+	{
+		// Where each box starts and ends, and one over the number of pixels in it for each row
+		m_x_start.resize(dst_xres);
+		m_x_end.resize(dst_xres);
+		for (int x = 0; x < dst_xres; x++)
+			get_box(x, dst_xres, src_xres, m_x_start[x], m_x_end[x]);
+		m_recip.resize(dst_xres);
+		m_sum.resize((size_t)src_xres * 4);
+
+		for (int y = 0; y < dst_yres; y++) {
+			int y_start, y_end;
+			get_box(y, dst_yres, src_yres, y_start, y_end);
+			const int y_step = (y_end - y_start + detail::max_box_rows - 1) / detail::max_box_rows;
+
+			// Sum the rows
+			int no_rows = 0;
+			for (int src_y = y_start; src_y < y_end; src_y += y_step, no_rows++)
+				accumulate(m_sum.data(), p_src + (size_t)src_y * src_stride, !no_rows, src_xres * 4);
+
+			for (int x = 0; x < dst_xres; x++) {
+				const uint32_t count = (uint32_t)no_rows * (uint32_t)(m_x_end[x] - m_x_start[x]);
+				m_recip[x] = 1.0f / (float)count;
+			}
+
+			// And then the columns
+			uint8_t* p_dst_line = p_dst + (size_t)y * dst_stride;
+			int x = 0;
+#ifdef NDI_CONTENT_X86
+			if (m_simd != simd_scalar) x = detail::box_columns_sse41(p_dst_line, m_sum.data(), m_x_start.data(), m_x_end.data(), m_recip.data(), dst_xres);
+#endif
+			detail::box_columns_scalar(p_dst_line, m_sum.data(), m_x_start.data(), m_x_end.data(), m_recip.data(), x, dst_xres);
+		}
+	}
+
+	void scale_bilinear(uint8_t* p_dst, const int dst_stride, const int dst_xres, const int dst_yres,
+						const uint8_t* p_src, const int src_stride, const int src_xres, const int src_yres)
+	{
+		// The input pixels either side of the center of each output column, with the weight of the second
+		m_x_0.resize(dst_xres);
+		m_x_1.resize(dst_xres);
+		m_weight_1.resize(dst_xres);
+		for (int x = 0; x < dst_xres; x++)
+			get_position(x, dst_xres, src_xres, m_x_0[x], m_x_1[x], m_weight_1[x]);
+		m_line.resize((size_t)src_xres * 4);
+
+		for (int y = 0; y < dst_yres; y++) {
+			int y_0, y_1, weight_1;
+			get_position(y, dst_yres, src_yres, y_0, y_1, weight_1);
+
+			// Blend the rows
+			const uint8_t* p_src_0 = p_src + (size_t)y_0 * src_stride;
+			const uint8_t* p_src_1 = p_src + (size_t)y_1 * src_stride;
+			const int n = src_xres * 4;
+			int x = 0;
+#ifdef NDI_CONTENT_X86
+			if (m_simd == simd_avx2) x = detail::blend_rows_avx2(m_line.data(), p_src_0, p_src_1, weight_1, n);
+			else if (m_simd == simd_sse41) x = detail::blend_rows_sse41(m_line.data(), p_src_0, p_src_1, weight_1, n);
+#endif
+			detail::blend_rows_scalar(m_line.data(), p_src_0, p_src_1, weight_1, x, n);
+
+			// And then the columns
+			uint8_t* p_dst_line = p_dst + (size_t)y * dst_stride;
+			x = 0;
+#ifdef NDI_CONTENT_X86
+			if (m_simd != simd_scalar) x = detail::blend_columns_sse41(p_dst_line, m_line.data(), m_x_0.data(), m_x_1.data(), m_weight_1.data(), dst_xres);
+#endif
+			detail::blend_columns_scalar(p_dst_line, m_line.data(), m_x_0.data(), m_x_1.data(), m_weight_1.data(), x, dst_xres);
+		}
+	}
+
+	// Get the input pixels that an output pixel covers, which is always at least one
+	static void get_box(const int dst, const int dst_size, const int src_size, int& src_start, int& src_end)
+	{
+		src_start = std::min((int)((int64_t)dst * src_size / dst_size), src_size - 1);
+		src_end = std::max(src_start + 1, (int)((int64_t)(dst + 1) * src_size / dst_size));
+	}
+
+	// Get the input pixels either side of the center of an output pixel, in 1/256ths of a pixel
+	static void get_position(const int dst, const int dst_size, const int src_size, int& src_0, int& src_1, int& weight_1)
+	{
+		const int64_t position = std::max((int64_t)0, ((int64_t)(2 * dst + 1) * src_size * 128) / dst_size - 128);
+		src_0 = std::min((int)(position >> 8), src_size - 1);
+		src_1 = std::min(src_0 + 1, src_size - 1);
+		weight_1 = (src_0 == src_1) ? 0 : (int)(position & 255);
+	}
+
+	void accumulate(uint16_t* p_sum, const uint8_t* p_src, const bool first, const int n)
+	{
+		int x = 0;
+#ifdef NDI_CONTENT_X86
+		if (m_simd == simd_avx2) x = detail::accumulate_avx2(p_sum, p_src, first, n);
+		else if (m_simd == simd_sse41) x = detail::accumulate_sse41(p_sum, p_src, first, n);
+#endif
+		detail::accumulate_scalar(p_sum, p_src, first, x, n);
+	}
+
+	simd_e m_simd;
+
+	// The box filter's sums and tables
+	std::vector<uint16_t> m_sum;
+	std::vector<int> m_x_start, m_x_end;
+	std::vector<float> m_recip;
+
+	// The bilinear filter's blended line and tables
+	std::vector<uint16_t> m_line;
+	std::vector<int> m_x_0, m_x_1, m_weight_1;
+};
+
+} // namespace ndi_scale
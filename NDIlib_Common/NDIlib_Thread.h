@@ -0,0 +1,319 @@
+#pragma once
+
+// Helpers for placing threads on particular cores and NUMA nodes, and for giving them real-time priority. These are
+// used by the examples that run many senders or receivers on one machine, where placement makes a real difference to
+// how far they scale. There is also a pool of threads for splitting the rows of a frame into bands, for processing that
+// happens on every frame, and a bounded queue for handing frames between the stages of a pipeline.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ndi_thread {
+
+// The number of logical CPUs on this machine
+inline int no_cpus(void)
+{
+	const unsigned no_cpus = std::thread::hardware_concurrency();
+	return no_cpus ? (int)no_cpus : 1;
+}
+
+// Restrict the calling thread to a set of logical CPUs.
+inline bool set_affinity(const std::vector<int>& cpus)
+{
+	if (cpus.empty())
+		return false;
+
+#ifdef _WIN32
+	DWORD_PTR mask = 0;
+	for (const int cpu : cpus) {
+		if (cpu < (int)(sizeof(DWORD_PTR) * 8))
+			mask |= (DWORD_PTR)1 << cpu;
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	for (const int cpu : cpus) {
+		if ((cpu >= 0) && (cpu < CPU_SETSIZE))
+			CPU_SET(cpu, &cpu_set);
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#endif
+}
+
+// Pin the calling thread to a single logical CPU.
+inline bool pin_to_cpu(const int cpu)
+{
+	return set_affinity(std::vector<int>(1, cpu % no_cpus()));
+}
+
+// Give the calling thread a real-time priority, from 1 (the lowest) to 99 (the highest). On Linux this is SCHED_FIFO,
+// which needs CAP_SYS_NICE or an rtprio limit, and on Windows the priority is mapped onto the thread priority levels.
+inline bool set_realtime_priority(const int priority)
+{
+#ifdef _WIN32
+	const int level = (priority >= 90) ? THREAD_PRIORITY_TIME_CRITICAL : (priority >= 50) ? THREAD_PRIORITY_HIGHEST : THREAD_PRIORITY_ABOVE_NORMAL;
+	return SetThreadPriority(GetCurrentThread(), level) != 0;
+#else
+	sched_param param = sched_param();
+	param.sched_priority = std::min(std::max(priority, sched_get_priority_min(SCHED_FIFO)), sched_get_priority_max(SCHED_FIFO));
+	return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#endif
+}
+
+// Parse a Linux style CPU list, for instance "0-3,8-11".
+inline std::vector<int> parse_cpu_list(const std::string& list)
+{
+	std::vector<int> cpus;
+	for (size_t start = 0; start < list.size();) {
+		size_t end = list.find(',', start);
+		if (end == std::string::npos)
+			end = list.size();
+
+		const std::string range = list.substr(start, end - start);
+		const size_t dash = range.find('-');
+		const int first = atoi(range.c_str());
+		const int last = (dash == std::string::npos) ? first : atoi(range.c_str() + dash + 1);
+		for (int cpu = first; cpu <= last; cpu++)
+			cpus.push_back(cpu);
+
+		start = end + 1;
+	}
+
+	return cpus;
+}
+
+// Get the logical CPUs on each NUMA node. If this cannot be determined, it is reported as a single node with all CPUs.
+inline std::vector<std::vector<int>> numa_nodes(void)
+{
+	std::vector<std::vector<int>> nodes;
+
+#ifndef _WIN32
+	for (int node = 0; ; node++) {
+		char filename[128];
+		snprintf(filename, sizeof(filename), "/sys/devices/system/node/node%d/cpulist", node);
+		FILE* p_file = fopen(filename, "r");
+		if (!p_file)
+			break;
+
+		char line[1024] = { 0 };
+		if (fgets(line, sizeof(line), p_file)) {
+			std::string list = line;
+			while (!list.empty() && ((list.back() == '\n') || (list.back() == '\r')))
+				list.pop_back();
+			nodes.push_back(parse_cpu_list(list));
+		}
+		fclose(p_file);
+	}
+#endif
+
+	if (nodes.empty()) {
+		nodes.resize(1);
+		for (int cpu = 0; cpu < no_cpus(); cpu++)
+			nodes[0].push_back(cpu);
+	}
+
+	return nodes;
+}
+
+// Runs a function over bands of rows, one band per thread. The threads are kept running between frames, because at
+// 4K60 creating them again for every frame costs a noticeable part of the frame budget. The calling thread takes the
+// last band, so a pool of one thread does everything on the caller. A pool should only be used by one thread at a time.
+class band_pool {
+public:
+	// no_threads = 0 means one per CPU
+	explicit band_pool(const int no_threads = 0)
+		: m_no_threads(no_threads ? no_threads : ndi_thread::no_cpus()), m_p_fn(NULL), m_yres(0), m_band_size(0), m_no_bands(0),
+		  m_generation(0), m_no_running(0), m_exit(false)
+	{
+		for (int i = 1; i < m_no_threads; i++)
+			m_threads.push_back(std::thread(&band_pool::worker, this, i - 1));
+	}
+
+	~band_pool(void)
+	{
+		{	std::unique_lock<std::mutex> lock(m_lock);
+			m_exit = true;
+		}
+		m_start.notify_all();
+
+		for (auto& thread : m_threads)
+			thread.join();
+	}
+
+	int no_threads(void) const { return m_no_threads; }
+
+	// Call fn(y_start, y_end) over all of the rows, returning when every band is done. Bands are at least min_rows
+	// rows, and are rounded to a multiple of row_align rows (for instance 2 for 4:2:0 chroma).
+	void run(const int yres, const std::function<void(int, int)>& fn, const int min_rows = 16, const int row_align = 1)
+	{
+		run_bands(yres, [&fn](const int, const int y_start, const int y_end) { fn(y_start, y_end); }, min_rows, row_align);
+	}
+
+	// The same, but calling fn(band, y_start, y_end), where band is less than no_threads() and no two bands that are
+	// running at the same time have the same number. This lets the caller keep memory for each band.
+	void run_bands(const int yres, const std::function<void(int, int, int)>& fn, const int min_rows = 16, const int row_align = 1)
+	{
+		const int no_bands = std::max(1, std::min(m_no_threads, yres / std::max(1, min_rows)));
+		int band_size = (yres + no_bands - 1) / no_bands;
+		band_size = (band_size + row_align - 1) / row_align * row_align;
+
+		// Hand the other bands to the workers
+		{	std::unique_lock<std::mutex> lock(m_lock);
+			m_p_fn = &fn;
+			m_yres = yres;
+			m_band_size = band_size;
+			m_no_bands = no_bands;
+			m_no_running = no_bands - 1;
+			m_generation++;
+		}
+		m_start.notify_all();
+
+		// We take the last band ourselves
+		const int y_start = std::min(yres, (no_bands - 1) * band_size);
+		if (y_start < yres)
+			fn(no_bands - 1, y_start, yres);
+
+		std::unique_lock<std::mutex> lock(m_lock);
+		while (m_no_running)
+			m_done.wait(lock);
+		m_p_fn = NULL;
+	}
+
+private:
+	band_pool(const band_pool&);
+	band_pool& operator=(const band_pool&);
+
+	void worker(const int band)
+	{
+		uint64_t generation = 0;
+		for (;;) {
+			std::unique_lock<std::mutex> lock(m_lock);
+			while (!m_exit && (m_generation == generation))
+				m_start.wait(lock);
+			if (m_exit)
+				return;
+			generation = m_generation;
+
+			// Not every run uses every thread
+			if (band >= m_no_bands - 1)
+				continue;
+
+			const std::function<void(int, int, int)>& fn = *m_p_fn;
+			const int y_start = std::min(m_yres, band * m_band_size);
+			const int y_end = std::min(m_yres, (band + 1) * m_band_size);
+			lock.unlock();
+
+			if (y_start < y_end)
+				fn(band, y_start, y_end);
+
+			lock.lock();
+			if (!--m_no_running)
+				m_done.notify_one();
+		}
+	}
+
+	int m_no_threads;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_lock;
+	std::condition_variable m_start, m_done;
+	const std::function<void(int, int, int)>* m_p_fn;
+	int m_yres, m_band_size, m_no_bands;
+	uint64_t m_generation;
+	int m_no_running;
+	bool m_exit;
+};
+
+// A queue with a fixed capacity for passing items between threads. push waits while the queue is full, which is what
+// stops a fast stage of a pipeline from running ahead of a slow one, and pop waits while it is empty. Once the queue is
+// closed, push fails and pop fails when there is nothing left, which lets every stage of a pipeline drain and exit.
+template<typename T>
+class bounded_queue {
+public:
+	explicit bounded_queue(const size_t capacity) : m_capacity(std::max((size_t)1, capacity)), m_closed(false) {}
+
+	bool push(const T& item)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		while (!m_closed && (m_items.size() >= m_capacity))
+			m_not_full.wait(lock);
+		if (m_closed)
+			return false;
+
+		m_items.push_back(item);
+		m_not_empty.notify_one();
+		return true;
+	}
+
+	// Push without waiting, which fails when the queue is full, for a stage that would rather drop an item than wait
+	bool try_push(const T& item)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		if (m_closed || (m_items.size() >= m_capacity))
+			return false;
+
+		m_items.push_back(item);
+		m_not_empty.notify_one();
+		return true;
+	}
+
+	bool pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		while (!m_closed && m_items.empty())
+			m_not_empty.wait(lock);
+		if (m_items.empty())
+			return false;
+
+		item = m_items.front();
+		m_items.pop_front();
+		m_not_full.notify_one();
+		return true;
+	}
+
+	void close(void)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_closed = true;
+		m_not_full.notify_all();
+		m_not_empty.notify_all();
+	}
+
+	size_t size(void) const
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		return m_items.size();
+	}
+
+	size_t capacity(void) const { return m_capacity; }
+
+private:
+	const size_t m_capacity;
+	std::deque<T> m_items;
+	bool m_closed;
+
+	mutable std::mutex m_lock;
+	std::condition_variable m_not_full, m_not_empty;
+};
+
+} // namespace ndi_thread
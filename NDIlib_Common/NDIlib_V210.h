@@ -0,0 +1,491 @@
+#pragma once
+
+// Packing and unpacking of V210, the 10 bit 4:2:2 format that SDI hardware uses.
+//
+// V210 stores three 10 bit samples in each 32 bit word, with 2 bits unused, in UYVY order. Six pixels take four words :
+//		[U0 Y0 V0] [Y1 U1 Y2] [V1 Y3 U2] [Y4 V2 Y5]
+// and lines are padded to a multiple of 48 pixels (128 bytes).
+//
+// The 16 bit side is either P216 (a plane of Y followed by a plane of interleaved UV) or fully planar Y, U and V, with
+// the value in the top bits of each 16 bit sample, so 10 bit values are shifted up by 6 bits. Packing truncates the
+// bottom 6 bits, and unpacking followed by packing gives back exactly the same V210.
+//
+// The kernels use AVX2 or SSE4.1 when the CPU supports them, selected at run-time with a scalar fallback for other
+// CPUs and for the ends of lines, and the rows of a frame can be split across a pool of threads. ndi_v210::converter
+// can be used in place of NDIlib_util_V210_to_P216 and NDIlib_util_P216_to_V210.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <Processing.NDI.Lib.h>
+
+#include "NDIlib_Content.h"
+#include "NDIlib_Thread.h"
+
+namespace ndi_v210 {
+
+// The instruction sets are the same as the content generator's
+using ndi_content::simd_e;
+using ndi_content::simd_scalar;
+using ndi_content::simd_sse41;
+using ndi_content::simd_avx2;
+using ndi_content::simd_name;
+using ndi_content::detect_simd;
+
+// The line stride of a V210 frame, which is padded to a multiple of 48 pixels
+inline int line_stride(const int xres)
+{
+	return ((xres + 47) / 48) * 128;
+}
+
+namespace detail {
+
+// Pack from pixel x0 (a multiple of 6) to the end of a line. The missing samples of a partial group at the end are zero.
+inline void pack_line_p216_scalar(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_uv, const int x0, const int xres)
+{
+	uint32_t* p_words = (uint32_t*)p_dst + (x0 / 6) * 4;
+	for (int x = x0; x < xres; x += 6, p_words += 4) {
+		uint32_t s[12];
+		for (int i = 0; i < 6; i++) {
+			s[i * 2 + 0] = (x + i < xres) ? (p_uv[x + i] >> 6) : 0;
+			s[i * 2 + 1] = (x + i < xres) ? (p_y[x + i] >> 6) : 0;
+		}
+
+		for (int w = 0; w < 4; w++)
+			p_words[w] = s[w * 3] | (s[w * 3 + 1] << 10) | (s[w * 3 + 2] << 20);
+	}
+}
+
+inline void pack_line_planar_scalar(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_u, const uint16_t* p_v, const int x0, const int xres)
+{
+	uint32_t* p_words = (uint32_t*)p_dst + (x0 / 6) * 4;
+	for (int x = x0; x < xres; x += 6, p_words += 4) {
+		uint32_t s[12];
+		for (int i = 0; i < 6; i++) {
+			const uint16_t* p_c = (i & 1) ? p_v : p_u;
+			s[i * 2 + 0] = (x + i < xres) ? (p_c[(x + i) / 2] >> 6) : 0;
+			s[i * 2 + 1] = (x + i < xres) ? (p_y[x + i] >> 6) : 0;
+		}
+
+		for (int w = 0; w < 4; w++)
+			p_words[w] = s[w * 3] | (s[w * 3 + 1] << 10) | (s[w * 3 + 2] << 20);
+	}
+}
+
+inline void unpack_line_p216_scalar(uint16_t* p_y, uint16_t* p_uv, const uint8_t* p_src, const int x0, const int xres)
+{
+	const uint32_t* p_words = (const uint32_t*)p_src + (x0 / 6) * 4;
+	for (int x = x0; x < xres; x += 6, p_words += 4) {
+		uint16_t s[12];
+		for (int w = 0; w < 4; w++) {
+			s[w * 3 + 0] = (uint16_t)(((p_words[w] >> 0) & 0x3FF) << 6);
+			s[w * 3 + 1] = (uint16_t)(((p_words[w] >> 10) & 0x3FF) << 6);
+			s[w * 3 + 2] = (uint16_t)(((p_words[w] >> 20) & 0x3FF) << 6);
+		}
+
+		for (int i = 0; (i < 6) && (x + i < xres); i++) {
+			p_uv[x + i] = s[i * 2 + 0];
+			p_y[x + i] = s[i * 2 + 1];
+		}
+	}
+}
+
+inline void unpack_line_planar_scalar(uint16_t* p_y, uint16_t* p_u, uint16_t* p_v, const uint8_t* p_src, const int x0, const int xres)
+{
+	const uint32_t* p_words = (const uint32_t*)p_src + (x0 / 6) * 4;
+	for (int x = x0; x < xres; x += 6, p_words += 4) {
+		uint16_t s[12];
+		for (int w = 0; w < 4; w++) {
+			s[w * 3 + 0] = (uint16_t)(((p_words[w] >> 0) & 0x3FF) << 6);
+			s[w * 3 + 1] = (uint16_t)(((p_words[w] >> 10) & 0x3FF) << 6);
+			s[w * 3 + 2] = (uint16_t)(((p_words[w] >> 20) & 0x3FF) << 6);
+		}
+
+		for (int i = 0; (i < 6) && (x + i < xres); i++) {
+			((i & 1) ? p_v : p_u)[(x + i) / 2] = s[i * 2 + 0];
+			p_y[x + i] = s[i * 2 + 1];
+		}
+	}
+}
+
+#ifdef NDI_CONTENT_X86
+
+// A group of six pixels is four words, and word k holds samples 3k, 3k+1 and 3k+2 of U0 Y0 V0 Y1 U1 Y2 V1 Y3 U2 Y4 V2 Y5.
+// Taking the first, second and third sample of every word gives three vectors of four words, A, B and C :
+//		A = U0 Y1 V1 Y4		B = Y0 U1 Y3 V2		C = V0 Y2 U2 Y5
+// and these shuffles move the 16 bit samples between A, B and C and the Y and UV registers (Y0..Y5 and U0 V0 U1 V1 U2 V2).
+enum shuffle_e {
+	a_from_y, a_from_uv, b_from_y, b_from_uv, c_from_y, c_from_uv,
+	y_from_a, y_from_b, y_from_c, uv_from_a, uv_from_b, uv_from_c,
+	shuffle_max
+};
+
+inline const uint8_t (*shuffles(void))[16]
+{
+	static const uint8_t z = 0x80;
+	static const uint8_t tables[shuffle_max][16] = {
+		{ z, z, z, z,  2, 3, z, z,  z, z, z, z,  8, 9, z, z },		// a_from_y
+		{ 0, 1, z, z,  z, z, z, z,  6, 7, z, z,  z, z, z, z },		// a_from_uv
+		{ 0, 1, z, z,  z, z, z, z,  6, 7, z, z,  z, z, z, z },		// b_from_y
+		{ z, z, z, z,  4, 5, z, z,  z, z, z, z, 10, 11, z, z },		// b_from_uv
+		{ z, z, z, z,  4, 5, z, z,  z, z, z, z, 10, 11, z, z },		// c_from_y
+		{ 2, 3, z, z,  z, z, z, z,  8, 9, z, z,  z, z, z, z },		// c_from_uv
+		{ z, z, 4, 5,  z, z, z, z, 12, 13, z, z,  z, z, z, z },		// y_from_a
+		{ 0, 1, z, z,  z, z, 8, 9,  z, z, z, z,  z, z, z, z },		// y_from_b
+		{ z, z, z, z,  4, 5, z, z,  z, z, 12, 13, z, z, z, z },		// y_from_c
+		{ 0, 1, z, z,  z, z, 8, 9,  z, z, z, z,  z, z, z, z },		// uv_from_a
+		{ z, z, z, z,  4, 5, z, z,  z, z, 12, 13, z, z, z, z },		// uv_from_b
+		{ z, z, 0, 1,  z, z, z, z,  8, 9, z, z,  z, z, z, z },		// uv_from_c
+	};
+	return tables;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline __m128i shuffle_sse41(const shuffle_e shuffle)
+{
+	return _mm_loadu_si128((const __m128i*)shuffles()[shuffle]);
+}
+
+// Pack six pixels, y and uv hold 10 bit values in their first six 16 bit lanes
+NDI_CONTENT_TARGET_SSE41 inline __m128i pack6_sse41(const __m128i y, const __m128i uv)
+{
+	const __m128i a = _mm_or_si128(_mm_shuffle_epi8(y, shuffle_sse41(a_from_y)), _mm_shuffle_epi8(uv, shuffle_sse41(a_from_uv)));
+	const __m128i b = _mm_or_si128(_mm_shuffle_epi8(y, shuffle_sse41(b_from_y)), _mm_shuffle_epi8(uv, shuffle_sse41(b_from_uv)));
+	const __m128i c = _mm_or_si128(_mm_shuffle_epi8(y, shuffle_sse41(c_from_y)), _mm_shuffle_epi8(uv, shuffle_sse41(c_from_uv)));
+	return _mm_or_si128(a, _mm_or_si128(_mm_slli_epi32(b, 10), _mm_slli_epi32(c, 20)));
+}
+
+// Unpack six pixels into the first six 16 bit lanes of y and uv
+NDI_CONTENT_TARGET_SSE41 inline void unpack6_sse41(const __m128i words, __m128i& y, __m128i& uv)
+{
+	const __m128i mask = _mm_set1_epi32(0x3FF);
+	const __m128i a = _mm_slli_epi32(_mm_and_si128(words, mask), 6);
+	const __m128i b = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(words, 10), mask), 6);
+	const __m128i c = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(words, 20), mask), 6);
+
+	y = _mm_or_si128(_mm_shuffle_epi8(a, shuffle_sse41(y_from_a)),
+		_mm_or_si128(_mm_shuffle_epi8(b, shuffle_sse41(y_from_b)), _mm_shuffle_epi8(c, shuffle_sse41(y_from_c))));
+	uv = _mm_or_si128(_mm_shuffle_epi8(a, shuffle_sse41(uv_from_a)),
+		_mm_or_si128(_mm_shuffle_epi8(b, shuffle_sse41(uv_from_b)), _mm_shuffle_epi8(c, shuffle_sse41(uv_from_c))));
+}
+
+// Load three U and three V and interleave them. This reads four of each.
+NDI_CONTENT_TARGET_SSE41 inline __m128i load_uv_planar_sse41(const uint16_t* p_u, const uint16_t* p_v)
+{
+	return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)p_u), _mm_loadl_epi64((const __m128i*)p_v));
+}
+
+// U0 V0 U1 V1 U2 V2 into U0 U1 U2 in the low half and V0 V1 V2 in the high half
+NDI_CONTENT_TARGET_SSE41 inline __m128i split_uv_sse41(const __m128i uv)
+{
+	return _mm_shuffle_epi8(uv, _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15));
+}
+
+// The SIMD loops read and write eight samples for each group of six pixels, so the last groups are left to the scalar
+// code. These return the first pixel that they did not do.
+NDI_CONTENT_TARGET_SSE41 inline int pack_line_p216_sse41(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_uv, const int xres)
+{
+	int x = 0;
+	for (; x + 8 <= xres; x += 6, p_dst += 16) {
+		const __m128i y = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(p_y + x)), 6);
+		const __m128i uv = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(p_uv + x)), 6);
+		_mm_storeu_si128((__m128i*)p_dst, pack6_sse41(y, uv));
+	}
+	return x;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int pack_line_planar_sse41(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_u, const uint16_t* p_v, const int xres)
+{
+	int x = 0;
+	for (; x + 8 <= xres; x += 6, p_dst += 16) {
+		const __m128i y = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(p_y + x)), 6);
+		const __m128i uv = _mm_srli_epi16(load_uv_planar_sse41(p_u + x / 2, p_v + x / 2), 6);
+		_mm_storeu_si128((__m128i*)p_dst, pack6_sse41(y, uv));
+	}
+	return x;
+}
+
+// Each group writes eight samples, the last two of which the next group replaces
+NDI_CONTENT_TARGET_SSE41 inline int unpack_line_p216_sse41(uint16_t* p_y, uint16_t* p_uv, const uint8_t* p_src, const int xres)
+{
+	int x = 0;
+	for (; x + 8 <= xres; x += 6, p_src += 16) {
+		__m128i y, uv;
+		unpack6_sse41(_mm_loadu_si128((const __m128i*)p_src), y, uv);
+		_mm_storeu_si128((__m128i*)(p_y + x), y);
+		_mm_storeu_si128((__m128i*)(p_uv + x), uv);
+	}
+	return x;
+}
+
+NDI_CONTENT_TARGET_SSE41 inline int unpack_line_planar_sse41(uint16_t* p_y, uint16_t* p_u, uint16_t* p_v, const uint8_t* p_src, const int xres)
+{
+	int x = 0;
+	for (; x + 8 <= xres; x += 6, p_src += 16) {
+		__m128i y, uv;
+		unpack6_sse41(_mm_loadu_si128((const __m128i*)p_src), y, uv);
+		_mm_storeu_si128((__m128i*)(p_y + x), y);
+
+		uv = split_uv_sse41(uv);
+		_mm_storel_epi64((__m128i*)(p_u + x / 2), uv);
+		_mm_storel_epi64((__m128i*)(p_v + x / 2), _mm_srli_si128(uv, 8));
+	}
+	return x;
+}
+
+// The AVX2 versions do two groups at a time, one in each 128 bit lane, since the byte shuffles do not cross lanes.
+NDI_CONTENT_TARGET_AVX2 inline __m256i shuffle_avx2(const shuffle_e shuffle)
+{
+	return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)shuffles()[shuffle]));
+}
+
+NDI_CONTENT_TARGET_AVX2 inline __m256i loadu2_avx2(const void* p_lo, const void* p_hi)
+{
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p_lo)), _mm_loadu_si128((const __m128i*)p_hi), 1);
+}
+
+NDI_CONTENT_TARGET_AVX2 inline void storeu2_avx2(void* p_lo, void* p_hi, const __m256i value)
+{
+	// The low lane is stored first, because the high lane overwrites the end of it
+	_mm_storeu_si128((__m128i*)p_lo, _mm256_castsi256_si128(value));
+	_mm_storeu_si128((__m128i*)p_hi, _mm256_extracti128_si256(value, 1));
+}
+
+NDI_CONTENT_TARGET_AVX2 inline __m256i pack12_avx2(const __m256i y, const __m256i uv)
+{
+	const __m256i a = _mm256_or_si256(_mm256_shuffle_epi8(y, shuffle_avx2(a_from_y)), _mm256_shuffle_epi8(uv, shuffle_avx2(a_from_uv)));
+	const __m256i b = _mm256_or_si256(_mm256_shuffle_epi8(y, shuffle_avx2(b_from_y)), _mm256_shuffle_epi8(uv, shuffle_avx2(b_from_uv)));
+	const __m256i c = _mm256_or_si256(_mm256_shuffle_epi8(y, shuffle_avx2(c_from_y)), _mm256_shuffle_epi8(uv, shuffle_avx2(c_from_uv)));
+	return _mm256_or_si256(a, _mm256_or_si256(_mm256_slli_epi32(b, 10), _mm256_slli_epi32(c, 20)));
+}
+
+NDI_CONTENT_TARGET_AVX2 inline void unpack12_avx2(const __m256i words, __m256i& y, __m256i& uv)
+{
+	const __m256i mask = _mm256_set1_epi32(0x3FF);
+	const __m256i a = _mm256_slli_epi32(_mm256_and_si256(words, mask), 6);
+	const __m256i b = _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(words, 10), mask), 6);
+	const __m256i c = _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(words, 20), mask), 6);
+
+	y = _mm256_or_si256(_mm256_shuffle_epi8(a, shuffle_avx2(y_from_a)),
+		_mm256_or_si256(_mm256_shuffle_epi8(b, shuffle_avx2(y_from_b)), _mm256_shuffle_epi8(c, shuffle_avx2(y_from_c))));
+	uv = _mm256_or_si256(_mm256_shuffle_epi8(a, shuffle_avx2(uv_from_a)),
+		_mm256_or_si256(_mm256_shuffle_epi8(b, shuffle_avx2(uv_from_b)), _mm256_shuffle_epi8(c, shuffle_avx2(uv_from_c))));
+}
+
+// The AVX2 loops need 14 pixels for the two groups, and then the SSE4.1 loop carries on from where they stop
+NDI_CONTENT_TARGET_AVX2 inline int pack_line_p216_avx2(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_uv, const int xres)
+{
+	int x = 0;
+	for (; x + 14 <= xres; x += 12, p_dst += 32) {
+		const __m256i y = _mm256_srli_epi16(loadu2_avx2(p_y + x, p_y + x + 6), 6);
+		const __m256i uv = _mm256_srli_epi16(loadu2_avx2(p_uv + x, p_uv + x + 6), 6);
+		_mm256_storeu_si256((__m256i*)p_dst, pack12_avx2(y, uv));
+	}
+	return x + pack_line_p216_sse41(p_dst, p_y + x, p_uv + x, xres - x);
+}
+
+NDI_CONTENT_TARGET_AVX2 inline int pack_line_planar_avx2(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_u, const uint16_t* p_v, const int xres)
+{
+	int x = 0;
+	for (; x + 14 <= xres; x += 12, p_dst += 32) {
+		const __m256i y = _mm256_srli_epi16(loadu2_avx2(p_y + x, p_y + x + 6), 6);
+		const __m256i u = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadl_epi64((const __m128i*)(p_u + x / 2))), _mm_loadl_epi64((const __m128i*)(p_u + x / 2 + 3)), 1);
+		const __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadl_epi64((const __m128i*)(p_v + x / 2))), _mm_loadl_epi64((const __m128i*)(p_v + x / 2 + 3)), 1);
+		const __m256i uv = _mm256_srli_epi16(_mm256_unpacklo_epi16(u, v), 6);
+		_mm256_storeu_si256((__m256i*)p_dst, pack12_avx2(y, uv));
+	}
+	return x + pack_line_planar_sse41(p_dst, p_y + x, p_u + x / 2, p_v + x / 2, xres - x);
+}
+
+NDI_CONTENT_TARGET_AVX2 inline int unpack_line_p216_avx2(uint16_t* p_y, uint16_t* p_uv, const uint8_t* p_src, const int xres)
+{
+	int x = 0;
+	for (; x + 14 <= xres; x += 12, p_src += 32) {
+		__m256i y, uv;
+		unpack12_avx2(_mm256_loadu_si256((const __m256i*)p_src), y, uv);
+		storeu2_avx2(p_y + x, p_y + x + 6, y);
+		storeu2_avx2(p_uv + x, p_uv + x + 6, uv);
+	}
+	return x + unpack_line_p216_sse41(p_y + x, p_uv + x, p_src, xres - x);
+}
+
+NDI_CONTENT_TARGET_AVX2 inline int unpack_line_planar_avx2(uint16_t* p_y, uint16_t* p_u, uint16_t* p_v, const uint8_t* p_src, const int xres)
+{
+	const __m256i split = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15));
+
+	int x = 0;
+	for (; x + 14 <= xres; x += 12, p_src += 32) {
+		__m256i y, uv;
+		unpack12_avx2(_mm256_loadu_si256((const __m256i*)p_src), y, uv);
+		storeu2_avx2(p_y + x, p_y + x + 6, y);
+
+		// Each lane has three U in its low 64 bits and three V in its high 64 bits
+		uv = _mm256_shuffle_epi8(uv, split);
+		const __m128i uv_lo = _mm256_castsi256_si128(uv), uv_hi = _mm256_extracti128_si256(uv, 1);
+		_mm_storel_epi64((__m128i*)(p_u + x / 2), uv_lo);
+		_mm_storel_epi64((__m128i*)(p_v + x / 2), _mm_srli_si128(uv_lo, 8));
+		_mm_storel_epi64((__m128i*)(p_u + x / 2 + 3), uv_hi);
+		_mm_storel_epi64((__m128i*)(p_v + x / 2 + 3), _mm_srli_si128(uv_hi, 8));
+	}
+	return x + unpack_line_planar_sse41(p_y + x, p_u + x / 2, p_v + x / 2, p_src, xres - x);
+}
+
+#endif // NDI_CONTENT_X86
+
+} // namespace detail
+
+// Pack and unpack single lines with the best instruction set that we are allowed to use. The line functions work on
+// the 16 bit lines of one row, for P216 the Y line and the UV line.
+inline void pack_line_p216(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_uv, const int xres, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd == simd_avx2) x = detail::pack_line_p216_avx2(p_dst, p_y, p_uv, xres);
+	else if (simd == simd_sse41) x = detail::pack_line_p216_sse41(p_dst, p_y, p_uv, xres);
+#endif
+	detail::pack_line_p216_scalar(p_dst, p_y, p_uv, x, xres);
+}
+
+inline void pack_line_planar(uint8_t* p_dst, const uint16_t* p_y, const uint16_t* p_u, const uint16_t* p_v, const int xres, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd == simd_avx2) x = detail::pack_line_planar_avx2(p_dst, p_y, p_u, p_v, xres);
+	else if (simd == simd_sse41) x = detail::pack_line_planar_sse41(p_dst, p_y, p_u, p_v, xres);
+#endif
+	detail::pack_line_planar_scalar(p_dst, p_y, p_u, p_v, x, xres);
+}
+
+inline void unpack_line_p216(uint16_t* p_y, uint16_t* p_uv, const uint8_t* p_src, const int xres, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd == simd_avx2) x = detail::unpack_line_p216_avx2(p_y, p_uv, p_src, xres);
+	else if (simd == simd_sse41) x = detail::unpack_line_p216_sse41(p_y, p_uv, p_src, xres);
+#endif
+	detail::unpack_line_p216_scalar(p_y, p_uv, p_src, x, xres);
+}
+
+inline void unpack_line_planar(uint16_t* p_y, uint16_t* p_u, uint16_t* p_v, const uint8_t* p_src, const int xres, const simd_e simd = detect_simd())
+{
+	int x = 0;
+#ifdef NDI_CONTENT_X86
+	if (simd == simd_avx2) x = detail::unpack_line_planar_avx2(p_y, p_u, p_v, p_src, xres);
+	else if (simd == simd_sse41) x = detail::unpack_line_planar_sse41(p_y, p_u, p_v, p_src, xres);
+#endif
+	detail::unpack_line_planar_scalar(p_y, p_u, p_v, p_src, x, xres);
+}
+
+// Converts whole frames to and from V210, splitting the rows across a pool of threads. A converter keeps its threads, so
+// it is worth keeping one around rather than creating it for each frame. It should only be used by one thread at a time.
+class converter {
+public:
+	// no_threads = 0 means one per CPU
+	explicit converter(const int no_threads = 0, const simd_e simd = detect_simd())
+		: m_simd(simd), m_threads(no_threads)
+	{
+	}
+
+	simd_e simd(void) const { return m_simd; }
+	int no_threads(void) const { return m_threads.no_threads(); }
+
+	// Pack a P216 frame, which is the Y plane followed by the UV plane with the same line stride. xres should be even.
+	void pack_p216(uint8_t* p_dst, const int dst_stride_in_bytes, const uint8_t* p_src, const int src_stride_in_bytes, const int xres, const int yres)
+	{
+		const uint8_t* p_src_uv = p_src + (size_t)src_stride_in_bytes * yres;
+		m_threads.run(yres, [&](const int y_start, const int y_end) {
+			for (int y = y_start; y < y_end; y++) {
+				pack_line_p216(p_dst + (size_t)y * dst_stride_in_bytes,
+					(const uint16_t*)(p_src + (size_t)y * src_stride_in_bytes),
+					(const uint16_t*)(p_src_uv + (size_t)y * src_stride_in_bytes), xres, m_simd);
+			}
+		});
+	}
+
+	// Pack a planar 4:2:2 frame, the U and V lines have xres/2 samples each.
+	void pack_planar(uint8_t* p_dst, const int dst_stride_in_bytes,
+		const uint16_t* p_y, const int y_stride_in_bytes, const uint16_t* p_u, const uint16_t* p_v, const int uv_stride_in_bytes,
+		const int xres, const int yres)
+	{
+		m_threads.run(yres, [&](const int y_start, const int y_end) {
+			for (int y = y_start; y < y_end; y++) {
+				pack_line_planar(p_dst + (size_t)y * dst_stride_in_bytes,
+					(const uint16_t*)((const uint8_t*)p_y + (size_t)y * y_stride_in_bytes),
+					(const uint16_t*)((const uint8_t*)p_u + (size_t)y * uv_stride_in_bytes),
+					(const uint16_t*)((const uint8_t*)p_v + (size_t)y * uv_stride_in_bytes), xres, m_simd);
+			}
+		});
+	}
+
+	// Unpack into a P216 frame
+	void unpack_p216(uint8_t* p_dst, const int dst_stride_in_bytes, const uint8_t* p_src, const int src_stride_in_bytes, const int xres, const int yres)
+	{
+		uint8_t* p_dst_uv = p_dst + (size_t)dst_stride_in_bytes * yres;
+		m_threads.run(yres, [&](const int y_start, const int y_end) {
+			for (int y = y_start; y < y_end; y++) {
+				unpack_line_p216((uint16_t*)(p_dst + (size_t)y * dst_stride_in_bytes),
+					(uint16_t*)(p_dst_uv + (size_t)y * dst_stride_in_bytes),
+					p_src + (size_t)y * src_stride_in_bytes, xres, m_simd);
+			}
+		});
+	}
+
+	// Unpack into a planar 4:2:2 frame
+	void unpack_planar(uint16_t* p_y, const int y_stride_in_bytes, uint16_t* p_u, uint16_t* p_v, const int uv_stride_in_bytes,
+		const uint8_t* p_src, const int src_stride_in_bytes, const int xres, const int yres)
+	{
+		m_threads.run(yres, [&](const int y_start, const int y_end) {
+			for (int y = y_start; y < y_end; y++) {
+				unpack_line_planar((uint16_t*)((uint8_t*)p_y + (size_t)y * y_stride_in_bytes),
+					(uint16_t*)((uint8_t*)p_u + (size_t)y * uv_stride_in_bytes),
+					(uint16_t*)((uint8_t*)p_v + (size_t)y * uv_stride_in_bytes),
+					p_src + (size_t)y * src_stride_in_bytes, xres, m_simd);
+			}
+		});
+	}
+
+	// The same as NDIlib_util_V210_to_P216. The destination must have p_data allocated for the P216 frame, and the rest
+	// of its description is filled in from the source. A line stride of zero in either frame means the default.
+	void v210_to_p216(const NDIlib_video_frame_v2_t* p_src_v210, NDIlib_video_frame_v2_t* p_dst_p216)
+	{
+		const int xres = p_src_v210->xres, yres = p_src_v210->yres;
+		describe(p_src_v210, p_dst_p216, NDIlib_FourCC_type_P216, xres * (int)sizeof(uint16_t));
+
+		const int src_stride = p_src_v210->line_stride_in_bytes ? p_src_v210->line_stride_in_bytes : line_stride(xres);
+		unpack_p216(p_dst_p216->p_data, p_dst_p216->line_stride_in_bytes, p_src_v210->p_data, src_stride, xres, yres);
+	}
+
+	// The same as NDIlib_util_P216_to_V210
+	void p216_to_v210(const NDIlib_video_frame_v2_t* p_src_p216, NDIlib_video_frame_v2_t* p_dst_v210)
+	{
+		const int xres = p_src_p216->xres, yres = p_src_p216->yres;
+		describe(p_src_p216, p_dst_v210, (NDIlib_FourCC_video_type_e)NDI_LIB_FOURCC('V', '2', '1', '0'), line_stride(xres));
+
+		const int src_stride = p_src_p216->line_stride_in_bytes ? p_src_p216->line_stride_in_bytes : xres * (int)sizeof(uint16_t);
+		pack_p216(p_dst_v210->p_data, p_dst_v210->line_stride_in_bytes, p_src_p216->p_data, src_stride, xres, yres);
+	}
+
+private:
+	converter(const converter&);
+	converter& operator=(const converter&);
+
+	// Describe the output frame from the input frame
+	static void describe(const NDIlib_video_frame_v2_t* p_src, NDIlib_video_frame_v2_t* p_dst, const NDIlib_FourCC_video_type_e FourCC, const int default_stride)
+	{
+		p_dst->xres = p_src->xres;
+		p_dst->yres = p_src->yres;
+		p_dst->FourCC = FourCC;
+		p_dst->frame_rate_N = p_src->frame_rate_N;
+		p_dst->frame_rate_D = p_src->frame_rate_D;
+		p_dst->picture_aspect_ratio = p_src->picture_aspect_ratio;
+		p_dst->frame_format_type = p_src->frame_format_type;
+		p_dst->timecode = p_src->timecode;
+		if (!p_dst->line_stride_in_bytes)
+			p_dst->line_stride_in_bytes = default_stride;
+	}
+
+	simd_e m_simd;
+	ndi_thread::band_pool m_threads;
+};
+
+} // namespace ndi_v210
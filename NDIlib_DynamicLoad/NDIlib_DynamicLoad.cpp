@@ -16,6 +16,8 @@
 
 #include "Processing.NDI.Lib.h"
 
+#include "../NDIlib_Common/NDIlib_Benchmark.h"
+
 static std::atomic<bool> exit_loop(false);
 static void sigint_handler(int) { exit_loop = true; }
 
@@ -114,27 +116,30 @@ int main(int argc, char* argv[])
 	NDI_video_frame.line_stride_in_bytes = 1920 * 4;
 	NDI_video_frame.p_data = (uint8_t*)malloc(1920 * 1080 * 4);
 
-	// We will send 1000 frames of video. 
-	while (!exit_loop) {
-		// Get the current time
-		const auto start_time = std::chrono::high_resolution_clock::now();
-
-		// Send 200 frames
-		for (int idx = 0; !exit_loop && idx < 200; idx++) {
-			// Fill in the buffer. It is likely that you would do something much smarter than this.
-			memset((void*)NDI_video_frame.p_data, (idx & 1) ? 255 : 0, 1920 * 1080 * 4);
-
-			// We now submit the frame. Note that this call will be clocked so that we end up submitting at exactly 29.97fps.
-			p_NDILib->send_send_video_v2(pNDI_send, &NDI_video_frame);
-		}
-
-		// Get the end time
-		const auto end_time = std::chrono::high_resolution_clock::now();
-
-		// Just display something helpful
-		printf("200 frames sent, average fps=%1.2f\n", 200.0f / std::chrono::duration_cast<std::chrono::duration<float>>(end_time - start_time).count());
+	// Measure how the sending performs
+	ndi_benchmark::options bench_options;
+	bench_options.parse(argc, argv);
+
+	ndi_benchmark::session bench("NDIlib_DynamicLoad", bench_options);
+	bench.set("ndi_version", p_NDILib->version());
+	bench.set("xres", NDI_video_frame.xres);
+	bench.set("yres", NDI_video_frame.yres);
+	bench.set("fourcc", "BGRA");
+
+	// We will send video until we are stopped.
+	for (int idx = 0; !exit_loop && bench.running(); idx++) {
+		// Fill in the buffer. It is likely that you would do something much smarter than this.
+		memset((void*)NDI_video_frame.p_data, (idx & 1) ? 255 : 0, 1920 * 1080 * 4);
+
+		// We now submit the frame. Note that this call will be clocked so that we end up submitting at exactly 29.97fps.
+		bench.begin_call();
+		p_NDILib->send_send_video_v2(pNDI_send, &NDI_video_frame);
+		bench.end_call();
 	}
 
+	// Display the results
+	bench.report();
+
 	// Free the video frame
 	free(NDI_video_frame.p_data);
 
@@ -5,10 +5,10 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
-#include <functional>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -16,6 +16,7 @@
 
 #ifdef _WIN32
 #define strcasecmp  _stricmp
+#define strncasecmp _strnicmp
 
 #ifdef _WIN64
 #pragma comment(lib, "Processing.NDI.Lib.x64.lib")
@@ -32,38 +33,168 @@
 #define MINIAUDIO_IMPLEMENTATION
 #include "miniaudio.h"
 
+#include "../NDIlib_Common/NDIlib_Audio.h"
+#include "../NDIlib_Common/NDIlib_Thread.h"
+
 static std::atomic<bool>       g_exit_process(false);
 static std::mutex		       g_exit_lock;
 static bool				       g_exit_threads = false;
 static std::condition_variable g_exit_cv;
 
+// The streams share one miniaudio context, so their devices are opened and closed one at a time.
+static std::mutex		       g_device_lock;
+
 // Helper to convert from dB to a ratio
 double dB_to_ratio(double dB)
 {
 	return pow(10.0, dB / 20.0);
 }
 
-bool process_input(const std::string& audio_device_name, const std::string& audio_ndi_name, float gain_in_dB)
+// How long the audio callbacks take compared with how long they have, which is the length of the audio that each one
+// carries. A callback that takes longer than that will cause a drop-out sooner or later. The callbacks that found the
+// ring buffer full (capture) or empty (playback) are counted too. These are written by the audio thread only, and read
+// by whoever wants to display them.
+struct callback_stats_t {
+	callback_stats_t(const char* p_xrun_name)
+		: m_no_callbacks(0), m_no_samples(0), m_total_ns(0), m_budget_ns(0), m_max_ns(0), m_no_over_budget(0),
+		  m_no_xruns(0), m_no_xrun_samples(0), m_p_xrun_name(p_xrun_name)
+	{
+	}
+
+	// Record a callback that could not write or read all of its samples.
+	void add_xrun(ma_uint32 no_samples)
+	{
+		m_no_xruns.store(m_no_xruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		m_no_xrun_samples.store(m_no_xrun_samples.load(std::memory_order_relaxed) + no_samples, std::memory_order_relaxed);
+	}
+
+	// Record one callback.
+	void add(ma_uint32 no_samples, ma_uint32 sample_rate, int64_t duration_ns)
+	{
+		const int64_t budget_ns = sample_rate ? (int64_t)no_samples * 1000000000LL / sample_rate : 0;
+		m_no_callbacks.store(m_no_callbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		m_no_samples.store(no_samples, std::memory_order_relaxed);
+		m_total_ns.store(m_total_ns.load(std::memory_order_relaxed) + duration_ns, std::memory_order_relaxed);
+		m_budget_ns.store(m_budget_ns.load(std::memory_order_relaxed) + budget_ns, std::memory_order_relaxed);
+		if (duration_ns > m_max_ns.load(std::memory_order_relaxed))
+			m_max_ns.store(duration_ns, std::memory_order_relaxed);
+		if (duration_ns > budget_ns)
+			m_no_over_budget.store(m_no_over_budget.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	// Display what we have so far.
+	void display(const char* p_name) const
+	{
+		const int64_t no_callbacks = m_no_callbacks.load(std::memory_order_relaxed);
+		if (!no_callbacks) {
+			printf("\n%s : No audio yet.\n", p_name);
+			return;
+		}
+
+		const double period_ms = 1e-6 * (double)m_budget_ns.load(std::memory_order_relaxed) / (double)no_callbacks;
+		const double average_us = 1e-3 * (double)m_total_ns.load(std::memory_order_relaxed) / (double)no_callbacks;
+		const double max_us = 1e-3 * (double)m_max_ns.load(std::memory_order_relaxed);
+		printf("\n%s : %lld callbacks of %u samples (%1.2fms), average %1.1fus (%1.1f%%), longest %1.1fus (%1.1f%%), %lld over budget, %lld %s (%lld samples).\n",
+			p_name, (long long)no_callbacks, (unsigned)m_no_samples.load(std::memory_order_relaxed), period_ms,
+			average_us, period_ms > 0.0 ? 0.1 * average_us / period_ms : 0.0, max_us, period_ms > 0.0 ? 0.1 * max_us / period_ms : 0.0,
+			(long long)m_no_over_budget.load(std::memory_order_relaxed), (long long)m_no_xruns.load(std::memory_order_relaxed),
+			m_p_xrun_name, (long long)m_no_xrun_samples.load(std::memory_order_relaxed));
+	}
+
+	std::atomic<int64_t> m_no_callbacks;
+	std::atomic<ma_uint32> m_no_samples;
+	std::atomic<int64_t> m_total_ns;
+	std::atomic<int64_t> m_budget_ns;
+	std::atomic<int64_t> m_max_ns;
+	std::atomic<int64_t> m_no_over_budget;
+	std::atomic<int64_t> m_no_xruns;
+	std::atomic<int64_t> m_no_xrun_samples;
+	const char* m_p_xrun_name;
+};
+
+// The worker threads wake up this often, a quarter of the latency but no more than once a millisecond.
+static std::chrono::microseconds worker_interval(ma_uint32 latency_ms)
 {
-	// Initialize a miniaudio context.
-	ma_context context;
-	if (ma_context_init(nullptr, 0, nullptr, &context) != MA_SUCCESS) {
-		puts("ERROR : Unable to initialize audio devices.");
-		return false;
+	return std::chrono::microseconds(std::max<ma_uint32>(latency_ms * 250, 1000));
+}
+
+// The settings for one stream, which is one sound card going to or coming from one NDI source.
+struct stream_settings_t {
+	stream_settings_t(bool is_input)
+		: m_is_input(is_input), m_gain_dB(0.0f), m_period(0), m_latency_ms(is_input ? 10 : 20), m_priority(0)
+	{
 	}
 
-	// Let's enumerate the capture devices.
-	ma_device_info* p_capture_devices;
-	ma_uint32 num_capture_devices;
-	if (ma_context_get_devices(&context, nullptr, nullptr, &p_capture_devices, &num_capture_devices) != MA_SUCCESS) {
-		puts("ERROR : Unable to enumerate audio devices.");
+	// Capture from a device and send it, or receive and play it on a device.
+	bool m_is_input;
+
+	// The device name or number, and the NDI source to create (input) or to receive (output).
+	std::string m_device, m_ndi_name;
+
+	// The gain, the device period in samples (0 is the device's) and the latency.
+	float m_gain_dB;
+	ma_uint32 m_period;
+	ma_uint32 m_latency_ms;
+
+	// The CPUs to run the stream's threads on (empty is any), and their real-time priority (0 is a normal thread).
+	std::vector<int> m_cpus;
+	int m_priority;
+};
+
+// Puts a thread on the stream's CPUs and gives it the stream's priority. The device's thread belongs to miniaudio, so it
+// does this to itself in its first callback, which is the only time that a callback makes a system call. Whether it
+// worked is picked up by the stream's own thread, which reports it.
+struct thread_setup_t {
+	thread_setup_t(const std::vector<int>& cpus, int priority)
+		: m_cpus(cpus), m_priority(priority), m_done(false), m_ok(true)
+	{
 	}
 
+	// Set up the calling thread.
+	bool apply(void) const
+	{
+		bool ok = true;
+		if (!m_cpus.empty() && !ndi_thread::set_affinity(m_cpus))
+			ok = false;
+		if ((m_priority > 0) && !ndi_thread::set_realtime_priority(m_priority))
+			ok = false;
+		return ok;
+	}
+
+	// Set up the calling thread if it has not been already, for the device's callback.
+	void apply_once(void)
+	{
+		if (m_done.load(std::memory_order_acquire))
+			return;
+		m_ok = apply();
+		m_done.store(true, std::memory_order_release);
+	}
+
+	// Report whether the device's thread could be set up, once it has been.
+	void report(const char* p_name)
+	{
+		if (!m_done.load(std::memory_order_acquire) || m_reported)
+			return;
+		m_reported = true;
+		if (!m_ok)
+			printf("\n%s : Unable to set the CPUs or the priority of the device's thread.\n", p_name);
+	}
+
+	const std::vector<int> m_cpus;
+	const int m_priority;
+	std::atomic<bool> m_done;
+	bool m_ok;
+	bool m_reported = false;
+};
+
+// Find a device by its name or its number, or the default device when neither of those match.
+static ma_uint32 find_device(const ma_device_info* p_devices, ma_uint32 num_devices, const std::string& audio_device_name)
+{
 	ma_uint32 device_num = (ma_uint32)-1;
 
-	// Look for the capture device by name.
-	for (ma_uint32 i = 0; i != num_capture_devices; i++) {
-		if (strcasecmp(p_capture_devices[i].name, audio_device_name.c_str()) == 0) {
+	// Look for the device by name.
+	for (ma_uint32 i = 0; i != num_devices; i++) {
+		if (strcasecmp(p_devices[i].name, audio_device_name.c_str()) == 0) {
 			device_num = i;
 			break;
 		}
@@ -72,27 +203,47 @@ bool process_input(const std::string& audio_device_name, const std::string& audi
 	// The device name didn't match anything. Perhaps it's a numeric index instead.
 	if (device_num == (ma_uint32)-1) {
 		int num = atoi(audio_device_name.c_str());
-		if (num != 0)
+		if ((num > 0) && ((ma_uint32)num <= num_devices))
 			device_num = num - 1;
 	}
 
 	// There have been no matches so far. We'll fallback to the default device instead.
 	if (device_num == (ma_uint32)-1) {
-		for (ma_uint32 i = 0; i != num_capture_devices; i++) {
-			if (p_capture_devices[i].isDefault) {
+		for (ma_uint32 i = 0; i != num_devices; i++) {
+			if (p_devices[i].isDefault) {
 				device_num = i;
 				break;
 			}
 		}
 	}
 
-	// Audio sending class.
+	return device_num;
+}
+
+bool process_input(ma_context* p_context, const ma_device_info* p_capture_devices, ma_uint32 num_capture_devices, const stream_settings_t& settings, bool display_stats)
+{
+	const std::string name = "Input " + settings.m_ndi_name;
+	const ma_uint32 latency_ms = settings.m_latency_ms;
+
+	// This thread runs on the same CPUs as the device's, one priority below it.
+	const int priority = (settings.m_priority > 1) ? settings.m_priority - 1 : settings.m_priority;
+	if (!thread_setup_t(settings.m_cpus, priority).apply())
+		printf("\n%s : Unable to set the CPUs or the priority of the stream's thread.\n", name.c_str());
+
+	// Look for the capture device.
+	ma_uint32 device_num = find_device(p_capture_devices, num_capture_devices, settings.m_device);
+
+	// Audio sending class. The device's callback only copies the audio into a ring buffer, and this thread takes it out
+	// again, splits out the channels, applies the gain and sends it to NDI. That way nothing that NDI does can hold up
+	// the sound card. If this thread falls so far behind that the ring is full, the audio that does not fit is dropped
+	// and counted as an overrun.
 	struct audio_cature_t {
-		audio_cature_t(const char* p_audio_name, float gain_in_dB)
-			: m_gain_in_dB(gain_in_dB)
+		audio_cature_t(const char* p_audio_name, float gain, const std::vector<int>& cpus, int priority)
+			: m_gain(gain), m_simd(ndi_audio::detect_simd()), m_sample_rate(0), m_frame_samples(0), m_stats("overruns"), m_device_thread(cpus, priority)
 		{
-			// Create the NDI source.
+			// Create the NDI source. The sound card is the clock, so NDI does not need to clock the audio.
 			NDIlib_send_create_t send_create(p_audio_name);
+			send_create.clock_audio = false;
 			m_p_ndi_send = NDIlib_send_create(&send_create);
 		}
 
@@ -103,41 +254,78 @@ bool process_input(const std::string& audio_device_name, const std::string& audi
 			m_p_ndi_send = nullptr;
 		}
 
+		// Allocate the ring and the workspaces, this must be called before the device is started. The audio is sent to
+		// NDI in frames of the latency, and the ring can hold four of them.
+		void prepare(ma_uint32 no_channels, ma_uint32 sample_rate, ma_uint32 period, ma_uint32 latency_ms)
+		{
+			m_sample_rate = sample_rate;
+			m_frame_samples = std::max<size_t>((size_t)sample_rate * latency_ms / 1000, 1);
+			m_ring.create((int)no_channels, std::max<size_t>(4 * m_frame_samples, 4 * (size_t)period));
+			m_interleaved.assign(no_channels * m_frame_samples, 0.0f);
+			m_workspace.assign(no_channels * m_frame_samples, 0.0f);
+		}
+
 		void callback_proc(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount)
 		{
-			// Build up a source audio level.
-			NDIlib_audio_frame_interleaved_32f_t src_audio_frame;
-			src_audio_frame.no_channels = pDevice->capture.channels;
-			src_audio_frame.sample_rate = pDevice->capture.internalSampleRate;
-			src_audio_frame.no_samples = frameCount;
-			src_audio_frame.p_data = (float*)pInput;
-
-			// Convert this to an output buffer.
-			NDIlib_audio_frame_v2_t	dst_audio_frame;
-			m_workspace.resize(src_audio_frame.no_channels * src_audio_frame.no_samples);
-			dst_audio_frame.p_data = (float*)m_workspace.data();
-			dst_audio_frame.channel_stride_in_bytes = sizeof(float) * src_audio_frame.no_samples;
-
-			// Convert the audio.
-			NDIlib_util_audio_from_interleaved_32f_v2(&src_audio_frame, &dst_audio_frame);
-
-			// Scale the audio correctly.
-			for (size_t i = 0; i != m_workspace.size(); i++)
-				m_workspace[i] *= m_gain_in_dB;
-
-			// Send the audio please!
-			NDIlib_send_send_audio_v2(m_p_ndi_send, &dst_audio_frame);
+			m_device_thread.apply_once();
+			const auto start = std::chrono::steady_clock::now();
+
+			// Copy the audio into the ring, whatever does not fit is lost.
+			const size_t no_written = m_ring.write((const float*)pInput, frameCount);
+			if (no_written < frameCount)
+				m_stats.add_xrun(frameCount - (ma_uint32)no_written);
+
+			// How long did that take ?
+			m_stats.add(frameCount, m_sample_rate, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		// Send all of the complete frames that are waiting in the ring.
+		void send_proc(void)
+		{
+			while (m_ring.available() >= m_frame_samples) {
+				m_ring.read(m_interleaved.data(), m_frame_samples);
+
+				// Build up the planar audio frame.
+				NDIlib_audio_frame_v2_t dst_audio_frame;
+				dst_audio_frame.sample_rate = (int)m_sample_rate;
+				dst_audio_frame.no_channels = m_ring.no_channels();
+				dst_audio_frame.no_samples = (int)m_frame_samples;
+				dst_audio_frame.p_data = m_workspace.data();
+				dst_audio_frame.channel_stride_in_bytes = (int)(sizeof(float) * m_frame_samples);
+
+				// Convert the audio and scale it correctly.
+				ndi_audio::deinterleave(m_interleaved.data(), dst_audio_frame.no_channels, dst_audio_frame.no_samples,
+					m_workspace.data(), dst_audio_frame.channel_stride_in_bytes, m_gain, m_simd);
+
+				// Send the audio please!
+				NDIlib_send_send_audio_v2(m_p_ndi_send, &dst_audio_frame);
+			}
 		}
 
 		// The NDI audio sender.
 		NDIlib_send_instance_t m_p_ndi_send = nullptr;
 
-		// The audio gain.
-		float m_gain_in_dB;
+		// The audio gain, as a ratio.
+		float m_gain;
+
+		// The instruction set to use.
+		ndi_audio::simd_e m_simd;
 
-		// Workspace for planar channels.
+		// The audio format, and how many samples are sent to NDI at a time.
+		ma_uint32 m_sample_rate;
+		size_t m_frame_samples;
+
+		// The audio on its way from the device, and the workspaces to send it from.
+		ndi_audio::ring m_ring;
+		std::vector<float> m_interleaved;
 		std::vector<float> m_workspace;
-	} audio_capture(audio_ndi_name.c_str(), (float)dB_to_ratio(gain_in_dB));
+
+		// How long the callbacks take.
+		callback_stats_t m_stats;
+
+		// The CPUs and the priority of the device's thread.
+		thread_setup_t m_device_thread;
+	} audio_capture(settings.m_ndi_name.c_str(), (float)dB_to_ratio(settings.m_gain_dB), settings.m_cpus, settings.m_priority);
 
 	// I do not know how this happened.
 	if (device_num != (ma_uint32)-1) {
@@ -147,6 +335,7 @@ bool process_input(const std::string& audio_device_name, const std::string& audi
 		// Setup the device to be used.
 		config.capture.pDeviceID = &p_capture_devices[device_num].id;
 		config.capture.format = ma_format_f32;
+		config.periodSizeInFrames = settings.m_period;
 		config.pUserData = &audio_capture;
 		config.dataCallback = [](ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount) {
 			((audio_cature_t*)pDevice->pUserData)->callback_proc(pDevice, pOutput, pInput, frameCount);
@@ -154,71 +343,69 @@ bool process_input(const std::string& audio_device_name, const std::string& audi
 
 		// Create a device.
 		ma_device device;
-		if (ma_device_init(&context, &config, &device) == MA_SUCCESS) {
+		std::unique_lock<std::mutex> device_lock(g_device_lock);
+		const bool device_ok = (ma_device_init(p_context, &config, &device) == MA_SUCCESS);
+		device_lock.unlock();
+		if (device_ok) {
+			// Everything that the callback uses is allocated before it starts.
+			audio_capture.prepare(device.capture.channels, device.sampleRate, device.capture.internalPeriodSizeInFrames, latency_ms);
+
 			// The device is sleeping by default so you'll need to start it manually.
 			ma_device_start(&device);
 
-			// Wait for exit to be signaled and process audio until then!
+			// Send the audio to NDI until exit is signaled.
+			auto last_display = std::chrono::steady_clock::now();
 			std::unique_lock<std::mutex> exit_lock(g_exit_lock);
-			g_exit_cv.wait(exit_lock, [] { return g_exit_threads; });
+			while (!g_exit_cv.wait_for(exit_lock, worker_interval(latency_ms), [] { return g_exit_threads; })) {
+				exit_lock.unlock();
+				audio_capture.send_proc();
+
+				// Display whether the device's thread could be set up, and how the callbacks are doing every few seconds.
+				audio_capture.m_device_thread.report(name.c_str());
+				if (display_stats && (std::chrono::steady_clock::now() - last_display >= std::chrono::seconds(5))) {
+					audio_capture.m_stats.display(name.c_str());
+					last_display = std::chrono::steady_clock::now();
+				}
+				exit_lock.lock();
+			}
 			exit_lock.unlock();
 
 			// This will stop the device so no need to do that manually.
+			device_lock.lock();
 			ma_device_uninit(&device);
+			device_lock.unlock();
+
+			// How did the callbacks do ?
+			audio_capture.m_stats.display(name.c_str());
+			return true;
 		}
 	}
 
-	ma_context_uninit(&context);
-	return true;
+	printf("\nERROR : Unable to open the capture device \"%s\".\n", settings.m_device.c_str());
+	return false;
 }
 
-bool process_output(const std::string& audio_device_name, const std::string& audio_ndi_name, float gain_in_dB)
+bool process_output(ma_context* p_context, const ma_device_info* p_playback_devices, ma_uint32 num_playback_devices, const stream_settings_t& settings, bool display_stats)
 {
-	// Initialize a miniaudio context.
-	ma_context context;
-	if (ma_context_init(nullptr, 0, nullptr, &context) != MA_SUCCESS) {
-		puts("ERROR : Unable to initialize audio devices.");
-		return false;
-	}
-
-	// Let's enumerate the playback devices.
-	ma_device_info* p_playback_devices;
-	ma_uint32 num_playback_devices;
-	if (ma_context_get_devices(&context, &p_playback_devices, &num_playback_devices, nullptr, nullptr) != MA_SUCCESS) {
-		puts("ERROR : Unable to enumerate audio devices.");
-	}
-
-	ma_uint32 device_num = (ma_uint32)-1;
-
-	// Look for the playback device by name.
-	for (ma_uint32 i = 0; i != num_playback_devices; i++) {
-		if (strcasecmp(p_playback_devices[i].name, audio_device_name.c_str()) == 0) {
-			device_num = i;
-			break;
-		}
-	}
-
-	// The device name didn't match anything. Perhaps it's a numeric index instead.
-	if (device_num == (ma_uint32)-1) {
-		int num = atoi(audio_device_name.c_str());
-		if (num != 0)
-			device_num = num - 1;
-	}
-
-	// There have been no matches so far. We'll fallback to the default device instead.
-	if (device_num == (ma_uint32)-1) {
-		for (ma_uint32 i = 0; i != num_playback_devices; i++) {
-			if (p_playback_devices[i].isDefault) {
-				device_num = i;
-				break;
-			}
-		}
-	}
-
-	// Audio receiving class.
+	const std::string name = "Output " + settings.m_ndi_name;
+	const ma_uint32 latency_ms = settings.m_latency_ms;
+
+	// This thread runs on the same CPUs as the device's, one priority below it.
+	const int priority = (settings.m_priority > 1) ? settings.m_priority - 1 : settings.m_priority;
+	if (!thread_setup_t(settings.m_cpus, priority).apply())
+		printf("\n%s : Unable to set the CPUs or the priority of the stream's thread.\n", name.c_str());
+
+	// Look for the playback device.
+	ma_uint32 device_num = find_device(p_playback_devices, num_playback_devices, settings.m_device);
+
+	// Audio receiving class. This thread takes the audio from the frame-sync, applies the gain, interleaves it and keeps
+	// a ring buffer topped up with the latency's worth of it, so the device's callback only has to copy the audio out of
+	// the ring. The frame-sync is always asked for audio at the rate that the sound card is playing it, so it stays in
+	// step with the sound card's clock. If the ring runs dry the rest of the callback is silent, and counted as an
+	// underrun.
 	struct audio_playback_t {
-		audio_playback_t(const char* p_audio_name, float gain_in_dB)
-			: m_gain_in_dB(gain_in_dB)
+		audio_playback_t(const char* p_audio_name, float gain, const std::vector<int>& cpus, int priority)
+			: m_gain(gain), m_simd(ndi_audio::detect_simd()), m_sample_rate(0), m_target_samples(0), m_min_samples(0), m_stats("underruns"), m_device_thread(cpus, priority)
 		{
 			// Create the NDI receiver.
 			NDIlib_recv_create_v3_t recv_create;
@@ -241,28 +428,58 @@ bool process_output(const std::string& audio_device_name, const std::string& aud
 			m_p_ndi_recv = nullptr;
 		}
 
+		// Allocate the ring and the workspace and fill the ring, this must be called before the device is started. The
+		// ring is kept with the latency's worth of audio in it, but at least two periods of the device.
+		void prepare(ma_uint32 no_channels, ma_uint32 sample_rate, ma_uint32 period, ma_uint32 latency_ms)
+		{
+			m_sample_rate = sample_rate;
+			m_target_samples = std::max<size_t>((size_t)sample_rate * latency_ms / 1000, 2 * (size_t)period);
+			m_min_samples = std::max<size_t>(std::min<size_t>(period, m_target_samples / 2), 1);
+			m_ring.create((int)no_channels, m_target_samples);
+			m_interleaved.assign(no_channels * m_target_samples, 0.0f);
+			receive_proc();
+		}
+
 		void callback_proc(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount)
 		{
-			// We get the audio data.
-			NDIlib_audio_frame_v2_t src_aud;
-			NDIlib_framesync_capture_audio(m_p_ndi_framesync, &src_aud, pDevice->playback.internalSampleRate, pDevice->playback.channels, frameCount);
+			m_device_thread.apply_once();
+			const auto start = std::chrono::steady_clock::now();
+
+			// Copy the audio out of the ring, and if there is not enough the rest is silent.
+			const size_t no_read = m_ring.read((float*)pOutput, frameCount);
+			if (no_read < frameCount) {
+				memset((float*)pOutput + no_read * pDevice->playback.channels, 0, (frameCount - no_read) * pDevice->playback.channels * sizeof(float));
+				m_stats.add_xrun(frameCount - (ma_uint32)no_read);
+			}
 
-			// Build up a source audio level.
-			NDIlib_audio_frame_interleaved_32f_t dst_aud;
-			dst_aud.no_channels = pDevice->playback.channels;
-			dst_aud.sample_rate = pDevice->playback.internalSampleRate;
-			dst_aud.no_samples = frameCount;
-			dst_aud.p_data = (float*)pOutput;
+			// How long did that take ?
+			m_stats.add(frameCount, m_sample_rate, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		// Top the ring up to the latency, once at least a period of it has been played.
+		void receive_proc(void)
+		{
+			const size_t no_available = m_ring.available();
+			if (no_available + m_min_samples > m_target_samples)
+				return;
 
-			// Convert the channels from planar to interleaved.
-			NDIlib_util_audio_to_interleaved_32f_v2(&src_aud, &dst_aud);
+			// We get the audio data, which is silence when there is no source.
+			const int no_channels = m_ring.no_channels();
+			const int no_samples = (int)(m_target_samples - no_available);
+			NDIlib_audio_frame_v2_t src_aud;
+			NDIlib_framesync_capture_audio(m_p_ndi_framesync, &src_aud, (int)m_sample_rate, no_channels, no_samples);
+
+			// Convert the channels from planar to interleaved and scale the audio correctly.
+			if (src_aud.p_data && (src_aud.no_channels == no_channels) && (src_aud.no_samples == no_samples))
+				ndi_audio::interleave(src_aud.p_data, src_aud.channel_stride_in_bytes, no_channels, no_samples, m_interleaved.data(), m_gain, m_simd);
+			else
+				memset(m_interleaved.data(), 0, (size_t)no_channels * no_samples * sizeof(float));
 
 			// Free the original frame.
 			NDIlib_framesync_free_audio(m_p_ndi_framesync, &src_aud);
 
-			// Scale the audio correctly.
-			for (int i = 0; i < dst_aud.no_samples * dst_aud.no_channels; i++)
-				dst_aud.p_data[i] *= m_gain_in_dB;
+			// And give it to the device.
+			m_ring.write(m_interleaved.data(), no_samples);
 		}
 
 		// The NDI audio receiver.
@@ -271,9 +488,27 @@ bool process_output(const std::string& audio_device_name, const std::string& aud
 		// The NDI frame-sync.
 		NDIlib_framesync_instance_t m_p_ndi_framesync = nullptr;
 
-		// The audio gain.
-		float m_gain_in_dB;
-	} audio_playback(audio_ndi_name.c_str(), (float)dB_to_ratio(gain_in_dB));
+		// The audio gain, as a ratio.
+		float m_gain;
+
+		// The instruction set to use.
+		ndi_audio::simd_e m_simd;
+
+		// The audio format, how much audio is kept in the ring, and the least that it is topped up by.
+		ma_uint32 m_sample_rate;
+		size_t m_target_samples;
+		size_t m_min_samples;
+
+		// The audio on its way to the device, and the workspace to interleave it in.
+		ndi_audio::ring m_ring;
+		std::vector<float> m_interleaved;
+
+		// How long the callbacks take.
+		callback_stats_t m_stats;
+
+		// The CPUs and the priority of the device's thread.
+		thread_setup_t m_device_thread;
+	} audio_playback(settings.m_ndi_name.c_str(), (float)dB_to_ratio(settings.m_gain_dB), settings.m_cpus, settings.m_priority);
 
 	// I do not know how this happened.
 	if (device_num != (ma_uint32)-1) {
@@ -283,6 +518,7 @@ bool process_output(const std::string& audio_device_name, const std::string& aud
 		// Setup the device to be used.
 		config.playback.pDeviceID = &p_playback_devices[device_num].id;
 		config.playback.format = ma_format_f32;
+		config.periodSizeInFrames = settings.m_period;
 		config.pUserData = &audio_playback;
 		config.dataCallback = [](ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount) {
 			((audio_playback_t*)pDevice->pUserData)->callback_proc(pDevice, pOutput, pInput, frameCount);
@@ -290,22 +526,145 @@ bool process_output(const std::string& audio_device_name, const std::string& aud
 
 		// Create a device.
 		ma_device device;
-		if (ma_device_init(&context, &config, &device) == MA_SUCCESS) {
+		std::unique_lock<std::mutex> device_lock(g_device_lock);
+		const bool device_ok = (ma_device_init(p_context, &config, &device) == MA_SUCCESS);
+		device_lock.unlock();
+		if (device_ok) {
+			// Everything that the callback uses is allocated, and the ring filled, before it starts.
+			audio_playback.prepare(device.playback.channels, device.sampleRate, device.playback.internalPeriodSizeInFrames, latency_ms);
+
 			// The device is sleeping by default so you'll need to start it manually.
 			ma_device_start(&device);
 
-			// Wait for exit to be signaled and process audio until then!
+			// Receive the audio from NDI until exit is signaled.
+			auto last_display = std::chrono::steady_clock::now();
 			std::unique_lock<std::mutex> exit_lock(g_exit_lock);
-			g_exit_cv.wait(exit_lock, [] { return g_exit_threads; });
+			while (!g_exit_cv.wait_for(exit_lock, worker_interval(latency_ms), [] { return g_exit_threads; })) {
+				exit_lock.unlock();
+				audio_playback.receive_proc();
+
+				// Display whether the device's thread could be set up, and how the callbacks are doing every few seconds.
+				audio_playback.m_device_thread.report(name.c_str());
+				if (display_stats && (std::chrono::steady_clock::now() - last_display >= std::chrono::seconds(5))) {
+					audio_playback.m_stats.display(name.c_str());
+					last_display = std::chrono::steady_clock::now();
+				}
+				exit_lock.lock();
+			}
 			exit_lock.unlock();
 
 			// This will stop the device so no need to do that manually.
+			device_lock.lock();
 			ma_device_uninit(&device);
+			device_lock.unlock();
+
+			// How did the callbacks do ?
+			audio_playback.m_stats.display(name.c_str());
+			return true;
 		}
 	}
 
-	ma_context_uninit(&context);
-	return true;
+	printf("\nERROR : Unable to open the playback device \"%s\".\n", settings.m_device.c_str());
+	return false;
+}
+
+// Split a line of a configuration file into words. A word in "quotes" can have spaces in it, and anything after a # is
+// a comment.
+static std::vector<std::string> split_line(const char* p_line)
+{
+	std::vector<std::string> words;
+	for (const char* p = p_line; *p;) {
+		// Skip the spaces between words.
+		if ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n')) {
+			p++;
+			continue;
+		}
+
+		// The rest of the line is a comment.
+		if (*p == '#')
+			break;
+
+		// Get the word.
+		std::string word;
+		if (*p == '"') {
+			for (p++; *p && (*p != '"'); p++)
+				word += *p;
+			if (*p == '"')
+				p++;
+		} else {
+			for (; *p && (*p != ' ') && (*p != '\t') && (*p != '\r') && (*p != '\n'); p++)
+				word += *p;
+		}
+		words.push_back(word);
+	}
+
+	return words;
+}
+
+// Load the streams from a configuration file, which has one stream on each line :
+//		input <device> <NDI source name> [options]
+//		output <device> <NDI source name> [options]
+// where the options are any of gain <dB>, period <samples>, latency <ms>, cpus <list, e.g. 2 or 2-3> and
+// priority <1-99>. They are the same as the command line options of the same names.
+static bool load_config(const char* p_filename, std::vector<stream_settings_t>& streams)
+{
+	FILE* p_file = fopen(p_filename, "r");
+	if (!p_file) {
+		printf("ERROR : Unable to open %s.\n", p_filename);
+		return false;
+	}
+
+	bool ok = true;
+	char line[4096];
+	for (int line_no = 1; ok && fgets(line, sizeof(line), p_file); line_no++) {
+		const std::vector<std::string> words = split_line(line);
+		if (words.empty())
+			continue;
+
+		// The direction, device and NDI source come first.
+		const bool is_input = (strcasecmp(words[0].c_str(), "input") == 0);
+		if ((!is_input && (strcasecmp(words[0].c_str(), "output") != 0)) || (words.size() < 3)) {
+			printf("ERROR : %s line %d, expected input or output followed by a device and an NDI source.\n", p_filename, line_no);
+			ok = false;
+			break;
+		}
+
+		stream_settings_t stream(is_input);
+		stream.m_device = words[1];
+		stream.m_ndi_name = words[2];
+
+		// Then the options, which all have a value.
+		for (size_t i = 3; i < words.size(); i += 2) {
+			const char* p_option = words[i].c_str();
+			if (i + 1 >= words.size()) {
+				printf("ERROR : %s line %d, %s has no value.\n", p_filename, line_no, p_option);
+				ok = false;
+				break;
+			}
+
+			const std::string& value = words[i + 1];
+			if (strcasecmp(p_option, "gain") == 0)
+				stream.m_gain_dB = (float)atof(value.c_str());
+			else if (strcasecmp(p_option, "period") == 0)
+				stream.m_period = (ma_uint32)std::max(atoi(value.c_str()), 0);
+			else if (strcasecmp(p_option, "latency") == 0)
+				stream.m_latency_ms = (ma_uint32)std::max(atoi(value.c_str()), 1);
+			else if (strcasecmp(p_option, "cpus") == 0)
+				stream.m_cpus = ndi_thread::parse_cpu_list(value);
+			else if (strcasecmp(p_option, "priority") == 0)
+				stream.m_priority = std::min(std::max(atoi(value.c_str()), 0), 99);
+			else {
+				printf("ERROR : %s line %d, unknown option %s.\n", p_filename, line_no, p_option);
+				ok = false;
+				break;
+			}
+		}
+
+		streams.push_back(stream);
+	}
+
+	fclose(p_file);
+	return ok;
 }
 
 int main(int argc, char* argv[])
@@ -317,84 +676,133 @@ int main(int argc, char* argv[])
 	puts("NDI Free Audio");
 	puts("==============\n");
 
-	// The command lines
-	std::string input_source, input_name_source = "Free Audio";
-	std::string output_source = "default", output_name_source;
-	float input_gain_dB = 0.0, output_gain_dB = 0.0;
+	// The streams from the command line, and any that are in configuration files.
+	stream_settings_t input_stream(true), output_stream(false);
+	input_stream.m_ndi_name = "Free Audio";
+	output_stream.m_device = "default";
+	std::vector<stream_settings_t> streams;
+	bool display_stats = false;
 
 	// Parse the command line
 	for (int i = 1; i < argc; i++) {
-		// Get the output source
-		if (strcasecmp(argv[i], "-output") == 0) {
-			// Get the arguments
+		// Is this an input or an output option ?
+		stream_settings_t* p_stream = (strncasecmp(argv[i], "-input", 6) == 0) ? &input_stream : (strncasecmp(argv[i], "-output", 7) == 0) ? &output_stream : nullptr;
+		const char* p_option = p_stream ? argv[i] + (p_stream->m_is_input ? 6 : 7) : argv[i];
+
+		// Get the device
+		if (p_stream && (*p_option == 0)) {
+			// Get the argument.
 			if (++i < argc)
-				output_source = argv[i];
+				p_stream->m_device = argv[i];
 
 			continue;
 		}
 
-		// Get the output source
-		if (strcasecmp(argv[i], "-output_name") == 0) {
-			// Get the arguments
+		// Get the NDI source
+		if (p_stream && (strcasecmp(p_option, "_name") == 0)) {
+			// Get the argument.
 			if (++i < argc)
-				output_name_source = argv[i];
+				p_stream->m_ndi_name = argv[i];
 
 			continue;
 		}
 
-		// Get the output gain.
-		if (strcasecmp(argv[i], "-output_gain") == 0) {
+		// Get the gain.
+		if (p_stream && (strcasecmp(p_option, "_gain") == 0)) {
 			// Get the argument.
 			if (++i < argc)
-				output_gain_dB = (float)atof(argv[i]);
+				p_stream->m_gain_dB = (float)atof(argv[i]);
 
 			continue;
 		}
 
-		// Get the input source.
-		if (strcasecmp(argv[i], "-input") == 0) {
+		// Get the period, in samples.
+		if (p_stream && (strcasecmp(p_option, "_period") == 0)) {
 			// Get the argument.
 			if (++i < argc)
-				input_source = argv[i];
+				p_stream->m_period = (ma_uint32)std::max(atoi(argv[i]), 0);
 
 			continue;
 		}
 
-		// Get the input source.
-		if (strcasecmp(argv[i], "-input_name") == 0) {
+		// Get the latency, in milliseconds.
+		if (p_stream && (strcasecmp(p_option, "_latency") == 0)) {
 			// Get the argument.
 			if (++i < argc)
-				input_name_source = argv[i];
+				p_stream->m_latency_ms = (ma_uint32)std::max(atoi(argv[i]), 1);
 
 			continue;
 		}
 
-		// Get the input gain.
-		if (strcasecmp(argv[i], "-input_gain") == 0) {
+		// Get the CPUs to run on.
+		if (p_stream && (strcasecmp(p_option, "_cpus") == 0)) {
 			// Get the argument.
 			if (++i < argc)
-				input_gain_dB = (float)atof(argv[i]);
+				p_stream->m_cpus = ndi_thread::parse_cpu_list(argv[i]);
+
+			continue;
+		}
+
+		// Get the real-time priority.
+		if (p_stream && (strcasecmp(p_option, "_priority") == 0)) {
+			// Get the argument.
+			if (++i < argc)
+				p_stream->m_priority = std::min(std::max(atoi(argv[i]), 0), 99);
+
+			continue;
+		}
+
+		// Get the streams from a file.
+		if (strcasecmp(p_option, "-config") == 0) {
+			// Get the argument.
+			if ((++i < argc) && !load_config(argv[i], streams))
+				return 1;
+
+			continue;
+		}
 
+		// Display how long the audio callbacks take every few seconds.
+		if (strcasecmp(p_option, "-stats") == 0) {
+			display_stats = true;
 			continue;
 		}
 	}
 
-	// Start the output thread if needed.
-	std::thread output_thread;
-	if (!output_source.empty() && !output_name_source.empty()) {
-		puts("Starting Audio Output ...");
-		output_thread = std::thread(std::bind(process_output, output_source, output_name_source, output_gain_dB));
+	// The streams on the command line go first.
+	if (!input_stream.m_device.empty() && !input_stream.m_ndi_name.empty())
+		streams.insert(streams.begin(), input_stream);
+	if (!output_stream.m_device.empty() && !output_stream.m_ndi_name.empty())
+		streams.insert(streams.begin(), output_stream);
+
+	// Initialize a miniaudio context, which all of the streams share.
+	ma_context context;
+	if (ma_context_init(nullptr, 0, nullptr, &context) != MA_SUCCESS) {
+		puts("ERROR : Unable to initialize audio devices.");
+		return 1;
 	}
 
-	// Start the input thread if needed.
-	std::thread input_thread;
-	if (!input_source.empty() && !input_name_source.empty()) {
-		puts("Starting Audio Input ...");
-		input_thread = std::thread(std::bind(process_input, input_source, input_name_source, input_gain_dB));
+	// Let's enumerate the devices. These are not enumerated again, so the list stays valid while the streams run.
+	ma_device_info* p_playback_devices = nullptr;
+	ma_device_info* p_capture_devices = nullptr;
+	ma_uint32 num_playback_devices = 0, num_capture_devices = 0;
+	if (ma_context_get_devices(&context, &p_playback_devices, &num_playback_devices, &p_capture_devices, &num_capture_devices) != MA_SUCCESS) {
+		puts("ERROR : Unable to enumerate audio devices.");
+	}
+
+	// Start a thread for each stream.
+	std::vector<std::thread> threads;
+	for (const stream_settings_t& stream : streams) {
+		if (stream.m_is_input) {
+			printf("Starting Audio Input %s -> %s ...\n", stream.m_device.c_str(), stream.m_ndi_name.c_str());
+			threads.push_back(std::thread(process_input, &context, p_capture_devices, num_capture_devices, stream, display_stats));
+		} else {
+			printf("Starting Audio Output %s -> %s ...\n", stream.m_ndi_name.c_str(), stream.m_device.c_str());
+			threads.push_back(std::thread(process_output, &context, p_playback_devices, num_playback_devices, stream, display_stats));
+		}
 	}
 
 	// Wait for things to finish
-	if (output_thread.joinable() || input_thread.joinable()) {
+	if (!threads.empty()) {
 		char progress[] = "\r[.....................................................]";
 		const char rotate[] = { "-\\|/" };
 		for (size_t i = 0; !g_exit_process; i++) {
@@ -417,13 +825,11 @@ int main(int argc, char* argv[])
 
 		// Wait for the threads to exit.
 
-		if (output_thread.joinable())
-			output_thread.join();
-
-		if (input_thread.joinable())
-			input_thread.join();
+		for (std::thread& thread : threads)
+			thread.join();
 
 		// Finished.
+		ma_context_uninit(&context);
 		return 0;
 	}
 
@@ -433,27 +839,24 @@ int main(int argc, char* argv[])
 	puts("    or -input 1");
 	puts("    or -input default");
 	puts("    -input_name \"Some Source\"");
-	puts("    -input_gain +10dB\n");
+	puts("    -input_gain +10dB");
+	puts("    -input_period 64 (samples, default the device's)");
+	puts("    -input_latency 10 (milliseconds of audio in each NDI frame)");
+	puts("    -input_cpus 2-3 (the CPUs for the stream's threads)");
+	puts("    -input_priority 80 (real-time priority, 1-99)\n");
 	puts("       -output \"audio device name\"");
 	puts("    or -output 3");
 	puts("    or -output default");
 	puts("    -output_name \"Some Network Source\"");
-	puts("    -output_gain -15dB\n");
-
-	// Initialize a miniaudio context.
-	ma_context context;
-	if (ma_context_init(nullptr, 0, nullptr, &context) != MA_SUCCESS) {
-		puts("ERROR : Unable to initialize audio devices.");
-		return 1;
-	}
-
-	// Let's enumerate the devices.
-	ma_device_info* p_playback_devices;
-	ma_device_info* p_capture_devices;
-	ma_uint32 num_playback_devices, num_capture_devices;
-	if (ma_context_get_devices(&context, &p_playback_devices, &num_playback_devices, &p_capture_devices, &num_capture_devices) != MA_SUCCESS) {
-		puts("ERROR : Unable to enumerate audio devices.");
-	}
+	puts("    -output_gain -15dB");
+	puts("    -output_period 64 (samples, default the device's)");
+	puts("    -output_latency 20 (milliseconds of audio buffered for the device)");
+	puts("    -output_cpus 2-3 (the CPUs for the stream's threads)");
+	puts("    -output_priority 80 (real-time priority, 1-99)\n");
+	puts("    -config streams.txt (any number of streams, one per line, for example)");
+	puts("        input \"USB Audio CODEC\" \"Rack 1\" gain 6 period 64 latency 10 cpus 2 priority 80");
+	puts("        output 3 \"STUDIO (Program)\" latency 20 cpus 3");
+	puts("    -stats (display how long the audio callbacks take every 5s)\n");
 
 	// List the input devices.
 	puts("\nInput Devices:");
@@ -0,0 +1,1697 @@
+// NDI Loopback
+// ============
+//
+// This is a drop-in, in-process stand-in for libndi that implements the subset of Processing.NDI.Lib.h that is used
+// by the examples in this folder (send, receive, find, frame-sync, routing, meta-data, tally and the utility
+// functions). Senders, finders and receivers within the same process talk to each other through in-memory queues, and
+// there is no mDNS, no network and no compression. This allows the examples to be benchmarked in isolation so that the
+// numbers that you see are only the cost of the application side, and allows them to be run on offline machines.
+//
+// It is built against the real SDK header so that it is binary compatible with the examples, and it produces a library
+// with the same name as the real one so that it can just be dropped next to the example executables :
+//
+//		g++ -std=c++11 -O2 -fPIC -shared -I<NDI SDK>/include NDIlib_Loopback.cpp -o libndi.so.5 -lpthread
+//
+// On Windows it is Processing.NDI.Lib.x64.dll (or x86), built with PROCESSINGNDILIB_EXPORTS defined so that the SDK
+// header exports the functions rather than importing them :
+//
+//		cl /O2 /EHsc /LD /DPROCESSINGNDILIB_EXPORTS /I<NDI SDK>\Include NDIlib_Loopback.cpp /Fe:Processing.NDI.Lib.x64.dll
+//
+// Notes :
+//	- A frame that is sent is copied exactly once (this stands in for the compression), and it is then shared between all
+//	  receivers that are connected without any further copies. If no receivers are connected, no copy is made at all.
+//	- Video is delivered in the FourCC that it was sent in, the receiver color_format is not honored. The bandwidth is
+//	  honored only so far as audio-only and meta-data-only receivers do not get video.
+//	- The frame-sync does not resample audio, it is delivered at the sample rate it was sent with.
+//	- All sources are local, so NDIlib_find_create_t::show_local_sources, groups and extra IPs are ignored.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <Processing.NDI.Lib.h>
+
+namespace {
+
+// The clock used for all time-stamps and clocking
+typedef std::chrono::steady_clock clock_type;
+
+// The maximum number of frames of each type that we hold on a receiver before we start dropping the oldest ones.
+static const int max_queued_video = 8;
+static const int max_queued_audio = 64;
+static const int max_queued_metadata = 64;
+
+//-----------------------------------------------------------------------------------------------------------------------
+// Reference counted memory blocks. Every buffer that we hand out to the application is allocated with this header in
+// front of it, so that it can be shared between many receivers and be freed when the last one is done with it.
+struct loopback_block {
+	std::atomic<int> m_ref_count;
+};
+
+// The header is padded so that the data that follows is 64 byte aligned.
+static const size_t block_header_size = 64;
+
+uint8_t* block_alloc(const size_t size, const int ref_count)
+{
+	void* p_mem = nullptr;
+#ifdef _WIN32
+	p_mem = _aligned_malloc(block_header_size + size, 64);
+#else
+	if (posix_memalign(&p_mem, 64, block_header_size + size))
+		p_mem = nullptr;
+#endif
+	if (!p_mem)
+		return nullptr;
+
+	loopback_block* p_block = new(p_mem) loopback_block;
+	p_block->m_ref_count = ref_count;
+	return (uint8_t*)p_mem + block_header_size;
+}
+
+void block_add_ref(const void* p_data)
+{
+	if (p_data)
+		((loopback_block*)((uint8_t*)p_data - block_header_size))->m_ref_count++;
+}
+
+void block_release(const void* p_data)
+{
+	if (!p_data)
+		return;
+
+	loopback_block* p_block = (loopback_block*)((uint8_t*)p_data - block_header_size);
+	if (--p_block->m_ref_count == 0) {
+		p_block->~loopback_block();
+#ifdef _WIN32
+		_aligned_free(p_block);
+#else
+		free(p_block);
+#endif
+	}
+}
+
+// Allocate a block that holds a copy of a string
+char* block_strdup(const char* p_str, const int ref_count)
+{
+	const size_t len = strlen(p_str);
+	char* p_ret = (char*)block_alloc(len + 1, ref_count);
+	if (p_ret)
+		memcpy(p_ret, p_str, len + 1);
+	return p_ret;
+}
+
+// Get the current time in 100ns units, which is what NDI uses for time-stamps and time-codes
+int64_t time_in_100ns(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 100;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+// The size of the video data for a particular frame, including all planes.
+int video_default_stride(const NDIlib_video_frame_v2_t& frame)
+{
+	switch (frame.FourCC) {
+		case NDIlib_FourCC_type_BGRA:
+		case NDIlib_FourCC_type_BGRX:
+		case NDIlib_FourCC_type_RGBA:
+		case NDIlib_FourCC_type_RGBX:
+			return frame.xres * 4;
+
+		case NDIlib_FourCC_type_YV12:
+		case NDIlib_FourCC_type_I420:
+		case NDIlib_FourCC_type_NV12:
+			return frame.xres;
+
+		default:
+			return frame.xres * 2;
+	}
+}
+
+size_t video_frame_size(const NDIlib_video_frame_v2_t& frame, int* p_stride)
+{
+	const int stride = frame.line_stride_in_bytes ? frame.line_stride_in_bytes : video_default_stride(frame);
+	const size_t plane_size = (size_t)stride * frame.yres;
+	*p_stride = stride;
+
+	switch (frame.FourCC) {
+		// Followed by an 8bit alpha plane
+		case NDIlib_FourCC_type_UYVA:
+			return plane_size + (size_t)frame.xres * frame.yres;
+
+		// Followed by a 16bit interleaved UV plane
+		case NDIlib_FourCC_type_P216:
+			return plane_size * 2;
+
+		// Followed by a 16bit interleaved UV plane and a 16bit alpha plane
+		case NDIlib_FourCC_type_PA16:
+			return plane_size * 3;
+
+		// Followed by half height chroma
+		case NDIlib_FourCC_type_YV12:
+		case NDIlib_FourCC_type_I420:
+		case NDIlib_FourCC_type_NV12:
+			return plane_size + plane_size / 2;
+
+		default:
+			return plane_size;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+// A frame that is sitting on a receiver queue
+struct loopback_frame {
+	NDIlib_frame_type_e m_type;
+	NDIlib_video_frame_v2_t m_video;
+	NDIlib_audio_frame_v2_t m_audio;
+	NDIlib_metadata_frame_t m_metadata;
+
+	// Release the memory held by this frame
+	void release(void)
+	{
+		switch (m_type) {
+			case NDIlib_frame_type_video: block_release(m_video.p_data); break;
+			case NDIlib_frame_type_audio: block_release(m_audio.p_data); break;
+			case NDIlib_frame_type_metadata: block_release(m_metadata.p_data); break;
+			default: break;
+		}
+	}
+};
+
+struct loopback_source;
+
+//-----------------------------------------------------------------------------------------------------------------------
+// A receiver instance.
+struct loopback_recv {
+	loopback_recv(const NDIlib_recv_create_v3_t& settings)
+		: m_ref_count(1), m_bandwidth(settings.bandwidth), m_p_source(nullptr),
+		  m_queued_video(0), m_queued_audio(0), m_queued_metadata(0), m_status_changed(false)
+	{
+		if (settings.p_ndi_recv_name)
+			m_name = settings.p_ndi_recv_name;
+	}
+
+	// Receivers are reference counted since senders hold on to them for the duration of a send.
+	void add_ref(void) { m_ref_count++; }
+	void release(void) { if (--m_ref_count == 0) delete this; }
+
+	// Add a frame to the queue, dropping the oldest frame of the same type if we are too deep.
+	void push(const loopback_frame& frame);
+
+	// Take everything off the queue
+	void flush(void);
+
+	// The reference count
+	std::atomic<int> m_ref_count;
+
+	// The settings
+	std::string m_name;
+	const NDIlib_recv_bandwidth_e m_bandwidth;
+
+	// The name of the source that we want to be connected to and the source itself (protected by the global lock).
+	std::string m_source_name;
+	loopback_source* m_p_source;
+
+	// The current tally and our connection meta-data (protected by the global lock).
+	NDIlib_tally_t m_tally;
+	std::vector<std::string> m_connection_metadata;
+
+	// The queue of frames
+	std::mutex m_lock;
+	std::condition_variable m_cv;
+	std::deque<loopback_frame> m_queue;
+	int m_queued_video, m_queued_audio, m_queued_metadata;
+	bool m_status_changed;
+
+	// Performance counters
+	NDIlib_recv_performance_t m_total, m_dropped;
+
+private:
+	~loopback_recv(void) { flush(); }
+};
+
+void loopback_recv::push(const loopback_frame& frame)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	// Count the frame and see whether the queue is already at its limit
+	int* p_queued = nullptr;
+	int max_queued = 0;
+	int64_t* p_dropped = nullptr;
+	switch (frame.m_type) {
+		case NDIlib_frame_type_video:
+			m_total.video_frames++;
+			p_queued = &m_queued_video; max_queued = max_queued_video; p_dropped = &m_dropped.video_frames;
+			break;
+
+		case NDIlib_frame_type_audio:
+			m_total.audio_frames++;
+			p_queued = &m_queued_audio; max_queued = max_queued_audio; p_dropped = &m_dropped.audio_frames;
+			break;
+
+		case NDIlib_frame_type_metadata:
+			m_total.metadata_frames++;
+			p_queued = &m_queued_metadata; max_queued = max_queued_metadata; p_dropped = &m_dropped.metadata_frames;
+			break;
+
+		default:
+			return;
+	}
+
+	// Drop the oldest frame of this type, which is what a receiver that is falling behind would do
+	if (*p_queued >= max_queued) {
+		for (auto it = m_queue.begin(); it != m_queue.end(); it++) {
+			if (it->m_type == frame.m_type) {
+				it->release();
+				m_queue.erase(it);
+				(*p_queued)--;
+				(*p_dropped)++;
+				break;
+			}
+		}
+	}
+
+	// Add it to the queue
+	m_queue.push_back(frame);
+	(*p_queued)++;
+	lock.unlock();
+	m_cv.notify_all();
+}
+
+void loopback_recv::flush(void)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	for (auto& frame : m_queue)
+		frame.release();
+	m_queue.clear();
+	m_queued_video = m_queued_audio = m_queued_metadata = 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+// A source that can be found on the "network". This is either a sender or a router.
+struct loopback_source {
+	loopback_source(const char* p_ndi_name, const bool is_router);
+
+	// The name and URL that are visible to finders
+	std::string m_short_name, m_name, m_url;
+	NDIlib_source_t m_source;
+
+	// Is this a router, and if so what is it routed to (protected by the global lock)
+	const bool m_is_router;
+	std::string m_routed_to;
+
+	// The receivers connected to this source (protected by the global lock)
+	std::vector<loopback_recv*> m_receivers;
+
+	// The connection meta-data that is sent to each receiver that connects (protected by the global lock)
+	std::vector<std::string> m_connection_metadata;
+
+	// The meta-data that receivers have sent back to us
+	std::mutex m_lock;
+	std::condition_variable m_cv;
+	std::deque<std::string> m_metadata;
+};
+
+//-----------------------------------------------------------------------------------------------------------------------
+// The global state that stands in for the network. Lock ordering is always the global lock first, then a per
+// receiver or per source lock.
+std::mutex g_lock;
+std::condition_variable g_cv;
+std::vector<loopback_source*> g_sources;
+std::vector<loopback_recv*> g_receivers;
+uint64_t g_sources_generation = 0;
+std::atomic<int> g_source_no(0);
+
+std::string host_name(void)
+{
+	char name[256] = { 0 };
+#ifdef _WIN32
+	const char* p_name = getenv("COMPUTERNAME");
+	if (p_name)
+		strncpy(name, p_name, sizeof(name) - 1);
+#else
+	gethostname(name, sizeof(name) - 1);
+#endif
+	std::string ret = name[0] ? name : "LOOPBACK";
+	for (auto& ch : ret)
+		ch = (char)toupper((unsigned char)ch);
+	return ret;
+}
+
+loopback_source::loopback_source(const char* p_ndi_name, const bool is_router)
+	: m_is_router(is_router)
+{
+	const int source_no = ++g_source_no;
+
+	// Build the names in the same way that NDI does, "MACHINE (name)"
+	char default_name[64];
+	snprintf(default_name, sizeof(default_name), "Source %d", source_no);
+	m_short_name = (p_ndi_name && *p_ndi_name) ? p_ndi_name : default_name;
+	m_name = host_name() + " (" + m_short_name + ")";
+
+	char url[64];
+	snprintf(url, sizeof(url), "127.0.0.1:%d", 5960 + source_no);
+	m_url = url;
+
+	m_source.p_ndi_name = m_name.c_str();
+	m_source.p_url_address = m_url.c_str();
+}
+
+// Does a source name match this source. We accept both the full name and just the name that was given to the sender.
+bool source_matches(const loopback_source* p_source, const std::string& name)
+{
+	return !name.empty() && (name == p_source->m_name || name == p_source->m_short_name);
+}
+
+// Connect a receiver to a source. The global lock must be held.
+void connect_locked(loopback_recv* p_recv, loopback_source* p_source)
+{
+	p_recv->m_p_source = p_source;
+	p_source->m_receivers.push_back(p_recv);
+
+	// The receiver gets the connection meta-data from the sender
+	for (const auto& metadata : p_source->m_connection_metadata) {
+		loopback_frame frame;
+		frame.m_type = NDIlib_frame_type_metadata;
+		frame.m_metadata.p_data = block_strdup(metadata.c_str(), 1);
+		frame.m_metadata.length = (int)metadata.size();
+		frame.m_metadata.timecode = time_in_100ns();
+		p_recv->push(frame);
+	}
+
+	// And the sender gets the connection meta-data from the receiver
+	{	std::unique_lock<std::mutex> lock(p_source->m_lock);
+		for (const auto& metadata : p_recv->m_connection_metadata)
+			p_source->m_metadata.push_back(metadata);
+	}
+	p_source->m_cv.notify_all();
+
+	// Let the receiver know that something changed
+	{	std::unique_lock<std::mutex> lock(p_recv->m_lock);
+		p_recv->m_status_changed = true;
+	}
+	p_recv->m_cv.notify_all();
+}
+
+// Disconnect a receiver from its source. The global lock must be held.
+void disconnect_locked(loopback_recv* p_recv)
+{
+	if (!p_recv->m_p_source)
+		return;
+
+	auto& receivers = p_recv->m_p_source->m_receivers;
+	receivers.erase(std::remove(receivers.begin(), receivers.end(), p_recv), receivers.end());
+	p_recv->m_p_source = nullptr;
+}
+
+// Add a source to the list of sources, and connect any receivers that were waiting for it.
+void add_source(loopback_source* p_source)
+{
+	std::unique_lock<std::mutex> lock(g_lock);
+	g_sources.push_back(p_source);
+	g_sources_generation++;
+
+	for (auto p_recv : g_receivers) {
+		if (!p_recv->m_p_source && source_matches(p_source, p_recv->m_source_name))
+			connect_locked(p_recv, p_source);
+	}
+
+	lock.unlock();
+	g_cv.notify_all();
+}
+
+// Remove a source from the list of sources. Receivers stay waiting for it in case it comes back.
+void remove_source(loopback_source* p_source)
+{
+	std::unique_lock<std::mutex> lock(g_lock);
+	g_sources.erase(std::remove(g_sources.begin(), g_sources.end(), p_source), g_sources.end());
+	g_sources_generation++;
+
+	while (!p_source->m_receivers.empty())
+		disconnect_locked(p_source->m_receivers.back());
+
+	lock.unlock();
+	g_cv.notify_all();
+}
+
+// Get all of the receivers that are currently watching a source, including those watching it through a router. Each
+// receiver that is returned has had a reference added to it.
+void collect_receivers(const loopback_source* p_source, std::vector<loopback_recv*>& receivers)
+{
+	receivers.clear();
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	for (auto p_recv : p_source->m_receivers) {
+		p_recv->add_ref();
+		receivers.push_back(p_recv);
+	}
+
+	for (auto p_router : g_sources) {
+		if (!p_router->m_is_router || !source_matches(p_source, p_router->m_routed_to))
+			continue;
+
+		for (auto p_recv : p_router->m_receivers) {
+			p_recv->add_ref();
+			receivers.push_back(p_recv);
+		}
+	}
+}
+
+void release_receivers(std::vector<loopback_recv*>& receivers)
+{
+	for (auto p_recv : receivers)
+		p_recv->release();
+	receivers.clear();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+// Clocking for a sender, which sleeps until it is time for the next frame.
+struct loopback_clock {
+	loopback_clock(void) : m_started(false) {}
+
+	void wait(const clock_type::duration frame_duration)
+	{
+		const auto now = clock_type::now();
+
+		// If this is the first frame, or we have fallen more than a frame behind, then we restart the clock.
+		if (!m_started || (now > m_next_time + frame_duration)) {
+			m_next_time = now;
+			m_started = true;
+		}
+
+		m_next_time += frame_duration;
+		std::this_thread::sleep_until(m_next_time);
+	}
+
+	bool m_started;
+	clock_type::time_point m_next_time;
+};
+
+//-----------------------------------------------------------------------------------------------------------------------
+// A sender instance
+struct loopback_send {
+	loopback_send(const NDIlib_send_create_t& settings)
+		: m_source(settings.p_ndi_name, false), m_clock_video(settings.clock_video), m_clock_audio(settings.clock_audio)
+	{
+	}
+
+	void send_video(const NDIlib_video_frame_v2_t& video_frame);
+	void send_audio(const NDIlib_audio_frame_v2_t& audio_frame);
+	void send_metadata(const NDIlib_metadata_frame_t& metadata_frame);
+
+	// The source that we are visible as
+	loopback_source m_source;
+
+	// The clocking
+	const bool m_clock_video, m_clock_audio;
+	loopback_clock m_video_clock, m_audio_clock;
+
+	// The last tally that was reported to the caller
+	NDIlib_tally_t m_last_tally;
+
+	// Scratch space so that we do not allocate on every frame. A sender is only ever used from one thread at a time.
+	std::vector<loopback_recv*> m_receivers;
+};
+
+void loopback_send::send_video(const NDIlib_video_frame_v2_t& video_frame)
+{
+	// Who is going to get this
+	collect_receivers(&m_source, m_receivers);
+
+	// Audio-only and meta-data only receivers do not get video
+	m_receivers.erase(std::remove_if(m_receivers.begin(), m_receivers.end(), [](loopback_recv* p_recv) {
+		if ((p_recv->m_bandwidth == NDIlib_recv_bandwidth_audio_only) || (p_recv->m_bandwidth == NDIlib_recv_bandwidth_metadata_only)) {
+			p_recv->release();
+			return true;
+		}
+		return false;
+	}), m_receivers.end());
+
+	// If there is nobody watching we do not even need a copy
+	if (!m_receivers.empty() && video_frame.p_data) {
+		// Make the one copy of the frame that all receivers will share
+		int stride = 0;
+		const size_t data_size = video_frame_size(video_frame, &stride);
+		const size_t metadata_size = video_frame.p_metadata ? strlen(video_frame.p_metadata) + 1 : 0;
+		uint8_t* p_data = block_alloc(data_size + metadata_size, (int)m_receivers.size());
+
+		if (p_data) {
+			memcpy(p_data, video_frame.p_data, data_size);
+			if (metadata_size)
+				memcpy(p_data + data_size, video_frame.p_metadata, metadata_size);
+
+			loopback_frame frame;
+			frame.m_type = NDIlib_frame_type_video;
+			frame.m_video = video_frame;
+			frame.m_video.p_data = p_data;
+			frame.m_video.line_stride_in_bytes = stride;
+			frame.m_video.p_metadata = metadata_size ? (const char*)(p_data + data_size) : nullptr;
+			frame.m_video.timestamp = time_in_100ns();
+			if (frame.m_video.timecode == NDIlib_send_timecode_synthesize)
+				frame.m_video.timecode = frame.m_video.timestamp;
+
+			for (auto p_recv : m_receivers)
+				p_recv->push(frame);
+		}
+	}
+
+	release_receivers(m_receivers);
+
+	// Clock the video if needed
+	if (m_clock_video && video_frame.frame_rate_N > 0 && video_frame.frame_rate_D > 0) {
+		m_video_clock.wait(std::chrono::duration_cast<clock_type::duration>(
+			std::chrono::nanoseconds((int64_t)1000000000 * video_frame.frame_rate_D / video_frame.frame_rate_N)));
+	}
+}
+
+void loopback_send::send_audio(const NDIlib_audio_frame_v2_t& audio_frame)
+{
+	collect_receivers(&m_source, m_receivers);
+
+	// Meta-data only receivers do not get audio
+	m_receivers.erase(std::remove_if(m_receivers.begin(), m_receivers.end(), [](loopback_recv* p_recv) {
+		if (p_recv->m_bandwidth == NDIlib_recv_bandwidth_metadata_only) {
+			p_recv->release();
+			return true;
+		}
+		return false;
+	}), m_receivers.end());
+
+	if (!m_receivers.empty() && audio_frame.p_data && audio_frame.no_samples > 0 && audio_frame.no_channels > 0) {
+		// We always deliver the channels tightly packed
+		const size_t channel_size = sizeof(float) * audio_frame.no_samples;
+		const size_t metadata_size = audio_frame.p_metadata ? strlen(audio_frame.p_metadata) + 1 : 0;
+		uint8_t* p_data = block_alloc(channel_size * audio_frame.no_channels + metadata_size, (int)m_receivers.size());
+
+		if (p_data) {
+			const int src_stride = audio_frame.channel_stride_in_bytes ? audio_frame.channel_stride_in_bytes : (int)channel_size;
+			for (int ch = 0; ch < audio_frame.no_channels; ch++)
+				memcpy(p_data + ch * channel_size, (const uint8_t*)audio_frame.p_data + ch * src_stride, channel_size);
+			if (metadata_size)
+				memcpy(p_data + channel_size * audio_frame.no_channels, audio_frame.p_metadata, metadata_size);
+
+			loopback_frame frame;
+			frame.m_type = NDIlib_frame_type_audio;
+			frame.m_audio = audio_frame;
+			frame.m_audio.p_data = (float*)p_data;
+			frame.m_audio.channel_stride_in_bytes = (int)channel_size;
+			frame.m_audio.p_metadata = metadata_size ? (const char*)(p_data + channel_size * audio_frame.no_channels) : nullptr;
+			frame.m_audio.timestamp = time_in_100ns();
+			if (frame.m_audio.timecode == NDIlib_send_timecode_synthesize)
+				frame.m_audio.timecode = frame.m_audio.timestamp;
+
+			for (auto p_recv : m_receivers)
+				p_recv->push(frame);
+		}
+	}
+
+	release_receivers(m_receivers);
+
+	// When video is clocked it drives the timing, otherwise we clock on the audio if asked to.
+	if (m_clock_audio && !m_clock_video && audio_frame.sample_rate > 0) {
+		m_audio_clock.wait(std::chrono::duration_cast<clock_type::duration>(
+			std::chrono::nanoseconds((int64_t)1000000000 * audio_frame.no_samples / audio_frame.sample_rate)));
+	}
+}
+
+void loopback_send::send_metadata(const NDIlib_metadata_frame_t& metadata_frame)
+{
+	if (!metadata_frame.p_data)
+		return;
+
+	collect_receivers(&m_source, m_receivers);
+
+	if (!m_receivers.empty()) {
+		loopback_frame frame;
+		frame.m_type = NDIlib_frame_type_metadata;
+		frame.m_metadata.p_data = block_strdup(metadata_frame.p_data, (int)m_receivers.size());
+		frame.m_metadata.length = (int)strlen(metadata_frame.p_data);
+		frame.m_metadata.timecode = (metadata_frame.timecode == NDIlib_send_timecode_synthesize) ? time_in_100ns() : metadata_frame.timecode;
+
+		if (frame.m_metadata.p_data) {
+			for (auto p_recv : m_receivers)
+				p_recv->push(frame);
+		}
+	}
+
+	release_receivers(m_receivers);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+// A router instance, which is just a source that forwards another source
+struct loopback_routing {
+	loopback_routing(const NDIlib_routing_create_t& settings)
+		: m_source(settings.p_ndi_name, true)
+	{
+	}
+
+	loopback_source m_source;
+};
+
+//-----------------------------------------------------------------------------------------------------------------------
+// A finder instance
+struct loopback_find {
+	loopback_find(void) : m_generation((uint64_t)-1) {}
+
+	// The generation of the source list that the caller last saw
+	uint64_t m_generation;
+
+	// The current list of sources, which remains valid until the next call
+	std::vector<std::string> m_names, m_urls;
+	std::vector<NDIlib_source_t> m_sources;
+};
+
+//-----------------------------------------------------------------------------------------------------------------------
+// A frame-sync instance. This takes the frames directly off the receiver queue, holds on to the most recent video
+// frame and keeps a FIFO of audio samples.
+struct loopback_framesync {
+	loopback_framesync(loopback_recv* p_recv)
+		: m_p_recv(p_recv), m_last_video(), m_audio_sample_rate(0), m_audio_no_channels(0), m_audio_read_pos(0)
+	{
+		m_last_video.p_data = nullptr;
+	}
+
+	~loopback_framesync(void)
+	{
+		block_release(m_last_video.p_data);
+	}
+
+	// Take the video and audio frames off the receiver queue. Meta-data is left for NDIlib_recv_capture_v2.
+	void pull(void);
+
+	// The number of samples currently in the audio FIFO
+	int audio_samples(void) const
+	{
+		return m_audio.empty() ? 0 : (int)(m_audio[0].size() - m_audio_read_pos);
+	}
+
+	loopback_recv* m_p_recv;
+
+	// Protects everything below, since video and audio may be captured from different threads
+	std::mutex m_lock;
+
+	// The most recent video frame
+	NDIlib_video_frame_v2_t m_last_video;
+
+	// The audio FIFO, one vector for each channel.
+	int m_audio_sample_rate, m_audio_no_channels;
+	std::vector<std::vector<float>> m_audio;
+	size_t m_audio_read_pos;
+};
+
+void loopback_framesync::pull(void)
+{
+	std::unique_lock<std::mutex> lock(m_p_recv->m_lock);
+
+	for (auto it = m_p_recv->m_queue.begin(); it != m_p_recv->m_queue.end();) {
+		if (it->m_type == NDIlib_frame_type_video) {
+			// Replace the last video frame
+			block_release(m_last_video.p_data);
+			m_last_video = it->m_video;
+			m_p_recv->m_queued_video--;
+		} else if (it->m_type == NDIlib_frame_type_audio) {
+			const NDIlib_audio_frame_v2_t& audio = it->m_audio;
+
+			// If the format changed we start again
+			if ((audio.sample_rate != m_audio_sample_rate) || (audio.no_channels != m_audio_no_channels)) {
+				m_audio_sample_rate = audio.sample_rate;
+				m_audio_no_channels = audio.no_channels;
+				m_audio.assign(audio.no_channels, std::vector<float>());
+				m_audio_read_pos = 0;
+			}
+
+			// Compact the FIFO once we have consumed more than half of it
+			if (m_audio_read_pos && (m_audio_read_pos * 2 > m_audio[0].size())) {
+				for (auto& channel : m_audio)
+					channel.erase(channel.begin(), channel.begin() + m_audio_read_pos);
+				m_audio_read_pos = 0;
+			}
+
+			// Append the samples
+			for (int ch = 0; ch < audio.no_channels; ch++) {
+				const float* p_src = (const float*)((const uint8_t*)audio.p_data + ch * audio.channel_stride_in_bytes);
+				m_audio[ch].insert(m_audio[ch].end(), p_src, p_src + audio.no_samples);
+			}
+
+			// We never keep more than one second of audio around
+			if (audio_samples() > m_audio_sample_rate)
+				m_audio_read_pos = m_audio[0].size() - m_audio_sample_rate;
+
+			block_release(audio.p_data);
+			m_p_recv->m_queued_audio--;
+		} else {
+			it++;
+			continue;
+		}
+
+		it = m_p_recv->m_queue.erase(it);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+// Wait on a condition variable with an NDI style timeout in milliseconds.
+template<typename predicate_type>
+bool wait_for(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, const uint32_t timeout_in_ms, predicate_type predicate)
+{
+	return cv.wait_for(lock, std::chrono::milliseconds(timeout_in_ms), predicate);
+}
+
+// Find an attribute value inside an XML string. This is not a real XML parser, but is sufficient for the connection
+// meta-data that senders register.
+bool find_attribute(const std::string& xml, const char* p_element, const char* p_attribute, std::string& value)
+{
+	const size_t element_pos = xml.find(p_element);
+	if (element_pos == std::string::npos)
+		return false;
+
+	const std::string attribute = std::string(p_attribute) + "=\"";
+	const size_t attribute_pos = xml.find(attribute, element_pos);
+	if (attribute_pos == std::string::npos)
+		return false;
+
+	const size_t value_pos = attribute_pos + attribute.size();
+	const size_t end_pos = xml.find('"', value_pos);
+	if (end_pos == std::string::npos)
+		return false;
+
+	value = xml.substr(value_pos, end_pos - value_pos);
+	return true;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------------------------------------------------
+// Library
+bool NDIlib_initialize(void)
+{
+	return true;
+}
+
+void NDIlib_destroy(void)
+{
+}
+
+const char* NDIlib_version(void)
+{
+	return "NDI Loopback 5.0";
+}
+
+bool NDIlib_is_supported_CPU(void)
+{
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+// Find
+NDIlib_find_instance_t NDIlib_find_create_v2(const NDIlib_find_create_t* p_create_settings)
+{
+	(void)p_create_settings;
+	return (NDIlib_find_instance_t)new loopback_find;
+}
+
+void NDIlib_find_destroy(NDIlib_find_instance_t p_instance)
+{
+	delete (loopback_find*)p_instance;
+}
+
+const NDIlib_source_t* NDIlib_find_get_current_sources(NDIlib_find_instance_t p_instance, uint32_t* p_no_sources)
+{
+	loopback_find* p_find = (loopback_find*)p_instance;
+	if (!p_find) {
+		if (p_no_sources)
+			*p_no_sources = 0;
+		return nullptr;
+	}
+
+	// Take a snapshot of the current sources
+	std::unique_lock<std::mutex> lock(g_lock);
+	p_find->m_generation = g_sources_generation;
+	p_find->m_names.clear();
+	p_find->m_urls.clear();
+	for (auto p_source : g_sources) {
+		p_find->m_names.push_back(p_source->m_name);
+		p_find->m_urls.push_back(p_source->m_url);
+	}
+	lock.unlock();
+
+	// We only fill these in now that the vectors are no longer being resized.
+	p_find->m_sources.resize(p_find->m_names.size());
+	for (size_t i = 0; i < p_find->m_sources.size(); i++) {
+		p_find->m_sources[i].p_ndi_name = p_find->m_names[i].c_str();
+		p_find->m_sources[i].p_url_address = p_find->m_urls[i].c_str();
+	}
+
+	if (p_no_sources)
+		*p_no_sources = (uint32_t)p_find->m_sources.size();
+	return p_find->m_sources.empty() ? nullptr : p_find->m_sources.data();
+}
+
+bool NDIlib_find_wait_for_sources(NDIlib_find_instance_t p_instance, uint32_t timeout_in_ms)
+{
+	loopback_find* p_find = (loopback_find*)p_instance;
+	if (!p_find)
+		return false;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	return wait_for(g_cv, lock, timeout_in_ms, [p_find] { return p_find->m_generation != g_sources_generation; });
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+// Receive
+NDIlib_recv_instance_t NDIlib_recv_create_v3(const NDIlib_recv_create_v3_t* p_create_settings)
+{
+	const NDIlib_recv_create_v3_t default_settings;
+	loopback_recv* p_recv = new loopback_recv(p_create_settings ? *p_create_settings : default_settings);
+
+	{	std::unique_lock<std::mutex> lock(g_lock);
+		g_receivers.push_back(p_recv);
+	}
+
+	// Connect if we were given a source
+	if (p_create_settings && p_create_settings->source_to_connect_to.p_ndi_name)
+		NDIlib_recv_connect((NDIlib_recv_instance_t)p_recv, &p_create_settings->source_to_connect_to);
+
+	return (NDIlib_recv_instance_t)p_recv;
+}
+
+void NDIlib_recv_destroy(NDIlib_recv_instance_t p_instance)
+{
+	loopback_recv* p_recv = (loopback_recv*)p_instance;
+	if (!p_recv)
+		return;
+
+	{	std::unique_lock<std::mutex> lock(g_lock);
+		disconnect_locked(p_recv);
+		g_receivers.erase(std::remove(g_receivers.begin(), g_receivers.end(), p_recv), g_receivers.end());
+	}
+	g_cv.notify_all();
+
+	// Senders might still be holding on to this receiver, it is deleted when they are done with it
+	p_recv->release();
+}
+
+void NDIlib_recv_connect(NDIlib_recv_instance_t p_instance, const NDIlib_source_t* p_src)
+{
+	loopback_recv* p_recv = (loopback_recv*)p_instance;
+	if (!p_recv)
+		return;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	disconnect_locked(p_recv);
+	p_recv->m_source_name = (p_src && p_src->p_ndi_name) ? p_src->p_ndi_name : "";
+
+	for (auto p_source : g_sources) {
+		if (source_matches(p_source, p_recv->m_source_name)) {
+			connect_locked(p_recv, p_source);
+			break;
+		}
+	}
+
+	lock.unlock();
+	g_cv.notify_all();
+}
+
+NDIlib_frame_type_e NDIlib_recv_capture_v2(NDIlib_recv_instance_t p_instance, NDIlib_video_frame_v2_t* p_video_data, NDIlib_audio_frame_v2_t* p_audio_data, NDIlib_metadata_frame_t* p_metadata, uint32_t timeout_in_ms)
+{
+	loopback_recv* p_recv = (loopback_recv*)p_instance;
+	if (!p_recv)
+		return NDIlib_frame_type_error;
+
+	const auto timeout_time = clock_type::now() + std::chrono::milliseconds(timeout_in_ms);
+	std::unique_lock<std::mutex> lock(p_recv->m_lock);
+	for (;;) {
+		// Status changes are reported first
+		if (p_recv->m_status_changed) {
+			p_recv->m_status_changed = false;
+			return NDIlib_frame_type_status_change;
+		}
+
+		// Take frames off the queue. Frames of a type that the caller did not ask for are discarded.
+		while (!p_recv->m_queue.empty()) {
+			loopback_frame frame = p_recv->m_queue.front();
+			p_recv->m_queue.pop_front();
+
+			switch (frame.m_type) {
+				case NDIlib_frame_type_video:
+					p_recv->m_queued_video--;
+					if (p_video_data) {
+						*p_video_data = frame.m_video;
+						return NDIlib_frame_type_video;
+					}
+					break;
+
+				case NDIlib_frame_type_audio:
+					p_recv->m_queued_audio--;
+					if (p_audio_data) {
+						*p_audio_data = frame.m_audio;
+						return NDIlib_frame_type_audio;
+					}
+					break;
+
+				case NDIlib_frame_type_metadata:
+					p_recv->m_queued_metadata--;
+					if (p_metadata) {
+						*p_metadata = frame.m_metadata;
+						return NDIlib_frame_type_metadata;
+					}
+					break;
+
+				default:
+					break;
+			}
+
+			frame.release();
+		}
+
+		// Wait for something to arrive
+		if (p_recv->m_cv.wait_until(lock, timeout_time) == std::cv_status::timeout) {
+			if (p_recv->m_queue.empty() && !p_recv->m_status_changed)
+				return NDIlib_frame_type_none;
+		}
+	}
+}
+
+void NDIlib_recv_free_video_v2(NDIlib_recv_instance_t p_instance, const NDIlib_video_frame_v2_t* p_video_data)
+{
+	(void)p_instance;
+	if (p_video_data)
+		block_release(p_video_data->p_data);
+}
+
+void NDIlib_recv_free_audio_v2(NDIlib_recv_instance_t p_instance, const NDIlib_audio_frame_v2_t* p_audio_data)
+{
+	(void)p_instance;
+	if (p_audio_data)
+		block_release(p_audio_data->p_data);
+}
+
+void NDIlib_recv_free_metadata(NDIlib_recv_instance_t p_instance, const NDIlib_metadata_frame_t* p_metadata)
+{
+	(void)p_instance;
+	if (p_metadata)
+		block_release(p_metadata->p_data);
+}
+
+void NDIlib_recv_free_string(NDIlib_recv_instance_t p_instance, const char* p_string)
+{
+	(void)p_instance;
+	block_release(p_string);
+}
+
+bool NDIlib_recv_send_metadata(NDIlib_recv_instance_t p_instance, const NDIlib_metadata_frame_t* p_metadata)
+{
+	loopback_recv* p_recv = (loopback_recv*)p_instance;
+	if (!p_recv || !p_metadata || !p_metadata->p_data)
+		return false;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	loopback_source* p_source = p_recv->m_p_source;
+	if (!p_source)
+		return false;
+
+	{	std::unique_lock<std::mutex> source_lock(p_source->m_lock);
+		p_source->m_metadata.push_back(p_metadata->p_data);
+	}
+	p_source->m_cv.notify_all();
+	return true;
+}
+
+bool NDIlib_recv_set_tally(NDIlib_recv_instance_t p_instance, const NDIlib_tally_t* p_tally)
+{
+	loopback_recv* p_recv = (loopback_recv*)p_instance;
+	if (!p_recv || !p_tally)
+		return false;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	p_recv->m_tally = *p_tally;
+	const bool connected = (p_recv->m_p_source != nullptr);
+	lock.unlock();
+	g_cv.notify_all();
+
+	return connected;
+}
+
+void NDIlib_recv_get_performance(NDIlib_recv_instance_t p_instance, NDIlib_recv_performance_t* p_total, NDIlib_recv_performance_t* p_dropped)
+{
+	loopback_recv* p_recv = (loopback_recv*)p_instance;
+	if (!p_recv)
+		return;
+
+	std::unique_lock<std::mutex> lock(p_recv->m_lock);
+	if (p_total)
+		*p_total = p_recv->m_total;
+	if (p_dropped)
+		*p_dropped = p_recv->m_dropped;
+}
+
+void NDIlib_recv_get_queue(NDIlib_recv_instance_t p_instance, NDIlib_recv_queue_t* p_total)
+{
+	loopback_recv* p_recv = (loopback_recv*)p_instance;
+	if (!p_recv || !p_total)
+		return;
+
+	std::unique_lock<std::mutex> lock(p_recv->m_lock);
+	p_total->video_frames = p_recv->m_queued_video;
+	p_total->audio_frames = p_recv->m_queued_audio;
+	p_total->metadata_frames = p_recv->m_queued_metadata;
+}
+
+void NDIlib_recv_clear_connection_metadata(NDIlib_recv_instance_t p_instance)
+{
+	loopback_recv* p_recv = (loopback_recv*)p_instance;
+	if (!p_recv)
+		return;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	p_recv->m_connection_metadata.clear();
+}
+
+void NDIlib_recv_add_connection_metadata(NDIlib_recv_instance_t p_instance, const NDIlib_metadata_frame_t* p_metadata)
+{
+	loopback_recv* p_recv = (loopback_recv*)p_instance;
+	if (!p_recv || !p_metadata || !p_metadata->p_data)
+		return;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	p_recv->m_connection_metadata.push_back(p_metadata->p_data);
+}
+
+int NDIlib_recv_get_no_connections(NDIlib_recv_instance_t p_instance)
+{
+	loopback_recv* p_recv = (loopback_recv*)p_instance;
+	if (!p_recv)
+		return 0;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	return p_recv->m_p_source ? 1 : 0;
+}
+
+const char* NDIlib_recv_get_web_control(NDIlib_recv_instance_t p_instance)
+{
+	loopback_recv* p_recv = (loopback_recv*)p_instance;
+	if (!p_recv)
+		return nullptr;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	if (!p_recv->m_p_source)
+		return nullptr;
+
+	// Look for the web control in the connection meta-data of the sender
+	std::string url;
+	for (const auto& metadata : p_recv->m_p_source->m_connection_metadata) {
+		if (find_attribute(metadata, "<ndi_capabilities", "web_control", url))
+			break;
+	}
+	lock.unlock();
+
+	if (url.empty())
+		return nullptr;
+
+	// Everything is on this machine
+	const size_t ip_pos = url.find("%IP%");
+	if (ip_pos != std::string::npos)
+		url.replace(ip_pos, 4, "127.0.0.1");
+
+	return block_strdup(url.c_str(), 1);
+}
+
+bool NDIlib_recv_ptz_is_supported(NDIlib_recv_instance_t p_instance)
+{
+	loopback_recv* p_recv = (loopback_recv*)p_instance;
+	if (!p_recv)
+		return false;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	if (!p_recv->m_p_source)
+		return false;
+
+	std::string value;
+	for (const auto& metadata : p_recv->m_p_source->m_connection_metadata) {
+		if (find_attribute(metadata, "<ndi_capabilities", "ntk_ptz", value))
+			return value == "true";
+	}
+
+	return false;
+}
+
+bool NDIlib_recv_ptz_recall_preset(NDIlib_recv_instance_t p_instance, const int preset_no, const float speed)
+{
+	// PTZ commands are just meta-data that is sent to the source
+	char ptz_command[128];
+	snprintf(ptz_command, sizeof(ptz_command), "<ntk_ptz_recall_preset index=\"%d\" speed=\"%f\"/>", preset_no, speed);
+
+	NDIlib_metadata_frame_t metadata;
+	metadata.p_data = ptz_command;
+	return NDIlib_recv_send_metadata(p_instance, &metadata);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+// Send
+NDIlib_send_instance_t NDIlib_send_create(const NDIlib_send_create_t* p_create_settings)
+{
+	const NDIlib_send_create_t default_settings;
+	loopback_send* p_send = new loopback_send(p_create_settings ? *p_create_settings : default_settings);
+	add_source(&p_send->m_source);
+	return (NDIlib_send_instance_t)p_send;
+}
+
+void NDIlib_send_destroy(NDIlib_send_instance_t p_instance)
+{
+	loopback_send* p_send = (loopback_send*)p_instance;
+	if (!p_send)
+		return;
+
+	remove_source(&p_send->m_source);
+	delete p_send;
+}
+
+void NDIlib_send_send_video_v2(NDIlib_send_instance_t p_instance, const NDIlib_video_frame_v2_t* p_video_data)
+{
+	loopback_send* p_send = (loopback_send*)p_instance;
+	if (p_send && p_video_data)
+		p_send->send_video(*p_video_data);
+}
+
+void NDIlib_send_send_video_async_v2(NDIlib_send_instance_t p_instance, const NDIlib_video_frame_v2_t* p_video_data)
+{
+	// The frame is always copied before we return, so the buffer is released even sooner than the SDK promises and a
+	// NULL frame (which is used to synchronize) has nothing to do.
+	NDIlib_send_send_video_v2(p_instance, p_video_data);
+}
+
+void NDIlib_send_send_audio_v2(NDIlib_send_instance_t p_instance, const NDIlib_audio_frame_v2_t* p_audio_data)
+{
+	loopback_send* p_send = (loopback_send*)p_instance;
+	if (p_send && p_audio_data)
+		p_send->send_audio(*p_audio_data);
+}
+
+void NDIlib_send_send_metadata(NDIlib_send_instance_t p_instance, const NDIlib_metadata_frame_t* p_metadata)
+{
+	loopback_send* p_send = (loopback_send*)p_instance;
+	if (p_send && p_metadata)
+		p_send->send_metadata(*p_metadata);
+}
+
+NDIlib_frame_type_e NDIlib_send_capture(NDIlib_send_instance_t p_instance, NDIlib_metadata_frame_t* p_metadata, uint32_t timeout_in_ms)
+{
+	loopback_send* p_send = (loopback_send*)p_instance;
+	if (!p_send || !p_metadata)
+		return NDIlib_frame_type_error;
+
+	loopback_source& source = p_send->m_source;
+	std::unique_lock<std::mutex> lock(source.m_lock);
+	if (!wait_for(source.m_cv, lock, timeout_in_ms, [&source] { return !source.m_metadata.empty(); }))
+		return NDIlib_frame_type_none;
+
+	const std::string& metadata = source.m_metadata.front();
+	p_metadata->p_data = block_strdup(metadata.c_str(), 1);
+	p_metadata->length = (int)metadata.size();
+	p_metadata->timecode = time_in_100ns();
+	source.m_metadata.pop_front();
+
+	return p_metadata->p_data ? NDIlib_frame_type_metadata : NDIlib_frame_type_none;
+}
+
+void NDIlib_send_free_metadata(NDIlib_send_instance_t p_instance, const NDIlib_metadata_frame_t* p_metadata)
+{
+	(void)p_instance;
+	if (p_metadata)
+		block_release(p_metadata->p_data);
+}
+
+bool NDIlib_send_get_tally(NDIlib_send_instance_t p_instance, NDIlib_tally_t* p_tally, uint32_t timeout_in_ms)
+{
+	loopback_send* p_send = (loopback_send*)p_instance;
+	if (!p_send)
+		return false;
+
+	// The tally is the combination of all connected receivers
+	const auto current_tally = [p_send](void) {
+		NDIlib_tally_t tally;
+		for (auto p_recv : p_send->m_source.m_receivers) {
+			tally.on_program |= p_recv->m_tally.on_program;
+			tally.on_preview |= p_recv->m_tally.on_preview;
+		}
+		return tally;
+	};
+
+	// Wait for the tally to change
+	std::unique_lock<std::mutex> lock(g_lock);
+	const bool changed = wait_for(g_cv, lock, timeout_in_ms, [&] {
+		const NDIlib_tally_t tally = current_tally();
+		return (tally.on_program != p_send->m_last_tally.on_program) || (tally.on_preview != p_send->m_last_tally.on_preview);
+	});
+
+	p_send->m_last_tally = current_tally();
+	if (p_tally)
+		*p_tally = p_send->m_last_tally;
+
+	return changed;
+}
+
+int NDIlib_send_get_no_connections(NDIlib_send_instance_t p_instance, uint32_t timeout_in_ms)
+{
+	loopback_send* p_send = (loopback_send*)p_instance;
+	if (!p_send)
+		return 0;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	wait_for(g_cv, lock, timeout_in_ms, [p_send] { return !p_send->m_source.m_receivers.empty(); });
+	return (int)p_send->m_source.m_receivers.size();
+}
+
+void NDIlib_send_clear_connection_metadata(NDIlib_send_instance_t p_instance)
+{
+	loopback_send* p_send = (loopback_send*)p_instance;
+	if (!p_send)
+		return;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	p_send->m_source.m_connection_metadata.clear();
+}
+
+void NDIlib_send_add_connection_metadata(NDIlib_send_instance_t p_instance, const NDIlib_metadata_frame_t* p_metadata)
+{
+	loopback_send* p_send = (loopback_send*)p_instance;
+	if (!p_send || !p_metadata || !p_metadata->p_data)
+		return;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	p_send->m_source.m_connection_metadata.push_back(p_metadata->p_data);
+
+	// Receivers that are already connected see this as a status change
+	for (auto p_recv : p_send->m_source.m_receivers) {
+		{	std::unique_lock<std::mutex> recv_lock(p_recv->m_lock);
+			p_recv->m_status_changed = true;
+		}
+		p_recv->m_cv.notify_all();
+	}
+}
+
+void NDIlib_send_set_failover(NDIlib_send_instance_t p_instance, const NDIlib_source_t* p_failover_source)
+{
+	// There is no failure to fail over from
+	(void)p_instance;
+	(void)p_failover_source;
+}
+
+const NDIlib_source_t* NDIlib_send_get_source_name(NDIlib_send_instance_t p_instance)
+{
+	loopback_send* p_send = (loopback_send*)p_instance;
+	return p_send ? &p_send->m_source.m_source : nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+// Routing
+NDIlib_routing_instance_t NDIlib_routing_create(const NDIlib_routing_create_t* p_create_settings)
+{
+	const NDIlib_routing_create_t default_settings;
+	loopback_routing* p_routing = new loopback_routing(p_create_settings ? *p_create_settings : default_settings);
+	add_source(&p_routing->m_source);
+	return (NDIlib_routing_instance_t)p_routing;
+}
+
+void NDIlib_routing_destroy(NDIlib_routing_instance_t p_instance)
+{
+	loopback_routing* p_routing = (loopback_routing*)p_instance;
+	if (!p_routing)
+		return;
+
+	remove_source(&p_routing->m_source);
+	delete p_routing;
+}
+
+bool NDIlib_routing_change(NDIlib_routing_instance_t p_instance, const NDIlib_source_t* p_source)
+{
+	loopback_routing* p_routing = (loopback_routing*)p_instance;
+	if (!p_routing)
+		return false;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	p_routing->m_source.m_routed_to = (p_source && p_source->p_ndi_name) ? p_source->p_ndi_name : "";
+	return true;
+}
+
+bool NDIlib_routing_clear(NDIlib_routing_instance_t p_instance)
+{
+	return NDIlib_routing_change(p_instance, nullptr);
+}
+
+int NDIlib_routing_get_no_connections(NDIlib_routing_instance_t p_instance, uint32_t timeout_in_ms)
+{
+	loopback_routing* p_routing = (loopback_routing*)p_instance;
+	if (!p_routing)
+		return 0;
+
+	std::unique_lock<std::mutex> lock(g_lock);
+	wait_for(g_cv, lock, timeout_in_ms, [p_routing] { return !p_routing->m_source.m_receivers.empty(); });
+	return (int)p_routing->m_source.m_receivers.size();
+}
+
+const NDIlib_source_t* NDIlib_routing_get_source_name(NDIlib_routing_instance_t p_instance)
+{
+	loopback_routing* p_routing = (loopback_routing*)p_instance;
+	return p_routing ? &p_routing->m_source.m_source : nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+// Frame-sync
+NDIlib_framesync_instance_t NDIlib_framesync_create(NDIlib_recv_instance_t p_receiver)
+{
+	if (!p_receiver)
+		return nullptr;
+
+	return (NDIlib_framesync_instance_t)new loopback_framesync((loopback_recv*)p_receiver);
+}
+
+void NDIlib_framesync_destroy(NDIlib_framesync_instance_t p_instance)
+{
+	delete (loopback_framesync*)p_instance;
+}
+
+void NDIlib_framesync_capture_audio(NDIlib_framesync_instance_t p_instance, NDIlib_audio_frame_v2_t* p_audio_data, int sample_rate, int no_channels, int no_samples)
+{
+	loopback_framesync* p_framesync = (loopback_framesync*)p_instance;
+	if (!p_framesync || !p_audio_data)
+		return;
+
+	std::unique_lock<std::mutex> lock(p_framesync->m_lock);
+	p_framesync->pull();
+
+	// Zero values mean that the caller wants whatever the source is using
+	const int src_channels = p_framesync->m_audio_no_channels;
+	if (!sample_rate)
+		sample_rate = p_framesync->m_audio_sample_rate ? p_framesync->m_audio_sample_rate : 48000;
+	if (!no_channels)
+		no_channels = src_channels ? src_channels : 2;
+
+	*p_audio_data = NDIlib_audio_frame_v2_t(sample_rate, no_channels, no_samples);
+	p_audio_data->timestamp = time_in_100ns();
+	p_audio_data->timecode = p_audio_data->timestamp;
+	if (no_samples <= 0)
+		return;
+
+	// Allocate the output, which is silence by default
+	const size_t channel_size = sizeof(float) * no_samples;
+	p_audio_data->p_data = (float*)block_alloc(channel_size * no_channels, 1);
+	if (!p_audio_data->p_data)
+		return;
+	p_audio_data->channel_stride_in_bytes = (int)channel_size;
+	memset(p_audio_data->p_data, 0, channel_size * no_channels);
+
+	// Copy what we have. If we do not have enough samples, the end of the buffer is silent.
+	const int available = std::min(no_samples, p_framesync->audio_samples());
+	for (int ch = 0; ch < std::min(no_channels, src_channels); ch++)
+		memcpy(p_audio_data->p_data + ch * no_samples, p_framesync->m_audio[ch].data() + p_framesync->m_audio_read_pos, sizeof(float) * available);
+	p_framesync->m_audio_read_pos += available;
+}
+
+void NDIlib_framesync_free_audio(NDIlib_framesync_instance_t p_instance, NDIlib_audio_frame_v2_t* p_audio_data)
+{
+	(void)p_instance;
+	if (p_audio_data)
+		block_release(p_audio_data->p_data);
+}
+
+int NDIlib_framesync_audio_queue_depth(NDIlib_framesync_instance_t p_instance)
+{
+	loopback_framesync* p_framesync = (loopback_framesync*)p_instance;
+	if (!p_framesync)
+		return 0;
+
+	std::unique_lock<std::mutex> lock(p_framesync->m_lock);
+	p_framesync->pull();
+	return p_framesync->audio_samples();
+}
+
+void NDIlib_framesync_capture_video(NDIlib_framesync_instance_t p_instance, NDIlib_video_frame_v2_t* p_video_data, NDIlib_frame_format_type_e field_type)
+{
+	(void)field_type;
+	loopback_framesync* p_framesync = (loopback_framesync*)p_instance;
+	if (!p_framesync || !p_video_data)
+		return;
+
+	std::unique_lock<std::mutex> lock(p_framesync->m_lock);
+	p_framesync->pull();
+
+	// We return the most recent frame, which might be repeated. If nothing has arrived yet the frame is empty.
+	*p_video_data = p_framesync->m_last_video;
+	block_add_ref(p_video_data->p_data);
+	if (!p_video_data->p_data)
+		*p_video_data = NDIlib_video_frame_v2_t();
+}
+
+void NDIlib_framesync_free_video(NDIlib_framesync_instance_t p_instance, NDIlib_video_frame_v2_t* p_video_data)
+{
+	(void)p_instance;
+	if (p_video_data)
+		block_release(p_video_data->p_data);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+// Utilities
+void NDIlib_util_audio_to_interleaved_16s_v2(const NDIlib_audio_frame_v2_t* p_src, NDIlib_audio_frame_interleaved_16s_t* p_dst)
+{
+	p_dst->sample_rate = p_src->sample_rate;
+	p_dst->no_channels = p_src->no_channels;
+	p_dst->no_samples = p_src->no_samples;
+	p_dst->timecode = p_src->timecode;
+
+	// The reference level is how many dB above +4dBU the full 16bit range is
+	const float scale = 32767.0f * (float)pow(10.0, -p_dst->reference_level / 20.0);
+	for (int ch = 0; ch < p_src->no_channels; ch++) {
+		const float* p_src_ch = (const float*)((const uint8_t*)p_src->p_data + ch * p_src->channel_stride_in_bytes);
+		for (int i = 0; i < p_src->no_samples; i++) {
+			const float value = std::max(-32768.0f, std::min(32767.0f, p_src_ch[i] * scale));
+			p_dst->p_data[i * p_src->no_channels + ch] = (int16_t)lrintf(value);
+		}
+	}
+}
+
+void NDIlib_util_audio_from_interleaved_16s_v2(const NDIlib_audio_frame_interleaved_16s_t* p_src, NDIlib_audio_frame_v2_t* p_dst)
+{
+	p_dst->sample_rate = p_src->sample_rate;
+	p_dst->no_channels = p_src->no_channels;
+	p_dst->no_samples = p_src->no_samples;
+	p_dst->timecode = p_src->timecode;
+
+	const float scale = (float)pow(10.0, p_src->reference_level / 20.0) / 32767.0f;
+	for (int ch = 0; ch < p_src->no_channels; ch++) {
+		float* p_dst_ch = (float*)((uint8_t*)p_dst->p_data + ch * p_dst->channel_stride_in_bytes);
+		for (int i = 0; i < p_src->no_samples; i++)
+			p_dst_ch[i] = (float)p_src->p_data[i * p_src->no_channels + ch] * scale;
+	}
+}
+
+void NDIlib_util_audio_to_interleaved_32f_v2(const NDIlib_audio_frame_v2_t* p_src, NDIlib_audio_frame_interleaved_32f_t* p_dst)
+{
+	p_dst->sample_rate = p_src->sample_rate;
+	p_dst->no_channels = p_src->no_channels;
+	p_dst->no_samples = p_src->no_samples;
+	p_dst->timecode = p_src->timecode;
+
+	// The frame-sync might give us no data when nothing has been received
+	if (!p_src->p_data) {
+		memset(p_dst->p_data, 0, sizeof(float) * p_src->no_samples * p_src->no_channels);
+		return;
+	}
+
+	for (int ch = 0; ch < p_src->no_channels; ch++) {
+		const float* p_src_ch = (const float*)((const uint8_t*)p_src->p_data + ch * p_src->channel_stride_in_bytes);
+		for (int i = 0; i < p_src->no_samples; i++)
+			p_dst->p_data[i * p_src->no_channels + ch] = p_src_ch[i];
+	}
+}
+
+void NDIlib_util_audio_from_interleaved_32f_v2(const NDIlib_audio_frame_interleaved_32f_t* p_src, NDIlib_audio_frame_v2_t* p_dst)
+{
+	p_dst->sample_rate = p_src->sample_rate;
+	p_dst->no_channels = p_src->no_channels;
+	p_dst->no_samples = p_src->no_samples;
+	p_dst->timecode = p_src->timecode;
+
+	for (int ch = 0; ch < p_src->no_channels; ch++) {
+		float* p_dst_ch = (float*)((uint8_t*)p_dst->p_data + ch * p_dst->channel_stride_in_bytes);
+		for (int i = 0; i < p_src->no_samples; i++)
+			p_dst_ch[i] = p_src->p_data[i * p_src->no_channels + ch];
+	}
+}
+
+void NDIlib_util_send_send_audio_interleaved_16s(NDIlib_send_instance_t p_instance, const NDIlib_audio_frame_interleaved_16s_t* p_audio_data)
+{
+	std::vector<float> planar(p_audio_data->no_samples * p_audio_data->no_channels);
+	NDIlib_audio_frame_v2_t audio_frame;
+	audio_frame.p_data = planar.data();
+	audio_frame.channel_stride_in_bytes = sizeof(float) * p_audio_data->no_samples;
+	NDIlib_util_audio_from_interleaved_16s_v2(p_audio_data, &audio_frame);
+	NDIlib_send_send_audio_v2(p_instance, &audio_frame);
+}
+
+void NDIlib_util_send_send_audio_interleaved_32f(NDIlib_send_instance_t p_instance, const NDIlib_audio_frame_interleaved_32f_t* p_audio_data)
+{
+	std::vector<float> planar(p_audio_data->no_samples * p_audio_data->no_channels);
+	NDIlib_audio_frame_v2_t audio_frame;
+	audio_frame.p_data = planar.data();
+	audio_frame.channel_stride_in_bytes = sizeof(float) * p_audio_data->no_samples;
+	NDIlib_util_audio_from_interleaved_32f_v2(p_audio_data, &audio_frame);
+	NDIlib_send_send_audio_v2(p_instance, &audio_frame);
+}
+
+// The format of V210 is :
+// [10 bits U0] [10 bits Y0] [10 bits V0] [2 bits unused] [10 bits Y1] [10 bits U2] [10 bits Y2] [2 bits unused] etc...
+//
+// The format of P216 is a plane of 16bit Y followed by a plane of 16bit interleaved UV, both with the same stride.
+void NDIlib_util_V210_to_P216(const NDIlib_video_frame_v2_t* p_src_v210, NDIlib_video_frame_v2_t* p_dst_p216)
+{
+	const int xres = p_src_v210->xres;
+	const int yres = p_src_v210->yres;
+	const int src_stride = p_src_v210->line_stride_in_bytes ? p_src_v210->line_stride_in_bytes : ((xres + 47) / 48) * 128;
+
+	// Describe the output frame
+	p_dst_p216->xres = xres;
+	p_dst_p216->yres = yres;
+	p_dst_p216->FourCC = NDIlib_FourCC_type_P216;
+	p_dst_p216->frame_rate_N = p_src_v210->frame_rate_N;
+	p_dst_p216->frame_rate_D = p_src_v210->frame_rate_D;
+	p_dst_p216->picture_aspect_ratio = p_src_v210->picture_aspect_ratio;
+	p_dst_p216->frame_format_type = p_src_v210->frame_format_type;
+	p_dst_p216->timecode = p_src_v210->timecode;
+	if (!p_dst_p216->line_stride_in_bytes)
+		p_dst_p216->line_stride_in_bytes = xres * sizeof(uint16_t);
+	const int dst_stride = p_dst_p216->line_stride_in_bytes;
+
+	for (int y = 0; y < yres; y++) {
+		const uint32_t* p_src = (const uint32_t*)(p_src_v210->p_data + (size_t)y * src_stride);
+		uint16_t* p_dst_y = (uint16_t*)(p_dst_p216->p_data + (size_t)y * dst_stride);
+		uint16_t* p_dst_uv = (uint16_t*)(p_dst_p216->p_data + (size_t)(yres + y) * dst_stride);
+
+		// Unpack the 10 bit values in their natural order and then scatter them
+		uint16_t values[12];
+		for (int x = 0; x < xres; x += 6, p_src += 4) {
+			for (int w = 0; w < 4; w++) {
+				values[w * 3 + 0] = (uint16_t)(((p_src[w] >>  0) & 0x3ff) << 6);
+				values[w * 3 + 1] = (uint16_t)(((p_src[w] >> 10) & 0x3ff) << 6);
+				values[w * 3 + 2] = (uint16_t)(((p_src[w] >> 20) & 0x3ff) << 6);
+			}
+
+			// U0 Y0 V0 Y1 U2 Y2 V2 Y3 U4 Y4 V4 Y5
+			const int no_pixels = std::min(6, xres - x);
+			for (int i = 0; i < no_pixels; i++)
+				p_dst_y[x + i] = values[i * 2 + 1];
+			for (int i = 0; i < (no_pixels + 1) / 2; i++) {
+				p_dst_uv[x + i * 2 + 0] = values[i * 4 + 0];
+				p_dst_uv[x + i * 2 + 1] = values[i * 4 + 2];
+			}
+		}
+	}
+}
+
+void NDIlib_util_P216_to_V210(const NDIlib_video_frame_v2_t* p_src_p216, NDIlib_video_frame_v2_t* p_dst_v210)
+{
+	const int xres = p_src_p216->xres;
+	const int yres = p_src_p216->yres;
+	const int src_stride = p_src_p216->line_stride_in_bytes ? p_src_p216->line_stride_in_bytes : xres * (int)sizeof(uint16_t);
+
+	p_dst_v210->xres = xres;
+	p_dst_v210->yres = yres;
+	p_dst_v210->FourCC = (NDIlib_FourCC_video_type_e)NDI_LIB_FOURCC('V', '2', '1', '0');
+	p_dst_v210->frame_rate_N = p_src_p216->frame_rate_N;
+	p_dst_v210->frame_rate_D = p_src_p216->frame_rate_D;
+	p_dst_v210->picture_aspect_ratio = p_src_p216->picture_aspect_ratio;
+	p_dst_v210->frame_format_type = p_src_p216->frame_format_type;
+	p_dst_v210->timecode = p_src_p216->timecode;
+	if (!p_dst_v210->line_stride_in_bytes)
+		p_dst_v210->line_stride_in_bytes = ((xres + 47) / 48) * 128;
+	const int dst_stride = p_dst_v210->line_stride_in_bytes;
+
+	for (int y = 0; y < yres; y++) {
+		const uint16_t* p_src_y = (const uint16_t*)(p_src_p216->p_data + (size_t)y * src_stride);
+		const uint16_t* p_src_uv = (const uint16_t*)(p_src_p216->p_data + (size_t)(yres + y) * src_stride);
+		uint32_t* p_dst = (uint32_t*)(p_dst_v210->p_data + (size_t)y * dst_stride);
+
+		uint32_t values[12];
+		for (int x = 0; x < xres; x += 6, p_dst += 4) {
+			// Gather the values in V210 order, repeating the last pixel at the end of the line
+			const int no_pixels = std::min(6, xres - x);
+			for (int i = 0; i < 6; i++)
+				values[i * 2 + 1] = p_src_y[x + std::min(i, no_pixels - 1)] >> 6;
+			for (int i = 0; i < 3; i++) {
+				const int uv_x = x + std::min(i * 2, (no_pixels - 1) & ~1);
+				values[i * 4 + 0] = p_src_uv[uv_x + 0] >> 6;
+				values[i * 4 + 2] = p_src_uv[uv_x + 1] >> 6;
+			}
+
+			for (int w = 0; w < 4; w++)
+				p_dst[w] = values[w * 3 + 0] | (values[w * 3 + 1] << 10) | (values[w * 3 + 2] << 20);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+// Dynamic loading
+static NDIlib_v5 build_NDIlib_v5(void)
+{
+	NDIlib_v5 lib;
+	memset(&lib, 0, sizeof(lib));
+
+	lib.initialize = NDIlib_initialize;
+	lib.destroy = NDIlib_destroy;
+	lib.version = NDIlib_version;
+	lib.is_supported_CPU = NDIlib_is_supported_CPU;
+	lib.find_create_v2 = NDIlib_find_create_v2;
+	lib.find_destroy = NDIlib_find_destroy;
+	lib.find_get_current_sources = NDIlib_find_get_current_sources;
+	lib.find_wait_for_sources = NDIlib_find_wait_for_sources;
+	lib.recv_create_v3 = NDIlib_recv_create_v3;
+	lib.recv_destroy = NDIlib_recv_destroy;
+	lib.recv_connect = NDIlib_recv_connect;
+	lib.recv_capture_v2 = NDIlib_recv_capture_v2;
+	lib.recv_free_video_v2 = NDIlib_recv_free_video_v2;
+	lib.recv_free_audio_v2 = NDIlib_recv_free_audio_v2;
+	lib.recv_free_metadata = NDIlib_recv_free_metadata;
+	lib.send_create = NDIlib_send_create;
+	lib.send_destroy = NDIlib_send_destroy;
+	lib.send_send_video_v2 = NDIlib_send_send_video_v2;
+	lib.send_send_video_async_v2 = NDIlib_send_send_video_async_v2;
+	lib.send_send_audio_v2 = NDIlib_send_send_audio_v2;
+	lib.send_send_metadata = NDIlib_send_send_metadata;
+	lib.send_get_source_name = NDIlib_send_get_source_name;
+	lib.framesync_create = NDIlib_framesync_create;
+	lib.framesync_destroy = NDIlib_framesync_destroy;
+	lib.framesync_capture_video = NDIlib_framesync_capture_video;
+	lib.framesync_free_video = NDIlib_framesync_free_video;
+	lib.framesync_capture_audio = NDIlib_framesync_capture_audio;
+	lib.framesync_free_audio = NDIlib_framesync_free_audio;
+
+	return lib;
+}
+
+const NDIlib_v5* NDIlib_v5_load(void)
+{
+	static const NDIlib_v5 lib = build_NDIlib_v5();
+	return &lib;
+}
+
+const NDIlib_v4* NDIlib_v4_load(void)
+{
+	return NDIlib_v5_load();
+}
@@ -10,75 +10,7 @@
 #endif // _WIN64
 #endif // _WIN32
 
-// RAII class for initializing and cleaning up NDI
-class NDIInitializer {
-public:
-    NDIInitializer() {
-        if (!NDIlib_initialize()) {
-            throw std::runtime_error("Failed to initialize NDI");
-        }
-    }
-
-    ~NDIInitializer() {
-        NDIlib_destroy();
-    }
-};
-
-// RAII class for handling NDI find instance
-class NDIFinder {
-public:
-    NDIFinder() {
-        pNDI_find = NDIlib_find_create_v2();
-        if (!pNDI_find) {
-            throw std::runtime_error("Failed to create NDI finder");
-        }
-    }
-
-    ~NDIFinder() {
-        NDIlib_find_destroy(pNDI_find);
-    }
-
-    NDIlib_find_instance_t get() const {
-        return pNDI_find;
-    }
-
-private:
-    NDIlib_find_instance_t pNDI_find;
-};
-
-// RAII class for handling NDI receiver instance
-class NDIReceiver {
-public:
-    NDIReceiver() {
-        pNDI_recv = NDIlib_recv_create_v3();
-        if (!pNDI_recv) {
-            throw std::runtime_error("Failed to create NDI receiver");
-        }
-    }
-
-    ~NDIReceiver() {
-        NDIlib_recv_destroy(pNDI_recv);
-    }
-
-    void connect(const NDIlib_source_t& source) {
-        NDIlib_recv_connect(pNDI_recv, &source);
-    }
-
-    int capture(NDIlib_video_frame_v2_t& video_frame, NDIlib_audio_frame_v2_t& audio_frame) {
-        return NDIlib_recv_capture_v2(pNDI_recv, &video_frame, &audio_frame, nullptr, 5000);
-    }
-
-    void free_video(NDIlib_video_frame_v2_t& video_frame) {
-        NDIlib_recv_free_video_v2(pNDI_recv, &video_frame);
-    }
-
-    void free_audio(NDIlib_audio_frame_v2_t& audio_frame) {
-        NDIlib_recv_free_audio_v2(pNDI_recv, &audio_frame);
-    }
-
-private:
-    NDIlib_recv_instance_t pNDI_recv;
-};
+#include "../NDIlib_Common/NDIlib_RAII.h"
 
 int main(int argc, char* argv[])
 {
@@ -95,8 +27,8 @@ int main(int argc, char* argv[])
         while (!no_sources) {
             // Wait until the sources on the network have changed
             printf("Looking for sources ...\n");
-            NDIlib_find_wait_for_sources(ndiFinder.get(), 1000 /* One second */);
-            p_sources = NDIlib_find_get_current_sources(ndiFinder.get(), &no_sources);
+            ndiFinder.wait_for_sources(1000 /* One second */);
+            p_sources = ndiFinder.get_current_sources(no_sources);
         }
 
         // We now have at least one source, so we create a receiver to look at it using RAII
@@ -109,23 +41,24 @@ int main(int argc, char* argv[])
         // Run for one minute
         using namespace std::chrono;
         for (const auto start = high_resolution_clock::now(); high_resolution_clock::now() - start < minutes(5);) {
-            // The descriptors
-            NDIlib_video_frame_v2_t video_frame;
-            NDIlib_audio_frame_v2_t audio_frame;
+            // The frames, these are freed when they go out of scope
+            VideoFrame video_frame;
+            AudioFrame audio_frame;
 
-            switch (ndiReceiver.capture(video_frame, audio_frame)) {
+            switch (ndiReceiver.capture(&video_frame, &audio_frame, nullptr, 5000)) {
                 case NDIlib_frame_type_none:
                     printf("No data received.\n");
                     break;
 
                 case NDIlib_frame_type_video:
-                    printf("Video data received (%dx%d).\n", video_frame.xres, video_frame.yres);
-                    ndiReceiver.free_video(video_frame);
+                    printf("Video data received (%dx%d).\n", video_frame->xres, video_frame->yres);
                     break;
 
                 case NDIlib_frame_type_audio:
-                    printf("Audio data received (%d samples).\n", audio_frame.no_samples);
-                    ndiReceiver.free_audio(audio_frame);
+                    printf("Audio data received (%d samples).\n", audio_frame->no_samples);
+                    break;
+
+                default:
                     break;
             }
         }
@@ -1,10 +1,16 @@
 #include <csignal>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <atomic>
 #include <chrono>
+#include <vector>
 
 #ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
 
 #ifdef _WIN64
@@ -13,88 +19,27 @@
 #pragma comment(lib, "Processing.NDI.Lib.x86.lib")
 #endif // _WIN64
 
+#define strcasecmp _stricmp
+#else
+#include <strings.h>
 #endif
 
 #include <Processing.NDI.Lib.h>
 
+#include "../NDIlib_Common/NDIlib_Audio.h"
+#include "../NDIlib_Common/NDIlib_RAII.h"
+
+// Receives audio and converts it to interleaved 16-bit samples. The conversion uses ndi_audio::to_int16 into a buffer
+// that is kept between frames and only grows when the format does, rather than allocating a buffer for every frame.
+//		-reference_level <dB>	How many dB above +4dBU the full 16-bit range is (default 20).
+//		-dither					Add TPDF dither before rounding to 16 bits.
+//		-sdk					Convert with NDIlib_util_audio_to_interleaved_16s_v2 instead, for comparison.
+
 static std::atomic<bool> exit_loop(false);
 
 // Signal handler to handle graceful exit
 static void sigint_handler(int) { exit_loop = true; }
 
-// RAII class for initializing and cleaning up NDI
-class NDIInitializer {
-public:
-    NDIInitializer() {
-        if (!NDIlib_initialize()) {
-            throw std::runtime_error("Failed to initialize NDI");
-        }
-    }
-
-    ~NDIInitializer() {
-        NDIlib_destroy();
-    }
-};
-
-// RAII class for handling NDI find instance
-class NDIFinder {
-public:
-    NDIFinder() {
-        const NDIlib_find_create_t NDI_find_create_desc = {};  // Default settings
-        pNDI_find = NDIlib_find_create_v2(&NDI_find_create_desc);
-        if (!pNDI_find) {
-            throw std::runtime_error("Failed to create NDI find instance");
-        }
-    }
-
-    ~NDIFinder() {
-        NDIlib_find_destroy(pNDI_find);
-    }
-
-    NDIlib_find_instance_t get() const { return pNDI_find; }
-
-private:
-    NDIlib_find_instance_t pNDI_find;
-};
-
-// RAII class for handling NDI receiver instance
-class NDIReceiver {
-public:
-    NDIReceiver(const NDIlib_source_t& source) {
-        NDIlib_recv_create_v3_t NDI_recv_create_desc = {};
-        NDI_recv_create_desc.source_to_connect_to = source;
-        NDI_recv_create_desc.p_ndi_recv_name = "Example Audio Converter Receiver";
-
-        pNDI_recv = NDIlib_recv_create_v3(&NDI_recv_create_desc);
-        if (!pNDI_recv) {
-            throw std::runtime_error("Failed to create NDI receiver");
-        }
-    }
-
-    ~NDIReceiver() {
-        NDIlib_recv_destroy(pNDI_recv);
-    }
-
-    int capture(NDIlib_video_frame_v2_t& video_frame, NDIlib_audio_frame_v2_t& audio_frame, NDIlib_metadata_frame_t& metadata_frame) {
-        return NDIlib_recv_capture_v2(pNDI_recv, &video_frame, &audio_frame, &metadata_frame, 1000);
-    }
-
-    void free_video(NDIlib_video_frame_v2_t& video_frame) {
-        NDIlib_recv_free_video_v2(pNDI_recv, &video_frame);
-    }
-
-    void free_audio(NDIlib_audio_frame_v2_t& audio_frame) {
-        NDIlib_recv_free_audio_v2(pNDI_recv, &audio_frame);
-    }
-
-    void free_metadata(NDIlib_metadata_frame_t& metadata_frame) {
-        NDIlib_recv_free_metadata(pNDI_recv, &metadata_frame);
-    }
-
-private:
-    NDIlib_recv_instance_t pNDI_recv;
-};
-
 int main(int argc, char* argv[])
 {
     try {
@@ -104,6 +49,22 @@ int main(int argc, char* argv[])
         // Catch interrupt signal to shut down gracefully
         signal(SIGINT, sigint_handler);
 
+        // The settings
+        int reference_level = 20;  // 20dB of headroom
+        bool use_dither = false, use_sdk = false;
+        for (int i = 1; i < argc; i++) {
+            if ((strcasecmp(argv[i], "-reference_level") == 0) && (i + 1 < argc))
+                reference_level = atoi(argv[++i]);
+            else if (strcasecmp(argv[i], "-dither") == 0)
+                use_dither = true;
+            else if (strcasecmp(argv[i], "-sdk") == 0)
+                use_sdk = true;
+        }
+
+        const ndi_audio::simd_e simd = ndi_audio::detect_simd();
+        printf("Converting to 16-bit at a reference level of %ddB with %s%s.\n", reference_level,
+            use_sdk ? "the NDI SDK" : ndi_audio::simd_name(simd), use_dither ? " and TPDF dither" : "");
+
         // Create NDI finder instance using RAII
         NDIFinder ndiFinder;
 
@@ -113,8 +74,8 @@ int main(int argc, char* argv[])
         // Wait until we find at least one source
         while (!exit_loop && !no_sources) {
             printf("Looking for sources...\n");
-            NDIlib_find_wait_for_sources(ndiFinder.get(), 1000);  // Wait for 1 second
-            p_sources = NDIlib_find_get_current_sources(ndiFinder.get(), &no_sources);
+            ndiFinder.wait_for_sources(1000);  // Wait for 1 second
+            p_sources = ndiFinder.get_current_sources(no_sources);
         }
 
         // If no sources found, exit
@@ -124,51 +85,71 @@ int main(int argc, char* argv[])
         }
 
         // Create NDI receiver to connect to the first source using RAII
-        NDIReceiver ndiReceiver(p_sources[0]);
+        NDIReceiver ndiReceiver(p_sources[0], "Example Audio Converter Receiver");
 
         // Destroy the NDI finder since we no longer need it
         // (it will be destroyed automatically when ndiFinder goes out of scope)
 
+        // The interleaved audio, which is reused for every frame
+        std::vector<int16_t> audio_16bpp;
+        ndi_audio::tpdf_dither dither;
+
         // Run for up to one minute
         const auto start = std::chrono::high_resolution_clock::now();
         while (!exit_loop && std::chrono::high_resolution_clock::now() - start < std::chrono::minutes(1)) {
-            NDIlib_video_frame_v2_t video_frame;
-            NDIlib_audio_frame_v2_t audio_frame;
-            NDIlib_metadata_frame_t metadata_frame;
+            // The frames, these are freed when they go out of scope
+            VideoFrame video_frame;
+            AudioFrame audio_frame;
+            MetadataFrame metadata_frame;
 
-            switch (ndiReceiver.capture(video_frame, audio_frame, metadata_frame)) {
+            switch (ndiReceiver.capture(&video_frame, &audio_frame, &metadata_frame, 1000)) {
                 case NDIlib_frame_type_none:
                     printf("No data received.\n");
                     break;
 
                 case NDIlib_frame_type_video:
-                    printf("Video data received (%dx%d).\n", video_frame.xres, video_frame.yres);
-                    ndiReceiver.free_video(video_frame);
+                    printf("Video data received (%dx%d).\n", video_frame->xres, video_frame->yres);
                     break;
 
                 case NDIlib_frame_type_audio: {
-                    printf("Audio data received (%d samples).\n", audio_frame.no_samples);
+                    // The buffer only needs to grow when the format changes
+                    const size_t no_values = (size_t)audio_frame->no_samples * audio_frame->no_channels;
+                    if (audio_16bpp.size() < no_values) {
+                        audio_16bpp.resize(no_values);
+                        printf("Conversion buffer is now %d channels of %d samples.\n", audio_frame->no_channels, audio_frame->no_samples);
+                    }
 
                     // Convert audio data to interleaved format
                     NDIlib_audio_frame_interleaved_16s_t audio_frame_16bpp_interleaved;
-                    audio_frame_16bpp_interleaved.reference_level = 20;  // 20dB of headroom
-                    audio_frame_16bpp_interleaved.p_data = new short[audio_frame.no_samples * audio_frame.no_channels];
-
-                    NDIlib_util_audio_to_interleaved_16s_v2(&audio_frame, &audio_frame_16bpp_interleaved);
+                    audio_frame_16bpp_interleaved.sample_rate = audio_frame->sample_rate;
+                    audio_frame_16bpp_interleaved.no_channels = audio_frame->no_channels;
+                    audio_frame_16bpp_interleaved.no_samples = audio_frame->no_samples;
+                    audio_frame_16bpp_interleaved.timecode = audio_frame->timecode;
+                    audio_frame_16bpp_interleaved.reference_level = reference_level;
+                    audio_frame_16bpp_interleaved.p_data = audio_16bpp.data();
+
+                    const auto convert_start = std::chrono::high_resolution_clock::now();
+                    if (use_sdk) {
+                        NDIlib_util_audio_to_interleaved_16s_v2(&audio_frame.get(), &audio_frame_16bpp_interleaved);
+                    } else {
+                        const float* p_dither = use_dither ? dither.generate(audio_frame->no_channels, audio_frame->no_samples, simd) : nullptr;
+                        ndi_audio::to_int16(audio_frame->p_data, audio_frame->channel_stride_in_bytes, audio_frame->no_channels,
+                            audio_frame->no_samples, audio_16bpp.data(), reference_level, p_dither, simd);
+                    }
+                    const auto convert_time = std::chrono::high_resolution_clock::now() - convert_start;
+
+                    printf("Audio data received (%d samples), converted in %.1fus.\n", audio_frame->no_samples,
+                        std::chrono::duration<double, std::micro>(convert_time).count());
 
                     // Free original audio buffer
-                    ndiReceiver.free_audio(audio_frame);
+                    audio_frame.reset();
 
                     // Process the interleaved audio data (not shown here)
-
-                    // Clean up the interleaved audio data
-                    delete[] audio_frame_16bpp_interleaved.p_data;
                     break;
                 }
 
                 case NDIlib_frame_type_metadata:
                     printf("Meta data received.\n");
-                    ndiReceiver.free_metadata(metadata_frame);
                     break;
 
                 case NDIlib_frame_type_status_change:
@@ -3,11 +3,18 @@
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <string>
 #include <thread>
+#include <vector>
 
 #ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
 
 #ifdef _WIN64
@@ -20,20 +27,64 @@
 #define snprintf _snprintf
 #endif
 
+#define strcasecmp _stricmp
+
+#else
+#include <strings.h>
 #endif
 
 #include <Processing.NDI.Lib.h>
 
+#include "../NDIlib_Common/NDIlib_Benchmark.h"
+#include "../NDIlib_Common/NDIlib_Thread.h"
+
+// This connects a number of receivers to one source and measures how many frames each one can decode, so that we know
+// how many inputs a machine can ingest.
+//
+// Command line options :
+//		-receivers <count>				The number of receivers, 1 to 64 (default 4).
+//		-source <name>					Connect to the first source whose name contains this (default the first found).
+//		-color uyvy|bgra|fastest|best	The color_format to receive in (default uyvy, which is UYVY_BGRA).
+//		-bandwidth highest|lowest		The bandwidth to receive at (default highest).
+//		-pin							Pin each receiver to its own core.
+// The -warmup, -duration (default 60), -json, -csv and -quiet options of the other benchmarks are also understood.
+
 static std::atomic<bool> exit_loop(false);
 static void sigint_handler(int) { exit_loop = true; }
 
+// The settings for each receiver
+struct receive_settings_t {
+	NDIlib_recv_color_format_e color_format;
+	NDIlib_recv_bandwidth_e bandwidth;
+	bool pin;
+};
+
+// The results from one receiver
+struct receive_results_t {
+	uint64_t frames;
+	int64_t total_frames, dropped_frames;
+	int max_queue_depth;
+	int xres, yres;
+	NDIlib_FourCC_video_type_e FourCC;
+};
+
 struct receive_example {
 	// Constructor
-	receive_example(const int channel_no, const NDIlib_source_t& source);
+	receive_example(const int channel_no, const NDIlib_source_t& source, const receive_settings_t& settings);
 
 	// Destructor
 	~receive_example(void);
 
+	// Start and stop measuring. The results are from the time between the two calls.
+	void start_measuring(void);
+	receive_results_t stop_measuring(void);
+
+	// The number of frames received since we started measuring
+	uint64_t frames(void) const { return m_frames; }
+
+	// The deepest the video queue has been since we started measuring
+	int max_queue_depth(void) const { return m_max_queue_depth; }
+
 private:	// Create the receiver
 	NDIlib_recv_instance_t m_pNDI_recv;
 
@@ -43,58 +94,109 @@ private:	// Create the receiver
 	// Are we ready to exit
 	std::atomic<bool> m_exit;
 
+	// Has the receiver been created
+	std::atomic<bool> m_ready;
+
 	// The channel number
 	const int m_channel_no;
 
+	// The source and how to receive it
+	const std::string m_source_name;
+	const receive_settings_t m_settings;
+
+	// What we have received since we started measuring
+	std::atomic<uint64_t> m_frames;
+	std::atomic<int> m_max_queue_depth;
+	NDIlib_recv_performance_t m_start_total, m_start_dropped;
+
+	// The format of the most recent frame
+	std::atomic<int> m_xres, m_yres, m_FourCC;
+
 	// This is called to receive frames
 	void receive(void);
 };
 
 // Constructor
-receive_example::receive_example(const int channel_no, const NDIlib_source_t& source)
-	: m_pNDI_recv(NULL), m_exit(false), m_channel_no(channel_no)
+receive_example::receive_example(const int channel_no, const NDIlib_source_t& source, const receive_settings_t& settings)
+	: m_pNDI_recv(NULL), m_exit(false), m_ready(false), m_channel_no(channel_no), m_source_name(source.p_ndi_name ? source.p_ndi_name : ""),
+	  m_settings(settings), m_frames(0), m_max_queue_depth(0), m_xres(0), m_yres(0), m_FourCC(0)
 {
-	char ndi_recv_name[128];
-	snprintf(ndi_recv_name, sizeof(ndi_recv_name), "Example Multichannel Receiver %d", channel_no);
+	// Display the source we are connecting to
+	printf("Channel %d is connecting to %s.\n", m_channel_no, m_source_name.c_str());
 
-	// We now have at least one source, so we create a receiver to look at it.
-	// We tell it that we prefer YCbCr video since it is more efficient for us. If the source has an alpha channel
-	// it will still be provided in BGRA
-	NDIlib_recv_create_v3_t recv_create_desc;
-	recv_create_desc.source_to_connect_to = source;
-	recv_create_desc.bandwidth = NDIlib_recv_bandwidth_highest;
-	recv_create_desc.p_ndi_recv_name = ndi_recv_name;
-
-	// Display the frames per second
-	printf("Channel %d is connecting to %s.\n", m_channel_no, source.p_ndi_name);
-
-	// Create the receiver
-	m_pNDI_recv = NDIlib_recv_create_v3(&recv_create_desc);
-	assert(m_pNDI_recv);
-
-	// Start a thread to receive frames
+	// Start a thread to receive frames. The receiver is created on that thread, once it has been pinned to its core,
+	// so that the threads NDI creates for it are placed there too.
 	m_receive_thread = std::thread(&receive_example::receive, this);
+
+	// Wait until the receiver exists
+	while (!m_ready)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
 }
 
 // Destructor
 receive_example::~receive_example(void)
 {
-	// Wait for the thread to exit
+	// Wait for the thread to exit, it destroys the receiver
 	m_exit = true;
 	m_receive_thread.join();
+}
 
-	// Destroy the receiver
-	NDIlib_recv_destroy(m_pNDI_recv);
+// Start measuring
+void receive_example::start_measuring(void)
+{
+	if (m_pNDI_recv)
+		NDIlib_recv_get_performance(m_pNDI_recv, &m_start_total, &m_start_dropped);
+	m_frames = 0;
+	m_max_queue_depth = 0;
+}
+
+// Stop measuring and get the results
+receive_results_t receive_example::stop_measuring(void)
+{
+	receive_results_t results;
+	results.frames = m_frames;
+	results.max_queue_depth = m_max_queue_depth;
+	results.xres = m_xres;
+	results.yres = m_yres;
+	results.FourCC = (NDIlib_FourCC_video_type_e)(int)m_FourCC;
+
+	// The frames that were dropped while we were measuring
+	NDIlib_recv_performance_t total, dropped;
+	if (m_pNDI_recv)
+		NDIlib_recv_get_performance(m_pNDI_recv, &total, &dropped);
+	results.total_frames = total.video_frames - m_start_total.video_frames;
+	results.dropped_frames = dropped.video_frames - m_start_dropped.video_frames;
+
+	return results;
 }
 
 // This is called to receive frames
 void receive_example::receive(void)
 {
-	// Keep track of times
-	auto prev_time = std::chrono::high_resolution_clock::now();
+	// Pin the thread first, so that the receiver is created on this core
+	if (m_settings.pin)
+		ndi_thread::pin_to_cpu(m_channel_no - 1);
+
+	char ndi_recv_name[128];
+	snprintf(ndi_recv_name, sizeof(ndi_recv_name), "Example Multichannel Receiver %d", m_channel_no);
+
+	// We now have at least one source, so we create a receiver to look at it.
+	NDIlib_source_t source;
+	source.p_ndi_name = m_source_name.c_str();
+
+	NDIlib_recv_create_v3_t recv_create_desc;
+	recv_create_desc.source_to_connect_to = source;
+	recv_create_desc.color_format = m_settings.color_format;
+	recv_create_desc.bandwidth = m_settings.bandwidth;
+	recv_create_desc.p_ndi_recv_name = ndi_recv_name;
+
+	// Create the receiver
+	m_pNDI_recv = NDIlib_recv_create_v3(&recv_create_desc);
+	assert(m_pNDI_recv);
+	m_ready = true;
 
 	// Lets work until things end
-	for (int frame_no = 0; !m_exit; ) {
+	while (m_pNDI_recv && !m_exit) {
 		// The descriptors
 		NDIlib_video_frame_v2_t video_frame;
 		NDIlib_audio_frame_v2_t audio_frame;
@@ -108,31 +210,20 @@ void receive_example::receive(void)
 				// Video data
 			case NDIlib_frame_type_video:
 			{
+				// Remember the format
+				m_xres = video_frame.xres;
+				m_yres = video_frame.yres;
+				m_FourCC = (int)video_frame.FourCC;
+
 				// Free the memory
 				NDIlib_recv_free_video_v2(m_pNDI_recv, &video_frame);
+				m_frames++;
 
-				// Double check that we are running sufficiently well
+				// Keep track of how far behind we are running
 				NDIlib_recv_queue_t recv_queue;
 				NDIlib_recv_get_queue(m_pNDI_recv, &recv_queue);
-				if (recv_queue.video_frames > 2) {
-					// Display the frames per second
-					printf("Channel %d queue depth is %d.\n", m_channel_no, recv_queue.video_frames);
-				}
-
-				// Every 1000 frames we check how long it has taken
-				if (frame_no == 200) {
-					// Get the time
-					const auto this_time = std::chrono::high_resolution_clock::now();
-
-					// Display the frames per second
-					printf("Channel %d is receiving video at %1.1ffps.\n", m_channel_no, (float)frame_no / std::chrono::duration_cast<std::chrono::duration<float>>(this_time - prev_time).count());
-
-					// Cycle the timers and reset the count
-					prev_time = this_time;
-					frame_no = 0;
-				} else {
-					frame_no++;
-				}
+				if (recv_queue.video_frames > m_max_queue_depth)
+					m_max_queue_depth = recv_queue.video_frames;
 
 				break;
 			}
@@ -149,7 +240,6 @@ void receive_example::receive(void)
 
 				// There is a status change on the receiver (e.g. new web interface)
 			case NDIlib_frame_type_status_change:
-				printf("Receiver connection status changed.\n");
 				break;
 
 				// Everything else
@@ -157,6 +247,19 @@ void receive_example::receive(void)
 				break;
 		}
 	}
+
+	// Destroy the receiver
+	NDIlib_recv_destroy(m_pNDI_recv);
+}
+
+// Get a FourCC as text
+static std::string fourcc_name(const NDIlib_FourCC_video_type_e FourCC)
+{
+	if (!FourCC)
+		return "-";
+
+	const char name[5] = { (char)(FourCC & 0xFF), (char)((FourCC >> 8) & 0xFF), (char)((FourCC >> 16) & 0xFF), (char)((FourCC >> 24) & 0xFF), 0 };
+	return name;
 }
 
 int main(int argc, char* argv[])
@@ -172,24 +275,78 @@ int main(int argc, char* argv[])
 	// Catch interrupt so that we can shut down gracefully
 	::signal(SIGINT, sigint_handler);
 
+	// The command line settings
+	receive_settings_t settings = { NDIlib_recv_color_format_UYVY_BGRA, NDIlib_recv_bandwidth_highest, false };
+	const char* p_color_name = "uyvy";
+	const char* p_bandwidth_name = "highest";
+	const char* p_source_filter = NULL;
+	int no_receivers = 4;
+	for (int i = 1; i < argc; i++) {
+		const bool has_value = (i + 1 < argc);
+		if (strcasecmp(argv[i], "-pin") == 0) {
+			settings.pin = true;
+		} else if (has_value && (strcasecmp(argv[i], "-receivers") == 0)) {
+			no_receivers = std::max(1, std::min(64, atoi(argv[++i])));
+		} else if (has_value && (strcasecmp(argv[i], "-source") == 0)) {
+			p_source_filter = argv[++i];
+		} else if (has_value && (strcasecmp(argv[i], "-color") == 0)) {
+			p_color_name = argv[++i];
+			if (strcasecmp(p_color_name, "uyvy") == 0)
+				settings.color_format = NDIlib_recv_color_format_UYVY_BGRA;
+			else if (strcasecmp(p_color_name, "bgra") == 0)
+				settings.color_format = NDIlib_recv_color_format_BGRX_BGRA;
+			else if (strcasecmp(p_color_name, "fastest") == 0)
+				settings.color_format = NDIlib_recv_color_format_fastest;
+			else if (strcasecmp(p_color_name, "best") == 0)
+				settings.color_format = NDIlib_recv_color_format_best;
+			else {
+				printf("Unknown color format \"%s\".\n", p_color_name);
+				return 0;
+			}
+		} else if (has_value && (strcasecmp(argv[i], "-bandwidth") == 0)) {
+			p_bandwidth_name = argv[++i];
+			if (strcasecmp(p_bandwidth_name, "highest") == 0)
+				settings.bandwidth = NDIlib_recv_bandwidth_highest;
+			else if (strcasecmp(p_bandwidth_name, "lowest") == 0)
+				settings.bandwidth = NDIlib_recv_bandwidth_lowest;
+			else {
+				printf("Unknown bandwidth \"%s\".\n", p_bandwidth_name);
+				return 0;
+			}
+		}
+	}
+
+	// We measure for one minute unless told otherwise
+	ndi_benchmark::options bench_options;
+	bench_options.m_duration_seconds = 60.0;
+	bench_options.parse(argc, argv);
+
 	// Create a finder
 	NDIlib_find_create_t NDI_find_create_desc; /* Defalt settings */
 	NDIlib_find_instance_t pNDI_find = NDIlib_find_create_v2(&NDI_find_create_desc);
 	if (!pNDI_find)
 		return 0;
 
-	// We wait until there is at least one source on the network
-	uint32_t no_sources = 0;
-	const NDIlib_source_t* p_sources = NULL;
-	while (!exit_loop && !no_sources) {
+	// We wait until the source we want is on the network
+	const NDIlib_source_t* p_source = NULL;
+	while (!exit_loop && !p_source) {
 		// Wait until the sources on the network have changed
 		NDIlib_find_wait_for_sources(pNDI_find, 1000);
-		p_sources = NDIlib_find_get_current_sources(pNDI_find, &no_sources);
+
+		uint32_t no_sources = 0;
+		const NDIlib_source_t* p_sources = NDIlib_find_get_current_sources(pNDI_find, &no_sources);
+		for (uint32_t i = 0; !p_source && i < no_sources; i++) {
+			if (!p_source_filter || strstr(p_sources[i].p_ndi_name, p_source_filter))
+				p_source = p_sources + i;
+		}
 	}
 
-	// We need at least one source
-	if (!p_sources)
+	// We need a source
+	if (!p_source) {
+		NDIlib_find_destroy(pNDI_find);
+		NDIlib_destroy();
 		return 0;
+	}
 
 	// Start up a bunch of receivers
 	// Note : Obviously it is tempting to specify a very high number of receivers here
@@ -197,24 +354,137 @@ int main(int argc, char* argv[])
 	//        real amount of network bandwidth (and some decompression time). In general on
 	//        a mediocre 1Gbit ethernet you should easily be able to get 4 channels of HD video.
 	//        If you have a well configured 1Gbe network then you should easily get to 8 channels.
-	//        Beyond this you will need a fast machine and a 10Gbit ethernet in order to get more 
-	//		  streams. For those that immediately want a very high input count, bear in mind that 
-	//		  even getting 8 channels from an SDI capture card can push a machine, and other 
+	//        Beyond this you will need a fast machine and a 10Gbit ethernet in order to get more
+	//		  streams. For those that immediately want a very high input count, bear in mind that
+	//		  even getting 8 channels from an SDI capture card can push a machine, and other
 	//		  leading IP standards typically cannot do a single HD channel on a 1Gbe connection !
-	static const int no_receivers = 4;
-	receive_example* p_receivers[no_receivers] = { 0 };
+	std::vector<receive_example*> p_receivers(no_receivers, NULL);
 	for (int idx = 0; idx < no_receivers; idx++)
-		p_receivers[idx] = new receive_example(idx + 1, p_sources[0]);
+		p_receivers[idx] = new receive_example(idx + 1, *p_source, settings);
 
-	// Destroy the NDI finder. We needed to have access to the pointers to p_sources[0]
+	// Destroy the NDI finder. The receivers keep their own copy of the source name.
+	const std::string source_name = p_source->p_ndi_name;
 	NDIlib_find_destroy(pNDI_find);
 
-	// Lets measure the performance for one minute
-	std::this_thread::sleep_until(std::chrono::high_resolution_clock::now() + std::chrono::minutes(1));
+	// Wait for the warm-up
+	if (!bench_options.m_quiet)
+		printf("Warming up for %1.1fs ...\n", bench_options.m_warmup_seconds);
+	const auto warmup_end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(bench_options.m_warmup_seconds));
+	while (!exit_loop && (std::chrono::steady_clock::now() < warmup_end))
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	// Lets measure the performance
+	for (auto p_receiver : p_receivers)
+		p_receiver->start_measuring();
+	const auto start_time = std::chrono::steady_clock::now();
+	const double process_cpu_start = ndi_benchmark::process_cpu_seconds();
+
+	auto progress_time = start_time;
+	uint64_t progress_frames = 0;
+	while (!exit_loop) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		const auto now = std::chrono::steady_clock::now();
+		const double elapsed = std::chrono::duration<double>(now - start_time).count();
+		if ((bench_options.m_duration_seconds > 0.0) && (elapsed >= bench_options.m_duration_seconds))
+			break;
+
+		// Display the total frame-rate once a second
+		if (!bench_options.m_quiet && (now - progress_time >= std::chrono::seconds(1))) {
+			uint64_t frames = 0;
+			int max_queue_depth = 0;
+			for (auto p_receiver : p_receivers) {
+				frames += p_receiver->frames();
+				max_queue_depth = std::max(max_queue_depth, p_receiver->max_queue_depth());
+			}
+
+			printf("%d channels are receiving video at %1.1ffps in total, max queue depth %d.\n", no_receivers,
+				(double)(frames - progress_frames) / std::chrono::duration<double>(now - progress_time).count(), max_queue_depth);
+			progress_time = now;
+			progress_frames = frames;
+		}
+	}
+
+	// Get the results
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+	const double process_cpu = ndi_benchmark::process_cpu_seconds() - process_cpu_start;
+	std::vector<receive_results_t> results;
+	for (auto p_receiver : p_receivers)
+		results.push_back(p_receiver->stop_measuring());
 
 	// Delete the receivers
-	for (int idx = 0; idx < no_receivers; idx++)
-		delete p_receivers[idx];
+	for (auto p_receiver : p_receivers)
+		delete p_receiver;
+
+	// Display the results
+	printf("\nNDIlib_Recv_Multichannel results\n");
+	printf("    %-20s %s\n", "ndi_version", NDIlib_version());
+	printf("    %-20s %s\n", "source", source_name.c_str());
+	printf("    %-20s %d%s\n", "receivers", no_receivers, settings.pin ? " (pinned)" : "");
+	printf("    %-20s %s\n", "color_format", p_color_name);
+	printf("    %-20s %s\n", "bandwidth", p_bandwidth_name);
+	printf("    %-20s %1.2fs\n", "duration", seconds);
+	printf("    %-20s %1.2fs (%1.1f%%)\n", "process cpu", process_cpu, seconds > 0.0 ? 100.0 * process_cpu / seconds : 0.0);
+
+	printf("\n%-8s%12s%10s%10s%10s%10s\n", "channel", "format", "frames", "fps", "dropped", "max queue");
+	uint64_t total_frames = 0;
+	int64_t total_dropped = 0;
+	int max_queue_depth = 0;
+	double min_fps = 0.0;
+	for (int idx = 0; idx < no_receivers; idx++) {
+		const receive_results_t& r = results[idx];
+		const double fps = seconds > 0.0 ? (double)r.frames / seconds : 0.0;
+		char format[64];
+		snprintf(format, sizeof(format), "%dx%d %s", r.xres, r.yres, fourcc_name(r.FourCC).c_str());
+		printf("%-8d%12s%10llu%10.2f%10lld%10d\n", idx + 1, format, (unsigned long long)r.frames, fps, (long long)r.dropped_frames, r.max_queue_depth);
+
+		total_frames += r.frames;
+		total_dropped += r.dropped_frames;
+		max_queue_depth = std::max(max_queue_depth, r.max_queue_depth);
+		min_fps = idx ? std::min(min_fps, fps) : fps;
+	}
+	printf("%-8s%12s%10llu%10.2f%10lld%10d\n", "total", "", (unsigned long long)total_frames, seconds > 0.0 ? (double)total_frames / seconds : 0.0,
+		(long long)total_dropped, max_queue_depth);
+	printf("\nThe slowest channel decoded at %1.2ffps.\n", min_fps);
+
+	// Write the results as JSON
+	if (!bench_options.m_json_filename.empty()) {
+		const bool to_stdout = (bench_options.m_json_filename == "-");
+		FILE* p_file = to_stdout ? stdout : fopen(bench_options.m_json_filename.c_str(), "w");
+		if (p_file) {
+			fprintf(p_file, "{\n  \"benchmark\": \"NDIlib_Recv_Multichannel\",\n  \"ndi_version\": \"%s\",\n", NDIlib_version());
+			fprintf(p_file, "  \"receivers\": %d,\n  \"pinned\": %s,\n  \"color_format\": \"%s\",\n  \"bandwidth\": \"%s\",\n", no_receivers,
+				settings.pin ? "true" : "false", p_color_name, p_bandwidth_name);
+			fprintf(p_file, "  \"seconds\": %.6f,\n  \"process_cpu_seconds\": %.6f,\n  \"total_fps\": %.3f,\n  \"min_fps\": %.3f,\n  \"channels\": [",
+				seconds, process_cpu, seconds > 0.0 ? (double)total_frames / seconds : 0.0, min_fps);
+			for (int idx = 0; idx < no_receivers; idx++) {
+				const receive_results_t& r = results[idx];
+				fprintf(p_file, "%s\n    { \"channel\": %d, \"xres\": %d, \"yres\": %d, \"fourcc\": \"%s\", \"frames\": %llu, \"fps\": %.3f, \"dropped\": %lld, \"max_queue_depth\": %d }",
+					idx ? "," : "", idx + 1, r.xres, r.yres, fourcc_name(r.FourCC).c_str(), (unsigned long long)r.frames,
+					seconds > 0.0 ? (double)r.frames / seconds : 0.0, (long long)r.dropped_frames, r.max_queue_depth);
+			}
+			fprintf(p_file, "\n  ]\n}\n");
+
+			if (!to_stdout)
+				fclose(p_file);
+		}
+	}
+
+	// Append a line per channel to a CSV file, with a header if it is new
+	if (!bench_options.m_csv_filename.empty()) {
+		FILE* p_file = fopen(bench_options.m_csv_filename.c_str(), "a");
+		if (p_file) {
+			fseek(p_file, 0, SEEK_END);
+			if (ftell(p_file) == 0)
+				fprintf(p_file, "benchmark,receivers,pinned,color_format,bandwidth,channel,xres,yres,fourcc,seconds,frames,fps,dropped,max_queue_depth\n");
+			for (int idx = 0; idx < no_receivers; idx++) {
+				const receive_results_t& r = results[idx];
+				fprintf(p_file, "NDIlib_Recv_Multichannel,%d,%d,%s,%s,%d,%d,%d,%s,%.6f,%llu,%.3f,%lld,%d\n", no_receivers, settings.pin ? 1 : 0,
+					p_color_name, p_bandwidth_name, idx + 1, r.xres, r.yres, fourcc_name(r.FourCC).c_str(), seconds, (unsigned long long)r.frames,
+					seconds > 0.0 ? (double)r.frames / seconds : 0.0, (long long)r.dropped_frames, r.max_queue_depth);
+			}
+			fclose(p_file);
+		}
+	}
 
 	// Not required, but nice
 	NDIlib_destroy();
@@ -1,9 +1,15 @@
+#include <csignal>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
 #include <chrono>
-#include <cassert>
+#include <string>
+#include <thread>
 #include <Processing.NDI.Lib.h>
 
-#include "LodePNG/lodepng.h"
+#include "../NDIlib_Common/NDIlib_PNG.h"
+#include "../NDIlib_Common/NDIlib_Thread.h"
 
 #ifdef _WIN32
 #ifdef _WIN64
@@ -11,16 +17,94 @@
 #else // _WIN64
 #pragma comment(lib, "Processing.NDI.Lib.x86.lib")
 #endif // _WIN64
+#define strcasecmp _stricmp
 #else
+#include <strings.h>
 #include "LodePNG/lodepng.cpp"
 #endif // _WIN32
 
+// This saves the video from the first source that is found as PNG files. Frames are written with their line stride, so
+// they are never copied, and alpha is only kept when the source sends it.
+//		-output <file>								The file to write (default CoolNDIImage.png). When more than one
+//													frame is saved, the frame number is added to the name.
+//		-count <n>									The number of frames to save (default 1).
+//		-interval <ms>								The time between the frames that are saved (default 1000).
+//		-compression none|fast|best					How hard to compress (default best).
+//		-threads <n>								The number of threads that compress each frame (default one per CPU).
+//		-async										Write the files on a worker thread, so that receiving never waits
+//													for compression. A frame is skipped while the worker is still busy
+//													with the one before it.
+
+static std::atomic<bool> exit_loop(false);
+static void sigint_handler(int)
+{
+	exit_loop = true;
+}
+
+// Get the name of the file for a frame, adding the frame number before the extension when there is more than one
+static std::string get_filename(const std::string& output, const int frame_no, const int no_frames)
+{
+	if (no_frames <= 1)
+		return output;
+
+	char number[32];
+	snprintf(number, sizeof(number), "_%04d", frame_no);
+
+	const size_t dot = output.find_last_of('.');
+	const size_t slash = output.find_last_of("/\\");
+	if ((dot == std::string::npos) || ((slash != std::string::npos) && (dot < slash)))
+		return output + number;
+	return output.substr(0, dot) + number + output.substr(dot);
+}
+
+// Write a frame and display how long it took
+static void write_frame(ndi_png::writer& png_writer, const std::string& filename, const NDIlib_video_frame_v2_t& video_frame)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const bool ok = png_writer.write(filename.c_str(), video_frame);
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (ok)
+		printf("Wrote %s (%dx%d) in %1.1fms.\n", filename.c_str(), video_frame.xres, video_frame.yres, ms);
+	else
+		printf("Could not write %s.\n", filename.c_str());
+}
+
 int main(int argc, char* argv[])
 {
+	// The settings
+	std::string output = "CoolNDIImage.png";
+	int no_frames = 1, interval_ms = 1000, no_threads = 0;
+	ndi_png::compression_e compression = ndi_png::compression_best;
+	bool async = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcasecmp(argv[i], "-async") == 0)
+			async = true;
+		else if (i == argc - 1)
+			break;
+		else if (strcasecmp(argv[i], "-output") == 0)
+			output = argv[++i];
+		else if (strcasecmp(argv[i], "-count") == 0)
+			no_frames = std::max(1, atoi(argv[++i]));
+		else if (strcasecmp(argv[i], "-interval") == 0)
+			interval_ms = std::max(0, atoi(argv[++i]));
+		else if (strcasecmp(argv[i], "-threads") == 0)
+			no_threads = std::max(0, atoi(argv[++i]));
+		else if (strcasecmp(argv[i], "-compression") == 0) {
+			if (!ndi_png::parse_compression(argv[++i], compression)) {
+				printf("Unknown compression %s, it should be none, fast or best.\n", argv[i]);
+				return 0;
+			}
+		}
+	}
+
 	// Not required, but "correct" (see the SDK documentation).
 	if (!NDIlib_initialize())
 		return 0;
 
+	// Catch interrupt so that we can shut down gracefully
+	signal(SIGINT, sigint_handler);
+
 	// Create a finder
 	NDIlib_find_instance_t pNDI_find = NDIlib_find_create_v2();
 	if (!pNDI_find)
@@ -29,13 +113,19 @@ int main(int argc, char* argv[])
 	// Wait until there is one source
 	uint32_t no_sources = 0;
 	const NDIlib_source_t* p_sources = NULL;
-	while (!no_sources) {
+	while (!exit_loop && !no_sources) {
 		// Wait until the sources on the network have changed
 		printf("Looking for sources ...\n");
 		NDIlib_find_wait_for_sources(pNDI_find, 1000/* One second */);
 		p_sources = NDIlib_find_get_current_sources(pNDI_find, &no_sources);
 	}
 
+	if (!no_sources) {
+		NDIlib_find_destroy(pNDI_find);
+		NDIlib_destroy();
+		return 0;
+	}
+
 	// We now have at least one source, so we create a receiver to look at it.
 	NDIlib_recv_create_v3_t recv_desc;
 	recv_desc.color_format = NDIlib_recv_color_format_RGBX_RGBA;
@@ -49,16 +139,64 @@ int main(int argc, char* argv[])
 	// Destroy the NDI finder. We needed to have access to the pointers to p_sources[0]
 	NDIlib_find_destroy(pNDI_find);
 
-	// We wait for up to a minute to receive a video frame
-	NDIlib_video_frame_v2_t video_frame;
-	if (NDIlib_recv_capture_v2(pNDI_recv, &video_frame, nullptr, nullptr, 60000) == NDIlib_frame_type_video) {
-		// If we have stride that does not match the width then we'd need to make a copy, but this is just test
-		// code so this will have to do for now in this example.
-		assert(video_frame.line_stride_in_bytes == video_frame.xres * 4);
-		lodepng_encode_file("CoolNDIImage.png", video_frame.p_data, video_frame.xres, video_frame.yres, LCT_RGBA, 8);
+	// The PNG writer, with the frames that are waiting to be written when we are writing them on a worker thread. The
+	// worker holds on to each frame until it is written and then frees it.
+	ndi_png::writer png_writer(compression, no_threads);
+	printf("Writing with %s compression on %d threads%s.\n", ndi_png::compression_name(compression), png_writer.no_threads(), async ? ", on a worker thread" : "");
+
+	struct pending_t {
+		NDIlib_video_frame_v2_t frame;
+		int frame_no;
+	};
+	ndi_thread::bounded_queue<pending_t> pending(1);
+	std::thread writer_thread;
+	if (async) {
+		writer_thread = std::thread([&]() {
+			pending_t item;
+			while (pending.pop(item)) {
+				write_frame(png_writer, get_filename(output, item.frame_no, no_frames), item.frame);
+				NDIlib_recv_free_video_v2(pNDI_recv, &item.frame);
+			}
+		});
+	}
+
+	// Receive until we have saved enough frames, giving up if there is no video for a minute
+	using namespace std::chrono;
+	int frame_no = 0, no_skipped = 0;
+	auto last_video = steady_clock::now(), next_frame = steady_clock::now();
+	while (!exit_loop && (frame_no < no_frames) && (steady_clock::now() - last_video < minutes(1))) {
+		NDIlib_video_frame_v2_t video_frame;
+		if (NDIlib_recv_capture_v2(pNDI_recv, &video_frame, nullptr, nullptr, 1000) != NDIlib_frame_type_video)
+			continue;
+		last_video = steady_clock::now();
+
+		// Is this a frame that we want
+		if ((last_video < next_frame) || !ndi_png::is_supported(video_frame.FourCC)) {
+			NDIlib_recv_free_video_v2(pNDI_recv, &video_frame);
+			continue;
+		}
+
+		if (!async) {
+			// Write it here, and free the data
+			write_frame(png_writer, get_filename(output, frame_no, no_frames), video_frame);
+			NDIlib_recv_free_video_v2(pNDI_recv, &video_frame);
+		} else if (!pending.try_push(pending_t{ video_frame, frame_no })) {
+			// The worker is still busy, so we try again with the next frame
+			NDIlib_recv_free_video_v2(pNDI_recv, &video_frame);
+			no_skipped++;
+			continue;
+		}
+
+		frame_no++;
+		next_frame = last_video + milliseconds(interval_ms);
+	}
 
-		// Free the data 
-		NDIlib_recv_free_video_v2(pNDI_recv, &video_frame);
+	// Wait for the worker to write what it has
+	if (async) {
+		pending.close();
+		writer_thread.join();
+		if (no_skipped)
+			printf("%d frames were skipped while the worker was busy.\n", no_skipped);
 	}
 
 	// Destroy the receiver
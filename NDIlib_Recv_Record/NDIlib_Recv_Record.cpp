@@ -0,0 +1,238 @@
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <Processing.NDI.Lib.h>
+
+#include "../NDIlib_Common/NDIlib_Record.h"
+#include "../NDIlib_Common/NDIlib_Thread.h"
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#define strcasecmp _stricmp
+#else
+#include <strings.h>
+#endif // _WIN32
+
+// This records a source, with its video, audio and metadata frames exactly as the receiver sees them, so that it can
+// be played back bit for bit by NDIlib_Send_Playback. Each frame is kept with when it was received, and with its
+// timecode and timestamp, in a recording that can be memory mapped (see NDIlib_Record.h).
+//
+// Frames are written by a worker thread, so that the receiver never waits for the disk. The worker frees each frame once
+// it has been written, and when the disk cannot keep up and the queue in front of it is full the frames are dropped,
+// and counted, rather than holding up the receiver. Fields are received as whole frames.
+//		-output <file>						The recording (default Recording.ndirec).
+//		-source <name>						Record the first source whose name contains this (default the first source).
+//		-duration <seconds>					How long to record for (default until interrupted).
+//		-format fastest|best				The color format to receive (default fastest).
+//		-queue <n>							The number of frames that can wait for the disk (default 32).
+
+static std::atomic<bool> exit_loop(false);
+static void sigint_handler(int)
+{
+	exit_loop = true;
+}
+
+// A frame that is waiting to be written
+struct captured_t {
+	NDIlib_frame_type_e type;
+	NDIlib_video_frame_v2_t video;
+	NDIlib_audio_frame_v2_t audio;
+	NDIlib_metadata_frame_t metadata;
+	int64_t time;
+};
+
+int main(int argc, char* argv[])
+{
+	// The settings
+	std::string output = "Recording.ndirec";
+	const char* p_source_filter = NULL;
+	int duration_s = 0, queue_size = 32;
+	NDIlib_recv_color_format_e color_format = NDIlib_recv_color_format_fastest;
+	for (int i = 1; i < argc - 1; i++) {
+		if (strcasecmp(argv[i], "-output") == 0)
+			output = argv[++i];
+		else if (strcasecmp(argv[i], "-source") == 0)
+			p_source_filter = argv[++i];
+		else if (strcasecmp(argv[i], "-duration") == 0)
+			duration_s = std::max(0, atoi(argv[++i]));
+		else if (strcasecmp(argv[i], "-queue") == 0)
+			queue_size = std::max(1, atoi(argv[++i]));
+		else if (strcasecmp(argv[i], "-format") == 0) {
+			i++;
+			if (strcasecmp(argv[i], "fastest") == 0)
+				color_format = NDIlib_recv_color_format_fastest;
+			else if (strcasecmp(argv[i], "best") == 0)
+				color_format = NDIlib_recv_color_format_best;
+			else {
+				printf("Unknown format %s, it should be fastest or best.\n", argv[i]);
+				return 0;
+			}
+		}
+	}
+
+	// Not required, but "correct" (see the SDK documentation).
+	if (!NDIlib_initialize())
+		return 0;
+
+	// Catch interrupt so that we can shut down gracefully
+	signal(SIGINT, sigint_handler);
+
+	// Create a finder
+	NDIlib_find_instance_t pNDI_find = NDIlib_find_create_v2();
+	if (!pNDI_find)
+		return 0;
+
+	// Wait until the source that we want is there
+	const NDIlib_source_t* p_source = NULL;
+	while (!exit_loop && !p_source) {
+		printf("Looking for sources ...\n");
+		NDIlib_find_wait_for_sources(pNDI_find, 1000/* One second */);
+
+		uint32_t no_sources = 0;
+		const NDIlib_source_t* p_sources = NDIlib_find_get_current_sources(pNDI_find, &no_sources);
+		for (uint32_t i = 0; !p_source && (i < no_sources); i++) {
+			if (!p_source_filter || strstr(p_sources[i].p_ndi_name, p_source_filter))
+				p_source = p_sources + i;
+		}
+	}
+
+	if (!p_source) {
+		NDIlib_find_destroy(pNDI_find);
+		NDIlib_destroy();
+		return 0;
+	}
+
+	// Start the recording
+	ndi_record::writer recording;
+	if (!recording.open(output, p_source->p_ndi_name)) {
+		printf("Cannot write %s.\n", output.c_str());
+		NDIlib_find_destroy(pNDI_find);
+		NDIlib_destroy();
+		return 0;
+	}
+
+	// We now have the source, so we create a receiver to look at it.
+	NDIlib_recv_create_v3_t recv_desc;
+	recv_desc.color_format = color_format;
+	recv_desc.allow_video_fields = false;
+	NDIlib_recv_instance_t pNDI_recv = NDIlib_recv_create_v3(&recv_desc);
+	if (!pNDI_recv)
+		return 0;
+
+	// Connect to our source
+	printf("Recording %s to %s.\n", p_source->p_ndi_name, output.c_str());
+	NDIlib_recv_connect(pNDI_recv, p_source);
+
+	// Destroy the NDI finder. We needed to have access to the pointers to the source
+	NDIlib_find_destroy(pNDI_find);
+
+	// The worker that writes the frames and then gives them back to NDI
+	ndi_thread::bounded_queue<captured_t> captured(queue_size);
+	std::atomic<bool> write_failed(false);
+	std::atomic<uint64_t> bytes_written(0);
+	std::thread writer_thread([&]() {
+		captured_t frame;
+		while (captured.pop(frame)) {
+			// Once a write has failed the frames are only given back
+			bool ok = true;
+			switch (frame.type) {
+				case NDIlib_frame_type_video:
+					if (!write_failed)
+						ok = recording.write_video(frame.video, frame.time);
+					NDIlib_recv_free_video_v2(pNDI_recv, &frame.video);
+					break;
+				case NDIlib_frame_type_audio:
+					if (!write_failed)
+						ok = recording.write_audio(frame.audio, frame.time);
+					NDIlib_recv_free_audio_v2(pNDI_recv, &frame.audio);
+					break;
+				default:
+					if (!write_failed)
+						ok = recording.write_metadata(frame.metadata, frame.time);
+					NDIlib_recv_free_metadata(pNDI_recv, &frame.metadata);
+					break;
+			}
+
+			bytes_written = recording.size();
+
+			// A frame that could not be written is most likely a full disk, so we stop
+			if (!ok) {
+				printf("Cannot write to %s, the recording is stopping.\n", output.c_str());
+				write_failed = true;
+				exit_loop = true;
+			}
+		}
+	});
+
+	// Receive until we are told to stop
+	using namespace std::chrono;
+	const auto start = steady_clock::now();
+	auto last_display = start;
+	int64_t no_video = 0, no_audio = 0, no_metadata = 0, no_dropped = 0;
+	while (!exit_loop && (!duration_s || (steady_clock::now() - start < seconds(duration_s)))) {
+		captured_t frame;
+		frame.type = NDIlib_recv_capture_v2(pNDI_recv, &frame.video, &frame.audio, &frame.metadata, 100);
+		frame.time = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+
+		switch (frame.type) {
+			case NDIlib_frame_type_video:
+			case NDIlib_frame_type_audio:
+			case NDIlib_frame_type_metadata:
+				if (captured.try_push(frame)) {
+					no_video += (frame.type == NDIlib_frame_type_video) ? 1 : 0;
+					no_audio += (frame.type == NDIlib_frame_type_audio) ? 1 : 0;
+					no_metadata += (frame.type == NDIlib_frame_type_metadata) ? 1 : 0;
+					break;
+				}
+
+				// The disk has not kept up
+				no_dropped++;
+				if (frame.type == NDIlib_frame_type_video)
+					NDIlib_recv_free_video_v2(pNDI_recv, &frame.video);
+				else if (frame.type == NDIlib_frame_type_audio)
+					NDIlib_recv_free_audio_v2(pNDI_recv, &frame.audio);
+				else
+					NDIlib_recv_free_metadata(pNDI_recv, &frame.metadata);
+				break;
+
+			default:
+				break;
+		}
+
+		// Display how we are doing once a second
+		if (steady_clock::now() - last_display >= seconds(1)) {
+			printf("%lld video, %lld audio and %lld metadata frames, %1.1fMB written, %d frames waiting for the disk, %lld dropped.\n",
+				(long long)no_video, (long long)no_audio, (long long)no_metadata, (double)bytes_written / (1024.0 * 1024.0),
+				(int)captured.size(), (long long)no_dropped);
+			last_display = steady_clock::now();
+		}
+	}
+
+	// Write what is left and finish the recording
+	captured.close();
+	writer_thread.join();
+	const size_t no_frames = recording.no_frames();
+	if (!recording.close() || write_failed)
+		printf("The recording is not complete, NDIlib_Send_Playback can still play the frames that were written.\n");
+	else
+		printf("Recorded %llu frames to %s, %lld were dropped.\n", (unsigned long long)no_frames, output.c_str(), (long long)no_dropped);
+
+	// Destroy the receiver
+	NDIlib_recv_destroy(pNDI_recv);
+
+	// Not required, but nice
+	NDIlib_destroy();
+
+	// Finished
+	return 0;
+}
@@ -0,0 +1,392 @@
+#include <cctype>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Processing.NDI.Lib.h>
+
+#include "../NDIlib_Common/NDIlib_Benchmark.h"
+#include "../NDIlib_Common/NDIlib_Color.h"
+#include "../NDIlib_Common/NDIlib_PNG.h"
+#include "../NDIlib_Common/NDIlib_Scale.h"
+#include "../NDIlib_Common/NDIlib_Thread.h"
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#define strcasecmp _stricmp
+#else
+#include <strings.h>
+#include "../NDIlib_Recv_PNG/LodePNG/lodepng.cpp"
+#endif // _WIN32
+
+// This keeps a PNG thumbnail of every NDI source on the network up to date, for a monitoring wall. It runs until it is
+// interrupted, and picks up sources as they come and go.
+//
+// Every source has a receiver at the lowest bandwidth, which is the small proxy stream that NDI sends for multiviewers,
+// with a frame-sync in front of it so that the newest frame can be taken whenever we want one without waiting. When a
+// source is due, it is handed to a small pool of workers, which take its frame, scale it down and write the PNG. The
+// frame is given back to NDI as soon as it is scaled, and the PNG is written to a temporary file that is then renamed,
+// so that whatever reads the thumbnails never sees half of one. Nothing happens for a source between thumbnails other
+// than what NDI does itself, which is what lets this watch hundreds of sources on a fraction of a core.
+//		-output <folder>					Where to write the thumbnails (default the current folder).
+//		-width <n> -height <n>				The size of the thumbnails (default 320 wide, with the height from the aspect
+//											ratio of the source when it is not given).
+//		-interval <ms>						The time between thumbnails of each source (default 5000).
+//		-interval <name>=<ms>				The time between thumbnails of the sources whose names contain this, which can
+//											be given more than once.
+//		-workers <n>						The number of worker threads (default 2).
+//		-filter auto|box|bilinear			How to scale (default auto).
+//		-compression none|fast|best			How hard to compress (default fast).
+//		-source <name>						Only watch the sources whose names contain this.
+
+static std::atomic<bool> exit_loop(false);
+static void sigint_handler(int)
+{
+	exit_loop = true;
+}
+
+// The interval for the sources whose names contain a string
+struct interval_t {
+	std::string name;
+	int interval_ms;
+};
+
+// A source that we are watching. It is shared with a worker while a thumbnail is being made, so that it can be
+// forgotten about while that happens.
+struct source_t {
+	source_t(const std::string& name, const int interval_ms) : m_name(name), m_interval_ms(interval_ms), m_late(false), m_busy(false), m_no_thumbnails(0)
+	{
+		NDIlib_source_t source;
+		source.p_ndi_name = m_name.c_str();
+
+		// The lowest bandwidth is enough for a thumbnail, and we want to be able to write it without converting it
+		NDIlib_recv_create_v3_t recv_desc;
+		recv_desc.source_to_connect_to = source;
+		recv_desc.color_format = NDIlib_recv_color_format_RGBX_RGBA;
+		recv_desc.bandwidth = NDIlib_recv_bandwidth_lowest;
+		recv_desc.p_ndi_recv_name = "Example Thumbnails";
+		m_pNDI_recv = NDIlib_recv_create_v3(&recv_desc);
+		m_pNDI_framesync = m_pNDI_recv ? NDIlib_framesync_create(m_pNDI_recv) : NULL;
+
+		// The name of the file, without anything in it that would not be allowed in a filename
+		for (const char c : m_name)
+			m_filename += isalnum((unsigned char)c) ? c : '_';
+		m_filename += ".png";
+	}
+
+	~source_t(void)
+	{
+		if (m_pNDI_framesync)
+			NDIlib_framesync_destroy(m_pNDI_framesync);
+		if (m_pNDI_recv)
+			NDIlib_recv_destroy(m_pNDI_recv);
+	}
+
+	const std::string m_name;
+	std::string m_filename;
+	const int m_interval_ms;
+
+	NDIlib_recv_instance_t m_pNDI_recv;
+	NDIlib_framesync_instance_t m_pNDI_framesync;
+
+	// When the next thumbnail is due, whether it is waiting for a worker, and whether a worker has it. Only m_busy is
+	// used by the workers.
+	std::chrono::steady_clock::time_point m_next, m_last_seen;
+	bool m_late;
+	std::atomic<bool> m_busy;
+	std::atomic<int> m_no_thumbnails;
+};
+
+// The settings that the workers need
+struct thumbnail_settings_t {
+	std::string output;
+	int xres, yres;
+	ndi_scale::filter_e filter;
+	ndi_png::compression_e compression;
+};
+
+// The statistics that are displayed
+struct thumbnail_stats_t {
+	thumbnail_stats_t(void) : m_no_written(0), m_no_empty(0), m_no_failed(0), m_scale_ns(0), m_write_ns(0) {}
+
+	std::atomic<int64_t> m_no_written, m_no_empty, m_no_failed;
+	std::atomic<int64_t> m_scale_ns, m_write_ns;
+};
+
+// Make a thumbnail of a source. The scaler, converter, writer and buffers belong to the worker, so that once it has seen
+// a size it does not allocate again.
+struct thumbnail_worker_t {
+	thumbnail_worker_t(const thumbnail_settings_t& settings, thumbnail_stats_t& stats)
+		: m_settings(settings), m_stats(stats), m_color_converter(ndi_color::matrix_bt709, ndi_color::range_limited, 1), m_png_writer(settings.compression, 1)
+	{
+	}
+
+	void make_thumbnail(source_t& source)
+	{
+		using namespace std::chrono;
+
+		// Take the newest frame, there is not one until the source has sent something
+		NDIlib_video_frame_v2_t video_frame;
+		NDIlib_framesync_capture_video(source.m_pNDI_framesync, &video_frame, NDIlib_frame_format_type_progressive);
+		if (!video_frame.p_data) {
+			NDIlib_framesync_free_video(source.m_pNDI_framesync, &video_frame);
+			m_stats.m_no_empty++;
+			return;
+		}
+
+		// The size of the thumbnail, with the aspect ratio of the source unless we were told both sizes
+		const float aspect = (video_frame.picture_aspect_ratio > 0.0f) ? video_frame.picture_aspect_ratio : (float)video_frame.xres / (float)video_frame.yres;
+		const int xres = m_settings.xres ? m_settings.xres : std::max(1, (int)(m_settings.yres * aspect + 0.5f));
+		const int yres = m_settings.yres ? m_settings.yres : std::max(1, (int)(m_settings.xres / aspect + 0.5f));
+
+		// Scale it, converting it to RGBA first when it is not already one of the formats with four bytes per pixel
+		const auto start_scale = steady_clock::now();
+		bool ok = true;
+		NDIlib_video_frame_v2_t src_frame = video_frame;
+		if (!ndi_scale::is_supported(video_frame.FourCC)) {
+			m_rgba.resize((size_t)video_frame.xres * video_frame.yres * 4);
+			src_frame.FourCC = NDIlib_FourCC_type_RGBA;
+			src_frame.p_data = m_rgba.data();
+			ok = m_color_converter.convert(&video_frame, &src_frame);
+		}
+
+		NDIlib_video_frame_v2_t thumbnail_frame(xres, yres);
+		m_thumbnail.resize((size_t)xres * yres * 4);
+		thumbnail_frame.p_data = m_thumbnail.data();
+		thumbnail_frame.line_stride_in_bytes = xres * 4;
+		ok = ok && m_scaler.scale(src_frame, thumbnail_frame, m_settings.filter);
+
+		// We are done with the frame
+		NDIlib_framesync_free_video(source.m_pNDI_framesync, &video_frame);
+		m_stats.m_scale_ns += duration_cast<nanoseconds>(steady_clock::now() - start_scale).count();
+
+		// Write it next to where it goes and then move it into place
+		const auto start_write = steady_clock::now();
+		const std::string filename = m_settings.output + "/" + source.m_filename;
+		const std::string temp_filename = filename + ".tmp";
+		ok = ok && m_png_writer.write(temp_filename.c_str(), thumbnail_frame);
+#ifdef _WIN32
+		if (ok)
+			remove(filename.c_str());
+#endif
+		ok = ok && !rename(temp_filename.c_str(), filename.c_str());
+		m_stats.m_write_ns += duration_cast<nanoseconds>(steady_clock::now() - start_write).count();
+
+		if (ok) {
+			source.m_no_thumbnails++;
+			m_stats.m_no_written++;
+		} else {
+			m_stats.m_no_failed++;
+		}
+	}
+
+	const thumbnail_settings_t& m_settings;
+	thumbnail_stats_t& m_stats;
+
+	ndi_scale::scaler m_scaler;
+	ndi_color::converter m_color_converter;
+	ndi_png::writer m_png_writer;
+	std::vector<uint8_t> m_rgba, m_thumbnail;
+};
+
+int main(int argc, char* argv[])
+{
+	// The settings
+	thumbnail_settings_t settings = { ".", 320, 0, ndi_scale::filter_auto, ndi_png::compression_fast };
+	int default_interval_ms = 5000, no_workers = 2;
+	std::vector<interval_t> intervals;
+	const char* p_source_filter = NULL;
+	for (int i = 1; i < argc - 1; i++) {
+		if (strcasecmp(argv[i], "-output") == 0)
+			settings.output = argv[++i];
+		else if (strcasecmp(argv[i], "-width") == 0)
+			settings.xres = std::max(0, atoi(argv[++i]));
+		else if (strcasecmp(argv[i], "-height") == 0)
+			settings.yres = std::max(0, atoi(argv[++i]));
+		else if (strcasecmp(argv[i], "-workers") == 0)
+			no_workers = std::max(1, atoi(argv[++i]));
+		else if (strcasecmp(argv[i], "-source") == 0)
+			p_source_filter = argv[++i];
+		else if (strcasecmp(argv[i], "-interval") == 0) {
+			const std::string value = argv[++i];
+			const size_t equals = value.rfind('=');
+			if (equals == std::string::npos)
+				default_interval_ms = std::max(1, atoi(value.c_str()));
+			else
+				intervals.push_back(interval_t{ value.substr(0, equals), std::max(1, atoi(value.c_str() + equals + 1)) });
+		} else if (strcasecmp(argv[i], "-filter") == 0) {
+			if (!ndi_scale::parse_filter(argv[++i], settings.filter)) {
+				printf("Unknown filter %s, it should be auto, box or bilinear.\n", argv[i]);
+				return 0;
+			}
+		} else if (strcasecmp(argv[i], "-compression") == 0) {
+			if (!ndi_png::parse_compression(argv[++i], settings.compression)) {
+				printf("Unknown compression %s, it should be none, fast or best.\n", argv[i]);
+				return 0;
+			}
+		}
+	}
+
+	if (!settings.xres && !settings.yres) {
+		printf("The thumbnails need a width or a height.\n");
+		return 0;
+	}
+
+	// Not required, but "correct" (see the SDK documentation).
+	if (!NDIlib_initialize())
+		return 0;
+
+	// Catch interrupt so that we can shut down gracefully
+	signal(SIGINT, sigint_handler);
+
+	// Create a finder
+	NDIlib_find_instance_t pNDI_find = NDIlib_find_create_v2();
+	if (!pNDI_find)
+		return 0;
+
+	// The workers take the sources that are due from a queue. It holds one source per worker, so when they fall behind
+	// the sources wait their turn here rather than piling up.
+	thumbnail_stats_t stats;
+	ndi_thread::bounded_queue<std::shared_ptr<source_t>> due(no_workers);
+	std::vector<std::thread> workers;
+	for (int i = 0; i < no_workers; i++) {
+		workers.push_back(std::thread([&]() {
+			thumbnail_worker_t worker(settings, stats);
+			std::shared_ptr<source_t> p_source;
+			while (due.pop(p_source)) {
+				worker.make_thumbnail(*p_source);
+				p_source->m_busy = false;
+				p_source.reset();
+			}
+		}));
+	}
+
+	char size[64];
+	if (settings.xres && settings.yres)
+		snprintf(size, sizeof(size), "%dx%d", settings.xres, settings.yres);
+	else if (settings.xres)
+		snprintf(size, sizeof(size), "%d wide", settings.xres);
+	else
+		snprintf(size, sizeof(size), "%d high", settings.yres);
+	printf("Writing %s thumbnails to %s every %dms with %d workers.\n", size, settings.output.c_str(), default_interval_ms, no_workers);
+
+	// The sources that we are watching. One that has not been on the network for a minute is forgotten about.
+	using namespace std::chrono;
+	std::vector<std::shared_ptr<source_t>> sources;
+	int64_t no_late = 0;
+	auto last_display = steady_clock::now();
+	int64_t last_written = 0;
+	double last_cpu_seconds = ndi_benchmark::process_cpu_seconds();
+
+	while (!exit_loop) {
+		// Look for new sources, this also waits for a short while between passes over the sources
+		NDIlib_find_wait_for_sources(pNDI_find, 100);
+		uint32_t no_sources = 0;
+		const NDIlib_source_t* p_sources = NDIlib_find_get_current_sources(pNDI_find, &no_sources);
+		const auto now = steady_clock::now();
+
+		for (uint32_t i = 0; i < no_sources; i++) {
+			const std::string name = p_sources[i].p_ndi_name;
+			if (p_source_filter && !strstr(name.c_str(), p_source_filter))
+				continue;
+
+			auto p_source = std::find_if(sources.begin(), sources.end(), [&](const std::shared_ptr<source_t>& p) { return p->m_name == name; });
+			if (p_source != sources.end()) {
+				(*p_source)->m_last_seen = now;
+				continue;
+			}
+
+			// A new source, which gets the interval of the first name that matches it
+			int interval_ms = default_interval_ms;
+			for (const interval_t& interval : intervals) {
+				if (strstr(name.c_str(), interval.name.c_str())) {
+					interval_ms = interval.interval_ms;
+					break;
+				}
+			}
+
+			std::shared_ptr<source_t> p_new_source = std::make_shared<source_t>(name, interval_ms);
+			if (!p_new_source->m_pNDI_framesync)
+				continue;
+
+			// The first thumbnail is a second after connecting, so that there is a frame
+			p_new_source->m_last_seen = now;
+			p_new_source->m_next = now + seconds(1);
+			sources.push_back(p_new_source);
+			printf("Watching %s every %dms.\n", name.c_str(), interval_ms);
+		}
+
+		// Forget about the sources that have gone
+		for (size_t i = 0; i < sources.size();) {
+			if (now - sources[i]->m_last_seen > minutes(1)) {
+				printf("%s has gone.\n", sources[i]->m_name.c_str());
+				sources.erase(sources.begin() + i);
+			} else {
+				i++;
+			}
+		}
+
+		// Hand the sources that are due to the workers. When they are all busy, a source waits until the next pass.
+		for (auto& p_source : sources) {
+			if ((now < p_source->m_next) || p_source->m_busy)
+				continue;
+
+			p_source->m_busy = true;
+			if (!due.try_push(p_source)) {
+				p_source->m_busy = false;
+				if (!p_source->m_late)
+					no_late++;
+				p_source->m_late = true;
+				continue;
+			}
+			p_source->m_late = false;
+
+			// The next one is due an interval after this one was meant to be, unless we have fallen a whole interval
+			// behind, in which case it is an interval from now
+			p_source->m_next += milliseconds(p_source->m_interval_ms);
+			if (p_source->m_next < now)
+				p_source->m_next = now + milliseconds(p_source->m_interval_ms);
+		}
+
+		// Display how we are doing every ten seconds
+		if (now - last_display >= seconds(10)) {
+			const double seconds = duration<double>(now - last_display).count();
+			const double cpu_seconds = ndi_benchmark::process_cpu_seconds();
+			const int64_t no_written = stats.m_no_written;
+			printf("%d sources, %1.1f thumbnails a second (scale %1.2fms, write %1.2fms), %lld late, %lld without video, %lld failed, %1.1f%% of a core.\n",
+				(int)sources.size(), (double)(no_written - last_written) / seconds,
+				no_written ? 1e-6 * (double)stats.m_scale_ns / (double)no_written : 0.0, no_written ? 1e-6 * (double)stats.m_write_ns / (double)no_written : 0.0,
+				(long long)no_late, (long long)stats.m_no_empty, (long long)stats.m_no_failed, 100.0 * (cpu_seconds - last_cpu_seconds) / seconds);
+
+			last_display = now;
+			last_written = no_written;
+			last_cpu_seconds = cpu_seconds;
+		}
+	}
+
+	// Stop the workers, and then the sources are destroyed with the last reference to them
+	due.close();
+	for (auto& worker : workers)
+		worker.join();
+	sources.clear();
+
+	// Destroy the NDI finder
+	NDIlib_find_destroy(pNDI_find);
+
+	// Not required, but nice
+	NDIlib_destroy();
+
+	// Finished
+	return 0;
+}
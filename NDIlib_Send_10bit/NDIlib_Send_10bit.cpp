@@ -1,9 +1,18 @@
+#include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <thread>
+#include <vector>
 #include <Processing.NDI.Lib.h>
 
+#include "../NDIlib_Common/NDIlib_FramePool.h"
+#include "../NDIlib_Common/NDIlib_Thread.h"
+#include "../NDIlib_Common/NDIlib_V210.h"
+
 #ifdef _WIN32
 #ifdef _WIN64
 #pragma comment(lib, "Processing.NDI.Lib.x64.lib")
@@ -12,83 +21,225 @@
 #endif // _WIN64
 #endif // _WIN32
 
-void fill_line_v210(uint8_t* p_line, const int xres, const uint16_t y, const uint16_t u, const uint16_t v)
+// This sends 10 bit video that starts out as V210, which is what SDI hardware delivers. The frames are built as 16 bit
+// 4:2:2 and then packed into V210 with SIMD across several CPUs. V210 is then unpacked into P216 for NDI in the same
+// way, straight into a pool of buffers that are sent asynchronously.
+//
+// These run as a pipeline of three stages, each on its own thread, so that while frame N is being sent (and compressed
+// by NDI), frame N+1 is being converted and frame N+2 is being generated :
+//		generate	Build the next V210 frame, which is where capturing from an SDI card would be.
+//		convert		Unpack V210 into a P216 buffer from the pool.
+//		send		Send the P216 buffers in order, clocked at 59.94Hz.
+// The stages are joined by bounded queues, so a stage that gets ahead waits for the one after it rather than using more
+// memory, and the number of P216 buffers bounds how far the conversion can run ahead of the sending.
+//		-xres <n> -yres <n>		The resolution (default 1920x1080).
+//		-threads <n>			The number of threads that pack and that unpack each frame (default half of the CPUs each,
+//								since the two stages run at the same time).
+//		-buffers <n>			The number of P216 buffers (default 4).
+
+static std::atomic<bool> exit_loop(false);
+static void sigint_handler(int)
 {
-	for (int N = xres; ; N -= 6, p_line += 16) {
-		// The first 32bits
-		if (N < 1) return;
-		*(uint32_t*)(0 + p_line) = (u >> 6) | ((y >> 6) << 10) | ((v >> 6) << 20);
-
-		// The second 32bits
-		if (N < 3) return;
-		*(uint32_t*)(4 + p_line) = (y >> 6) | ((u >> 6) << 10) | ((y >> 6) << 20);
-
-		// The third 32bits
-		if (N < 4) return;
-		*(uint32_t*)(8 + p_line) = (v >> 6) | ((y >> 6) << 10) | ((u >> 6) << 20);
-
-		// The third 32bits
-		if (N < 6) return;
-		*(uint32_t*)(12 + p_line) = (y >> 6) | ((v >> 6) << 10) | ((y >> 6) << 20);
-	}
+	exit_loop = true;
 }
 
+// The time that a stage is busy for, so that we can see which one limits the frame-rate
+struct stage_time_t {
+	stage_time_t(void) : m_ns(0), m_frames(0) {}
+
+	void add(const std::chrono::steady_clock::time_point start)
+	{
+		m_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		m_frames++;
+	}
+
+	// Get the average time in milliseconds since the last call
+	double take_ms(void)
+	{
+		const int64_t ns = m_ns.exchange(0), frames = m_frames.exchange(0);
+		return frames ? (double)ns * 1e-6 / (double)frames : 0.0;
+	}
+
+	std::atomic<int64_t> m_ns, m_frames;
+};
+
 int main(int argc, char* argv[])
 {
+	// The settings
+	int xres = 1920, yres = 1080, no_threads = 0;
+	ndi_frame_pool::options pool_options;
+	pool_options.m_no_buffers = 4;
+	for (int i = 1; i < argc - 1; i++) {
+		if (strcasecmp(argv[i], "-xres") == 0)
+			xres = atoi(argv[++i]) & ~1;
+		else if (strcasecmp(argv[i], "-yres") == 0)
+			yres = atoi(argv[++i]);
+		else if (strcasecmp(argv[i], "-threads") == 0)
+			no_threads = atoi(argv[++i]);
+		else if (strcasecmp(argv[i], "-buffers") == 0)
+			pool_options.m_no_buffers = atoi(argv[++i]);
+	}
+
+	if ((xres <= 0) || (yres <= 0)) {
+		printf("Invalid resolution.\n");
+		return 0;
+	}
+
+	// Packing and unpacking overlap, so by default they share the CPUs rather than each having all of them
+	if (no_threads <= 0)
+		no_threads = std::max(1, ndi_thread::no_cpus() / 2);
+
 	// Not required, but "correct" (see the SDK documentation).
 	if (!NDIlib_initialize())
 		return 0;
 
+	// Catch interrupt so that we can shut down gracefully
+	signal(SIGINT, sigint_handler);
+
 	// We create the NDI sender
 	NDIlib_send_instance_t pNDI_send = NDIlib_send_create();
 	if (!pNDI_send)
 		return 0;
 
-	// We are going to create a 1920x1080 frame in V210 (10 bit packed)
-	NDIlib_video_frame_v2_t NDI_video_frame_10bit;
-	NDI_video_frame_10bit.xres = 1920;
-	NDI_video_frame_10bit.yres = 1080;
-	NDI_video_frame_10bit.FourCC = (NDIlib_FourCC_video_type_e)NDI_LIB_FOURCC('V', '2', '1', '0');
-
+	// We are going to create frames in V210 (10 bit packed). There are three of them, so that one can be generated while
+	// one waits to be converted and another is being converted.
 	// The format of V210 is :
 	// [10 bits U0] [10 bits Y0] [10 bits V0] [2 bits unused] [10 bits Y1] [10 bits U2] [10 bits Y2] [2 bits unused] etc...
-	NDI_video_frame_10bit.line_stride_in_bytes = (NDI_video_frame_10bit.xres * sizeof(uint32_t) * 4 + /* Round up !*/5) / 6;
-	NDI_video_frame_10bit.p_data = (uint8_t*)malloc(NDI_video_frame_10bit.line_stride_in_bytes * NDI_video_frame_10bit.yres);
-
-	// We have a PA12 output
-	NDIlib_video_frame_v2_t NDI_video_frame_16bit;
-	NDI_video_frame_16bit.xres = NDI_video_frame_10bit.xres;
-	NDI_video_frame_16bit.yres = NDI_video_frame_10bit.yres;
+	// with each line padded to a multiple of 48 pixels.
+	const int no_v210_frames = 3;
+	const int v210_stride_in_bytes = ndi_v210::line_stride(xres);
+	std::vector<std::vector<uint8_t>> v210_frames(no_v210_frames, std::vector<uint8_t>((size_t)v210_stride_in_bytes * yres));
+
+	// We have a P216 output, which is converted into buffers from a pool
+	const int p216_stride_in_bytes = xres * sizeof(uint16_t);
+	ndi_frame_pool::frame_pool p216_buffers(pNDI_send, (size_t)p216_stride_in_bytes * 2 * yres, pool_options);
+	if (!p216_buffers.valid()) {
+		printf("Cannot allocate the frame buffers.\n");
+		NDIlib_send_destroy(pNDI_send);
+		NDIlib_destroy();
+		return 0;
+	}
 
-	NDI_video_frame_16bit.line_stride_in_bytes = NDI_video_frame_16bit.xres * sizeof(uint16_t);
-	NDI_video_frame_16bit.p_data = (uint8_t*)malloc(NDI_video_frame_16bit.line_stride_in_bytes * 2 * NDI_video_frame_16bit.yres);
+	// The queues between the stages. Empty V210 frames go round from the converter back to the generator.
+	ndi_thread::bounded_queue<int> v210_free(no_v210_frames), v210_ready(no_v210_frames);
+	ndi_thread::bounded_queue<uint8_t*> p216_ready(p216_buffers.no_buffers());
+	for (int i = 0; i < no_v210_frames; i++)
+		v210_free.push(i);
+
+	stage_time_t generate_time, convert_time, send_time;
+
+	// The first stage generates frames in V210
+	std::thread generate_thread([&]() {
+		// The source picture is built in 16 bit P216 (a Y plane followed by an interleaved UV plane), starting out black.
+		// Only the white line moves from frame to frame, so that is all we change before packing it.
+		const int src_stride_in_bytes = xres * sizeof(uint16_t);
+		std::vector<uint16_t> src_p216((size_t)xres * yres * 2);
+		std::fill_n(src_p216.begin(), (size_t)xres * yres, (uint16_t)4096);
+		std::fill(src_p216.begin() + (size_t)xres * yres, src_p216.end(), (uint16_t)32768);
+
+		ndi_v210::converter v210_packer(no_threads);
+
+		int v210_frame;
+		for (int frame_no = 0; !exit_loop && v210_free.pop(v210_frame); frame_no++) {
+			const auto start = std::chrono::steady_clock::now();
+
+			// Move the white line down
+			const int white_line_y = frame_no % yres;
+			const int last_line_y = (frame_no + yres - 1) % yres;
+			std::fill_n(src_p216.begin() + (size_t)last_line_y * xres, xres, (uint16_t)4096);
+			std::fill_n(src_p216.begin() + (size_t)white_line_y * xres, xres, (uint16_t)60160);
+
+			// Pack it into V210
+			v210_packer.pack_p216(v210_frames[v210_frame].data(), v210_stride_in_bytes,
+				(const uint8_t*)src_p216.data(), src_stride_in_bytes, xres, yres);
+			generate_time.add(start);
+
+			if (!v210_ready.push(v210_frame))
+				break;
+		}
+		v210_ready.close();
+	});
+
+	// The second stage converts them into P216
+	std::thread convert_thread([&]() {
+		ndi_v210::converter v210_converter(no_threads);
+		printf("Converting %dx%d V210 with %s on %d threads.\n", xres, yres, ndi_v210::simd_name(v210_converter.simd()), v210_converter.no_threads());
+
+		int v210_frame;
+		while (v210_ready.pop(v210_frame)) {
+			// This waits until there is a buffer that NDI is not using
+			uint8_t* p_p216 = p216_buffers.acquire();
+			const auto start = std::chrono::steady_clock::now();
+
+			NDIlib_video_frame_v2_t NDI_video_frame_10bit(xres, yres, (NDIlib_FourCC_video_type_e)NDI_LIB_FOURCC('V', '2', '1', '0'));
+			NDI_video_frame_10bit.p_data = v210_frames[v210_frame].data();
+			NDI_video_frame_10bit.line_stride_in_bytes = v210_stride_in_bytes;
+
+			NDIlib_video_frame_v2_t NDI_video_frame_16bit;
+			NDI_video_frame_16bit.p_data = p_p216;
+			NDI_video_frame_16bit.line_stride_in_bytes = p216_stride_in_bytes;
+			v210_converter.v210_to_p216(&NDI_video_frame_10bit, &NDI_video_frame_16bit);
+			convert_time.add(start);
+
+			// The V210 frame can be used again, and the P216 frame is ready to send
+			v210_free.push(v210_frame);
+			if (!p216_ready.push(p_p216)) {
+				p216_buffers.release(p_p216);
+				break;
+			}
+		}
+		v210_free.close();
+		p216_ready.close();
+	});
 
-	// Run for one minute
+	// The last stage sends them, on this thread, for five minutes. A frame is late when the earlier stages did not have
+	// it ready in time, so that it went out more than one and a half frames after the one before it.
 	int frame_no = 0;
+	int64_t no_late = 0;
 
 	using namespace std::chrono;
-	for (const auto start = high_resolution_clock::now(); high_resolution_clock::now() - start < minutes(5); frame_no++) {
-		// Get the current time
-		const auto start_send = high_resolution_clock::now();
-
-		// Cycle over the lines of the source
-		const int white_line_y = frame_no % NDI_video_frame_10bit.yres;
-		for (int y = 0; y < NDI_video_frame_10bit.yres; y++) {
-			// Get the line pointer
-			uint8_t* p_line = NDI_video_frame_10bit.p_data + y * NDI_video_frame_10bit.line_stride_in_bytes;
-			fill_line_v210(p_line, NDI_video_frame_10bit.xres, (y == white_line_y) ? 60160 : 4096, 32768, 32768);
+	const auto late_interval = nanoseconds(1001000000000LL * 3 / (60000 * 2));
+	auto last_display = steady_clock::now(), last_sent = steady_clock::now();
+	for (const auto start = steady_clock::now(); !exit_loop && (steady_clock::now() - start < minutes(5)); frame_no++) {
+		// Get the next frame
+		uint8_t* p_p216 = NULL;
+		if (!p216_ready.pop(p_p216))
+			break;
+
+		// We now submit the frame. Note that this call will be clocked so that we end up submitting at exactly 59.94fps.
+		const auto start_send = steady_clock::now();
+		NDIlib_video_frame_v2_t NDI_video_frame_16bit(xres, yres, NDIlib_FourCC_type_P216, 60000, 1001);
+		NDI_video_frame_16bit.p_data = p_p216;
+		NDI_video_frame_16bit.line_stride_in_bytes = p216_stride_in_bytes;
+		p216_buffers.send_video(NDI_video_frame_16bit);
+		send_time.add(start_send);
+
+		if (frame_no && (steady_clock::now() - last_sent > late_interval))
+			no_late++;
+		last_sent = steady_clock::now();
+
+		// Display how long each stage is taking once a second
+		if (steady_clock::now() - last_display >= seconds(1)) {
+			last_display = steady_clock::now();
+			printf("Frame %d : generate %1.2fms, convert %1.2fms, send %1.2fms, %d frames queued, %lld late.\n", frame_no,
+				generate_time.take_ms(), convert_time.take_ms(), send_time.take_ms(), (int)p216_ready.size(), (long long)no_late);
 		}
+	}
 
-		// Convert into the destination
-		NDIlib_util_V210_to_P216(&NDI_video_frame_10bit, &NDI_video_frame_16bit);
+	// Stop the pipeline. The buffers that were waiting to be sent, and the one that NDI has, are given back so that the
+	// converter is not left waiting for one, and then the stages drain and exit.
+	exit_loop = true;
+	v210_free.close();
+	v210_ready.close();
+	p216_ready.close();
 
-		// We now submit the frame. Note that this call will be clocked so that we end up submitting at exactly 29.97fps.
-		NDIlib_send_send_video_v2(pNDI_send, &NDI_video_frame_16bit);
-	}
+	uint8_t* p_p216 = NULL;
+	while (p216_ready.pop(p_p216))
+		p216_buffers.release(p_p216);
+	p216_buffers.flush();
 
-	// Free the video frame
-	free(NDI_video_frame_10bit.p_data);
-	free(NDI_video_frame_16bit.p_data);
+	generate_thread.join();
+	convert_thread.join();
 
 	// Destroy the NDI sender
 	NDIlib_send_destroy(pNDI_send);
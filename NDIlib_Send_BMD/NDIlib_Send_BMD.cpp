@@ -3,6 +3,7 @@
 #include <atomic>
 #include <chrono>
 #include <locale>
+#include <memory>
 #include <string>
 #include <thread>
 #include <utility>
@@ -10,6 +11,9 @@
 
 #include <Processing.NDI.Lib.h>
 
+#include "../NDIlib_Common/NDIlib_Color.h"
+#include "../NDIlib_Common/NDIlib_FramePool.h"
+
 #ifdef _WIN32
 
 #ifdef _WIN64
@@ -41,6 +45,7 @@ struct decklink_ndi_bridge : public IDeckLinkInputCallback {
 		, m_p_ndi_send(NULL)
 		, m_frame_rate_n(30000), m_frame_rate_d(1001)
 		, m_frame_format(NDIlib_frame_format_type_interleaved)
+		, m_pixel_format(bmdFormat8BitYUV)
 	{
 		// Going to keep a reference to this decklink device
 		m_p_decklink_input->AddRef();
@@ -60,6 +65,9 @@ struct decklink_ndi_bridge : public IDeckLinkInputCallback {
 
 	virtual ~decklink_ndi_bridge(void)
 	{
+		// The converted frames must be finished with before the sender goes
+		m_p_frame_pool.reset();
+
 		// Release the decklink device
 		if (m_p_decklink_input) {
 			m_p_decklink_input->StopStreams();
@@ -149,11 +157,22 @@ struct decklink_ndi_bridge : public IDeckLinkInputCallback {
 				break;
 		}
 
+		// An RGB signal is captured as BGRA and converted to UYVY ourselves, since UYVY is what NDI compresses natively
+		m_pixel_format = (detectedSignalFlags & bmdDetectedVideoInputRGB444) ? bmdFormat8BitBGRA : bmdFormat8BitYUV;
+		printf("Pixel format: %s\n", (m_pixel_format == bmdFormat8BitBGRA) ? "BGRA, converted to UYVY" : "UYVY");
 		printf("\n");
 
+		// Make sure that NDI has finished with every frame of the old format
+		m_p_frame_pool.reset();
+		NDIlib_send_send_video_async_v2(m_p_ndi_send, NULL);
+		if (m_p_decklink_video_frame) {
+			m_p_decklink_video_frame->Release();
+			m_p_decklink_video_frame = NULL;
+		}
+
 		// Pause the stream and set it up for the new video format
 		m_p_decklink_input->PauseStreams();
-		m_p_decklink_input->EnableVideoInput(newDisplayMode->GetDisplayMode(), bmdFormat8BitYUV, bmdVideoInputEnableFormatDetection);
+		m_p_decklink_input->EnableVideoInput(newDisplayMode->GetDisplayMode(), m_pixel_format, bmdVideoInputEnableFormatDetection);
 		m_p_decklink_input->FlushStreams();
 		m_p_decklink_input->StartStreams();
 		return S_OK;
@@ -200,6 +219,17 @@ private:
 		// Retrieve the pointer to the video data
 		deckLinkVideoFrame->GetBytes((void**)&ndi_video_frame.p_data);
 
+		// BGRA is converted into a buffer of our own, and then we do not need to keep the DeckLink frame
+		if (m_pixel_format == bmdFormat8BitBGRA) {
+			ndi_video_frame.FourCC = NDIlib_FourCC_type_BGRA;
+			send_converted(ndi_video_frame);
+
+			m_p_decklink_video_frame = NULL;
+			if (p_prev_video_frame)
+				p_prev_video_frame->Release();
+			return;
+		}
+
 		// Keep a reference to this video frame for async purposes
 		m_p_decklink_video_frame = deckLinkVideoFrame;
 		m_p_decklink_video_frame->AddRef();
@@ -212,6 +242,31 @@ private:
 			p_prev_video_frame->Release();
 	}
 
+	// Convert a frame into UYVY and send it
+	void send_converted(const NDIlib_video_frame_v2_t& bgra_frame)
+	{
+		// The buffers and the matrix depend on the resolution
+		const size_t uyvy_size = ndi_color::frame_size(NDIlib_FourCC_type_UYVY, bgra_frame.xres, bgra_frame.yres);
+		if (!m_p_frame_pool || (m_p_frame_pool->buffer_size() != uyvy_size)) {
+			m_p_frame_pool.reset();
+			m_p_frame_pool.reset(new ndi_frame_pool::frame_pool(m_p_ndi_send, uyvy_size));
+			m_p_color_converter.reset(new ndi_color::converter(ndi_color::default_matrix(bgra_frame.xres, bgra_frame.yres), ndi_color::range_limited));
+		}
+		if (!m_p_frame_pool->valid())
+			return;
+
+		NDIlib_video_frame_v2_t uyvy_frame;
+		uyvy_frame.FourCC = NDIlib_FourCC_type_UYVY;
+		uyvy_frame.p_data = m_p_frame_pool->acquire();
+		uyvy_frame.line_stride_in_bytes = 0;
+		if (!m_p_color_converter->convert(&bgra_frame, &uyvy_frame)) {
+			m_p_frame_pool->release(uyvy_frame.p_data);
+			return;
+		}
+
+		m_p_frame_pool->send_video(uyvy_frame);
+	}
+
 	void send(IDeckLinkAudioInputPacket* deckLinkAudioPacket)
 	{
 		NDIlib_audio_frame_interleaved_16s_t ndi_audio_frame = { };
@@ -239,6 +294,11 @@ private:
 	int m_frame_rate_n;
 	int m_frame_rate_d;
 	NDIlib_frame_format_type_e m_frame_format;
+
+	// Used when the signal is RGB
+	BMDPixelFormat m_pixel_format;
+	std::unique_ptr<ndi_frame_pool::frame_pool> m_p_frame_pool;
+	std::unique_ptr<ndi_color::converter> m_p_color_converter;
 };
 
 #ifdef _WIN32
@@ -1,4 +1,3 @@
-#include <cmath>
 #include <csignal>
 #include <cstddef>
 #include <cstring>
@@ -9,8 +8,13 @@
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <string>
+#include <vector>
 
 #ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
 
 #ifdef _WIN64
@@ -23,23 +27,212 @@
 #define snprintf _snprintf
 #endif
 
+#define strcasecmp _stricmp
+
+#else
+#include <strings.h>
 #endif
 
 #include <Processing.NDI.Lib.h>
 
-int clamp(float x)
+#include "../NDIlib_Common/NDIlib_Benchmark.h"
+#include "../NDIlib_Common/NDIlib_Color.h"
+#include "../NDIlib_Common/NDIlib_Content.h"
+
+static std::atomic<bool> exit_loop(false);
+static void sigint_handler(int) { exit_loop = true; }
+
+// The video formats that the sweep runs over
+struct sweep_fourcc_t {
+	const char* p_name;
+	NDIlib_FourCC_video_type_e FourCC;
+};
+
+static const sweep_fourcc_t sweep_fourccs[] = {
+	{ "UYVY", NDIlib_FourCC_type_UYVY },
+	{ "UYVA", NDIlib_FourCC_type_UYVA },
+	{ "BGRA", NDIlib_FourCC_type_BGRA },
+	{ "BGRX", NDIlib_FourCC_type_BGRX },
+	{ "NV12", NDIlib_FourCC_type_NV12 },
+	{ "I420", NDIlib_FourCC_type_I420 },
+	{ "P216", NDIlib_FourCC_type_P216 },
+	{ "PA16", NDIlib_FourCC_type_PA16 },
+};
+
+// The resolutions that the sweep runs over
+struct sweep_resolution_t {
+	const char* p_name;
+	int xres, yres;
+};
+
+static const sweep_resolution_t sweep_resolutions[] = {
+	{ "720p",  1280,  720 },
+	{ "1080p", 1920, 1080 },
+	{ "2160p", 3840, 2160 },
+	{ "4320p", 7680, 4320 },
+};
+
+// Is a name in a comma separated list. An empty list contains everything.
+bool in_list(const std::string& list, const char* p_name)
 {
-	if (x < 0.0f)
-		return 0;
+	if (list.empty())
+		return true;
+
+	for (size_t start = 0; start <= list.size();) {
+		size_t end = list.find(',', start);
+		if (end == std::string::npos)
+			end = list.size();
+		if (strcasecmp(list.substr(start, end - start).c_str(), p_name) == 0)
+			return true;
+		start = end + 1;
+	}
+
+	return false;
+}
 
-	if (x > 1.0f)
-		return 255;
+// Convert a BGRA frame into the FourCC we want to test, returning the line stride. The converter should use BT.709 at
+// limited range, which is what NDI expects for HD and UHD video.
+int build_frame(ndi_color::converter& converter, const std::vector<uint8_t>& bgra, const int xres, const int yres, const NDIlib_FourCC_video_type_e FourCC, std::vector<uint8_t>& dst)
+{
+	dst.resize(ndi_color::frame_size(FourCC, xres, yres));
+
+	NDIlib_video_frame_v2_t src_frame(xres, yres, NDIlib_FourCC_type_BGRA);
+	src_frame.p_data = (uint8_t*)bgra.data();
+	src_frame.line_stride_in_bytes = xres * 4;
 
-	return (int)(x * 255.0f);
+	NDIlib_video_frame_v2_t dst_frame;
+	dst_frame.FourCC = FourCC;
+	dst_frame.p_data = dst.data();
+	dst_frame.line_stride_in_bytes = 0;
+	return converter.convert(&src_frame, &dst_frame) ? dst_frame.line_stride_in_bytes : 0;
 }
 
-static std::atomic<bool> exit_loop(false);
-static void sigint_handler(int) { exit_loop = true; }
+// Run the benchmark across all FourCCs and resolutions and display a matrix of the frame-rates. This is selected with
+// -sweep, and can be limited with for instance -fourcc UYVY,P216 and -resolution 1080p,2160p.
+void run_sweep(NDIlib_send_instance_t pNDI_send, int argc, char* argv[], const ndi_benchmark::options& bench_options, ndi_content::generator& content)
+{
+	const int framerate_n = 60000;
+	const int framerate_d = 1001;
+
+	// Which FourCCs and resolutions to use
+	std::string fourcc_list, resolution_list;
+	for (int i = 1; i < argc - 1; i++) {
+		if (strcasecmp(argv[i], "-fourcc") == 0)
+			fourcc_list = argv[i + 1];
+		else if (strcasecmp(argv[i], "-resolution") == 0)
+			resolution_list = argv[i + 1];
+	}
+
+	// Each entry in the matrix is a short run, and the per run results are appended to the CSV file as they are made.
+	// The JSON file is written with the whole matrix at the end.
+	ndi_benchmark::options cell_options = bench_options;
+	if (cell_options.m_duration_seconds <= 0.0)
+		cell_options.m_duration_seconds = 5.0;
+	cell_options.m_json_filename.clear();
+	cell_options.m_quiet = true;
+
+	const int no_fourccs = sizeof(sweep_fourccs) / sizeof(sweep_fourccs[0]);
+	const int no_resolutions = sizeof(sweep_resolutions) / sizeof(sweep_resolutions[0]);
+	std::vector<double> fps(no_fourccs * no_resolutions, -1.0);
+
+	std::vector<uint8_t> bgra[2], frames[2];
+	ndi_color::converter color_converter(ndi_color::matrix_bt709, ndi_color::range_limited);
+	for (int r = 0; !exit_loop && r < no_resolutions; r++) {
+		const sweep_resolution_t& res = sweep_resolutions[r];
+		if (!in_list(resolution_list, res.p_name))
+			continue;
+
+		// Generate two frames of content that we alternate between
+		printf("Generating content for %s ...\n", res.p_name);
+		for (int i = 0; i < 2; i++) {
+			bgra[i].resize((size_t)res.xres * res.yres * 4);
+			content.generate_bgra(bgra[i].data(), res.xres, res.yres, res.xres * 4, i * res.yres / 4);
+		}
+
+		for (int f = 0; !exit_loop && f < no_fourccs; f++) {
+			const sweep_fourcc_t& fmt = sweep_fourccs[f];
+			if (!in_list(fourcc_list, fmt.p_name))
+				continue;
+
+			// Build the frames in this format
+			const int line_stride = build_frame(color_converter, bgra[0], res.xres, res.yres, fmt.FourCC, frames[0]);
+			build_frame(color_converter, bgra[1], res.xres, res.yres, fmt.FourCC, frames[1]);
+
+			ndi_benchmark::session bench("NDIlib_Send_Benchmark", cell_options);
+			bench.set("xres", res.xres);
+			bench.set("yres", res.yres);
+			bench.set("fourcc", fmt.p_name);
+			bench.set("content", ndi_content::content_name(content.content()));
+
+			for (int idx = 0; !exit_loop && bench.running(); idx++) {
+				NDIlib_video_frame_v2_t NDI_video_frame;
+				NDI_video_frame.xres = res.xres;
+				NDI_video_frame.yres = res.yres;
+				NDI_video_frame.FourCC = fmt.FourCC;
+				NDI_video_frame.p_data = frames[idx & 1].data();
+				NDI_video_frame.line_stride_in_bytes = line_stride;
+				NDI_video_frame.frame_rate_N = framerate_n;
+				NDI_video_frame.frame_rate_D = framerate_d;
+
+				bench.begin_call();
+				NDIlib_send_send_video_async_v2(pNDI_send, &NDI_video_frame);
+				bench.end_call();
+			}
+
+			// We must make sure that the frames are no longer in use before we change them
+			NDIlib_send_send_video_async_v2(pNDI_send, NULL);
+
+			const ndi_benchmark::results& results = bench.get_results();
+			fps[r * no_fourccs + f] = results.fps();
+			printf("%-6s %s : %1.1ffps\n", res.p_name, fmt.p_name, results.fps());
+
+			if (!cell_options.m_csv_filename.empty())
+				bench.write_csv(cell_options.m_csv_filename);
+		}
+	}
+
+	// Display the matrix
+	printf("\nEncode throughput (fps)\n%-8s", "");
+	for (int f = 0; f < no_fourccs; f++)
+		printf("%10s", sweep_fourccs[f].p_name);
+	printf("\n");
+
+	for (int r = 0; r < no_resolutions; r++) {
+		printf("%-8s", sweep_resolutions[r].p_name);
+		for (int f = 0; f < no_fourccs; f++) {
+			const double value = fps[r * no_fourccs + f];
+			if (value < 0.0)
+				printf("%10s", "-");
+			else
+				printf("%10.1f", value);
+		}
+		printf("\n");
+	}
+
+	// Write the matrix as JSON
+	if (!bench_options.m_json_filename.empty()) {
+		const bool to_stdout = (bench_options.m_json_filename == "-");
+		FILE* p_file = to_stdout ? stdout : fopen(bench_options.m_json_filename.c_str(), "w");
+		if (p_file) {
+			fprintf(p_file, "{\n  \"benchmark\": \"NDIlib_Send_Benchmark sweep\",\n  \"ndi_version\": \"%s\",\n  \"fps\": {", NDIlib_version());
+			for (int r = 0; r < no_resolutions; r++) {
+				fprintf(p_file, "%s\n    \"%s\": {", r ? "," : "", sweep_resolutions[r].p_name);
+				for (int f = 0, first = 1; f < no_fourccs; f++) {
+					const double value = fps[r * no_fourccs + f];
+					if (value < 0.0)
+						continue;
+					fprintf(p_file, "%s \"%s\": %.3f", first ? "" : ",", sweep_fourccs[f].p_name, value);
+					first = 0;
+				}
+				fprintf(p_file, " }");
+			}
+			fprintf(p_file, "\n  }\n}\n");
+
+			if (!to_stdout)
+				fclose(p_file);
+		}
+	}
+}
 
 int main(int argc, char* argv[])
 {
@@ -68,14 +261,37 @@ int main(int argc, char* argv[])
 #endif // _WIN64
 #endif // _DEBUG
 
-	// Display that we're thinking about thins
-	printf("Generating content for benchmark ...\n");
+	// The benchmark settings come from the command line
+	ndi_benchmark::options bench_options;
+	bench_options.parse(argc, argv);
 
 	// We create the NDI sender
 	NDIlib_send_instance_t pNDI_send = NDIlib_send_create(&NDI_send_create_desc);
 	if (!pNDI_send)
 		return 0;
 
+	// The content to send is selected with -content gradient|noise|text|camera
+	ndi_content::content_e content_type = ndi_content::content_gradient;
+	for (int i = 1; i < argc - 1; i++) {
+		if ((strcasecmp(argv[i], "-content") == 0) && !ndi_content::parse_content(argv[i + 1], content_type))
+			printf("Unknown content \"%s\", using %s.\n", argv[i + 1], ndi_content::content_name(content_type));
+	}
+	ndi_content::generator content(content_type);
+
+	// Are we running over all formats and resolutions
+	for (int i = 1; i < argc; i++) {
+		if (strcasecmp(argv[i], "-sweep") == 0) {
+			run_sweep(pNDI_send, argc, argv, bench_options, content);
+
+			NDIlib_send_destroy(pNDI_send);
+			NDIlib_destroy();
+			return 0;
+		}
+	}
+
+	// Display that we're thinking about thins
+	printf("Generating content for benchmark ...\n");
+
 	// We build a video frame that is twice to long, which allows us to "scroll" down the image
 	// so that the content is changing but it takes no CPU time to generate this.
 	const int xres = 3840;
@@ -84,42 +300,26 @@ int main(int argc, char* argv[])
 	const int framerate_d = 1001;
 	const int scroll_dist = 4;
 
-	// Allocate the memory
+	// Allocate the memory and generate the content
+	const auto generate_start = std::chrono::steady_clock::now();
 	uint8_t* p_src = (uint8_t*)malloc(xres * yres * scroll_dist * 2);
-	for (int y = 0; y < yres * scroll_dist; y++) {
-		// Get the line
-		uint8_t* p_src_line = p_src + y * xres * 2;
-		for (int x = 0; x < xres; x += 2, p_src_line += 4) {
-			// Generate some patterns of some kind
-			const float fy   = (float)y / (float)yres;
-			const float fx_0 = (float)(x + 0) / (float)xres;
-			const float fx_1 = (float)(x + 1) / (float)xres;
-
-			// Get the color in RGB
-			const int r0 = clamp(cos(fx_0 *  9.0f + fy *  9.5f) * 0.5f + 0.5f);
-			const int g0 = clamp(cos(fx_0 * 12.0f + fy * 40.5f) * 0.5f + 0.5f);
-			const int b0 = clamp(cos(fx_0 * 23.0f + fy * 15.5f) * 0.5f + 0.5f);
-
-			const int r1 = clamp(cos(fx_1 *  9.0f + fy *  9.5f) * 0.5f + 0.5f);
-			const int g1 = clamp(cos(fx_1 * 12.0f + fy * 40.5f) * 0.5f + 0.5f);
-			const int b1 = clamp(cos(fx_1 * 23.0f + fy * 15.5f) * 0.5f + 0.5f);
-
-			// Color convert the pixels using integer
-			p_src_line[0] = std::max(0, std::min(255, ((112 * b0 -  87 * g0 -  26 * r0) >> 8) + 128));
-			p_src_line[1] = std::max(0, std::min(255, (( 16 * b0 + 157 * g0 +  47 * r0) >> 8) +  16));
-			p_src_line[2] = std::max(0, std::min(255, ((112 * r1 -  10 * b1 - 102 * g1) >> 8) + 128));
-			p_src_line[3] = std::max(0, std::min(255, (( 16 * b1 + 157 * g1 +  47 * r1) >> 8) +  16));
-		}
-	}
-
-	// Keep track of times
-	auto prev_time = std::chrono::high_resolution_clock::now();
+	content.generate_uyvy(p_src, xres, yres * scroll_dist, xres * 2, 0);
+	printf("Generated %s content in %1.0fms using %s.\n", ndi_content::content_name(content.content()),
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - generate_start).count(), ndi_content::simd_name(content.simd()));
+
+	// Describe the benchmark
+	ndi_benchmark::session bench("NDIlib_Send_Benchmark", bench_options);
+	bench.set("ndi_version", NDIlib_version());
+	bench.set("xres", xres);
+	bench.set("yres", yres);
+	bench.set("fourcc", "UYVY");
+	bench.set("content", ndi_content::content_name(content.content()));
 
 	// Display that we're thinking about thins
 	printf("Running benchmark ...\n");
 
 	// Cycle over data
-	for (int idx = 0; !exit_loop; idx++) {
+	for (int idx = 0; !exit_loop && bench.running(); idx++) {
 		// We are going to create a 1920x1080 interlaced frame at 29.97Hz.
 		NDIlib_video_frame_v2_t NDI_video_frame;
 		NDI_video_frame.xres = xres;
@@ -131,25 +331,18 @@ int main(int argc, char* argv[])
 		NDI_video_frame.frame_rate_D = framerate_d;
 
 		// We now submit the frame. 
+		bench.begin_call();
 		NDIlib_send_send_video_async_v2(pNDI_send, &NDI_video_frame);
-
-		// Every 1000 frames we check how long it has taken
-		if (idx && ((idx % 1000) == 0)) {
-			// Get the time
-			const auto this_time = std::chrono::high_resolution_clock::now();
-
-			// Display the frames per second
-			printf("%dx%d video encoded at %1.1ffps.\n", xres, yres, 1000.0f / std::chrono::duration_cast<std::chrono::duration<float>>(this_time - prev_time).count());
-
-			// Cycle the timers
-			prev_time = this_time;
-		}
+		bench.end_call();
 	}
 
 	// Sync
 	printf("Benchmark stopped.\n");
 	NDIlib_send_send_video_async_v2(pNDI_send, NULL);
 
+	// Display the results
+	bench.report();
+
 	// Free the video frame
 	free(p_src);
 
@@ -9,8 +9,15 @@
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 #ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
 
 #ifdef _WIN64
@@ -23,13 +30,231 @@
 #define snprintf _snprintf
 #endif
 
+#define strcasecmp _stricmp
+
+#else
+#include <strings.h>
 #endif
 
 #include <Processing.NDI.Lib.h>
 
+#include "../NDIlib_Common/NDIlib_Benchmark.h"
+#include "../NDIlib_Common/NDIlib_Content.h"
+#include "../NDIlib_Common/NDIlib_FramePool.h"
+#include "../NDIlib_Common/NDIlib_Thread.h"
+
 static std::atomic<bool> exit_loop(false);
 static void sigint_handler(int) { exit_loop = true; }
 
+// How the sender threads are placed on the machine
+enum pin_mode_e {
+	pin_mode_none,
+	pin_mode_cores,
+	pin_mode_numa
+};
+
+// The settings for running many senders at once
+struct multi_sender_settings_t {
+	int xres, yres;
+	pin_mode_e pin_mode;
+	bool use_content;
+	ndi_content::content_e content;
+	ndi_frame_pool::options pool_options;
+};
+
+// Fill every buffer in the pool with a frame of content. These are then sent in turn. The seed makes the content
+// different for each sender, and no_threads = 0 generates with one thread per CPU.
+void fill_frames(ndi_frame_pool::frame_pool& pool, const multi_sender_settings_t& settings, const int seed, const int no_threads)
+{
+	const size_t no_pixels = (size_t)settings.xres * settings.yres;
+	ndi_content::generator content(settings.content, no_threads);
+
+	std::vector<uint8_t*> p_frames;
+	for (int i = 0; i < pool.no_buffers(); i++) {
+		uint8_t* p_frame = pool.acquire();
+		if (settings.use_content) {
+			content.generate_uyvy(p_frame, settings.xres, settings.yres, settings.xres * 2, seed * 64 + i);
+		} else {
+			const int luma = 16 + (seed * 37) % 200;
+			std::fill_n((uint16_t*)p_frame, no_pixels, (uint16_t)(128 | (((i & 1) ? 251 - luma : luma) << 8)));
+		}
+		p_frames.push_back(p_frame);
+	}
+
+	for (uint8_t* p_frame : p_frames)
+		pool.release(p_frame);
+}
+
+// Run a number of senders, each on its own thread with its own content, and return the results of each one.
+std::vector<ndi_benchmark::results> run_senders(const int no_senders, const multi_sender_settings_t& settings, const ndi_benchmark::options& bench_options)
+{
+	const int framerate_n = 60000;
+	const int framerate_d = 1001;
+
+	std::vector<ndi_benchmark::results> results(no_senders);
+	std::atomic<int> no_ready(0);
+
+	// The sessions outlive the threads so that the CSV file is written from this thread once they are all done
+	std::vector<std::unique_ptr<ndi_benchmark::session>> sessions(no_senders);
+
+	const std::vector<std::vector<int>> numa_nodes = ndi_thread::numa_nodes();
+
+	std::vector<std::thread> threads;
+	for (int sender_no = 0; sender_no < no_senders; sender_no++) {
+		threads.push_back(std::thread([&, sender_no] {
+			// Place the thread first, so that the frame buffers are allocated on the NUMA node that it runs on
+			if (settings.pin_mode == pin_mode_cores)
+				ndi_thread::pin_to_cpu(sender_no);
+			else if (settings.pin_mode == pin_mode_numa)
+				ndi_thread::set_affinity(numa_nodes[sender_no % numa_nodes.size()]);
+
+			// Each thread has its own sender
+			char ndi_name[64];
+			snprintf(ndi_name, sizeof(ndi_name), "Benchmark %d", sender_no + 1);
+			NDIlib_send_create_t NDI_send_create_desc(ndi_name, nullptr, false, false);
+			NDIlib_send_instance_t pNDI_send = NDIlib_send_create(&NDI_send_create_desc);
+
+			// Each sender gets its own content, either generated frames that are offset for each sender or different
+			// levels for each one. The other senders are generating at the same time, so use a single thread each.
+			ndi_frame_pool::frame_pool pool(pNDI_send, (size_t)settings.xres * settings.yres * 2, settings.pool_options);
+			if (pool.valid())
+				fill_frames(pool, settings, sender_no, 1);
+
+			// Wait until all senders are ready so that they are measured over the same time
+			no_ready++;
+			while (!exit_loop && (no_ready < no_senders))
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+			sessions[sender_no].reset(new ndi_benchmark::session("NDIlib_Send_Benchmark_8K", bench_options));
+			ndi_benchmark::session& bench = *sessions[sender_no];
+			bench.set("xres", settings.xres);
+			bench.set("yres", settings.yres);
+			bench.set("fourcc", "UYVY");
+			bench.set("content", settings.use_content ? ndi_content::content_name(settings.content) : "flat");
+			bench.set("senders", no_senders);
+			bench.set("sender", sender_no + 1);
+
+			for (int idx = 0; pNDI_send && pool.valid() && !exit_loop && bench.running(); idx++) {
+				NDIlib_video_frame_v2_t NDI_video_frame;
+				NDI_video_frame.xres = settings.xres;
+				NDI_video_frame.yres = settings.yres;
+				NDI_video_frame.FourCC = NDIlib_FourCC_type_UYVY;
+				NDI_video_frame.p_data = pool.acquire();
+				NDI_video_frame.line_stride_in_bytes = settings.xres * 2;
+				NDI_video_frame.frame_rate_N = framerate_n;
+				NDI_video_frame.frame_rate_D = framerate_d;
+
+				bench.begin_call();
+				pool.send_video(NDI_video_frame);
+				bench.end_call();
+			}
+
+			// Sync and clean up
+			pool.flush();
+			results[sender_no] = bench.get_results();
+
+			NDIlib_send_destroy(pNDI_send);
+		}));
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	if (!bench_options.m_csv_filename.empty()) {
+		for (auto& p_session : sessions)
+			if (p_session)
+				p_session->write_csv(bench_options.m_csv_filename);
+	}
+
+	return results;
+}
+
+// Run with 1, 2, 4 ... up to max_senders senders and display how the throughput scales. If max_senders is not a power of
+// two then it is the last step. When scaling is false, only max_senders is run.
+void run_multi_sender(const int max_senders, const bool scaling, const multi_sender_settings_t& settings, const ndi_benchmark::options& bench_options)
+{
+	// Each step is a fixed length run, and the progress of each sender is not displayed
+	ndi_benchmark::options step_options = bench_options;
+	if (step_options.m_duration_seconds <= 0.0)
+		step_options.m_duration_seconds = 10.0;
+	step_options.m_json_filename.clear();
+	step_options.m_quiet = true;
+
+	std::vector<int> steps;
+	if (scaling) {
+		for (int no_senders = 1; no_senders < max_senders; no_senders *= 2)
+			steps.push_back(no_senders);
+	}
+	steps.push_back(max_senders);
+
+	// The aggregate frame-rate for each step
+	std::vector<double> aggregate_fps;
+
+	for (size_t step = 0; !exit_loop && step < steps.size(); step++) {
+		const int no_senders = steps[step];
+		printf("Running %d sender%s ...\n", no_senders, (no_senders == 1) ? "" : "s");
+
+		const std::vector<ndi_benchmark::results> results = run_senders(no_senders, settings, step_options);
+		if (exit_loop)
+			break;
+
+		// Display each sender
+		double total_fps = 0.0;
+		ndi_benchmark::histogram call_ns;
+		for (int i = 0; i < no_senders; i++) {
+			printf("    sender %-3d %8.1ffps  call p50=%1.2fus p99=%1.2fus  thread cpu=%1.1f%%\n", i + 1, results[i].fps(),
+				(double)results[i].m_call_ns.percentile(50.0) * 1e-3, (double)results[i].m_call_ns.percentile(99.0) * 1e-3,
+				results[i].m_seconds > 0.0 ? 100.0 * results[i].m_thread_cpu_seconds / results[i].m_seconds : 0.0);
+			total_fps += results[i].fps();
+			call_ns.merge(results[i].m_call_ns);
+		}
+
+		printf("    aggregate  %8.1ffps  call p50=%1.2fus p99=%1.2fus p99.9=%1.2fus  process cpu=%1.1f%%\n", total_fps,
+			(double)call_ns.percentile(50.0) * 1e-3, (double)call_ns.percentile(99.0) * 1e-3, (double)call_ns.percentile(99.9) * 1e-3,
+			results[0].m_seconds > 0.0 ? 100.0 * results[0].m_process_cpu_seconds / results[0].m_seconds : 0.0);
+		aggregate_fps.push_back(total_fps);
+	}
+
+	if (aggregate_fps.empty())
+		return;
+
+	// Display the scaling curve. The knee is the last step at which each sender that was added still gave us at least
+	// half of what a single sender can do.
+	printf("\n%-10s%12s%12s%12s\n", "senders", "fps", "per sender", "efficiency");
+	size_t knee = 0;
+	for (size_t step = 0; step < aggregate_fps.size(); step++) {
+		const double per_sender = aggregate_fps[step] / steps[step];
+		const double efficiency = (aggregate_fps[0] > 0.0) ? per_sender * steps[0] / aggregate_fps[0] : 0.0;
+		printf("%-10d%12.1f%12.1f%11.0f%%\n", steps[step], aggregate_fps[step], per_sender, 100.0 * efficiency);
+
+		if (step) {
+			const double marginal = (aggregate_fps[step] - aggregate_fps[step - 1]) / (steps[step] - steps[step - 1]);
+			if ((knee == step - 1) && (marginal >= 0.5 * aggregate_fps[0] / steps[0]))
+				knee = step;
+		}
+	}
+
+	if (aggregate_fps.size() > 1)
+		printf("\nScaling knee at %d senders.\n", steps[knee]);
+
+	// Write the curve as JSON
+	if (!bench_options.m_json_filename.empty()) {
+		const bool to_stdout = (bench_options.m_json_filename == "-");
+		FILE* p_file = to_stdout ? stdout : fopen(bench_options.m_json_filename.c_str(), "w");
+		if (p_file) {
+			fprintf(p_file, "{\n  \"benchmark\": \"NDIlib_Send_Benchmark_8K multi-sender\",\n  \"ndi_version\": \"%s\",\n", NDIlib_version());
+			fprintf(p_file, "  \"xres\": %d,\n  \"yres\": %d,\n  \"pin\": \"%s\",\n  \"knee\": %d,\n  \"steps\": [", settings.xres, settings.yres,
+				(settings.pin_mode == pin_mode_cores) ? "cores" : (settings.pin_mode == pin_mode_numa) ? "numa" : "none", steps[knee]);
+			for (size_t step = 0; step < aggregate_fps.size(); step++)
+				fprintf(p_file, "%s\n    { \"senders\": %d, \"fps\": %.3f }", step ? "," : "", steps[step], aggregate_fps[step]);
+			fprintf(p_file, "\n  ]\n}\n");
+
+			if (!to_stdout)
+				fclose(p_file);
+		}
+	}
+}
+
 int main(int argc, char* argv[])
 {
 	// Not required, but "correct" (see the SDK documentation).
@@ -57,6 +282,54 @@ int main(int argc, char* argv[])
 #endif // _WIN64
 #endif // _DEBUG
 
+	// The benchmark settings come from the command line
+	ndi_benchmark::options bench_options;
+	bench_options.parse(argc, argv);
+
+	// Running many senders at once is selected with -senders N (or -scaling N to run 1, 2, 4 ... N senders), with
+	// -pin cores or -pin numa to place them. -xres/-yres change the resolution from 8K, with one sender or many. By
+	// default the frames are flat colours, -content gradient|noise|text|camera sends generated content instead. The
+	// frames are sent in turn from a pool of -buffers N buffers (default 2), which can be backed by huge pages with
+	// -hugepages and locked into memory with -mlock.
+	multi_sender_settings_t multi_settings = { 7680, 4320, pin_mode_none, false, ndi_content::content_gradient, ndi_frame_pool::options() };
+	int max_senders = 0;
+	bool scaling = false;
+	multi_settings.pool_options.m_no_buffers = 2;
+	for (int i = 1; i < argc; i++) {
+		if (strcasecmp(argv[i], "-hugepages") == 0)
+			multi_settings.pool_options.m_huge_pages = true;
+		else if (strcasecmp(argv[i], "-mlock") == 0)
+			multi_settings.pool_options.m_lock = true;
+	}
+
+	for (int i = 1; i < argc - 1; i++) {
+		if (strcasecmp(argv[i], "-senders") == 0) {
+			max_senders = atoi(argv[i + 1]);
+		} else if (strcasecmp(argv[i], "-scaling") == 0) {
+			max_senders = atoi(argv[i + 1]);
+			scaling = true;
+		} else if (strcasecmp(argv[i], "-pin") == 0) {
+			if (strcasecmp(argv[i + 1], "cores") == 0)
+				multi_settings.pin_mode = pin_mode_cores;
+			else if (strcasecmp(argv[i + 1], "numa") == 0)
+				multi_settings.pin_mode = pin_mode_numa;
+		} else if (strcasecmp(argv[i], "-xres") == 0) {
+			multi_settings.xres = atoi(argv[i + 1]) & ~1;
+		} else if (strcasecmp(argv[i], "-yres") == 0) {
+			multi_settings.yres = atoi(argv[i + 1]);
+		} else if (strcasecmp(argv[i], "-content") == 0) {
+			multi_settings.use_content = ndi_content::parse_content(argv[i + 1], multi_settings.content);
+		} else if (strcasecmp(argv[i], "-buffers") == 0) {
+			multi_settings.pool_options.m_no_buffers = atoi(argv[i + 1]);
+		}
+	}
+
+	if (max_senders > 0) {
+		run_multi_sender(max_senders, scaling, multi_settings, bench_options);
+		NDIlib_destroy();
+		return 0;
+	}
+
 	// Display that we're thinking about thins
 	printf("Generating content for benchmark ...\n");
 
@@ -65,64 +338,56 @@ int main(int argc, char* argv[])
 	if (!pNDI_send)
 		return 0;
 
-	// We build a video frame that is twice to long, which allows us to "scroll" down the image
-	// so that the content is changing but it takes no CPU time to generate this.
-	const int xres = 7680;
-	const int yres = 4320;
+	// The frames that we send in turn
+	const int xres = multi_settings.xres;
+	const int yres = multi_settings.yres;
 	const int framerate_n = 60000;
 	const int framerate_d = 1001;
 
-	// Allocate the memory
-	uint8_t* p_src[2] = {
-		(uint8_t*)malloc(xres * yres * 2),
-		(uint8_t*)malloc(xres * yres * 2)
-	};
-
-	std::fill_n((uint16_t*)p_src[0], xres * yres, (uint16_t)(128 | ( 16 << 8)));
-	std::fill_n((uint16_t*)p_src[1], xres * yres, (uint16_t)(128 | (235 << 8)));
+	// Allocate the memory and fill in the frames
+	ndi_frame_pool::frame_pool pool(pNDI_send, (size_t)xres * yres * 2, multi_settings.pool_options);
+	if (!pool.valid())
+		return 0;
+	fill_frames(pool, multi_settings, 0, 0);
 
-	// Keep track of times
-	auto prev_time = std::chrono::high_resolution_clock::now();
+	// Describe the benchmark
+	ndi_benchmark::session bench("NDIlib_Send_Benchmark_8K", bench_options);
+	bench.set("ndi_version", NDIlib_version());
+	bench.set("xres", xres);
+	bench.set("yres", yres);
+	bench.set("fourcc", "UYVY");
+	bench.set("content", multi_settings.use_content ? ndi_content::content_name(multi_settings.content) : "flat");
+	bench.set("buffers", pool.no_buffers());
+	bench.set("huge_pages", pool.huge_pages() ? "yes" : "no");
+	bench.set("locked", pool.locked() ? "yes" : "no");
 
 	// Display that we're thinking about thins
 	printf("Running benchmark ...\n");
 
 	// Cycle over data
-	for (int idx = 0; !exit_loop; idx++) {
+	for (int idx = 0; !exit_loop && bench.running(); idx++) {
 		// Lets send out this video frame
 		NDIlib_video_frame_v2_t NDI_video_frame;
 		NDI_video_frame.xres = xres;
 		NDI_video_frame.yres = yres;
 		NDI_video_frame.FourCC = NDIlib_FourCC_type_UYVY;
-		NDI_video_frame.p_data = p_src[idx & 1];
+		NDI_video_frame.p_data = pool.acquire();
 		NDI_video_frame.line_stride_in_bytes = xres * 2;
 		NDI_video_frame.frame_rate_N = framerate_n;
 		NDI_video_frame.frame_rate_D = framerate_d;
 
 		// We now submit the frame. 
-		NDIlib_send_send_video_async_v2(pNDI_send, &NDI_video_frame);
-
-		// Every 1000 frames we check how long it has taken
-		if (idx && ((idx % 1000) == 0)) {
-			// Get the time
-			const auto this_time = std::chrono::high_resolution_clock::now();
-
-			// Display the frames per second
-			printf("%dx%d video encoded at %1.1ffps.\n", xres, yres,
-				1000.0f / std::chrono::duration_cast<std::chrono::duration<float>>(this_time - prev_time).count());
-
-			// Cycle the timers
-			prev_time = this_time;
-		}
+		bench.begin_call();
+		pool.send_video(NDI_video_frame);
+		bench.end_call();
 	}
 
 	// Sync
 	printf("Benchmark stopped.\n");
-	NDIlib_send_send_video_async_v2(pNDI_send, NULL);
+	pool.flush();
 
-	// Free the video frame
-	free(p_src[0]);
-	free(p_src[1]);
+	// Display the results
+	bench.report();
 
 	// Destroy the NDI sender
 	NDIlib_send_destroy(pNDI_send);
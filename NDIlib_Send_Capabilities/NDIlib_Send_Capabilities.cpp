@@ -7,14 +7,24 @@
 #include <chrono>
 #include <Processing.NDI.Lib.h>
 
+#include "../NDIlib_Common/NDIlib_Benchmark.h"
+#include "../NDIlib_Common/NDIlib_Pattern.h"
+
 #ifdef _WIN32
 #ifdef _WIN64
 #pragma comment(lib, "Processing.NDI.Lib.x64.lib")
 #else // _WIN64
 #pragma comment(lib, "Processing.NDI.Lib.x86.lib")
 #endif // _WIN64
+#define strcasecmp _stricmp
+#else
+#include <strings.h>
 #endif
 
+// The frames are a test pattern with a moving box and a frame counter, of which only the parts that change are drawn
+// each frame (see NDIlib_Pattern.h).
+//		-pattern bars|ramp|zoneplate			The pattern to send (default bars).
+
 static std::atomic<bool> exit_loop(false);
 static void sigint_handler(int) { exit_loop = true; }
 
@@ -59,26 +69,39 @@ int main(int argc, char* argv[])
 	NDI_video_frame.FourCC = NDIlib_FourCC_type_BGRA;
 	NDI_video_frame.p_data = (uint8_t*)malloc(NDI_video_frame.xres * NDI_video_frame.yres * 4);
 
-	// We will send 1000 frames of video. 
-	while (!exit_loop) {
-		// Get the current time
-		const auto start_time = std::chrono::high_resolution_clock::now();
-
-		// Send 200 frames
-		for (int idx = 0; !exit_loop && idx < 200; idx++) {
-			// Fill in the buffer. It is likely that you would do something much smarter than this.
-			::memset((void*)NDI_video_frame.p_data, (idx & 1) ? 255 : 0, NDI_video_frame.xres * NDI_video_frame.yres * 4);
-
-			// We now submit the frame. Note that this call will be clocked so that we end up submitting at exactly 29.97fps.
-			NDIlib_send_send_video_v2(pNDI_send, &NDI_video_frame);
-		}
-
-		// Get the end time
-		const auto end_time = std::chrono::high_resolution_clock::now();
-
-		// Just display something helpful
-		printf("200 frames sent, average fps=%1.2f\n", 200.0f / std::chrono::duration_cast<std::chrono::duration<float>>(end_time - start_time).count());
+	// Measure how the sending performs
+	ndi_benchmark::options bench_options;
+	bench_options.parse(argc, argv);
+
+	ndi_benchmark::session bench("NDIlib_Send_Capabilities", bench_options);
+	bench.set("ndi_version", NDIlib_version());
+	bench.set("xres", NDI_video_frame.xres);
+	bench.set("yres", NDI_video_frame.yres);
+	bench.set("fourcc", "BGRA");
+
+	// The test pattern
+	ndi_pattern::pattern_e pattern = ndi_pattern::pattern_bars;
+	for (int i = 1; i < argc - 1; i++) {
+		if ((strcasecmp(argv[i], "-pattern") == 0) && !ndi_pattern::parse_pattern(argv[++i], pattern))
+			printf("Unknown pattern \"%s\", using %s.\n", argv[i], ndi_pattern::pattern_name(pattern));
 	}
+	ndi_pattern::generator test_pattern(pattern);
+	bench.set("pattern", ndi_pattern::pattern_name(pattern));
+
+	// We will send video until we are stopped.
+	for (int idx = 0; !exit_loop && bench.running(); idx++) {
+		// Fill in the buffer. The whole pattern is only drawn the first time, after that it is just the box and the
+		// counter.
+		test_pattern.generate(NDI_video_frame, idx);
+
+		// We now submit the frame. Note that this call will be clocked so that we end up submitting at exactly 29.97fps.
+		bench.begin_call();
+		NDIlib_send_send_video_v2(pNDI_send, &NDI_video_frame);
+		bench.end_call();
+	}
+
+	// Display the results
+	bench.report();
 
 	// Free the video frame
 	free(NDI_video_frame.p_data);
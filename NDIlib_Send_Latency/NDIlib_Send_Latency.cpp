@@ -1,10 +1,18 @@
+#include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <string>
 #include <thread>
+#include <vector>
 
 #ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
 
 #define strcasecmp _stricmp
@@ -20,38 +28,315 @@
 
 #include <Processing.NDI.Lib.h>
 
-void receive_source(const NDIlib_source_t* pSourceName, const std::chrono::high_resolution_clock::time_point reference_time)
+#include "../NDIlib_Common/NDIlib_Benchmark.h"
+#include "../NDIlib_Common/NDIlib_Content.h"
+
+// This measures the time from a frame being handed to NDIlib_send_send_video_async_v2 to it being returned from
+// NDIlib_recv_capture_v2, which includes compression, transmission and decompression. The send time is carried in the
+// timecode of each frame. It also measures the time from NDIlib_recv_connect to the first frame arriving.
+//
+// With -clocked, the send call is where NDI waits for the next frame time, and that wait comes after the timecode is
+// taken. NDI may wait before it sends the frame, so the clocked latency can include up to a frame of that wait and is
+// not directly comparable with the unclocked latency. The time spent in the send call is shown alongside it.
+//
+// Command line options :
+//		-xres <pixels> -yres <pixels>	The resolution (default 1920x1080).
+//		-fourcc <name>					UYVY, BGRA, BGRX, RGBA, RGBX, NV12, I420 or P216 (default UYVY).
+//		-fps <rate>						For instance 60, 59.94, 50 or 30000/1001 (default 59.94).
+//		-clocked						Let NDI clock the sender, otherwise we pace the frames ourselves.
+//		-content <name>					gradient, noise, text or camera (default gradient).
+//		-samples <count>				The number of latency samples to take, 0 means until interrupted (default 5000).
+//		-ttff <count>					The number of time-to-first-frame measurements (default 20).
+// The -warmup, -json, -csv and -quiet options of the other benchmarks are also understood.
+
+typedef std::chrono::steady_clock clock_type;
+
+static std::atomic<bool> exit_loop(false);
+static void sigint_handler(int) { exit_loop = true; }
+
+// The current time in ns since a reference time
+static int64_t time_since(const clock_type::time_point reference_time)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - reference_time).count();
+}
+
+// The settings for the test
+struct latency_settings_t {
+	int xres, yres;
+	std::string fourcc_name;
+	NDIlib_FourCC_video_type_e FourCC;
+	int frame_rate_N, frame_rate_D;
+	bool clocked;
+	ndi_content::content_e content;
+	int no_samples;
+	int no_ttff;
+};
+
+// Get a frame-rate from the command line. Rates like 59.94 are taken to be the NTSC rate 60000/1001.
+bool parse_frame_rate(const char* p_text, int& frame_rate_N, int& frame_rate_D)
+{
+	const char* p_slash = strchr(p_text, '/');
+	if (p_slash) {
+		frame_rate_N = atoi(p_text);
+		frame_rate_D = atoi(p_slash + 1);
+	} else {
+		const double fps = atof(p_text);
+		const int rounded = (int)(fps + 0.5);
+		if ((double)rounded != fps) {
+			frame_rate_N = rounded * 1000;
+			frame_rate_D = 1001;
+		} else {
+			frame_rate_N = rounded;
+			frame_rate_D = 1;
+		}
+	}
+
+	return (frame_rate_N > 0) && (frame_rate_D > 0);
+}
+
+// Get a FourCC from its name
+bool parse_fourcc(const char* p_name, NDIlib_FourCC_video_type_e& FourCC, std::string& name)
+{
+	static const struct { const char* p_name; NDIlib_FourCC_video_type_e FourCC; } fourccs[] = {
+		{ "UYVY", NDIlib_FourCC_type_UYVY }, { "BGRA", NDIlib_FourCC_type_BGRA }, { "BGRX", NDIlib_FourCC_type_BGRX },
+		{ "RGBA", NDIlib_FourCC_type_RGBA }, { "RGBX", NDIlib_FourCC_type_RGBX }, { "NV12", NDIlib_FourCC_type_NV12 },
+		{ "I420", NDIlib_FourCC_type_I420 }, { "P216", NDIlib_FourCC_type_P216 },
+	};
+
+	for (const auto& fourcc : fourccs) {
+		if (strcasecmp(p_name, fourcc.p_name) == 0) {
+			FourCC = fourcc.FourCC;
+			name = fourcc.p_name;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Build a frame of content in the FourCC we are testing, returning the line stride. The RGB formats use the BGRA
+// content as is (the order of the colors makes no difference to the latency), and the planar formats are made from the
+// UYVY content.
+int build_frame(ndi_content::generator& content, const latency_settings_t& settings, const int frame_no, std::vector<uint8_t>& dst)
+{
+	const int xres = settings.xres, yres = settings.yres;
+	switch (settings.FourCC) {
+		case NDIlib_FourCC_type_BGRA:
+		case NDIlib_FourCC_type_BGRX:
+		case NDIlib_FourCC_type_RGBA:
+		case NDIlib_FourCC_type_RGBX:
+			dst.resize((size_t)xres * yres * 4);
+			content.generate_bgra(dst.data(), xres, yres, xres * 4, frame_no);
+			return xres * 4;
+
+		case NDIlib_FourCC_type_UYVY:
+			dst.resize((size_t)xres * yres * 2);
+			content.generate_uyvy(dst.data(), xres, yres, xres * 2, frame_no);
+			return xres * 2;
+
+		default:
+			break;
+	}
+
+	std::vector<uint8_t> uyvy((size_t)xres * yres * 2);
+	content.generate_uyvy(uyvy.data(), xres, yres, xres * 2, frame_no);
+
+	if (settings.FourCC == NDIlib_FourCC_type_P216) {
+		// A 16bit Y plane followed by a 16bit interleaved UV plane
+		dst.resize((size_t)xres * yres * 4);
+		uint16_t* p_y = (uint16_t*)dst.data();
+		uint16_t* p_uv = p_y + (size_t)xres * yres;
+		for (size_t i = 0; i < (size_t)xres * yres; i += 2) {
+			p_uv[i + 0] = (uint16_t)(uyvy[i * 2 + 0] << 8);
+			p_y [i + 0] = (uint16_t)(uyvy[i * 2 + 1] << 8);
+			p_uv[i + 1] = (uint16_t)(uyvy[i * 2 + 2] << 8);
+			p_y [i + 1] = (uint16_t)(uyvy[i * 2 + 3] << 8);
+		}
+		return xres * 2;
+	}
+
+	// NV12 and I420, a Y plane followed by chroma from every other line
+	const size_t y_size = (size_t)xres * yres;
+	dst.resize(y_size + y_size / 2);
+	for (size_t i = 0; i < y_size; i++)
+		dst[i] = uyvy[i * 2 + 1];
+
+	uint8_t* p_uv = &dst[y_size];
+	for (int y = 0; y < yres; y += 2) {
+		const uint8_t* p_src = &uyvy[(size_t)y * xres * 2];
+		for (int x = 0; x < xres; x += 2, p_src += 4) {
+			if (settings.FourCC == NDIlib_FourCC_type_NV12) {
+				p_uv[(size_t)(y / 2) * xres + x + 0] = p_src[0];
+				p_uv[(size_t)(y / 2) * xres + x + 1] = p_src[2];
+			} else {
+				p_uv[(size_t)(y / 2) * (xres / 2) + x / 2] = p_src[0];
+				p_uv[y_size / 4 + (size_t)(y / 2) * (xres / 2) + x / 2] = p_src[2];
+			}
+		}
+	}
+	return xres;
+}
+
+// Send frames at the frame-rate until told to stop. The send time is placed in the timecode of each frame.
+void send_frames(NDIlib_send_instance_t pNDI_send, const latency_settings_t& settings, const std::vector<uint8_t>* p_frames, const int line_stride,
+				 const clock_type::time_point reference_time, const std::atomic<bool>& stop, ndi_benchmark::histogram& send_call_ns)
+{
+	const auto frame_time = std::chrono::duration_cast<clock_type::duration>(
+		std::chrono::duration<double>((double)settings.frame_rate_D / (double)settings.frame_rate_N));
+	auto next_frame = clock_type::now();
+
+	for (int idx = 0; !stop && !exit_loop; idx++) {
+		// When the sender is not clocked, we pace the frames ourselves. If we fall behind we do not try to catch up,
+		// since a burst of frames would show up as latency.
+		if (!settings.clocked) {
+			std::this_thread::sleep_until(next_frame);
+			next_frame += frame_time;
+			if (clock_type::now() > next_frame)
+				next_frame = clock_type::now();
+		}
+
+		NDIlib_video_frame_v2_t NDI_video_frame;
+		NDI_video_frame.xres = settings.xres;
+		NDI_video_frame.yres = settings.yres;
+		NDI_video_frame.FourCC = settings.FourCC;
+		NDI_video_frame.frame_rate_N = settings.frame_rate_N;
+		NDI_video_frame.frame_rate_D = settings.frame_rate_D;
+		NDI_video_frame.p_data = (uint8_t*)p_frames[idx & 1].data();
+		NDI_video_frame.line_stride_in_bytes = line_stride;
+
+		// Measure the number of nano-seconds since the reference time
+		const int64_t send_time = time_since(reference_time);
+		NDI_video_frame.timecode = send_time;
+
+		// We now submit the frame. When clocked, this is where we wait for the next frame time, which is counted in the
+		// latency when NDI waits before it sends the frame.
+		::NDIlib_send_send_video_async_v2(pNDI_send, &NDI_video_frame);
+		send_call_ns.add((uint64_t)(time_since(reference_time) - send_time));
+	}
+
+	// Synchronize, the frames must not be freed while they are in use
+	::NDIlib_send_send_video_async_v2(pNDI_send, nullptr);
+}
+
+// Receive frames and record the latency of each one
+void measure_latency(const NDIlib_source_t* p_source, const latency_settings_t& settings, const ndi_benchmark::options& bench_options,
+					 const clock_type::time_point reference_time, ndi_benchmark::histogram& latency_ns, NDIlib_recv_performance_t& dropped)
 {
-	// Open a receiver and connect to the receiver
-	NDIlib_recv_instance_t pNDI_recv = ::NDIlib_recv_create_v3();
-	::NDIlib_recv_connect(pNDI_recv, pSourceName);
+	// Open a receiver and connect to the sender
+	NDIlib_recv_create_v3_t NDI_recv_create_desc;
+	NDI_recv_create_desc.color_format = NDIlib_recv_color_format_fastest;
+	NDIlib_recv_instance_t pNDI_recv = ::NDIlib_recv_create_v3(&NDI_recv_create_desc);
+	if (!pNDI_recv)
+		return;
+	::NDIlib_recv_connect(pNDI_recv, p_source);
+
+	if (!bench_options.m_quiet)
+		printf("Warming up for %1.1fs ...\n", bench_options.m_warmup_seconds);
 
-	for (bool exit = false; !exit;) {
+	// The samples start once the warm-up is over
+	const int64_t warmup_end = time_since(reference_time) + (int64_t)(bench_options.m_warmup_seconds * 1e9);
+	int64_t progress_time = warmup_end;
+	NDIlib_recv_performance_t dropped_at_start;
+	bool measuring = false;
+
+	while (!exit_loop && ((settings.no_samples <= 0) || (latency_ns.count() < (uint64_t)settings.no_samples))) {
 		// Receive a frame
 		NDIlib_video_frame_v2_t video_frame;
-		if (::NDIlib_recv_capture_v2(pNDI_recv, &video_frame, nullptr, nullptr, 250) == NDIlib_frame_type_video) {
-			// Get the current time in ns
-			const uint64_t time_since_reference = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - reference_time).count();
+		if (::NDIlib_recv_capture_v2(pNDI_recv, &video_frame, nullptr, nullptr, 1000) != NDIlib_frame_type_video)
+			continue;
+
+		// Get the current time in ns, and free the frame
+		const int64_t receive_time = time_since(reference_time);
+		const int64_t send_time = video_frame.timecode;
+		::NDIlib_recv_free_video_v2(pNDI_recv, &video_frame);
 
-			// Show we exit ?
-			if ((video_frame.p_metadata) && (0 == strcasecmp(video_frame.p_metadata, "<exit/>")))
-				exit = true;
+		if (receive_time < warmup_end)
+			continue;
 
-			// Free the data
-			::NDIlib_recv_free_video_v2(pNDI_recv, &video_frame);
+		// Remember how many frames had been dropped when we started
+		if (!measuring) {
+			measuring = true;
+			::NDIlib_recv_get_performance(pNDI_recv, nullptr, &dropped_at_start);
+		}
 
-			// Display the time in MS
-			const uint64_t latency_in_ms = (time_since_reference - video_frame.timecode + 500) / 1000;
+		if (receive_time >= send_time)
+			latency_ns.add((uint64_t)(receive_time - send_time));
 
-			// Dislplay it
-			printf("NDI video latency (with compression, transmission and decompression) = %1.2fms\n", (float)(time_since_reference - video_frame.timecode) / 1000.0f);
+		// Display progress once a second
+		if (!bench_options.m_quiet && (receive_time - progress_time >= 1000000000)) {
+			printf("%llu samples, latency p50=%1.2fms p99=%1.2fms max=%1.2fms\n", (unsigned long long)latency_ns.count(),
+				(double)latency_ns.percentile(50.0) * 1e-6, (double)latency_ns.percentile(99.0) * 1e-6, (double)latency_ns.max() * 1e-6);
+			progress_time = receive_time;
 		}
 	}
 
-	// Destroy 
+	// How many frames were dropped while we were measuring
+	::NDIlib_recv_get_performance(pNDI_recv, nullptr, &dropped);
+	dropped.video_frames -= dropped_at_start.video_frames;
+	dropped.audio_frames -= dropped_at_start.audio_frames;
+	dropped.metadata_frames -= dropped_at_start.metadata_frames;
+
+	// Destroy
 	::NDIlib_recv_destroy(pNDI_recv);
 }
 
+// Measure how long it takes from connecting a new receiver to the first video frame arriving
+void measure_time_to_first_frame(const NDIlib_source_t* p_source, const latency_settings_t& settings, ndi_benchmark::histogram& ttff_ns)
+{
+	for (int i = 0; !exit_loop && i < settings.no_ttff; i++) {
+		NDIlib_recv_create_v3_t NDI_recv_create_desc;
+		NDI_recv_create_desc.color_format = NDIlib_recv_color_format_fastest;
+		NDIlib_recv_instance_t pNDI_recv = ::NDIlib_recv_create_v3(&NDI_recv_create_desc);
+		if (!pNDI_recv)
+			return;
+
+		const auto connect_time = clock_type::now();
+		::NDIlib_recv_connect(pNDI_recv, p_source);
+
+		// Wait up to five seconds for the first frame
+		while (!exit_loop && (clock_type::now() - connect_time < std::chrono::seconds(5))) {
+			NDIlib_video_frame_v2_t video_frame;
+			if (::NDIlib_recv_capture_v2(pNDI_recv, &video_frame, nullptr, nullptr, 100) == NDIlib_frame_type_video) {
+				ttff_ns.add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - connect_time).count());
+				::NDIlib_recv_free_video_v2(pNDI_recv, &video_frame);
+				break;
+			}
+		}
+
+		::NDIlib_recv_destroy(pNDI_recv);
+	}
+}
+
+// Display a histogram as a percentile distribution, in the same layout as HdrHistogram
+void display_distribution(const char* p_name, const ndi_benchmark::histogram& values)
+{
+	static const double percentiles[] = { 0.0, 10.0, 20.0, 30.0, 40.0, 50.0, 60.0, 70.0, 80.0, 90.0, 95.0, 97.5, 99.0, 99.5, 99.9, 99.95, 99.99, 100.0 };
+
+	printf("\n%s (%llu samples)\n", p_name, (unsigned long long)values.count());
+	if (!values.count())
+		return;
+
+	printf("%12s %14s %12s %16s\n", "Value(ms)", "Percentile", "TotalCount", "1/(1-Percentile)");
+	for (const double percentile : percentiles) {
+		const uint64_t value = (percentile == 0.0) ? values.min() : (percentile == 100.0) ? values.max() : values.percentile(percentile);
+		const uint64_t total_count = std::max((uint64_t)1, (uint64_t)((percentile / 100.0) * (double)values.count() + 0.5));
+		if (percentile < 100.0)
+			printf("%12.3f %14.6f %12llu %16.2f\n", (double)value * 1e-6, percentile / 100.0, (unsigned long long)total_count, 100.0 / (100.0 - percentile));
+		else
+			printf("%12.3f %14.6f %12llu %16s\n", (double)value * 1e-6, 1.0, (unsigned long long)values.count(), "inf");
+	}
+	printf("#[Mean = %1.3f, Max = %1.3f, Total count = %llu]\n", values.mean() * 1e-6, (double)values.max() * 1e-6, (unsigned long long)values.count());
+}
+
+// Write the percentiles of a histogram as a JSON object
+void write_json_histogram(FILE* p_file, const char* p_name, const ndi_benchmark::histogram& values, const bool last)
+{
+	fprintf(p_file, "  \"%s\": { \"count\": %llu, \"min\": %llu, \"mean\": %.1f, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p99_9\": %llu, \"p99_99\": %llu, \"max\": %llu }%s\n",
+		p_name, (unsigned long long)values.count(), (unsigned long long)values.min(), values.mean(),
+		(unsigned long long)values.percentile(50.0), (unsigned long long)values.percentile(90.0), (unsigned long long)values.percentile(99.0),
+		(unsigned long long)values.percentile(99.9), (unsigned long long)values.percentile(99.99), (unsigned long long)values.max(), last ? "" : ",");
+}
+
 int main(int argc, char* argv[])
 {
 	// Not required, but "correct" (see the SDK documentation.
@@ -62,12 +347,51 @@ int main(int argc, char* argv[])
 		return 0;
 	}
 
-	// This is our reference time which we use 
-	const std::chrono::high_resolution_clock::time_point reference_time = std::chrono::high_resolution_clock::now();
+	// Catch interrupt so that we can shut down gracefully
+	signal(SIGINT, sigint_handler);
 
-	// Create an NDI source that is called "My PNG" and is clocked to the video.
+	// The default is 1080p59.94 UYVY
+	latency_settings_t settings = { 1920, 1080, "UYVY", NDIlib_FourCC_type_UYVY, 60000, 1001, false, ndi_content::content_gradient, 5000, 20 };
+	for (int i = 1; i < argc; i++) {
+		const bool has_value = (i + 1 < argc);
+		if (strcasecmp(argv[i], "-clocked") == 0) {
+			settings.clocked = true;
+		} else if (has_value && (strcasecmp(argv[i], "-xres") == 0)) {
+			settings.xres = atoi(argv[++i]) & ~1;
+		} else if (has_value && (strcasecmp(argv[i], "-yres") == 0)) {
+			settings.yres = atoi(argv[++i]) & ~1;
+		} else if (has_value && (strcasecmp(argv[i], "-fourcc") == 0)) {
+			if (!parse_fourcc(argv[++i], settings.FourCC, settings.fourcc_name))
+				printf("Unknown FourCC \"%s\", using %s.\n", argv[i], settings.fourcc_name.c_str());
+		} else if (has_value && (strcasecmp(argv[i], "-fps") == 0)) {
+			if (!parse_frame_rate(argv[++i], settings.frame_rate_N, settings.frame_rate_D)) {
+				settings.frame_rate_N = 60000;
+				settings.frame_rate_D = 1001;
+			}
+		} else if (has_value && (strcasecmp(argv[i], "-content") == 0)) {
+			ndi_content::parse_content(argv[++i], settings.content);
+		} else if (has_value && (strcasecmp(argv[i], "-samples") == 0)) {
+			settings.no_samples = atoi(argv[++i]);
+		} else if (has_value && (strcasecmp(argv[i], "-ttff") == 0)) {
+			settings.no_ttff = atoi(argv[++i]);
+		}
+	}
+
+	if ((settings.xres <= 0) || (settings.yres <= 0)) {
+		printf("Invalid resolution.\n");
+		return 0;
+	}
+
+	// The -warmup, -json, -csv and -quiet options
+	ndi_benchmark::options bench_options;
+	bench_options.parse(argc, argv);
+
+	// This is our reference time which we use
+	const clock_type::time_point reference_time = clock_type::now();
+
+	// Create an NDI source that is called "Latency Check", and is clocked to the video if we were asked to.
 	NDIlib_send_create_t NDI_send_create_desc;
-	NDI_send_create_desc.clock_video = false;
+	NDI_send_create_desc.clock_video = settings.clocked;
 	NDI_send_create_desc.p_ndi_name = "Latency Check";
 
 	// We create the NDI sender
@@ -75,42 +399,91 @@ int main(int argc, char* argv[])
 	if (!pNDI_send)
 		return 0;
 
-	// We create a thread that now listens for sources
-	std::thread receive_thread(receive_source, ::NDIlib_send_get_source_name(pNDI_send), reference_time);
+	// We build two frames that we alternate between
+	printf("Generating content ...\n");
+	ndi_content::generator content(settings.content);
+	std::vector<uint8_t> frames[2];
+	const int line_stride = build_frame(content, settings, 0, frames[0]);
+	build_frame(content, settings, settings.yres / 4, frames[1]);
 
-	// We are going to create a frame
-	NDIlib_video_frame_v2_t NDI_video_frame;
-	NDI_video_frame.xres = 640;
-	NDI_video_frame.yres = 480;
-	NDI_video_frame.FourCC = NDIlib_FourCC_type_UYVY;
-	NDI_video_frame.line_stride_in_bytes = NDI_video_frame.xres * 2;
-	NDI_video_frame.p_data = new uint8_t[NDI_video_frame.line_stride_in_bytes * NDI_video_frame.yres];
-	::memset(NDI_video_frame.p_data, 128, NDI_video_frame.line_stride_in_bytes * NDI_video_frame.yres);
+	printf("Sending %dx%d %s at %1.2ffps (%s) ...\n", settings.xres, settings.yres, settings.fourcc_name.c_str(),
+		(double)settings.frame_rate_N / (double)settings.frame_rate_D, settings.clocked ? "clocked" : "unclocked");
 
-	for (int idx = 100; idx; idx--) {
-		// Measure the number of nano-seconds since the reference time
-		NDI_video_frame.timecode = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - reference_time).count();
-		if (idx == 1)
-			NDI_video_frame.p_metadata = "<exit/>";
+	// We send on a thread of its own
+	std::atomic<bool> stop_sending(false);
+	ndi_benchmark::histogram send_call_ns;
+	std::thread send_thread(send_frames, pNDI_send, std::cref(settings), frames, line_stride, reference_time, std::cref(stop_sending), std::ref(send_call_ns));
 
-		// We now submit the frame. Note that this call will be clocked so that we end up submitting at exactly 29.97fps.
-		::NDIlib_send_send_video_async_v2(pNDI_send, &NDI_video_frame);
+	// Measure the latency
+	const NDIlib_source_t* p_source = ::NDIlib_send_get_source_name(pNDI_send);
+	ndi_benchmark::histogram latency_ns;
+	NDIlib_recv_performance_t dropped;
+	measure_latency(p_source, settings, bench_options, reference_time, latency_ns, dropped);
 
-		// We do not want to become time limited, in effect this means that we check the latency every 250ms
-		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+	// Measure the time to the first frame
+	ndi_benchmark::histogram ttff_ns;
+	if (settings.no_ttff > 0) {
+		printf("Measuring time to first frame over %d connections ...\n", settings.no_ttff);
+		measure_time_to_first_frame(p_source, settings, ttff_ns);
 	}
 
-	// Synchronize, just in case
-	::NDIlib_send_send_video_async_v2(pNDI_send, nullptr);
+	// Stop sending
+	stop_sending = true;
+	send_thread.join();
 
-	// Destroy the NDI sender
-	::NDIlib_send_destroy(pNDI_send);
+	// Display the results
+	printf("\nNDI video latency (with compression, transmission and decompression)\n");
+	printf("    %-20s %s\n", "ndi_version", NDIlib_version());
+	printf("    %-20s %dx%d %s\n", "format", settings.xres, settings.yres, settings.fourcc_name.c_str());
+	printf("    %-20s %d/%d (%s)\n", "frame rate", settings.frame_rate_N, settings.frame_rate_D, settings.clocked ? "clocked" : "unclocked");
+	printf("    %-20s %s\n", "content", ndi_content::content_name(settings.content));
+	printf("    %-20s %lld\n", "dropped frames", (long long)dropped.video_frames);
+
+	if (settings.clocked)
+		printf("    The clocked latency includes any time that NDI waits for the frame time before sending the frame.\n");
+
+	display_distribution("Latency", latency_ns);
+	display_distribution("Time to first frame", ttff_ns);
+	display_distribution("Send call time", send_call_ns);
 
-	// Free the memory
-	delete[] NDI_video_frame.p_data;
+	// Write the results as JSON
+	if (!bench_options.m_json_filename.empty()) {
+		const bool to_stdout = (bench_options.m_json_filename == "-");
+		FILE* p_file = to_stdout ? stdout : fopen(bench_options.m_json_filename.c_str(), "w");
+		if (p_file) {
+			fprintf(p_file, "{\n  \"benchmark\": \"NDIlib_Send_Latency\",\n  \"ndi_version\": \"%s\",\n", NDIlib_version());
+			fprintf(p_file, "  \"xres\": %d,\n  \"yres\": %d,\n  \"fourcc\": \"%s\",\n  \"frame_rate_N\": %d,\n  \"frame_rate_D\": %d,\n  \"clocked\": %s,\n",
+				settings.xres, settings.yres, settings.fourcc_name.c_str(), settings.frame_rate_N, settings.frame_rate_D, settings.clocked ? "true" : "false");
+			fprintf(p_file, "  \"content\": \"%s\",\n  \"dropped_frames\": %lld,\n", ndi_content::content_name(settings.content), (long long)dropped.video_frames);
+			write_json_histogram(p_file, "latency_ns", latency_ns, false);
+			write_json_histogram(p_file, "time_to_first_frame_ns", ttff_ns, false);
+			write_json_histogram(p_file, "send_call_ns", send_call_ns, true);
+			fprintf(p_file, "}\n");
+
+			if (!to_stdout)
+				fclose(p_file);
+		}
+	}
 
-	// We wait for the receiver to exit
-	receive_thread.join();
+	// Append the results to a CSV file, with a header if it is new
+	if (!bench_options.m_csv_filename.empty()) {
+		FILE* p_file = fopen(bench_options.m_csv_filename.c_str(), "a");
+		if (p_file) {
+			fseek(p_file, 0, SEEK_END);
+			if (ftell(p_file) == 0)
+				fprintf(p_file, "benchmark,xres,yres,fourcc,frame_rate_N,frame_rate_D,clocked,content,samples,dropped,latency_min_ns,latency_p50_ns,latency_p99_ns,latency_p99_9_ns,latency_max_ns,ttff_p50_ns,ttff_max_ns\n");
+			fprintf(p_file, "NDIlib_Send_Latency,%d,%d,%s,%d,%d,%d,%s,%llu,%lld,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+				settings.xres, settings.yres, settings.fourcc_name.c_str(), settings.frame_rate_N, settings.frame_rate_D, settings.clocked ? 1 : 0,
+				ndi_content::content_name(settings.content), (unsigned long long)latency_ns.count(), (long long)dropped.video_frames,
+				(unsigned long long)latency_ns.min(), (unsigned long long)latency_ns.percentile(50.0), (unsigned long long)latency_ns.percentile(99.0),
+				(unsigned long long)latency_ns.percentile(99.9), (unsigned long long)latency_ns.max(),
+				(unsigned long long)ttff_ns.percentile(50.0), (unsigned long long)ttff_ns.max());
+			fclose(p_file);
+		}
+	}
+
+	// Destroy the NDI sender
+	::NDIlib_send_destroy(pNDI_send);
 
 	// Not required, but nice
 	::NDIlib_destroy();
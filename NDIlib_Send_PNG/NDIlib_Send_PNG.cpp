@@ -1,37 +1,262 @@
 #include <stdlib.h>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 #include <Processing.NDI.Lib.h>
 
+#include "../NDIlib_Common/NDIlib_Color.h"
+#include "../NDIlib_Common/NDIlib_FramePool.h"
+#include "../NDIlib_Common/NDIlib_Raw.h"
+#include "../NDIlib_Common/NDIlib_Thread.h"
+
 #ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
 #ifdef _WIN64
 #pragma comment(lib, "Processing.NDI.Lib.x64.lib")
 #else // _WIN64
 #pragma comment(lib, "Processing.NDI.Lib.x86.lib")
 #endif // _WIN64
+#define strcasecmp _stricmp
+#else
+#include <dirent.h>
+#include <strings.h>
 #endif
 
 // PNG loader in a single file !
-// From http://lodev.org/lodepng/ 
+// From http://lodev.org/lodepng/
 #include "picopng.hpp"
 
-int main(int argc, char* argv[])
+// This sends a PNG file, or plays a folder of PNG files as an image sequence, for instance a graphics loop with alpha.
+//
+// A sequence is played by a pipeline. A number of decoder threads each take a buffer from a pool, claim the next frame
+// and decode and convert it straight into the buffer, so the frames are decoded ahead and in parallel. The sending
+// thread takes them in order and sends them asynchronously, at the frame-rate that NDI clocks the sender to. Since a
+// decoder always has its buffer before it claims a frame, the frame that is sent next is always being decoded, and the
+// number of buffers bounds how far ahead the decoders can get. When the next frame is not ready in time to be sent,
+// that is a starvation event, which is counted and displayed along with how long the sender waited.
+//
+// Decoding a PNG file is slow, an 8K still takes seconds, so the frames can be kept in a cache folder once they have been
+// decoded and converted. Each one is a raw frame file (see NDIlib_Raw.h), which on later runs is memory mapped and sent
+// straight from the mapping, without decoding or copying it. A cached frame is made again when the size or modification
+// time of its PNG file changes.
+//		NDIlib_Send_PNG <file or folder> [options]
+//		-fps <n>[/<d>]			The frame-rate of a sequence, e.g. 25, 59.94 or 30000/1001 (default 30000/1001).
+//		-decoders <n>			The number of decoder threads (default one per CPU).
+//		-buffers <n>			The number of frame buffers, which is how far ahead we decode (default twice the decoders,
+//								and at least 4).
+//		-loop					Play the sequence until interrupted, rather than once.
+//		-name <name>			The name of the source (default "My PNG").
+//		-cache <folder>			Keep the decoded frames in this folder, which must exist (default no cache).
+
+static std::atomic<bool> exit_loop(false);
+static void sigint_handler(int)
+{
+	exit_loop = true;
+}
+
+// Get the PNG files in a folder, in order of their names. Returns false if it is not a folder.
+static bool list_png_files(const std::string& folder, std::vector<std::string>& filenames)
+{
+	filenames.clear();
+
+#ifdef _WIN32
+	const DWORD attributes = GetFileAttributesA(folder.c_str());
+	if ((attributes == INVALID_FILE_ATTRIBUTES) || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+		return false;
+
+	WIN32_FIND_DATAA find_data;
+	HANDLE hFind = FindFirstFileA((folder + "\\*.png").c_str(), &find_data);
+	if (hFind != INVALID_HANDLE_VALUE) {
+		do {
+			if (!(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+				filenames.push_back(folder + "\\" + find_data.cFileName);
+		} while (FindNextFileA(hFind, &find_data));
+		FindClose(hFind);
+	}
+#else
+	DIR* p_dir = opendir(folder.c_str());
+	if (!p_dir)
+		return false;
+
+	while (const dirent* p_entry = readdir(p_dir)) {
+		const size_t length = strlen(p_entry->d_name);
+		if ((length > 4) && !strcasecmp(p_entry->d_name + length - 4, ".png"))
+			filenames.push_back(folder + "/" + p_entry->d_name);
+	}
+	closedir(p_dir);
+#endif
+
+	std::sort(filenames.begin(), filenames.end());
+	return true;
+}
+
+// Parse a frame-rate, either as a fraction or as a number of frames per second. The NTSC rates become x/1001.
+static bool parse_frame_rate(const char* p_text, int& frame_rate_N, int& frame_rate_D)
+{
+	if (strchr(p_text, '/')) {
+		frame_rate_N = atoi(p_text);
+		frame_rate_D = atoi(strchr(p_text, '/') + 1);
+	} else {
+		const double fps = atof(p_text);
+		const double ntsc_N = std::floor(fps + 0.5) * 1000.0;
+		if ((fps > 0.0) && (std::fabs(fps - ntsc_N / 1001.0) < 0.005) && (std::fabs(fps - ntsc_N / 1000.0) > 0.005)) {
+			frame_rate_N = (int)ntsc_N;
+			frame_rate_D = 1001;
+		} else {
+			frame_rate_N = (int)(fps * 1000.0 + 0.5);
+			frame_rate_D = 1000;
+		}
+	}
+	return (frame_rate_N > 0) && (frame_rate_D > 0);
+}
+
+// Get the format that a picture is sent in. NDI compresses YUV natively, so we convert the picture to UYVY ourselves
+// rather than have NDI do it. When the picture has any transparency, we keep it with UYVA. Pictures with an odd width
+// cannot be 4:2:2, so they go as RGBA.
+static NDIlib_FourCC_video_type_e get_send_format(const std::vector<unsigned char>& image_data, const unsigned long xres)
+{
+	if (xres & 1)
+		return NDIlib_FourCC_type_RGBA;
+
+	for (size_t i = 3; i < image_data.size(); i += 4) {
+		if (image_data[i] != 255)
+			return NDIlib_FourCC_type_UYVA;
+	}
+	return NDIlib_FourCC_type_UYVY;
+}
+
+// Get the name of the cached frame for a PNG file, which has the name of the PNG file with a hash of its path, so that
+// files with the same name in different folders do not share a cached frame
+static std::string get_cache_filename(const std::string& cache_folder, const std::string& filename)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (const char c : filename) {
+		hash ^= (uint8_t)c;
+		hash *= 1099511628211ULL;
+	}
+
+	const size_t slash = filename.find_last_of("/\\");
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%016llx.ndiraw", (unsigned long long)hash);
+	return cache_folder + "/" + ((slash == std::string::npos) ? filename : filename.substr(slash + 1)) + suffix;
+}
+
+// Map the cached frame for a PNG file, when there is one that was made from this version of it. The frame stays valid
+// for as long as the mapping is open.
+static bool load_cached_frame(const std::string& cache_folder, const std::string& filename, ndi_raw::mapped_file& file, NDIlib_video_frame_v2_t& frame)
 {
-	std::vector<unsigned char> png_data;
-	if (argc == 2) {
-		// Lets load the file from disk.
-		loadFile(png_data, argv[1]);
+	ndi_raw::file_info_t source;
+	ndi_raw::frame_header_t header;
+	if (cache_folder.empty() || !ndi_raw::get_file_info(filename, source) ||
+		!ndi_raw::map_frame_file(get_cache_filename(cache_folder, filename), file, header, &source))
+		return false;
+
+	// It must be a frame that we could have made, which is all there in the file, and have been converted in the same way
+	// as we would now. Anything else is decoded again rather than being handed to NDI.
+	const NDIlib_FourCC_video_type_e FourCC = (NDIlib_FourCC_video_type_e)header.FourCC;
+	const bool is_yuv = (FourCC == NDIlib_FourCC_type_UYVY) || (FourCC == NDIlib_FourCC_type_UYVA);
+	if ((!is_yuv && (FourCC != NDIlib_FourCC_type_RGBA)) || (is_yuv && (header.xres & 1)) ||
+		((int64_t)header.line_stride_in_bytes < (int64_t)header.xres * (is_yuv ? 2 : 4)) ||
+		(ndi_color::frame_size(FourCC, header.xres, header.yres, header.line_stride_in_bytes) != header.data_size) ||
+		(header.flags != (uint32_t)ndi_color::default_matrix(header.xres, header.yres))) {
+		file.close();
+		return false;
 	}
 
-	// Bail if nothing was loaded (or no argument given).
+	frame.xres = header.xres;
+	frame.yres = header.yres;
+	frame.FourCC = FourCC;
+	frame.line_stride_in_bytes = header.line_stride_in_bytes;
+	frame.p_data = (uint8_t*)ndi_raw::frame_data(file, header);
+	return true;
+}
+
+// Keep a frame that we have decoded in the cache
+static void store_cached_frame(const std::string& cache_folder, const std::string& filename, const NDIlib_video_frame_v2_t& frame)
+{
+	ndi_raw::frame_header_t header;
+	if (cache_folder.empty() || !ndi_raw::get_file_info(filename, header.source))
+		return;
+
+	header.FourCC = (uint32_t)frame.FourCC;
+	header.xres = frame.xres;
+	header.yres = frame.yres;
+	header.line_stride_in_bytes = frame.line_stride_in_bytes;
+	header.flags = (uint32_t)ndi_color::default_matrix(frame.xres, frame.yres);
+	header.data_size = ndi_color::frame_size(frame.FourCC, frame.xres, frame.yres, frame.line_stride_in_bytes);
+	if (!ndi_raw::write_frame_file(get_cache_filename(cache_folder, filename), header, frame.p_data))
+		printf("Cannot write the cached frame for %s.\n", filename.c_str());
+}
+
+// Decode a PNG file and convert it into the format that we send it in, using the line stride that the format has
+// without padding. The frame's xres and yres are the size that the PNG must be, and its p_data is where the converted
+// frame goes, which must be big enough for UYVA and RGBA at that size.
+static bool decode_frame(const std::string& filename, std::vector<unsigned char>& png_data, std::vector<unsigned char>& image_data,
+						 ndi_color::converter* p_color_converter, NDIlib_video_frame_v2_t& frame)
+{
+	// Lets load the file from disk.
+	loadFile(png_data, filename);
 	if (png_data.empty())
-		return 0;
+		return false;
 
 	// Decode the PNG data.
-	std::vector<unsigned char> image_data;
 	unsigned long xres = 0, yres = 0;
 	if (decodePNG(image_data, xres, yres, &png_data[0], png_data.size(), true))
-		return 0;
+		return false;
+
+	// A picture of any other size would not fit in p_data
+	if (((int)xres != frame.xres) || ((int)yres != frame.yres))
+		return false;
+
+	NDIlib_video_frame_v2_t src_frame((int)xres, (int)yres, NDIlib_FourCC_type_RGBA);
+	src_frame.p_data = image_data.data();
+	src_frame.line_stride_in_bytes = (int)xres * 4;
+
+	frame.FourCC = get_send_format(image_data, xres);
+	frame.line_stride_in_bytes = 0;
+	if (p_color_converter)
+		return p_color_converter->convert(&src_frame, &frame);
+
+	ndi_color::converter color_converter(ndi_color::default_matrix((int)xres, (int)yres), ndi_color::range_limited);
+	return color_converter.convert(&src_frame, &frame);
+}
+
+// Send a single picture, once, and leave it on the output for a minute
+static int send_picture(const std::string& filename, const char* p_ndi_name, const std::string& cache_folder)
+{
+	// A picture that has been decoded before is sent straight from the cache
+	ndi_raw::mapped_file cached_file;
+	std::vector<unsigned char> png_data, image_data, frame_data;
+	NDIlib_video_frame_v2_t NDI_video_frame;
+	if (!load_cached_frame(cache_folder, filename, cached_file, NDI_video_frame)) {
+		// We need the size of the picture before we can make room for it, so it is decoded without being converted first
+		unsigned long xres = 0, yres = 0;
+		loadFile(png_data, filename);
+		if (png_data.empty() || decodePNG(image_data, xres, yres, &png_data[0], png_data.size(), true))
+			return 0;
+
+		NDI_video_frame.xres = (int)xres;
+		NDI_video_frame.yres = (int)yres;
+		frame_data.resize(std::max(ndi_color::frame_size(NDIlib_FourCC_type_UYVA, xres, yres), ndi_color::frame_size(NDIlib_FourCC_type_RGBA, xres, yres)));
+		NDI_video_frame.p_data = frame_data.data();
+		if (!decode_frame(filename, png_data, image_data, NULL, NDI_video_frame))
+			return 0;
+
+		store_cached_frame(cache_folder, filename, NDI_video_frame);
+	}
 
 	// Not required, but "correct" (see the SDK documentation).
 	if (!NDIlib_initialize()) {
@@ -43,21 +268,13 @@ int main(int argc, char* argv[])
 
 	// Create an NDI source that is called "My PNG" and is clocked to the video.
 	NDIlib_send_create_t NDI_send_create_desc;
-	NDI_send_create_desc.p_ndi_name = "My PNG";
+	NDI_send_create_desc.p_ndi_name = p_ndi_name;
 
 	// We create the NDI sender
 	NDIlib_send_instance_t pNDI_send = NDIlib_send_create(&NDI_send_create_desc);
 	if (!pNDI_send)
 		return 0;
 
-	// We are going to create a frame
-	NDIlib_video_frame_v2_t NDI_video_frame;
-	NDI_video_frame.xres = xres;
-	NDI_video_frame.yres = yres;
-	NDI_video_frame.FourCC = NDIlib_FourCC_type_RGBA;
-	NDI_video_frame.p_data = &image_data[0];
-	NDI_video_frame.line_stride_in_bytes = xres * 4;
-
 	// We now submit the frame. Note that this call will be clocked so that we end up submitting at exactly 29.97fps.
 	NDIlib_send_send_video_v2(pNDI_send, &NDI_video_frame);
 
@@ -75,3 +292,298 @@ int main(int argc, char* argv[])
 	return 0;
 }
 
+// The frames that have been claimed by the decoders, indexed by frame number modulo the number of buffers. There are
+// never more frames claimed than there are buffers, so a slot is not reused until its frame has been sent. A frame that
+// comes from the cache is sent from its mapping, but it still holds a buffer, so that the decoders stay the same number
+// of frames ahead.
+struct sequence_slot_t {
+	enum state_e { state_empty, state_decoding, state_ready, state_failed };
+
+	sequence_slot_t(void) : m_state(state_empty), m_frame_no(-1), m_p_data(NULL), m_p_send(NULL), m_FourCC(NDIlib_FourCC_type_UYVY), m_line_stride(0) {}
+
+	state_e m_state;
+	int64_t m_frame_no;
+	uint8_t* m_p_data;
+	const uint8_t* m_p_send;
+	NDIlib_FourCC_video_type_e m_FourCC;
+	int m_line_stride;
+	std::shared_ptr<ndi_raw::mapped_file> m_p_cached;
+};
+
+// Play a sequence of PNG files
+static int play_sequence(const std::vector<std::string>& filenames, const char* p_ndi_name, const int frame_rate_N, const int frame_rate_D,
+						 int no_decoders, int no_buffers, const bool loop, const std::string& cache_folder)
+{
+	// Every frame must be the size of the first one
+	std::vector<unsigned char> png_data, image_data;
+	unsigned long xres = 0, yres = 0;
+	{	ndi_raw::mapped_file cached_file;
+		NDIlib_video_frame_v2_t cached_frame;
+		if (load_cached_frame(cache_folder, filenames[0], cached_file, cached_frame)) {
+			xres = (unsigned long)cached_frame.xres;
+			yres = (unsigned long)cached_frame.yres;
+		} else {
+			loadFile(png_data, filenames[0]);
+			if (png_data.empty() || decodePNG(image_data, xres, yres, &png_data[0], png_data.size(), true)) {
+				printf("Cannot decode %s.\n", filenames[0].c_str());
+				return 0;
+			}
+		}
+	}
+
+	if (!no_decoders)
+		no_decoders = ndi_thread::no_cpus();
+	if (!no_buffers)
+		no_buffers = std::max(4, no_decoders * 2);
+	no_buffers = std::max(2, no_buffers);
+
+	// Not required, but "correct" (see the SDK documentation).
+	if (!NDIlib_initialize()) {
+		printf("Cannot run NDI.");
+		return 0;
+	}
+
+	// Catch interrupt so that we can shut down gracefully
+	signal(SIGINT, sigint_handler);
+
+	// We create the NDI sender, which is clocked to the video
+	NDIlib_send_create_t NDI_send_create_desc;
+	NDI_send_create_desc.p_ndi_name = p_ndi_name;
+	NDIlib_send_instance_t pNDI_send = NDIlib_send_create(&NDI_send_create_desc);
+	if (!pNDI_send)
+		return 0;
+
+	// The buffers are big enough for any of the formats that a frame might be sent in
+	const size_t buffer_size = std::max(ndi_color::frame_size(NDIlib_FourCC_type_UYVA, xres, yres), ndi_color::frame_size(NDIlib_FourCC_type_RGBA, xres, yres));
+	ndi_frame_pool::options pool_options;
+	pool_options.m_no_buffers = no_buffers;
+	ndi_frame_pool::frame_pool frame_buffers(pNDI_send, buffer_size, pool_options);
+	if (!frame_buffers.valid()) {
+		NDIlib_send_destroy(pNDI_send);
+		return 0;
+	}
+
+	const int64_t no_frames = (int64_t)filenames.size();
+	printf("Playing %lld frames of %lux%lu at %1.2ffps with %d decoders and %d buffers%s%s.\n", (long long)no_frames, xres, yres,
+		(double)frame_rate_N / (double)frame_rate_D, no_decoders, no_buffers, loop ? ", looping" : "", cache_folder.empty() ? "" : ", with a cache");
+
+	// The frames that have been claimed
+	std::vector<sequence_slot_t> slots(no_buffers);
+	std::mutex slots_lock;
+	std::condition_variable slot_ready;
+	int64_t next_frame_no = 0;
+	std::atomic<int64_t> decode_ns(0), no_decoded(0), no_cached(0);
+
+	// The decoders
+	std::vector<std::thread> decoders;
+	for (int i = 0; i < no_decoders; i++) {
+		decoders.push_back(std::thread([&]() {
+			ndi_color::converter color_converter(ndi_color::default_matrix(xres, yres), ndi_color::range_limited, 1);
+			std::vector<unsigned char> png_data, image_data;
+
+			while (!exit_loop) {
+				// Get a buffer first, so that the frame we claim is sure to be decoded
+				uint8_t* p_data = frame_buffers.acquire();
+
+				// Claim the next frame
+				int64_t frame_no;
+				{	std::unique_lock<std::mutex> lock(slots_lock);
+					frame_no = next_frame_no;
+					if (exit_loop || (!loop && (frame_no >= no_frames))) {
+						lock.unlock();
+						frame_buffers.release(p_data);
+						break;
+					}
+					next_frame_no++;
+
+					sequence_slot_t& slot = slots[frame_no % no_buffers];
+					slot.m_state = sequence_slot_t::state_decoding;
+					slot.m_frame_no = frame_no;
+					slot.m_p_data = p_data;
+				}
+
+				// Map it from the cache, or decode it and convert it into the buffer
+				const auto start = std::chrono::steady_clock::now();
+				const std::string& filename = filenames[frame_no % no_frames];
+				std::shared_ptr<ndi_raw::mapped_file> p_cached(new ndi_raw::mapped_file);
+				NDIlib_video_frame_v2_t dst_frame;
+				bool ok = load_cached_frame(cache_folder, filename, *p_cached, dst_frame) && (dst_frame.xres == (int)xres) && (dst_frame.yres == (int)yres);
+				if (ok)
+					no_cached++;
+				else {
+					p_cached.reset();
+					dst_frame.xres = (int)xres;
+					dst_frame.yres = (int)yres;
+					dst_frame.p_data = p_data;
+					ok = decode_frame(filename, png_data, image_data, &color_converter, dst_frame);
+					if (ok)
+						store_cached_frame(cache_folder, filename, dst_frame);
+					else
+						printf("Cannot decode %s, or it is not %lux%lu.\n", filename.c_str(), xres, yres);
+				}
+
+				decode_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+				no_decoded++;
+
+				// It is ready to send, unless we are stopping, in which case the buffer is given back
+				{	std::unique_lock<std::mutex> lock(slots_lock);
+					sequence_slot_t& slot = slots[frame_no % no_buffers];
+					if (exit_loop) {
+						slot.m_state = sequence_slot_t::state_empty;
+						frame_buffers.release(p_data);
+					} else {
+						slot.m_state = ok ? sequence_slot_t::state_ready : sequence_slot_t::state_failed;
+						slot.m_p_send = dst_frame.p_data;
+						slot.m_FourCC = dst_frame.FourCC;
+						slot.m_line_stride = dst_frame.line_stride_in_bytes;
+						slot.m_p_cached = p_cached;
+					}
+				}
+				slot_ready.notify_all();
+			}
+		}));
+	}
+
+	// Send the frames in order, on this thread. The sends are clocked, so when the next frame is not ready as soon as
+	// the last one has been sent, the decoders have not kept up.
+	using namespace std::chrono;
+	int64_t frame_no = 0, no_starved = 0, no_failed = 0, last_decoded = 0, last_decode_ns = 0;
+	std::shared_ptr<ndi_raw::mapped_file> p_sending_cached;
+	double starved_ms = 0.0;
+	auto last_display = steady_clock::now();
+	for (; !exit_loop && (loop || (frame_no < no_frames)); frame_no++) {
+		sequence_slot_t& slot = slots[frame_no % no_buffers];
+
+		std::unique_lock<std::mutex> lock(slots_lock);
+		const bool ready = (slot.m_frame_no == frame_no) && (slot.m_state >= sequence_slot_t::state_ready);
+		if (!ready) {
+			const auto start_wait = steady_clock::now();
+			while (!exit_loop && !((slot.m_frame_no == frame_no) && (slot.m_state >= sequence_slot_t::state_ready)))
+				slot_ready.wait_for(lock, milliseconds(100));
+
+			// Waiting for the first frame is just starting up
+			if (frame_no) {
+				no_starved++;
+				starved_ms += duration<double, std::milli>(steady_clock::now() - start_wait).count();
+			}
+			if (exit_loop)
+				break;
+		}
+
+		// A frame that could not be decoded is skipped
+		const sequence_slot_t frame = slot;
+		slot.m_state = sequence_slot_t::state_empty;
+		slot.m_p_cached.reset();
+		lock.unlock();
+
+		if (frame.m_state == sequence_slot_t::state_failed) {
+			frame_buffers.release(frame.m_p_data);
+			no_failed++;
+			continue;
+		}
+
+		// We now submit the frame. Note that this call will be clocked so that we end up submitting at the frame-rate.
+		NDIlib_video_frame_v2_t NDI_video_frame(xres, yres, frame.m_FourCC, frame_rate_N, frame_rate_D);
+		NDI_video_frame.p_data = (uint8_t*)frame.m_p_send;
+		NDI_video_frame.line_stride_in_bytes = frame.m_line_stride;
+		frame_buffers.send_video(NDI_video_frame);
+
+		// NDI has finished with the frame before this one, so when this frame came from the cache its buffer can be
+		// given back now, and its mapping is kept until the next frame has been sent
+		if (frame.m_p_cached)
+			frame_buffers.release(frame.m_p_data);
+		p_sending_cached = frame.m_p_cached;
+
+		// Display how we are doing once a second
+		if (steady_clock::now() - last_display >= seconds(1)) {
+			const double seconds = duration<double>(steady_clock::now() - last_display).count();
+			const int64_t decoded = no_decoded, ns = decode_ns;
+			int no_ahead = 0;
+			lock.lock();
+			for (const sequence_slot_t& ahead : slots)
+				no_ahead += (ahead.m_state == sequence_slot_t::state_ready) ? 1 : 0;
+			lock.unlock();
+
+			printf("Frame %lld : decoding at %1.1ffps (%1.1fms a frame), %d frames decoded ahead, %lld starved for %1.1fms in total, %lld failed, %lld from the cache.\n",
+				(long long)frame_no, (double)(decoded - last_decoded) / seconds, (decoded > last_decoded) ? 1e-6 * (double)(ns - last_decode_ns) / (double)(decoded - last_decoded) : 0.0,
+				no_ahead, (long long)no_starved, starved_ms, (long long)no_failed, (long long)no_cached.load());
+			last_display = steady_clock::now();
+			last_decoded = decoded;
+			last_decode_ns = ns;
+		}
+	}
+
+	// Stop the decoders. The frames that are waiting to be sent, and the one that NDI has, are given back so that a
+	// decoder is not left waiting for a buffer, and a decoder that is part way through a frame gives its own back.
+	exit_loop = true;
+	frame_buffers.flush();
+	p_sending_cached.reset();
+	{	std::unique_lock<std::mutex> lock(slots_lock);
+		for (sequence_slot_t& slot : slots) {
+			if (slot.m_state >= sequence_slot_t::state_ready) {
+				frame_buffers.release(slot.m_p_data);
+				slot.m_state = sequence_slot_t::state_empty;
+				slot.m_p_cached.reset();
+			}
+		}
+	}
+
+	for (auto& decoder : decoders)
+		decoder.join();
+
+	printf("Sent %lld frames, the decoders were starved %lld times for %1.1fms in total.\n", (long long)(frame_no - no_failed), (long long)no_starved, starved_ms);
+
+	// Destroy the NDI sender
+	NDIlib_send_destroy(pNDI_send);
+
+	// Not required, but nice
+	NDIlib_destroy();
+
+	// Success
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	// Bail if no argument is given.
+	if (argc < 2)
+		return 0;
+
+	// The settings
+	const char* p_ndi_name = "My PNG";
+	std::string cache_folder;
+	int frame_rate_N = 30000, frame_rate_D = 1001, no_decoders = 0, no_buffers = 0;
+	bool loop = false;
+	for (int i = 2; i < argc; i++) {
+		if (strcasecmp(argv[i], "-loop") == 0)
+			loop = true;
+		else if (i == argc - 1)
+			break;
+		else if (strcasecmp(argv[i], "-name") == 0)
+			p_ndi_name = argv[++i];
+		else if (strcasecmp(argv[i], "-cache") == 0)
+			cache_folder = argv[++i];
+		else if (strcasecmp(argv[i], "-decoders") == 0)
+			no_decoders = std::max(0, atoi(argv[++i]));
+		else if (strcasecmp(argv[i], "-buffers") == 0)
+			no_buffers = std::max(0, atoi(argv[++i]));
+		else if (strcasecmp(argv[i], "-fps") == 0) {
+			if (!parse_frame_rate(argv[++i], frame_rate_N, frame_rate_D)) {
+				printf("Invalid frame-rate %s.\n", argv[i]);
+				return 0;
+			}
+		}
+	}
+
+	// A folder is played as a sequence, anything else is sent as a single picture
+	std::vector<std::string> filenames;
+	if (!list_png_files(argv[1], filenames))
+		return send_picture(argv[1], p_ndi_name, cache_folder);
+
+	if (filenames.empty()) {
+		printf("There are no PNG files in %s.\n", argv[1]);
+		return 0;
+	}
+
+	return play_sequence(filenames, p_ndi_name, frame_rate_N, frame_rate_D, no_decoders, no_buffers, loop, cache_folder);
+}
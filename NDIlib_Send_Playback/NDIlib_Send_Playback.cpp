@@ -0,0 +1,185 @@
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <Processing.NDI.Lib.h>
+
+#include "../NDIlib_Common/NDIlib_Record.h"
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#define strcasecmp _stricmp
+#else
+#include <strings.h>
+#endif // _WIN32
+
+// This plays back a recording made by NDIlib_Recv_Record, sending every video, audio and metadata frame exactly as it
+// was received, with its timecode, at the times that it was received. This makes the same load on a receiver every time
+// that it is played, which is what we want for repeatable tests.
+//
+// The recording is memory mapped, and the video is sent asynchronously straight from the mapping, so nothing is copied
+// or decoded and the sender is not clocked; the frames are sent on the recording's own times instead. The frames that
+// are coming up in the next half a second are asked for ahead of time, so that they are in memory by the time they are
+// sent. A frame that is sent more than one frame late is counted and displayed.
+//		NDIlib_Send_Playback <recording> [options]
+//		-name <name>						The name of the source (default the name of the source that was recorded).
+//		-loop								Play the recording until interrupted, rather than once.
+
+static std::atomic<bool> exit_loop(false);
+static void sigint_handler(int)
+{
+	exit_loop = true;
+}
+
+int main(int argc, char* argv[])
+{
+	// Bail if no argument is given.
+	if (argc < 2)
+		return 0;
+
+	// The settings
+	const char* p_ndi_name = NULL;
+	bool loop = false;
+	for (int i = 2; i < argc; i++) {
+		if (strcasecmp(argv[i], "-loop") == 0)
+			loop = true;
+		else if ((strcasecmp(argv[i], "-name") == 0) && (i < argc - 1))
+			p_ndi_name = argv[++i];
+	}
+
+	// Open the recording
+	ndi_record::reader recording;
+	if (!recording.open(argv[1])) {
+		printf("Cannot read the recording %s.\n", argv[1]);
+		return 0;
+	}
+
+	const std::vector<ndi_record::index_entry_t>& entries = recording.entries();
+	if (!recording.is_complete())
+		printf("The recording was not finished, %llu frames were found in it.\n", (unsigned long long)entries.size());
+
+	// When looping, the recording starts again one frame after its last video frame
+	int64_t loop_ns = recording.duration();
+	for (auto entry = entries.rbegin(); entry != entries.rend(); entry++) {
+		if ((entry->type == ndi_record::frame_type_video) && (entry->frame_rate_N > 0)) {
+			loop_ns += (int64_t)entry->frame_rate_D * 1000000000LL / entry->frame_rate_N;
+			break;
+		}
+	}
+
+	// Not required, but "correct" (see the SDK documentation).
+	if (!NDIlib_initialize()) {
+		printf("Cannot run NDI.");
+		return 0;
+	}
+
+	// Catch interrupt so that we can shut down gracefully
+	signal(SIGINT, sigint_handler);
+
+	// We create the NDI sender. The frames are sent at the times that they were recorded, so NDI does not clock them.
+	std::string ndi_name = p_ndi_name ? p_ndi_name : recording.source_name();
+	if (ndi_name.empty())
+		ndi_name = "My Playback";
+	NDIlib_send_create_t NDI_send_create_desc;
+	NDI_send_create_desc.p_ndi_name = ndi_name.c_str();
+	NDI_send_create_desc.clock_video = false;
+	NDI_send_create_desc.clock_audio = false;
+	NDIlib_send_instance_t pNDI_send = NDIlib_send_create(&NDI_send_create_desc);
+	if (!pNDI_send)
+		return 0;
+
+	printf("Playing %llu frames, %1.1fs and %1.1fMB, as %s%s.\n", (unsigned long long)entries.size(), 1e-9 * (double)recording.duration(),
+		(double)recording.size() / (1024.0 * 1024.0), ndi_name.c_str(), loop ? ", looping" : "");
+
+	// Send the frames at their times
+	using namespace std::chrono;
+	const auto start = steady_clock::now();
+	auto last_display = start;
+	int64_t no_sent = 0, no_late = 0, loop_start_ns = 0;
+	double max_late_ms = 0.0;
+	size_t next_prefetch = 0;
+	for (size_t i = 0; !exit_loop && (i < entries.size());) {
+		const ndi_record::index_entry_t& entry = entries[i];
+		const int64_t time_ns = loop_start_ns + entry.time;
+
+		// Ask for the frames in the next half a second to be read in, including those at the start of the next loop
+		for (; next_prefetch < i + entries.size(); next_prefetch++) {
+			const size_t prefetch = next_prefetch % entries.size();
+			const int64_t prefetch_ns = loop_start_ns + entries[prefetch].time + ((next_prefetch >= entries.size()) ? loop_ns : 0);
+			if ((prefetch_ns - time_ns > 500000000LL) || (!loop && (next_prefetch >= entries.size())))
+				break;
+			recording.will_need(entries[prefetch]);
+		}
+
+		// Wait until it is time to send it
+		const auto send_time = start + nanoseconds(time_ns);
+		std::this_thread::sleep_until(send_time);
+		const double late_ms = duration<double, std::milli>(steady_clock::now() - send_time).count();
+
+		switch (entry.type) {
+			case ndi_record::frame_type_video: {
+				// This frame is in use until the next one is sent, which the mapping is
+				NDIlib_video_frame_v2_t video_frame;
+				recording.get_video(entry, video_frame);
+				NDIlib_send_send_video_async_v2(pNDI_send, &video_frame);
+
+				// A frame is late when it goes out after the next one should have
+				if ((entry.frame_rate_N > 0) && (late_ms > 1000.0 * entry.frame_rate_D / entry.frame_rate_N))
+					no_late++;
+				max_late_ms = std::max(max_late_ms, late_ms);
+				break;
+			}
+			case ndi_record::frame_type_audio: {
+				NDIlib_audio_frame_v2_t audio_frame;
+				recording.get_audio(entry, audio_frame);
+				NDIlib_send_send_audio_v2(pNDI_send, &audio_frame);
+				break;
+			}
+			default: {
+				NDIlib_metadata_frame_t metadata_frame;
+				recording.get_metadata(entry, metadata_frame);
+				NDIlib_send_send_metadata(pNDI_send, &metadata_frame);
+				break;
+			}
+		}
+		no_sent++;
+
+		// Display how we are doing once a second
+		if (steady_clock::now() - last_display >= seconds(1)) {
+			printf("%1.1fs : %lld frames sent, %lld video frames were late, by up to %1.1fms.\n",
+				1e-9 * (double)(time_ns), (long long)no_sent, (long long)no_late, max_late_ms);
+			last_display = steady_clock::now();
+		}
+
+		// Go round again
+		if ((++i == entries.size()) && loop) {
+			i = 0;
+			loop_start_ns += loop_ns;
+			next_prefetch -= entries.size();
+		}
+	}
+
+	// NDI has the last video frame until another is sent, so we make sure that it has finished with it before the
+	// recording is unmapped
+	NDIlib_send_send_video_async_v2(pNDI_send, NULL);
+	printf("Sent %lld frames, %lld video frames were late, by up to %1.1fms.\n", (long long)no_sent, (long long)no_late, max_late_ms);
+
+	// Destroy the NDI sender
+	NDIlib_send_destroy(pNDI_send);
+	recording.close();
+
+	// Not required, but nice
+	NDIlib_destroy();
+
+	// Success
+	return 0;
+}
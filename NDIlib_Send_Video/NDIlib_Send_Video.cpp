@@ -1,11 +1,13 @@
 #include <iostream>
 #include <chrono>
 #include <vector>
-#include <algorithm>  // for std::fill
+#include <algorithm>
 #include <memory>     // for std::unique_ptr
-#include <iomanip>    // for std::setprecision
 #include <Processing.NDI.Lib.h>
 
+#include "../NDIlib_Common/NDIlib_Benchmark.h"
+#include "../NDIlib_Common/NDIlib_Pattern.h"
+
 #ifdef _WIN32
 #ifdef _WIN64
 #pragma comment(lib, "Processing.NDI.Lib.x64.lib")
@@ -14,6 +16,10 @@
 #endif // _WIN64
 #endif // _WIN32
 
+// The frames are a test pattern with a moving box and a frame counter, of which only the parts that change are drawn
+// each frame, so that the benchmark measures sending rather than drawing (see NDIlib_Pattern.h).
+//		-pattern bars|ramp|zoneplate    The pattern to send (default bars).
+
 // RAII wrapper for NDI sender
 class NDISender {
 public:
@@ -82,26 +88,38 @@ int main(int argc, char* argv[]) {
         // Create NDI video frame (RAII)
         NDIFrame videoFrame(1920, 1080);
 
-        // Run for five minutes.
-        using namespace std::chrono;
-        for (const auto start = high_resolution_clock::now(); high_resolution_clock::now() - start < minutes(5);) {
-            // Get the current time
-            const auto start_send = high_resolution_clock::now();
-
-            // Send 200 frames
-            for (int idx = 200; idx; idx--) {
-                // Fill the buffer. We alternate between black and white.
-                std::fill(videoFrame.getBuffer().begin(), videoFrame.getBuffer().end(), (idx & 1) ? 255 : 0);
-
-                // Submit the frame
-                NDIlib_send_send_video_v2(ndiSender.get(), videoFrame.get());
-            }
-
-            // Display the FPS
-            std::cout << "200 frames sent, at "
-                      << std::fixed << std::setprecision(2) << (200.0f / duration_cast<duration<float>>(high_resolution_clock::now() - start_send).count())
-                      << " fps" << std::endl;
+        // Run for five minutes unless told otherwise on the command line.
+        ndi_benchmark::options benchOptions;
+        benchOptions.m_duration_seconds = 5 * 60;
+        benchOptions.parse(argc, argv);
+
+        // The test pattern, selected with -pattern bars|ramp|zoneplate
+        ndi_pattern::pattern_e pattern = ndi_pattern::pattern_bars;
+        for (int i = 1; i < argc - 1; i++) {
+            if ((strcasecmp(argv[i], "-pattern") == 0) && !ndi_pattern::parse_pattern(argv[++i], pattern))
+                std::cerr << "Unknown pattern \"" << argv[i] << "\", using " << ndi_pattern::pattern_name(pattern) << "." << std::endl;
         }
+        ndi_pattern::generator testPattern(pattern);
+
+        ndi_benchmark::session bench("NDIlib_Send_Video", benchOptions);
+        bench.set("ndi_version", NDIlib_version());
+        bench.set("xres", videoFrame.get()->xres);
+        bench.set("yres", videoFrame.get()->yres);
+        bench.set("fourcc", "BGRX");
+        bench.set("pattern", ndi_pattern::pattern_name(pattern));
+
+        for (int idx = 0; bench.running(); idx++) {
+            // Fill the buffer. Only the moving box and the counter are drawn after the first frame.
+            testPattern.generate(*videoFrame.get(), idx);
+
+            // Submit the frame
+            bench.begin_call();
+            NDIlib_send_send_video_v2(ndiSender.get(), videoFrame.get());
+            bench.end_call();
+        }
+
+        // Display the results
+        bench.report();
 
         // Everything is cleaned up automatically by RAII objects (NDISender and NDIFrame)
         return 0;
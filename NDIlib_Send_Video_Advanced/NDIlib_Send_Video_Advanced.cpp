@@ -10,6 +10,7 @@
 #include <windows.h>
 
 #define strncasecmp _strnicmp
+#define strcasecmp _stricmp
 
 #ifdef _WIN64
 #pragma comment(lib, "Processing.NDI.Lib.x64.lib")
@@ -22,11 +23,24 @@
 
 #include <Processing.NDI.Lib.h>
 
+#include "../NDIlib_Common/NDIlib_Pattern.h"
+
+// The frames are a test pattern with a moving box and a frame counter, of which only the parts that change are drawn
+// each frame (see NDIlib_Pattern.h).
+//		-pattern bars|ramp|zoneplate			The pattern to send (default bars).
+
 static std::atomic<bool> exit_loop(false);
 static void sigint_handler(int) { exit_loop = true; }
 
 int main(int argc, char* argv[])
 {
+	// The pattern to send
+	ndi_pattern::pattern_e pattern = ndi_pattern::pattern_bars;
+	for (int i = 1; i < argc - 1; i++) {
+		if ((strcasecmp(argv[i], "-pattern") == 0) && !ndi_pattern::parse_pattern(argv[++i], pattern))
+			printf("Unknown pattern \"%s\", using %s.\n", argv[i], ndi_pattern::pattern_name(pattern));
+	}
+
 	// Not required, but "correct" (see the SDK documentation).
 	if (!NDIlib_initialize()) {
 		// Cannot run NDI. Most likely because the CPU is not sufficient (see SDK documentation).
@@ -67,6 +81,9 @@ int main(int argc, char* argv[])
 	NDI_video_frame.p_data = (uint8_t*)malloc(NDI_video_frame.xres * NDI_video_frame.yres * 4);
 	NDI_video_frame.line_stride_in_bytes = 1920 * 4;
 
+	// The test pattern generator
+	ndi_pattern::generator test_pattern(pattern);
+
 	// We will send 1000 frames of video. 
 	for (int idx = 0; !exit_loop; idx++) {
 		// We do not use any resources until we are actually connected.
@@ -95,23 +112,9 @@ int main(int argc, char* argv[])
 			NDIlib_tally_t NDI_tally;
 			NDIlib_send_get_tally(pNDI_send, &NDI_tally, 0);
 
-			// Fill in the buffer. It is likely that you would do something much smarter than this.
-			for (int y = 0; y < NDI_video_frame.yres; y++) {
-				// The frame data
-				uint8_t* p_image = (uint8_t*)NDI_video_frame.p_data + NDI_video_frame.line_stride_in_bytes * y;
-
-				// The index start for this line
-				int line_idx = y + idx;
-
-				// Cycle over the line
-				for (int x = 0; x < NDI_video_frame.xres; x++, p_image += 4, line_idx++) {
-					// Slight transparent blue
-					p_image[0] = 255;
-					p_image[1] = 128;
-					p_image[2] = 128;
-					p_image[3] = (line_idx & 16) ? 255 : 128;
-				}
-			}
+			// Fill in the buffer. The whole pattern is only drawn the first time, after that it is just the box and the
+			// counter.
+			test_pattern.generate(NDI_video_frame, idx);
 
 			// We now submit the frame. Note that this call will be clocked so that we end up submitting at exactly 59.94fps
 			NDIlib_send_send_video_v2(pNDI_send, &NDI_video_frame);
@@ -6,6 +6,8 @@
 #include <atomic>
 #include <Processing.NDI.Lib.h>
 
+#include "../NDIlib_Common/NDIlib_FramePool.h"
+
 #ifdef _WIN32
 #ifdef _WIN64
 #pragma comment(lib, "Processing.NDI.Lib.x64.lib")
@@ -47,34 +49,38 @@ int main(int argc, char* argv[])
 	NDI_video_frame.FourCC = NDIlib_FourCC_type_BGRA;
 	NDI_video_frame.line_stride_in_bytes = 1920 * 4;
 
-	// We are going to need two frame-buffers because one will typically be in flight (being used by NDI send)
-	// while we are filling in the other at the same time.
-	void* p_frame_buffers[2] = {
-		malloc(1920 * 1080 * 4),
-		malloc(1920 * 1080 * 4)
-	};
-
-	// We will send 1000 frames of video. 
-	for (int idx = 0; idx < 1000; idx++) {
-		// Fill in the buffer. Note that we alternate between buffers because we are going to have one buffer processing
-		// being filled in while the second is "in flight" and being processed by the API.
-		memset(p_frame_buffers[idx & 1], (idx & 1) ? 255 : 0, 1920 * 1080 * 4);
-
-		// We now submit the frame asynchronously. This means that this call will return immediately and the 
-		// API will "own" the memory location until there is a synchronizing event. A synchronizing event is 
-		// one of : NDIlib_send_send_video_async, NDIlib_send_send_video, NDIlib_send_destroy
-		NDI_video_frame.p_data = (uint8_t*)p_frame_buffers[idx & 1];
-		NDIlib_send_send_video_async_v2(pNDI_send, &NDI_video_frame);
+	// We are going to need at least two frame-buffers because one will typically be in flight (being used by NDI
+	// send) while we are filling in another at the same time. The pool keeps track of which buffer is in flight for
+	// us. Passing -hugepages backs the buffers with huge pages, and -mlock locks them into memory.
+	ndi_frame_pool::options pool_options;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-hugepages"))
+			pool_options.m_huge_pages = true;
+		else if (!strcmp(argv[i], "-mlock"))
+			pool_options.m_lock = true;
 	}
 
-	// Because one buffer is in flight we need to make sure that there is no chance that we might free it before
-	// NDI is done with it. You can ensure this either by sending another frame, or just by sending a frame with
-	// a NULL pointer.
-	NDIlib_send_send_video_async_v2(pNDI_send, NULL);
-
-	// Free the video frame
-	free(p_frame_buffers[0]);
-	free(p_frame_buffers[1]);
+	{	ndi_frame_pool::frame_pool frame_buffers(pNDI_send, 1920 * 1080 * 4, pool_options);
+		if (!frame_buffers.valid())
+			printf("Cannot allocate the frame buffers.\n");
+
+		// We will send 1000 frames of video. The sender is still destroyed below if we could not allocate the buffers.
+		for (int idx = 0; frame_buffers.valid() && !exit_loop && idx < 1000; idx++) {
+			// Get a buffer that is not "in flight" and fill it in.
+			uint8_t* p_frame_buffer = frame_buffers.acquire();
+			memset(p_frame_buffer, (idx & 1) ? 255 : 0, 1920 * 1080 * 4);
+
+			// We now submit the frame asynchronously. This means that this call will return immediately and the
+			// API will "own" the memory location until there is a synchronizing event. A synchronizing event is
+			// one of : NDIlib_send_send_video_async, NDIlib_send_send_video, NDIlib_send_destroy
+			// Once this returns the pool knows that the buffer we sent last time is free again.
+			NDI_video_frame.p_data = p_frame_buffer;
+			frame_buffers.send_video(NDI_video_frame);
+		}
+
+		// Because one buffer is in flight we need to make sure that there is no chance that we might free it before
+		// NDI is done with it. The pool does this when it is destroyed by sending a frame with a NULL pointer.
+	}
 
 	// Destroy the NDI sender
 	NDIlib_send_destroy(pNDI_send);
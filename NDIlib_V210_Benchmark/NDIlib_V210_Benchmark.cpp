@@ -0,0 +1,262 @@
+#include <csignal>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <Processing.NDI.Lib.h>
+
+#include "../NDIlib_Common/NDIlib_Benchmark.h"
+#include "../NDIlib_Common/NDIlib_Content.h"
+#include "../NDIlib_Common/NDIlib_V210.h"
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#define strcasecmp _stricmp
+#else
+#include <strings.h>
+#endif
+
+// A micro-benchmark of converting between V210 and P216, comparing NDIlib_util_V210_to_P216 and
+// NDIlib_util_P216_to_V210 with ndi_v210::converter using each instruction set on one thread and then on all threads.
+// Each conversion is timed on its own, and is displayed as a share of the time that there is for a 59.94Hz frame.
+//		-resolution 1080p,2160p		The resolutions to run (default both).
+//		-threads <n>				The number of threads for the multi-threaded runs (default one per CPU).
+// along with the -warmup, -duration, -json, -csv and -quiet options of the other benchmarks. Each run is 2 seconds
+// unless -duration is given.
+
+static std::atomic<bool> exit_loop(false);
+static void sigint_handler(int)
+{
+	exit_loop = true;
+}
+
+// The resolutions that can be run
+struct resolution_t {
+	const char* p_name;
+	int xres, yres;
+};
+
+static const resolution_t resolutions[] = {
+	{ "1080p", 1920, 1080 },
+	{ "2160p", 3840, 2160 },
+};
+
+// The ways of converting that are compared
+struct method_t {
+	std::string name;
+	bool use_sdk;
+	ndi_v210::simd_e simd;
+	int no_threads;
+};
+
+// Is a name in a comma separated list. An empty list contains everything.
+static bool in_list(const std::string& list, const char* p_name)
+{
+	if (list.empty())
+		return true;
+
+	for (size_t start = 0; start <= list.size();) {
+		size_t end = list.find(',', start);
+		if (end == std::string::npos)
+			end = list.size();
+		if (strcasecmp(list.substr(start, end - start).c_str(), p_name) == 0)
+			return true;
+		start = end + 1;
+	}
+
+	return false;
+}
+
+int main(int argc, char* argv[])
+{
+	// Not required, but "correct" (see the SDK documentation).
+	if (!NDIlib_initialize()) {
+		printf("Cannot run NDI.");
+		return 0;
+	}
+
+	// Catch interrupt so that we can shut down gracefully
+	signal(SIGINT, sigint_handler);
+
+	// The settings
+	ndi_benchmark::options bench_options;
+	bench_options.m_warmup_seconds = 0.5;
+	bench_options.parse(argc, argv);
+
+	std::string resolution_list;
+	int no_threads = ndi_thread::no_cpus();
+	for (int i = 1; i < argc - 1; i++) {
+		if (strcasecmp(argv[i], "-resolution") == 0)
+			resolution_list = argv[i + 1];
+		else if (strcasecmp(argv[i], "-threads") == 0)
+			no_threads = std::max(1, atoi(argv[i + 1]));
+	}
+
+	// Each conversion is a short run, and the results of each are appended to the CSV file as they are made. The JSON
+	// file is written with all of them at the end.
+	ndi_benchmark::options run_options = bench_options;
+	if (run_options.m_duration_seconds <= 0.0)
+		run_options.m_duration_seconds = 2.0;
+	run_options.m_json_filename.clear();
+	run_options.m_quiet = true;
+
+	// The methods that this CPU can run
+	const ndi_v210::simd_e best_simd = ndi_v210::detect_simd();
+	std::vector<method_t> methods;
+	methods.push_back(method_t{ "NDI SDK", true, ndi_v210::simd_scalar, 1 });
+	for (int simd = ndi_v210::simd_scalar; simd <= best_simd; simd++)
+		methods.push_back(method_t{ std::string(ndi_v210::simd_name((ndi_v210::simd_e)simd)) + " x1", false, (ndi_v210::simd_e)simd, 1 });
+	if (no_threads > 1)
+		methods.push_back(method_t{ std::string(ndi_v210::simd_name(best_simd)) + " x" + std::to_string(no_threads), false, best_simd, no_threads });
+
+	// The time that there is for each frame at 59.94Hz
+	const double frame_ms = 1001.0 / 60.0;
+
+	// The results for the JSON file
+	struct result_t {
+		std::string resolution, direction, method;
+		double mean_ms, p99_ms;
+		bool matches;
+	};
+	std::vector<result_t> all_results;
+
+	for (const resolution_t& res : resolutions) {
+		if (exit_loop || !in_list(resolution_list, res.p_name))
+			continue;
+
+		// Build a 10 bit P216 frame from the camera content, with the bottom two bits of each sample coming from the
+		// next frame so that every 10 bit value is used.
+		printf("Generating content for %s ...\n", res.p_name);
+		const int p216_stride = res.xres * (int)sizeof(uint16_t), v210_stride = ndi_v210::line_stride(res.xres);
+		std::vector<uint8_t> uyvy[2];
+		ndi_content::generator content(ndi_content::content_camera);
+		for (int i = 0; i < 2; i++) {
+			uyvy[i].resize((size_t)res.xres * res.yres * 2);
+			content.generate_uyvy(uyvy[i].data(), res.xres, res.yres, res.xres * 2, i);
+		}
+
+		std::vector<uint8_t> p216_src((size_t)p216_stride * res.yres * 2);
+		for (int y = 0; y < res.yres; y++) {
+			const uint8_t* p_uyvy[2] = { uyvy[0].data() + (size_t)y * res.xres * 2, uyvy[1].data() + (size_t)y * res.xres * 2 };
+			uint16_t* p_y = (uint16_t*)(p216_src.data() + (size_t)y * p216_stride);
+			uint16_t* p_uv = (uint16_t*)(p216_src.data() + (size_t)(res.yres + y) * p216_stride);
+			for (int x = 0; x < res.xres; x++) {
+				p_uv[x] = (uint16_t)((p_uyvy[0][x * 2 + 0] << 8) | ((p_uyvy[1][x * 2 + 0] & 3) << 6));
+				p_y[x] = (uint16_t)((p_uyvy[0][x * 2 + 1] << 8) | ((p_uyvy[1][x * 2 + 1] & 3) << 6));
+			}
+		}
+
+		// The V210 version of it, and the output frames
+		std::vector<uint8_t> v210_src((size_t)v210_stride * res.yres);
+		ndi_v210::converter(1).pack_p216(v210_src.data(), v210_stride, p216_src.data(), p216_stride, res.xres, res.yres);
+
+		std::vector<uint8_t> p216_dst(p216_src.size()), p216_sdk(p216_src.size());
+		std::vector<uint8_t> v210_dst(v210_src.size()), v210_sdk(v210_src.size());
+
+		NDIlib_video_frame_v2_t v210_frame(res.xres, res.yres, (NDIlib_FourCC_video_type_e)NDI_LIB_FOURCC('V', '2', '1', '0'), 60000, 1001);
+		v210_frame.p_data = v210_src.data();
+		v210_frame.line_stride_in_bytes = v210_stride;
+
+		NDIlib_video_frame_v2_t p216_frame(res.xres, res.yres, NDIlib_FourCC_type_P216, 60000, 1001);
+		p216_frame.p_data = p216_src.data();
+		p216_frame.line_stride_in_bytes = p216_stride;
+
+		for (int direction = 0; direction < 2; direction++) {
+			const char* p_direction = direction ? "P216->V210" : "V210->P216";
+			printf("\n%s %s%*s  mean ms   p99 ms   frame budget   speed-up   output\n", res.p_name, p_direction, 10, "");
+
+			double sdk_mean_ms = 0.0;
+			for (const method_t& method : methods) {
+				if (exit_loop)
+					break;
+
+				ndi_v210::converter converter(method.no_threads, method.simd);
+
+				ndi_benchmark::session bench("NDIlib_V210_Benchmark", run_options);
+				bench.set("xres", res.xres);
+				bench.set("yres", res.yres);
+				bench.set("direction", p_direction);
+				bench.set("method", method.name);
+
+				NDIlib_video_frame_v2_t dst_frame;
+				dst_frame.p_data = direction ? (method.use_sdk ? v210_sdk.data() : v210_dst.data()) : (method.use_sdk ? p216_sdk.data() : p216_dst.data());
+				dst_frame.line_stride_in_bytes = direction ? v210_stride : p216_stride;
+
+				while (!exit_loop && bench.running()) {
+					bench.begin_call();
+					if (direction == 0) {
+						if (method.use_sdk)
+							NDIlib_util_V210_to_P216(&v210_frame, &dst_frame);
+						else
+							converter.v210_to_p216(&v210_frame, &dst_frame);
+					} else {
+						if (method.use_sdk)
+							NDIlib_util_P216_to_V210(&p216_frame, &dst_frame);
+						else
+							converter.p216_to_v210(&p216_frame, &dst_frame);
+					}
+					bench.end_call();
+				}
+
+				// Check that we give the same answer as the SDK
+				bool matches = true;
+				if (!method.use_sdk) {
+					if (direction == 0) {
+						matches = (p216_dst == p216_sdk);
+					} else {
+						for (int y = 0; matches && (y < res.yres); y++)
+							matches = !memcmp(v210_dst.data() + (size_t)y * v210_stride, v210_sdk.data() + (size_t)y * v210_stride, (res.xres / 6) * 16);
+					}
+				}
+
+				const ndi_benchmark::results& results = bench.get_results();
+				const double mean_ms = results.m_call_ns.mean() * 1e-6;
+				const double p99_ms = (double)results.m_call_ns.percentile(99.0) * 1e-6;
+				if (method.use_sdk)
+					sdk_mean_ms = mean_ms;
+
+				printf("  %-26s %8.3f %8.3f %13.1f%% %9.1fx   %s\n", method.name.c_str(), mean_ms, p99_ms,
+					100.0 * mean_ms / frame_ms, (mean_ms > 0.0) ? sdk_mean_ms / mean_ms : 0.0,
+					method.use_sdk ? "reference" : matches ? "matches" : "DIFFERS");
+
+				bench.set("matches_sdk", matches ? "yes" : "no");
+				if (!run_options.m_csv_filename.empty())
+					bench.write_csv(run_options.m_csv_filename);
+
+				all_results.push_back(result_t{ res.p_name, p_direction, method.name, mean_ms, p99_ms, matches });
+			}
+		}
+	}
+
+	// Write the results as JSON
+	if (!bench_options.m_json_filename.empty()) {
+		const bool to_stdout = (bench_options.m_json_filename == "-");
+		FILE* p_file = to_stdout ? stdout : fopen(bench_options.m_json_filename.c_str(), "w");
+		if (p_file) {
+			fprintf(p_file, "{\n  \"benchmark\": \"NDIlib_V210_Benchmark\",\n  \"ndi_version\": \"%s\",\n  \"results\": [", NDIlib_version());
+			for (size_t i = 0; i < all_results.size(); i++) {
+				const result_t& result = all_results[i];
+				fprintf(p_file, "%s\n    { \"resolution\": \"%s\", \"direction\": \"%s\", \"method\": \"%s\", \"mean_ms\": %.4f, \"p99_ms\": %.4f, \"matches_sdk\": %s }",
+					i ? "," : "", result.resolution.c_str(), result.direction.c_str(), result.method.c_str(), result.mean_ms, result.p99_ms,
+					result.matches ? "true" : "false");
+			}
+			fprintf(p_file, "\n  ]\n}\n");
+
+			if (!to_stdout)
+				fclose(p_file);
+		}
+	}
+
+	// Not required, but nice
+	NDIlib_destroy();
+
+	// Success
+	return 0;
+}
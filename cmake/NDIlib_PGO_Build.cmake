@@ -0,0 +1,32 @@
+# Builds the examples with profile guided optimization in one go :
+#
+#   cmake -DBUILD_DIR=build [-DCONFIGURE_ARGS="-DNDI_SDK_DIR=...;-DNDI_MARCH=native"] -P cmake/NDIlib_PGO_Build.cmake
+#
+# This configures and builds an instrumented build, runs the pgo_train target, and then reconfigures and rebuilds the
+# same folder using the profiles.
+
+cmake_minimum_required(VERSION 3.10)
+
+get_filename_component(source_dir "${CMAKE_CURRENT_LIST_DIR}/.." ABSOLUTE)
+if(NOT BUILD_DIR)
+    set(BUILD_DIR "${source_dir}/build")
+endif()
+
+function(run_step)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Failed: ${ARGN}")
+    endif()
+endfunction()
+
+# The instrumented build, with the old profiles removed
+file(REMOVE_RECURSE "${BUILD_DIR}/pgo")
+run_step(${CMAKE_COMMAND} -S "${source_dir}" -B "${BUILD_DIR}" -DCMAKE_BUILD_TYPE=Release -DNDI_PGO=GENERATE ${CONFIGURE_ARGS})
+run_step(${CMAKE_COMMAND} --build "${BUILD_DIR}" --config Release --parallel)
+
+# The training run
+run_step(${CMAKE_COMMAND} --build "${BUILD_DIR}" --config Release --target pgo_train)
+
+# The optimized build
+run_step(${CMAKE_COMMAND} -S "${source_dir}" -B "${BUILD_DIR}" -DCMAKE_BUILD_TYPE=Release -DNDI_PGO=USE ${CONFIGURE_ARGS})
+run_step(${CMAKE_COMMAND} --build "${BUILD_DIR}" --config Release --parallel)
@@ -0,0 +1,72 @@
+# The training run for profile guided optimization. This is run by the pgo_train target of the top level build with :
+#   BIN_DIR        Where the examples were built
+#   EXE_SUFFIX     The executable suffix (.exe on Windows)
+#   PGO_DIR        Where the profiles are written
+#   LLVM_PROFDATA  llvm-profdata when building with Clang, the raw profiles are merged with it
+#   LOOPBACK       Whether the examples are linked against NDIlib_Loopback
+#
+# It runs the send benchmarks across the video formats and content, the latency benchmark (which sends and receives in
+# the same process) and, when there is a network, receives a benchmark sender with the multi-channel receiver.
+
+cmake_minimum_required(VERSION 3.10)
+
+set(training_seconds 3)
+
+function(run_example name)
+    message(STATUS "Training with ${name} ${ARGN}")
+    execute_process(
+        COMMAND "${BIN_DIR}/${name}${EXE_SUFFIX}" ${ARGN}
+        WORKING_DIRECTORY "${BIN_DIR}"
+        TIMEOUT 600
+        RESULT_VARIABLE result
+        OUTPUT_QUIET
+    )
+    if(NOT result EQUAL 0)
+        message(WARNING "${name} failed: ${result}")
+    endif()
+endfunction()
+
+# Sending every FourCC and resolution, and with each kind of content
+run_example(NDIlib_Send_Benchmark -sweep -warmup 0.2 -duration 1 -quiet)
+foreach(content gradient noise text camera)
+    run_example(NDIlib_Send_Benchmark -content ${content} -warmup 0.5 -duration ${training_seconds} -quiet)
+endforeach()
+
+# 8K frames from one and from several senders
+run_example(NDIlib_Send_Benchmark_8K -content camera -warmup 0.5 -duration ${training_seconds} -quiet)
+run_example(NDIlib_Send_Benchmark_8K -senders 4 -xres 1920 -yres 1080 -content noise -warmup 0.5 -duration ${training_seconds} -quiet)
+
+# The round trip through a receiver, in the formats that are most common
+foreach(fourcc UYVY BGRA P216)
+    run_example(NDIlib_Send_Latency -fourcc ${fourcc} -fps 120 -samples 360 -ttff 3 -quiet)
+endforeach()
+
+# Receiving with several channels needs the sender to be a different process, so the loopback cannot be used for this.
+# Both are run at the same time, and the receivers are stopped by the timeout if the source is never found.
+if(NOT LOOPBACK)
+    message(STATUS "Training with NDIlib_Recv_Multichannel")
+    math(EXPR sender_seconds "${training_seconds} * 3")
+    execute_process(
+        COMMAND "${BIN_DIR}/NDIlib_Send_Benchmark_8K${EXE_SUFFIX}" -senders 1 -xres 1920 -yres 1080 -content camera
+                -warmup 0 -duration ${sender_seconds} -quiet
+        COMMAND "${BIN_DIR}/NDIlib_Recv_Multichannel${EXE_SUFFIX}" -receivers 4 -source "Benchmark 1"
+                -warmup 1 -duration ${training_seconds} -quiet
+        WORKING_DIRECTORY "${BIN_DIR}"
+        TIMEOUT 120
+        RESULTS_VARIABLE results
+        OUTPUT_QUIET
+    )
+    message(STATUS "NDIlib_Recv_Multichannel: ${results}")
+endif()
+
+# Clang writes one raw profile per process, which need to be merged before they can be used
+if(LLVM_PROFDATA)
+    file(GLOB raw_profiles "${PGO_DIR}/*.profraw")
+    if(raw_profiles)
+        execute_process(COMMAND "${LLVM_PROFDATA}" merge -output=${PGO_DIR}/default.profdata ${raw_profiles}
+            RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "Unable to merge the profiles")
+        endif()
+    endif()
+endif()